@@ -308,7 +308,10 @@ class PassesModel(BaseModel):
     string_encrypt: bool = False
     symbol_obfuscate: bool = False
     constant_obfuscate: bool = False
+    constant_encode: bool = False  # Also encode integer constants per function (with constant_obfuscate)
     address_obfuscation: bool = False  # Layer 1.5: Address-level obfuscation
+    address_force_loops: bool = False  # Also mask vectorizable inner loops and estimated-hot blocks
+    function_merge: bool = False
 
 
 class UPXModel(BaseModel):
@@ -323,6 +326,7 @@ class IndirectCallsModel(BaseModel):
     enabled: bool = False
     obfuscate_stdlib: bool = True
     obfuscate_custom: bool = True
+    guarded_fast_path: bool = False
 
 
 class RemarksModel(BaseModel):
@@ -342,6 +346,42 @@ class AntiDebugModel(BaseModel):
             "Linux techniques are auto-mapped to Windows equivalents when targeting Windows platform."
         )
     )
+    overhead_budget_us: int = Field(
+        default=1000, ge=1, description="Anti-debug overhead budget in microseconds per second (mlir-obs runtime)"
+    )
+    proc_cache_ms: int = Field(default=100, ge=0, description="How long a /proc check result is reused (ms)")
+
+
+class SelfChecksumModel(BaseModel):
+    enabled: bool = False
+    mode: str = Field(default="thread", pattern="^(thread|piggyback|eager)$")
+    cpu_budget_permille: int = Field(default=10, ge=1, le=1000, description="Share of one CPU for verification (1/1000)")
+    chunks_per_step: int = Field(default=4, ge=1, le=64)
+
+
+class OverheadPredictionModel(BaseModel):
+    """Static per-function slowdown estimate (TTI cost model, optionally llvm-mca)."""
+    enabled: bool = True
+    mca: bool = False
+    top: int = Field(default=10, ge=1, le=100)
+
+
+class ProfileModel(BaseModel):
+    """Profile-guided tiers (llvm-profdata .profdata or sample .afdo on the server)."""
+    path: Optional[str] = None
+    hot_percent: int = Field(default=90, ge=0, le=100)
+    warm_percent: int = Field(default=99, ge=0, le=100)
+    hot_policy: str = Field(default="none", pattern="^(none|cheap|full)$")
+    warm_policy: str = Field(default="cheap", pattern="^(none|cheap|full)$")
+    benchmark_args: Optional[list[str]] = None
+    benchmark_runs: int = Field(default=5, ge=1, le=50)
+    static_estimate: bool = False
+
+
+class SizeBudgetModel(BaseModel):
+    """Code-size growth cap; the planner decides which transforms run where."""
+    growth_percent: Optional[float] = Field(default=None, ge=0, le=1000)
+    plan_file: Optional[str] = None  # Saved plan to re-apply (path on the server)
 
 
 class VMModel(BaseModel):
@@ -363,6 +403,13 @@ class ConfigModel(BaseModel):
     upx: UPXModel = UPXModel()
     indirect_calls: IndirectCallsModel = IndirectCallsModel()
     anti_debug: AntiDebugModel = AntiDebugModel()
+    self_checksum: SelfChecksumModel = SelfChecksumModel()
+    overhead_prediction: OverheadPredictionModel = OverheadPredictionModel()
+    text_ir: bool = False  # Textual .ll/.mlir between stages instead of bitcode (debugging)
+    per_pass_metrics: bool = True  # IR snapshot after every MLIR/LLVM pass
+    profile: ProfileModel = ProfileModel()
+    policy_file: Optional[str] = None  # "<glob> none|light|max" rules (path on the server)
+    size_budget: SizeBudgetModel = SizeBudgetModel()
     remarks: RemarksModel = RemarksModel()  # Enable remarks by default
     vm: VMModel = VMModel()  # VM virtualization (experimental, disabled by default)
 
@@ -516,6 +563,10 @@ def _build_config_from_request(payload: ObfuscateRequest, destination_dir: Path,
         string_encrypt=payload.config.passes.string_encrypt or payload.config.string_encryption or detected_passes.get("string-encrypt", False),
         symbol_obfuscate=payload.config.passes.symbol_obfuscate or detected_passes.get("symbol-obfuscate", False),
         constant_obfuscate=payload.config.passes.constant_obfuscate or detected_passes.get("constant-obfuscate", False),
+        address_obfuscation=payload.config.passes.address_obfuscation or detected_passes.get("address-obfuscation", False),
+        constant_encode=payload.config.passes.constant_encode,
+        address_force_loops=payload.config.passes.address_force_loops,
+        function_merge=payload.config.passes.function_merge or detected_passes.get("function-merge", False),
     )
     upx_config = UPXConfiguration(
         enabled=payload.config.upx.enabled,
@@ -529,6 +580,7 @@ def _build_config_from_request(payload: ObfuscateRequest, destination_dir: Path,
         enabled=payload.config.indirect_calls.enabled,
         obfuscate_stdlib=payload.config.indirect_calls.obfuscate_stdlib,
         obfuscate_custom=payload.config.indirect_calls.obfuscate_custom,
+        guarded_fast_path=payload.config.indirect_calls.guarded_fast_path,
     )
     # Configure remarks (enabled by default)
     remarks_config = RemarksConfiguration(
@@ -543,6 +595,16 @@ def _build_config_from_request(payload: ObfuscateRequest, destination_dir: Path,
     anti_debug_config = AntiDebugConfiguration(
         enabled=payload.config.anti_debug.enabled,
         techniques=payload.config.anti_debug.techniques,
+        overhead_budget_us=payload.config.anti_debug.overhead_budget_us,
+        proc_cache_ms=payload.config.anti_debug.proc_cache_ms,
+    )
+
+    from core.config import SelfChecksumConfiguration
+    self_checksum_config = SelfChecksumConfiguration(
+        enabled=payload.config.self_checksum.enabled,
+        mode=payload.config.self_checksum.mode,
+        cpu_budget_permille=payload.config.self_checksum.cpu_budget_permille,
+        chunks_per_step=payload.config.self_checksum.chunks_per_step,
     )
     
     advanced = AdvancedConfiguration(
@@ -551,6 +613,7 @@ def _build_config_from_request(payload: ObfuscateRequest, destination_dir: Path,
         indirect_calls=indirect_calls,
         upx_packing=upx_config,
         anti_debug=anti_debug_config,
+        self_checksum=self_checksum_config,
         remarks=remarks_config,
     )
     # Auto-load plugin if passes are requested and no explicit plugin provided
@@ -585,7 +648,18 @@ def _build_config_from_request(payload: ObfuscateRequest, destination_dir: Path,
                                 "anti_debug": {
                                     "enabled": advanced.anti_debug.enabled,
                                     "techniques": advanced.anti_debug.techniques,
+                                    "overhead_budget_us": advanced.anti_debug.overhead_budget_us,
+                                    "proc_cache_ms": advanced.anti_debug.proc_cache_ms,
+                                },
+                                "self_checksum": {
+                                    "enabled": self_checksum_config.enabled,
+                                    "mode": self_checksum_config.mode,
+                                    "cpu_budget_permille": self_checksum_config.cpu_budget_permille,
+                                    "chunks_per_step": self_checksum_config.chunks_per_step,
                                 },
+                                "overhead_prediction": payload.config.overhead_prediction.dict(),
+                                "text_ir": payload.config.text_ir,
+                                "per_pass_metrics": payload.config.per_pass_metrics,
                                 "upx_packing": {
                                     "enabled": upx_config.enabled,
                                     "compression_level": upx_config.compression_level,
@@ -601,6 +675,9 @@ def _build_config_from_request(payload: ObfuscateRequest, destination_dir: Path,
             "custom_pass_plugin": chosen_plugin,
             "entrypoint_command": payload.entrypoint_command,
             "project_root": str(project_root) if project_root else None,
+            "profile": payload.config.profile.dict(),
+            "policy_file": payload.config.policy_file,
+            "size_budget": payload.config.size_budget.dict(),
             "vm": {
                 "enabled": payload.config.vm.enabled,
                 "timeout": payload.config.vm.timeout,
@@ -19,8 +19,9 @@ from core import (
     analyze_binary,
     compare_binaries,
 )
+from core.autotune import Autotuner
 from core.batch import load_batch_config
-from core.config import AdvancedConfiguration, AntiDebugConfiguration, IndirectCallConfiguration, OutputConfiguration, UPXConfiguration
+from core.config import AdvancedConfiguration, AntiDebugConfiguration, AutotuneConfig, IndirectCallConfiguration, OutputConfiguration, OverheadPredictionConfiguration, SizeBudgetConfiguration, UPXConfiguration
 from core.exceptions import ObfuscationError
 from core.jotai_benchmark import JotaiBenchmarkManager, BenchmarkCategory
 from core.utils import create_logger, load_yaml, normalize_flags_and_passes
@@ -343,6 +344,12 @@ def _build_config(
     custom_flags: Optional[str],
     config_file: Optional[Path],
     custom_pass_plugin: Optional[Path],
+    policy_file: Optional[Path] = None,
+    size_budget: Optional[float] = None,
+    size_plan: Optional[Path] = None,
+    overhead_mca: bool = False,
+    text_ir: bool = False,
+    per_pass_metrics: bool = True,
 ) -> ObfuscationConfig:
     if config_file:
         data = load_yaml(config_file)
@@ -385,6 +392,9 @@ def _build_config(
         indirect_calls=indirect_call_config,
         upx_packing=upx_config,
         anti_debug=anti_debug_config,
+        overhead_prediction=OverheadPredictionConfiguration(mca=overhead_mca),
+        text_ir=text_ir,
+        per_pass_metrics=per_pass_metrics,
     )
     output_config = OutputConfiguration(directory=output, report_formats=report_formats.split(","))
     return ObfuscationConfig(
@@ -395,6 +405,8 @@ def _build_config(
         advanced=advanced,
         output=output_config,
         custom_pass_plugin=custom_pass_plugin,
+        policy_file=policy_file,
+        size_budget=SizeBudgetConfiguration(growth_percent=size_budget, plan_file=size_plan),
     )
 
 
@@ -426,6 +438,12 @@ def compile(
     custom_flags: Optional[str] = typer.Option(None, help="Additional compiler flags"),
     config_file: Optional[Path] = typer.Option(None, help="Load configuration from YAML/JSON file"),
     custom_pass_plugin: Optional[Path] = typer.Option(None, help="Path to custom LLVM pass plugin"),
+    policy_file: Optional[Path] = typer.Option(None, "--policy-file", help="Per-function policies: '<glob> none|light|max' per line"),
+    size_budget: Optional[float] = typer.Option(None, "--size-budget", help="Max estimated code growth in percent; transforms are planned per function to fit"),
+    size_plan: Optional[Path] = typer.Option(None, "--size-plan", help="Re-apply a size plan saved by an earlier run"),
+    overhead_mca: bool = typer.Option(False, "--overhead-mca", help="Also run llvm-mca on the hottest block of the most slowed-down functions"),
+    text_ir: bool = typer.Option(False, "--text-ir", help="Pass textual .ll/.mlir between pipeline stages instead of bitcode (debugging)"),
+    per_pass_metrics: bool = typer.Option(True, "--per-pass-metrics/--no-per-pass-metrics", help="Record IR metrics after every MLIR and LLVM pass"),
 ):
     """Compile and obfuscate a source file."""
     try:
@@ -456,6 +474,12 @@ def compile(
             custom_flags=custom_flags,
             config_file=config_file,
             custom_pass_plugin=custom_pass_plugin,
+            policy_file=policy_file,
+            size_budget=size_budget,
+            size_plan=size_plan,
+            overhead_mca=overhead_mca,
+            text_ir=text_ir,
+            per_pass_metrics=per_pass_metrics,
         )
         reporter = ObfuscationReport(config.output.directory)
         obfuscator = LLVMObfuscator(reporter=reporter)
@@ -510,6 +534,49 @@ def batch(
             logger.error("Batch job failed for %s: %s", source, exc)
 
 
+@app.command()
+def autotune(
+    input_file: Path = typer.Argument(..., help="C/C++ source file to tune"),
+    benchmark: str = typer.Option("", "--benchmark", help="Benchmark command, {binary} is the binary under test (default: run it without arguments)"),
+    max_overhead: float = typer.Option(8.0, "--max-overhead", help="Runtime overhead budget in percent"),
+    candidates: int = typer.Option(16, min=1, help="Configurations to sample"),
+    runs: int = typer.Option(3, min=1, help="Benchmark runs per candidate in the first rung"),
+    jobs: int = typer.Option(0, min=0, help="Parallel builds (0 = one per CPU)"),
+    seed: int = typer.Option(0, help="Sampling seed"),
+    config_file: Optional[Path] = typer.Option(None, help="Base configuration (YAML/JSON) the search starts from"),
+    output: Path = typer.Option(Path("./autotune"), help="Output directory"),
+):
+    """Search pass configurations for the most protection within a runtime overhead budget."""
+    base = {}
+    if config_file:
+        data = load_yaml(config_file) or {}
+        base = data.get("obfuscation", data)
+    tuner = Autotuner(AutotuneConfig(
+        source=input_file,
+        benchmark_command=benchmark,
+        overhead_budget_percent=max_overhead,
+        candidates=candidates,
+        runs=runs,
+        jobs=jobs,
+        seed=seed,
+        base=base,
+        output=output,
+    ))
+    try:
+        results = tuner.run()
+    except ObfuscationError as exc:
+        logger.error("Autotune failed: %s", exc)
+        raise typer.Exit(code=1)
+    by_id = {c["id"]: c for c in results["candidates"]}
+    for candidate_id in results["pareto_front"]:
+        c = by_id[candidate_id]
+        typer.echo(f"c{candidate_id:03d}: protection {c['protection_index']}, overhead {c['overhead_percent']}%")
+    if results["config_file"] is None:
+        typer.echo(f"No candidate within {max_overhead}% overhead")
+        raise typer.Exit(code=1)
+    typer.echo(f"Best: c{results['best']:03d} -> {results['config_file']}")
+
+
 @app.command()
 def jotai(
     output: Path = typer.Option(Path("./jotai_results"), help="Output directory for benchmark results"),
@@ -523,6 +590,9 @@ def jotai(
     string_encryption: bool = typer.Option(False, "--string-encryption", help="Enable string encryption (MLIR pass)"),
     custom_flags: Optional[str] = typer.Option(None, help="Additional compiler flags"),
     custom_pass_plugin: Optional[Path] = typer.Option(None, help="Path to custom LLVM pass plugin"),
+    policy_file: Optional[Path] = typer.Option(None, "--policy-file", help="Per-function policies: '<glob> none|light|max' per line"),
+    size_budget: Optional[float] = typer.Option(None, "--size-budget", help="Max estimated code growth in percent; transforms are planned per function to fit"),
+    size_plan: Optional[Path] = typer.Option(None, "--size-plan", help="Re-apply a size plan saved by an earlier run"),
     max_failures: int = typer.Option(5, help="Stop after this many consecutive failures"),
     cache_dir: Optional[Path] = typer.Option(None, help="Directory to cache Jotai benchmarks"),
 ):
@@ -570,6 +640,9 @@ def jotai(
             custom_flags=custom_flags,
             config_file=None,
             custom_pass_plugin=custom_pass_plugin,
+            policy_file=policy_file,
+            size_budget=size_budget,
+            size_plan=size_plan,
         )
         
         # Initialize obfuscator
@@ -0,0 +1,266 @@
+"""Search obfuscation configurations for the most protection under a runtime overhead budget."""
+
+from __future__ import annotations
+
+import copy
+import json
+import math
+import random
+import shlex
+import subprocess
+import time
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+from .config import AutotuneConfig, ObfuscationConfig
+from .exceptions import ObfuscationError
+from .utils import create_logger, dump_yaml, ensure_directory, write_json
+
+
+def _build_candidate(source: str, config_data: Dict, directory: str) -> Dict:
+    """Build one candidate in a worker process; the obfuscator is not shared between builds."""
+    from .obfuscator import LLVMObfuscator
+
+    data = copy.deepcopy(config_data)
+    data.setdefault("output", {})["directory"] = directory
+    try:
+        result = LLVMObfuscator().obfuscate(Path(source), ObfuscationConfig.from_dict(data))
+    except Exception as exc:  # noqa: BLE001 - a failed candidate must not stop the search
+        return {"error": str(exc)}
+    return {
+        "protection": result.get("overall_protection_index", 0.0),
+        "binary": result["obfuscated_binary"],
+        "baseline": result["baseline_binary"],
+    }
+
+
+def _set_path(data: Dict, dotted: str, value) -> None:
+    keys = dotted.split(".")
+    for key in keys[:-1]:
+        data = data.setdefault(key, {})
+    data[keys[-1]] = value
+
+
+@dataclass
+class Candidate:
+    id: int
+    settings: Dict[str, object]
+    protection: float = 0.0
+    binary: Optional[Path] = None
+    baseline: Optional[Path] = None
+    error: Optional[str] = None
+    runs: int = 0
+    runtime_ms: Optional[float] = None
+    overhead_percent: Optional[float] = None
+    rung: int = 0
+    times_ms: List[float] = field(default_factory=list)
+
+    @property
+    def measured(self) -> bool:
+        return self.error is None and self.overhead_percent is not None
+
+    def to_dict(self) -> Dict:
+        return {
+            "id": self.id,
+            "settings": self.settings,
+            "status": "failed" if self.error else "success",
+            "error": self.error,
+            "protection_index": self.protection,
+            "runs": self.runs,
+            "rung": self.rung,
+            "runtime_ms": round(self.runtime_ms, 3) if self.runtime_ms is not None else None,
+            "overhead_percent": round(self.overhead_percent, 2) if self.overhead_percent is not None else None,
+        }
+
+
+class Autotuner:
+    """
+    Samples pass subsets, cycles and per-function tier policies on top of a
+    base configuration, builds the candidates in parallel and ranks them by
+    successive halving: every rung times the survivors with twice as many
+    runs as the last one (interleaved with the baseline, so drift hits both
+    alike) and keeps the best 1/eta. Candidates within the overhead budget
+    rank by overall_protection_index, the rest by overhead.
+    """
+
+    PASSES = (
+        "flattening", "substitution", "bogus_control_flow", "split", "linear_mba",
+        "string_encrypt", "symbol_obfuscate", "constant_obfuscate", "address_obfuscation", "function_merge",
+    )
+    CHOICES: Dict[str, Tuple] = {
+        "advanced.cycles": (1, 2, 3),
+        "advanced.fake_loops": (0, 4, 16),
+        "advanced.indirect_calls.enabled": (False, True),
+        "profile.hot_policy": ("none", "cheap", "full"),
+        "profile.warm_policy": ("cheap", "full"),
+    }
+
+    def __init__(self, config: AutotuneConfig) -> None:
+        self.config = config
+        self.logger = create_logger(__name__)
+        self.rng = random.Random(config.seed)
+
+    def sample(self) -> List[Candidate]:
+        """The base configuration first, then distinct random settings."""
+        base = self.config.base
+        profiled = bool((base.get("profile") or {}).get("path"))
+        candidates = [Candidate(0, {})]
+        seen = set()
+        attempts = 0
+        while len(candidates) < self.config.candidates and attempts < self.config.candidates * 50:
+            attempts += 1
+            settings: Dict[str, object] = {f"passes.{name}": self.rng.random() < 0.5 for name in self.PASSES}
+            for key, choices in self.CHOICES.items():
+                settings[key] = self.rng.choice(choices)
+            if not profiled:
+                settings["profile.static_estimate"] = True
+            key = json.dumps(settings, sort_keys=True)
+            if key not in seen:
+                seen.add(key)
+                candidates.append(Candidate(len(candidates), settings))
+        return candidates
+
+    def config_data(self, candidate: Candidate) -> Dict:
+        data = copy.deepcopy(self.config.base)
+        for key, value in candidate.settings.items():
+            _set_path(data, key, value)
+        return data
+
+    def build(self, candidates: List[Candidate]) -> None:
+        builds = self.config.output / "candidates"
+        with ProcessPoolExecutor(max_workers=self.config.jobs or None) as pool:
+            futures = {}
+            for candidate in candidates:
+                data = self.config_data(candidate)
+                # Builds run in parallel; timing them there would only measure contention
+                _set_path(data, "profile.benchmark_args", None)
+                futures[candidate.id] = pool.submit(
+                    _build_candidate, str(self.config.source), data, str(builds / f"c{candidate.id:03d}"))
+            for candidate in candidates:
+                result = futures[candidate.id].result()
+                candidate.error = result.get("error")
+                if candidate.error is None:
+                    candidate.protection = float(result["protection"])
+                    candidate.binary = Path(result["binary"])
+                    candidate.baseline = Path(result["baseline"])
+                else:
+                    self.logger.warning("Candidate %d failed to build: %s", candidate.id, candidate.error)
+
+    def command(self, binary: Path) -> List[str]:
+        """`{binary}` in the benchmark command is the binary under test; without it, the command is its arguments."""
+        template = self.config.benchmark_command
+        if "{binary}" in template:
+            return [arg.replace("{binary}", str(binary)) for arg in shlex.split(template)]
+        return [str(binary)] + shlex.split(template)
+
+    def run_once(self, binary: Path) -> Tuple[Optional[float], Optional[int]]:
+        start = time.perf_counter()
+        try:
+            result = subprocess.run(self.command(binary), stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                                    timeout=300, check=False)
+        except (OSError, subprocess.TimeoutExpired) as exc:
+            self.logger.warning("Benchmark of %s failed: %s", binary, exc)
+            return None, None
+        return (time.perf_counter() - start) * 1000.0, result.returncode
+
+    def measure(self, baseline: Path, candidates: List[Candidate], runs: int) -> float:
+        """Median time of each candidate and of the baseline over `runs` interleaved rounds."""
+        baseline_times = []
+        for candidate in candidates:
+            candidate.times_ms = []
+        for _ in range(runs):
+            elapsed, baseline_code = self.run_once(baseline)
+            if elapsed is None:
+                raise ObfuscationError(f"Benchmark command fails on the baseline binary {baseline}")
+            baseline_times.append(elapsed)
+            for candidate in candidates:
+                if candidate.error:
+                    continue
+                elapsed, code = self.run_once(candidate.binary)
+                if elapsed is None or code != baseline_code:
+                    candidate.error = f"benchmark exited with {code}, baseline with {baseline_code}"
+                    continue
+                candidate.times_ms.append(elapsed)
+        baseline_ms = self._median(baseline_times)
+        for candidate in candidates:
+            if candidate.error:
+                continue
+            candidate.runs = runs
+            candidate.runtime_ms = self._median(candidate.times_ms)
+            candidate.overhead_percent = 100.0 * (candidate.runtime_ms - baseline_ms) / baseline_ms if baseline_ms else 0.0
+        return baseline_ms
+
+    def rank_key(self, candidate: Candidate) -> Tuple:
+        within = candidate.overhead_percent <= self.config.overhead_budget_percent
+        if within:
+            return (0, -candidate.protection, candidate.overhead_percent, candidate.id)
+        return (1, candidate.overhead_percent, -candidate.protection, candidate.id)
+
+    @staticmethod
+    def pareto_front(candidates: List[Candidate]) -> List[Candidate]:
+        """Measured candidates no other one beats on both protection and overhead."""
+        measured = [c for c in candidates if c.measured]
+        front = [
+            c for c in measured
+            if not any(
+                o.protection >= c.protection and o.overhead_percent <= c.overhead_percent
+                and (o.protection > c.protection or o.overhead_percent < c.overhead_percent)
+                for o in measured
+            )
+        ]
+        return sorted(front, key=lambda c: (c.overhead_percent, -c.protection))
+
+    def run(self) -> Dict:
+        ensure_directory(self.config.output)
+        candidates = self.sample()
+        self.logger.info("Building %d candidates", len(candidates))
+        self.build(candidates)
+        built = [c for c in candidates if c.error is None]
+        if not built:
+            raise ObfuscationError("No autotune candidate built")
+        baseline = built[0].baseline
+
+        eta = max(2, self.config.eta)
+        survivors, runs, rung, baseline_ms = built, max(1, self.config.runs), 0, 0.0
+        while True:
+            self.logger.info("Rung %d: timing %d candidates x %d runs", rung, len(survivors), runs)
+            baseline_ms = self.measure(baseline, survivors, runs)
+            for candidate in survivors:
+                candidate.rung = rung
+            survivors = sorted((c for c in survivors if c.measured), key=self.rank_key)
+            if len(survivors) <= eta:
+                break
+            survivors = survivors[:math.ceil(len(survivors) / eta)]
+            runs, rung = runs * 2, rung + 1
+
+        within = [c for c in candidates if c.measured and c.overhead_percent <= self.config.overhead_budget_percent]
+        best = max(within, key=lambda c: (c.rung, c.protection, -c.overhead_percent, -c.id), default=None)
+        front = self.pareto_front(candidates)
+
+        config_file = None
+        if best is not None:
+            config_file = self.config.output / "obfuscation.yaml"
+            data = self.config_data(best)
+            data.setdefault("output", {})["directory"] = "./obfuscated"
+            dump_yaml(config_file, {"obfuscation": data})
+
+        results = {
+            "source": str(self.config.source),
+            "benchmark_command": self.config.benchmark_command,
+            "overhead_budget_percent": self.config.overhead_budget_percent,
+            "seed": self.config.seed,
+            "baseline_ms": round(baseline_ms, 3),
+            "best": best.id if best else None,
+            "config_file": str(config_file) if config_file else None,
+            "pareto_front": [c.id for c in front],
+            "candidates": [c.to_dict() for c in candidates],
+        }
+        write_json(self.config.output / "autotune.json", results)
+        return results
+
+    @staticmethod
+    def _median(values: List[float]) -> float:
+        ordered = sorted(values)
+        return ordered[len(ordered) // 2]
@@ -55,9 +55,11 @@ class MLIRFrontend(str, Enum):
 
     CLANG: Default - Current working pipeline (C/C++ → Clang → LLVM IR → MLIR)
     CLANGIR: New - ClangIR frontend (C/C++ → ClangIR → High-level MLIR) [LLVM 22 native]
+    POLYGEIST: Polygeist frontend (C/C++ → affine/SCF MLIR), two-stage: loop optimization, then obfuscation
     """
     CLANG = "clang"          # DEFAULT - existing pipeline (SAFE)
     CLANGIR = "clangir"      # NEW - ClangIR frontend (LLVM 22 compatible)
+    POLYGEIST = "polygeist"  # Polygeist frontend (affine loop nests optimized before obfuscation)
 
     @classmethod
     def from_string(cls, value: str) -> "MLIRFrontend":
@@ -65,7 +67,7 @@ class MLIRFrontend(str, Enum):
         try:
             return cls(normalized)
         except ValueError as exc:
-            raise ValueError(f"Unsupported MLIR frontend: {value}. Use 'clang' or 'clangir'.") from exc
+            raise ValueError(f"Unsupported MLIR frontend: {value}. Use 'clang', 'clangir' or 'polygeist'.") from exc
 
 
 class ObfuscationLevel(int, Enum):
@@ -100,7 +102,10 @@ class PassConfiguration:
     string_encrypt: bool = False
     symbol_obfuscate: bool = False
     constant_obfuscate: bool = False
+    constant_encode: bool = False  # Also encode integer constants per function (with constant_obfuscate)
     address_obfuscation: bool = False  # Layer 1.5: Address-level obfuscation
+    address_force_loops: bool = False  # Also mask vectorizable inner loops and estimated-hot blocks
+    function_merge: bool = False  # Merge similar functions behind selector thunks (also shrinks .text)
     crypto_hash: Optional[CryptoHashConfiguration] = None
 
     def enabled_passes(self) -> List[str]:
@@ -114,6 +119,7 @@ class PassConfiguration:
             "symbol-obfuscate": self.symbol_obfuscate,
             "constant-obfuscate": self.constant_obfuscate,
             "address-obfuscation": self.address_obfuscation,
+            "function-merge": self.function_merge,
         }
         passes = [name for name, enabled in mapping.items() if enabled]
 
@@ -128,6 +134,8 @@ class IndirectCallConfiguration:
     enabled: bool = False
     obfuscate_stdlib: bool = True
     obfuscate_custom: bool = True
+    # IR-level pass only: keep `fp == @f ? call @f : call fp` so PGO ICP can still inline
+    guarded_fast_path: bool = False
 
 
 @dataclass
@@ -156,6 +164,58 @@ class AntiDebugConfiguration:
     #                     nt_query_info, hardware_breakpoints, timing, output_debug_string
     # Note: Linux techniques are auto-mapped to Windows equivalents when targeting Windows platform
     techniques: List[str] = field(default_factory=lambda: ["ptrace", "proc_status"])
+    # mlir-obs anti-debug runtime: checks are sampled so they cost at most this
+    # many microseconds per second per thread; /proc results are reused for
+    # proc_cache_ms
+    overhead_budget_us: int = 1000
+    proc_cache_ms: int = 100
+
+@dataclass
+class SelfChecksumConfiguration:
+    """Incremental CRC32C verification of .text/.rodata (mlir-obs runtime, Linux only)."""
+    enabled: bool = False
+    # thread: background thread; piggyback: on anti-debug samples (needs the
+    # anti-debug pass, falls back to thread); eager: everything at startup
+    mode: str = "thread"
+    cpu_budget_permille: int = 10  # share of one CPU for the background thread
+    chunks_per_step: int = 4
+
+@dataclass
+class OverheadPredictionConfiguration:
+    """Static per-function slowdown estimate from TTI costs and block frequencies (no run needed)."""
+    enabled: bool = True
+    mca: bool = False  # Also schedule each function's hottest block with llvm-mca
+    top: int = 10  # Functions shown in the markdown table and analysed with llvm-mca
+
+@dataclass
+class ProfileConfiguration:
+    """Profile-guided tiers: hot code gets little or no obfuscation, cold code all of it."""
+    path: Optional[Path] = None  # .profdata (llvm-profdata merge) or .afdo/.prof (sample profile)
+    # Functions covering hot_percent of profiled counts are hot, up to warm_percent warm
+    hot_percent: int = 90
+    warm_percent: int = 99
+    # Transforms allowed per tier: none, cheap or full (cold is always full)
+    hot_policy: str = "none"
+    warm_policy: str = "cheap"
+    # When set, baseline and obfuscated binaries are run with these arguments
+    # and the median wall time is reported
+    benchmark_args: Optional[List[str]] = None
+    benchmark_runs: int = 5
+    # Without a profile, tier functions from mlir-obs' static hotness estimate
+    static_estimate: bool = False
+
+
+@dataclass
+class SizeBudgetConfiguration:
+    """Code-size growth cap: the planner picks transforms per function to fit it."""
+    growth_percent: Optional[float] = None  # Max estimated .text growth over the unobfuscated module
+    # Re-apply a plan saved by an earlier run (<output>/<name>_size_plan.json) instead of planning
+    plan_file: Optional[Path] = None
+
+    @property
+    def enabled(self) -> bool:
+        return self.growth_percent is not None or self.plan_file is not None
+
 
 @dataclass
 class AdvancedConfiguration:
@@ -165,11 +225,16 @@ class AdvancedConfiguration:
     remarks: RemarksConfiguration = field(default_factory=RemarksConfiguration)
     upx_packing: UPXConfiguration = field(default_factory=UPXConfiguration)
     anti_debug: AntiDebugConfiguration = field(default_factory=AntiDebugConfiguration)
+    self_checksum: SelfChecksumConfiguration = field(default_factory=SelfChecksumConfiguration)
+    overhead_prediction: OverheadPredictionConfiguration = field(default_factory=OverheadPredictionConfiguration)
     # ✅ NEW: IR and advanced metrics analysis options
     preserve_ir: bool = True  # Keep IR files after compilation for analysis
+    text_ir: bool = False  # Exchange textual .ll/.mlir between stages instead of bitcode (debugging)
     ir_metrics_enabled: bool = True  # Extract CFG and instruction metrics
-    per_pass_metrics: bool = False  # Analyze IR after each pass (expensive)
+    per_pass_metrics: bool = True  # IR snapshot after every MLIR/LLVM pass, taken in-process by pass instrumentation
     binary_analysis_extended: bool = True  # Extended binary structure analysis
+    # Curated post-obfuscation opt pipeline; final clang then only does codegen
+    recovery_pipeline: bool = True
 
 @dataclass
 class OutputConfiguration:
@@ -191,6 +256,10 @@ class ObfuscationConfig:
     custom_compiler_wrapper: Optional[str] = None  # Path to compiler wrapper (obf-clang) for transparent build interception
     mlir_frontend: MLIRFrontend = MLIRFrontend.CLANG  # DEFAULT to existing pipeline (SAFE)
     vm: VMConfig = field(default_factory=VMConfig)  # VM obfuscation (optional, isolated)
+    profile: ProfileConfiguration = field(default_factory=ProfileConfiguration)
+    # "<glob> none|light|max" per line; obf:<policy> annotations take precedence
+    policy_file: Optional[Path] = None
+    size_budget: SizeBudgetConfiguration = field(default_factory=SizeBudgetConfiguration)
 
     @classmethod
     def from_dict(cls, data: Dict) -> "ObfuscationConfig":
@@ -229,6 +298,10 @@ class ObfuscationConfig:
             string_encrypt=passes_data.get("string_encrypt", False),
             symbol_obfuscate=symbol_obfuscate_enabled,
             constant_obfuscate=passes_data.get("constant_obfuscate", False),
+            constant_encode=passes_data.get("constant_encode", False),
+            address_obfuscation=passes_data.get("address_obfuscation", False),
+            address_force_loops=passes_data.get("address_force_loops", False),
+            function_merge=passes_data.get("function_merge", False),
             crypto_hash=crypto_hash,
         )
         adv_data = data.get("advanced", {})
@@ -239,6 +312,7 @@ class ObfuscationConfig:
             enabled=indirect_data.get("enabled", False),
             obfuscate_stdlib=indirect_data.get("obfuscate_stdlib", True),
             obfuscate_custom=indirect_data.get("obfuscate_custom", True),
+            guarded_fast_path=indirect_data.get("guarded_fast_path", False),
         )
 
         remarks_data = adv_data.get("remarks", {})
@@ -265,6 +339,21 @@ class ObfuscationConfig:
         anti_debug_config = AntiDebugConfiguration(
             enabled=anti_debug_data.get("enabled", False),
             techniques=anti_debug_data.get("techniques", ["ptrace", "proc_status"]),
+            overhead_budget_us=anti_debug_data.get("overhead_budget_us", 1000),
+            proc_cache_ms=anti_debug_data.get("proc_cache_ms", 100),
+        )
+        self_checksum_data = adv_data.get("self_checksum", {})
+        self_checksum_config = SelfChecksumConfiguration(
+            enabled=self_checksum_data.get("enabled", False),
+            mode=self_checksum_data.get("mode", "thread"),
+            cpu_budget_permille=self_checksum_data.get("cpu_budget_permille", 10),
+            chunks_per_step=self_checksum_data.get("chunks_per_step", 4),
+        )
+        prediction_data = adv_data.get("overhead_prediction", {})
+        prediction_config = OverheadPredictionConfiguration(
+            enabled=prediction_data.get("enabled", True),
+            mca=prediction_data.get("mca", False),
+            top=prediction_data.get("top", 10),
         )
         advanced = AdvancedConfiguration(
             cycles=adv_data.get("cycles", 1),
@@ -273,6 +362,11 @@ class ObfuscationConfig:
             remarks=remarks_config,
             upx_packing=upx_config,
             anti_debug=anti_debug_config,
+            self_checksum=self_checksum_config,
+            overhead_prediction=prediction_config,
+            recovery_pipeline=adv_data.get("recovery_pipeline", True),
+            text_ir=adv_data.get("text_ir", False),
+            per_pass_metrics=adv_data.get("per_pass_metrics", True),
         )
         output_data = data.get("output", {})
         output = OutputConfiguration(
@@ -302,6 +396,27 @@ class ObfuscationConfig:
             fallback_on_error=vm_data.get("fallback_on_error", True),
         )
 
+        profile_data = data.get("profile", {})
+        profile_path = profile_data.get("path")
+        profile_config = ProfileConfiguration(
+            path=Path(profile_path) if profile_path else None,
+            hot_percent=profile_data.get("hot_percent", 90),
+            warm_percent=profile_data.get("warm_percent", 99),
+            hot_policy=profile_data.get("hot_policy", "none"),
+            warm_policy=profile_data.get("warm_policy", "cheap"),
+            benchmark_args=profile_data.get("benchmark_args"),
+            benchmark_runs=profile_data.get("benchmark_runs", 5),
+            static_estimate=profile_data.get("static_estimate", False),
+        )
+        policy_file = data.get("policy_file")
+
+        size_budget_data = data.get("size_budget") or {}
+        size_plan = size_budget_data.get("plan_file")
+        size_budget_config = SizeBudgetConfiguration(
+            growth_percent=size_budget_data.get("growth_percent"),
+            plan_file=Path(size_plan) if size_plan else None,
+        )
+
         return cls(
             level=level,
             platform=platform,
@@ -316,6 +431,9 @@ class ObfuscationConfig:
             custom_compiler_wrapper=custom_compiler_wrapper,
             mlir_frontend=mlir_frontend,
             vm=vm_config,
+            profile=profile_config,
+            policy_file=Path(policy_file) if policy_file else None,
+            size_budget=size_budget_config,
         )
 
 
@@ -329,4 +447,20 @@ class AnalyzeConfig:
 class CompareConfig:
     original_binary: Path
     obfuscated_binary: Path
-    output: Optional[Path] = None
\ No newline at end of file
+    output: Optional[Path] = None
+
+@dataclass
+class AutotuneConfig:
+    source: Path
+    # Run per measurement; {binary} is replaced by the binary under test,
+    # otherwise the command is passed to the binary as arguments
+    benchmark_command: str = ""
+    overhead_budget_percent: float = 8.0
+    candidates: int = 16
+    runs: int = 3  # Runs per candidate in the first rung, doubled every rung
+    eta: int = 2  # Successive halving keeps the best 1/eta of each rung
+    jobs: int = 0  # Parallel builds, 0 = one per CPU
+    seed: int = 0
+    # ObfuscationConfig.from_dict data the candidates are overlaid on
+    base: Dict = field(default_factory=dict)
+    output: Path = Path("./autotune")
@@ -0,0 +1,135 @@
+"""Per-function obfuscation policy for textual LLVM IR (mirrors mlir-obs function-policy)."""
+
+from __future__ import annotations
+
+import fnmatch
+import re
+import shutil
+import subprocess
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+from .exceptions import ObfuscationError
+from .utils import create_logger
+
+_DEFINE = re.compile(r'^define\b[^@]*@("?)([^"(]+)\1\(', re.MULTILINE)
+_ANNOTATION = re.compile(r'\{\s*ptr\s+@("?)([^",]+)\1,\s*ptr\s+@("?)([^",]+)\3,')
+_STRING = re.compile(r'^@("?)([^"=\s]+)\1 = [^\n]*\bc"((?:[^"\\]|\\[0-9A-Fa-f]{2}|\\\\)*)"', re.MULTILINE)
+
+
+def function_string_attributes(ir_text: str, key: str) -> Dict[str, str]:
+    """
+    Value of the `"key"="value"` function attribute per defined function.
+    mlir-obs passes record per-function decisions this way (passthrough),
+    so they still apply after symbol-obfuscate renamed the function.
+    """
+    group_pattern = re.compile(r'^attributes #(\d+) = \{[^\n]*"' + re.escape(key) + r'"="([^"]*)"', re.MULTILINE)
+    groups = {match.group(1): match.group(2) for match in group_pattern.finditer(ir_text)}
+    if not groups:
+        return {}
+    values: Dict[str, str] = {}
+    for match in _DEFINE.finditer(ir_text):
+        line_end = ir_text.find("\n", match.end())
+        tail = ir_text[match.end():line_end if line_end >= 0 else len(ir_text)]
+        for group in re.findall(r'#(\d+)', tail):
+            if group in groups:
+                values[match.group(2)] = groups[group]
+    return values
+
+
+class FunctionPolicy:
+    """
+    Resolves `none`, `light` or `max` per function: an
+    `__attribute__((annotate("obf:<policy>")))` on the definition wins,
+    otherwise the first policy-file rule whose glob matches the mangled or
+    demangled name. Same rules as the mlir-obs function-policy pass, so the
+    OLLVM stage honors what the MLIR passes saw; IR that went through that
+    pass carries its result as an "obf-policy" function attribute, which
+    still holds after symbol-obfuscate renamed the function.
+    """
+
+    POLICIES = ("none", "light", "max")
+    PREFIX = "obf:"
+    # Per-function transform limit (ProfileTiers.POLICIES) of each policy
+    LIMITS = {"none": "none", "light": "cheap", "max": "full"}
+
+    def __init__(self, rules: Optional[List[Tuple[str, str]]] = None) -> None:
+        self.rules = rules or []
+        self.logger = create_logger(__name__)
+
+    @classmethod
+    def from_file(cls, path: Path) -> "FunctionPolicy":
+        """`<glob> <policy>` per line, `#` starts a comment."""
+        rules = []
+        for number, raw in enumerate(path.read_text().splitlines(), start=1):
+            line = raw.split("#", 1)[0].strip()
+            if not line:
+                continue
+            parts = line.split()
+            if len(parts) != 2 or parts[1] not in cls.POLICIES:
+                raise ObfuscationError(f"{path}:{number}: expected '<glob> none|light|max'")
+            rules.append((parts[0], parts[1]))
+        return cls(rules)
+
+    def annotations(self, ir_text: str) -> Dict[str, str]:
+        """Policy per function from `obf:` entries of @llvm.global.annotations."""
+        annotations_line = next(
+            (line for line in ir_text.splitlines() if line.startswith("@llvm.global.annotations")), None
+        )
+        if annotations_line is None:
+            return {}
+        strings = {match.group(2): self._unescape(match.group(3)) for match in _STRING.finditer(ir_text)}
+
+        policies: Dict[str, str] = {}
+        for match in _ANNOTATION.finditer(annotations_line):
+            text = strings.get(match.group(4), "").split("\0", 1)[0]
+            if not text.startswith(self.PREFIX):
+                continue
+            policy = text[len(self.PREFIX):]
+            if policy not in self.POLICIES:
+                self.logger.warning("Ignoring unknown policy '%s' on %s", policy, match.group(2))
+                continue
+            policies[match.group(2)] = policy
+        return policies
+
+    def recorded(self, ir_text: str) -> Dict[str, str]:
+        """Policy per function from the "obf-policy" attribute function-policy sets."""
+        return {
+            name: policy
+            for name, policy in function_string_attributes(ir_text, "obf-policy").items()
+            if policy in self.POLICIES
+        }
+
+    def resolve(self, ir_text: str) -> Dict[str, str]:
+        """Policy per defined function that has one."""
+        policies = self.recorded(ir_text)
+        policies.update(self.annotations(ir_text))
+        if self.rules:
+            names = [match.group(2) for match in _DEFINE.finditer(ir_text) if match.group(2) not in policies]
+            for name, demangled in zip(names, self._demangle(names)):
+                for pattern, policy in self.rules:
+                    if fnmatch.fnmatchcase(name, pattern) or fnmatch.fnmatchcase(demangled, pattern):
+                        policies[name] = policy
+                        break
+        return policies
+
+    def summary(self, policies: Dict[str, str]) -> Dict[str, int]:
+        return {policy: sum(1 for p in policies.values() if p == policy) for policy in self.POLICIES}
+
+    @staticmethod
+    def _unescape(text: str) -> str:
+        return re.sub(r'\\([0-9A-Fa-f]{2})', lambda m: chr(int(m.group(1), 16)), text).replace("\\\\", "\\")
+
+    @staticmethod
+    def _demangle(names: List[str]) -> List[str]:
+        """Batch demangle with llvm-cxxfilt/c++filt; names unchanged when neither is installed."""
+        tool = shutil.which("llvm-cxxfilt") or shutil.which("c++filt")
+        if not tool or not names:
+            return list(names)
+        try:
+            result = subprocess.run([tool], input="\n".join(names), capture_output=True, text=True,
+                                    timeout=30, check=True)
+        except (OSError, subprocess.SubprocessError):
+            return list(names)
+        demangled = result.stdout.splitlines()
+        return demangled if len(demangled) == len(names) else list(names)
@@ -5,6 +5,7 @@ Extracts control flow and instruction-level metrics from LLVM IR files.
 
 import re
 import logging
+import shutil
 from pathlib import Path
 from typing import Dict, List, Optional, Tuple
 from .utils import run_command
@@ -25,6 +26,8 @@ class IRAnalyzer:
         self.opt_binary = opt_binary
         self.llvm_dis_binary = llvm_dis_binary
         self.logger = logging.getLogger(__name__)
+        # Last disassembly, keyed by (path, mtime, size): several analyses read the same bitcode
+        self._text_cache: Optional[Tuple[Tuple[str, int, int], str]] = None
 
     def analyze_control_flow(self, ir_file: Path) -> Dict:
         """Extract CFG metrics from LLVM IR.
@@ -170,12 +173,49 @@ class IRAnalyzer:
 
     # ========== PRIVATE HELPER METHODS ==========
 
+    def ir_text(self, ir_file: Path) -> Optional[str]:
+        """LLVM IR of a .ll or .bc file as text (None if it cannot be read)."""
+        return self._get_ir_text(ir_file)
+
+    def write_ir_text(self, ir_file: Path, ir_text: str) -> bool:
+        """Write text IR back to a .ll file, or assemble it into a .bc file with llvm-as."""
+        if ir_file.suffix != ".bc":
+            ir_file.write_text(ir_text)
+            return True
+        llvm_as = self._tool("llvm-as")
+        if llvm_as is None:
+            self.logger.warning(f"llvm-as not found; {ir_file.name} left unchanged")
+            return False
+        text_file = ir_file.with_suffix(".tmp.ll")
+        try:
+            text_file.write_text(ir_text)
+            returncode, _, stderr = run_command([llvm_as, str(text_file), "-o", str(ir_file)])
+        except Exception as e:
+            self.logger.warning(f"llvm-as failed for {ir_file}: {e}")
+            return False
+        finally:
+            text_file.unlink(missing_ok=True)
+        return returncode == 0
+
+    def _tool(self, name: str) -> Optional[str]:
+        """LLVM tool next to the configured llvm-dis (or the Docker backup), else from PATH."""
+        for directory in (self.llvm_dis_binary.parent, Path("/app/plugins/linux-x86_64")):
+            if (directory / name).exists():
+                return str(directory / name)
+        return shutil.which(name)
+
     def _get_ir_text(self, ir_file: Path) -> Optional[str]:
         """Get LLVM IR as text, converting from bitcode if needed."""
         try:
             if ir_file.suffix == ".bc":
                 # Convert bitcode to text using llvm-dis
-                return self._bitcode_to_text(ir_file)
+                stat = ir_file.stat()
+                key = (str(ir_file.resolve()), stat.st_mtime_ns, stat.st_size)
+                if self._text_cache is not None and self._text_cache[0] == key:
+                    return self._text_cache[1]
+                text = self._bitcode_to_text(ir_file)
+                self._text_cache = (key, text) if text is not None else None
+                return text
             elif ir_file.suffix == ".ll":
                 # Already text format
                 return ir_file.read_text(errors='ignore')
@@ -190,13 +230,14 @@ class IRAnalyzer:
         """Convert LLVM bitcode to text IR using llvm-dis."""
         try:
             # Use the configured llvm-dis path (passed from obfuscator/server initialization)
-            if not self.llvm_dis_binary.exists():
+            llvm_dis = self._tool("llvm-dis")
+            if llvm_dis is None:
                 self.logger.error(f"llvm-dis not found at {self.llvm_dis_binary}")
                 return None
 
             # Use llvm-dis to convert
             returncode, stdout, stderr = run_command(
-                [str(self.llvm_dis_binary), str(bc_file), "-o", "-"]
+                [llvm_dis, str(bc_file), "-o", "-"]
             )
             if returncode == 0:
                 return stdout
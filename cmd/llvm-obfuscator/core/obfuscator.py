@@ -1,18 +1,27 @@
 from __future__ import annotations
 
+import json
 import logging
 import os
 import re
+import subprocess
+import sys
+import time
 from pathlib import Path
-from typing import Dict, List, Optional
+from typing import Dict, List, Optional, Tuple
 
-from .config import Architecture, ObfuscationConfig, Platform
+from .config import Architecture, MLIRFrontend, ObfuscationConfig, Platform
 from .exceptions import ObfuscationError
-from .fake_loop_inserter import FakeLoopGenerator
-from .anti_debug_injector import AntiDebugInjector
+from .fake_loop_inserter import FakeLoop, FakeLoopGenerator
+from .function_policy import FunctionPolicy, function_string_attributes
+from .anti_debug_injector import AntiDebugCheck, AntiDebugInjector
 from .ir_analyzer import IRAnalyzer
 from .multifile_compiler import compile_multifile_ir_workflow
+from .overhead_predictor import ModuleCosts, OverheadPredictor
+from .profile_tiers import ProfileTiers
 from .reporter import ObfuscationReport
+from .self_checksum import SelfChecksumSealer
+from .size_budget import FunctionSize, SizeBudgetPlanner, SizePlan
 from .llvm_remarks import RemarksCollector
 from .upx_packer import UPXPacker
 from .binary_analyzer_extended import ExtendedBinaryAnalyzer
@@ -28,6 +37,7 @@ from .utils import (
     merge_flags,
     require_tool,
     run_command,
+    run_pipeline,
     summarize_symbols,
 )
 
@@ -66,12 +76,123 @@ class LLVMObfuscator:
         "constant-obfuscate",
     ]
 
+    # Passes provided by the mlir-obs plugin (run through mlir-opt, not opt)
+    MLIR_PASSES = [
+        "string-encrypt",
+        "symbol-obfuscate",
+        "crypto-hash",
+        "constant-obfuscate",
+        "address-obfuscation",
+        "function-merge",
+    ]
+    # mlir-obs passes emit obs dialect ops (opaque predicates, encoded keys,
+    # import resolution) that CSE/LICM and obs-lower hoist and share;
+    # obs-lower expands them last. It is a no-op when nothing produced obs ops.
+    OBS_LOWER_PASS = "obs-lower"
+    # Adjacent runs of these are replaced by one fused-obfuscate pass: a
+    # single module walk instead of one or more per pass, and one set of
+    # __obfs_* string helpers
+    FUSED_PASS = "fused-obfuscate"
+    FUSABLE_MLIR_PASSES = ("string-encrypt", "constant-obfuscate", "symbol-obfuscate", "crypto-hash")
+    # Function passes, anchored on the op they run on so the pass manager
+    # spreads them over the functions in parallel
+    FUNCTION_MLIR_PASSES = {
+        "address-obfuscation": "llvm.func",
+        "scf-obfuscate": "any",
+        "constant-encode": "llvm.func",
+        "indirect-call": "llvm.func",
+        "fake-loops": "llvm.func",
+    }
+    # Function passes that read the module hotness estimate; each is
+    # preceded by obs-hotness, which caches it for them
+    HOTNESS_FUNCTION_PASSES = ("address-obfuscation", "scf-obfuscate", "constant-encode")
+    HOTNESS_PASS = "obs-hotness"
+    # Function part of constant-obfuscate (integer constants), run after it
+    CONSTANT_ENCODE_PASS = "constant-encode"
+    # IR-level replacement for FakeLoopGenerator; count from advanced.fake_loops.
+    # The module pass picks the blocks, the function pass inserts the loops.
+    FAKE_LOOP_PLAN_PASS = "fake-loops-plan"
+    FAKE_LOOP_PASS = "fake-loops"
+    # IR-level replacement for IndirectCallObfuscator (advanced.indirect_calls).
+    # The module pass builds the table, the function pass rewrites the calls.
+    INDIRECT_CALL_TABLE_PASS = "indirect-call-table"
+    INDIRECT_CALL_PASS = "indirect-call"
+    # IR-level replacement for AntiDebugInjector on Linux; the checks live in
+    # mlir-obs/runtime/obfs_antidebug.c, which is linked into the binary
+    ANTI_DEBUG_PASS = "anti-debug"
+    ANTI_DEBUG_RUNTIME_TECHNIQUES = ("ptrace", "proc_status", "parent_check", "timing")
+    ANTI_DEBUG_RUNTIME = "obfs_antidebug.c"
+    # Incremental CRC32C verification of .text/.rodata; sealed after linking
+    SELF_CHECKSUM_RUNTIME = "obfs_selfcheck.c"
+    SELF_CHECKSUM_MODES = ("thread", "piggyback", "eager")
+    # Classifies functions from imported profile counts; runs first so every
+    # later pass can honor the tier limits (obs.transform_limit)
+    PROFILE_TIER_PASS = "profile-tiers"
+    # obf:none|light|max annotations and policy-file rules (obs.policy);
+    # overrides tiers in every pass that checks isTransformAllowed
+    FUNCTION_POLICY_PASS = "function-policy"
+    # Caps each function at the transform limit of the size plan
+    # (obs.budget_limit); see core/size_budget.py
+    SIZE_BUDGET_PASS = "size-budget"
+    MLIR_STATISTIC_PATTERN = re.compile(r"^\s*\(S\)\s+(\d+)\s+([\w.-]+)\s+-", re.MULTILINE)
+    # Without statistics, sites are counted in the exported IR instead: each
+    # rewritten site takes the address of its pass's global once
+    MLIR_SITE_GLOBALS = {
+        "icall-sites-converted": "__obfs_icall_table",
+        "anti-debug-sites": "__obfs_ad_countdown",
+        "fake-loops-inserted": "__obfs_fl_sink",
+    }
+    ICALL_TABLE_PATTERN = re.compile(r"^@__obfs_icall_table\s*=[^\[\n]*\[(\d+) x i64\]", re.MULTILINE)
+    # Attributes dropped from the MLIR stage's output (by mlir-obfuscate
+    # --strip-attrs or the textual repairs): CPU attributes that break
+    # cross-compilation, and LLVM 22+ intrinsic attributes opt rejects
+    EXPORT_STRIP_ATTRIBUTES = (
+        "target-cpu", "target-features", "tune-cpu",
+        "nocreateundeforpoison", "memory", "speculatable", "convergent",
+    )
+
+    # Curated post-obfuscation pipeline (new PM syntax). It recovers what the
+    # obfuscation cost (inlining merge thunks, SROA/mem2reg, GVN, LICM,
+    # vectorization) but leaves out the IPO passes (globalopt, ipsccp, ctor
+    # evaluation) that fold encodings away. Values behind mlir-obs opaque
+    # barriers (empty inline asm "=r,0") stay opaque to instcombine and GVN.
+    # Instruction scheduling is left to the backend at the final -O level.
+    RECOVERY_PIPELINE = (
+        "always-inline,"
+        "function(sroa<modify-cfg>,mem2reg,early-cse<memssa>,instcombine,simplifycfg,"
+        "loop-mssa(licm),gvn,dse,loop-vectorize,slp-vectorizer,instcombine,simplifycfg)"
+    )
+    OPAQUE_BARRIER_PATTERN = re.compile(r'asm\s+"",\s*"=r,0"')
+
+    # Polygeist two-stage mode: loop nests are optimized while still affine,
+    # then obfuscated without touching their structure.
+    POLYGEIST_AFFINE_PASSES = [
+        "--affine-loop-fusion",
+        "--affine-loop-tile=tile-size=32",
+        "--affine-super-vectorize=virtual-vector-size=8",
+        "--canonicalize",
+    ]
+    # affine-super-vectorize leaves vector.transfer_* ops, which only lower
+    # to LLVM after vector-to-scf; that in turn emits affine.apply/min
+    POLYGEIST_LOWERING_PASSES = [
+        "--convert-vector-to-scf",
+        "--lower-affine",
+        "--convert-scf-to-cf",
+        "--convert-vector-to-llvm",
+        "--convert-arith-to-llvm",
+        "--convert-cf-to-llvm",
+        "--finalize-memref-to-llvm",
+        "--convert-func-to-llvm",
+        "--reconcile-unrealized-casts",
+    ]
+
     def __init__(self, reporter: Optional[ObfuscationReport] = None) -> None:
         self.logger = create_logger(__name__)
         self.reporter = reporter
         # Use random seed for fake loops to ensure different output each compilation
         self.fake_loop_generator = FakeLoopGenerator(seed=int.from_bytes(os.urandom(4), 'big'))
         self.anti_debug_injector = AntiDebugInjector()
+        self.self_checksum_sealer = SelfChecksumSealer()
         self.remarks_collector = RemarksCollector()
         # UPX packer will be initialized with custom path when needed
         self.upx_packer = None
@@ -80,10 +201,20 @@ class LLVMObfuscator:
         opt_binary = Path("/usr/local/llvm-obfuscator/bin/opt")
         llvm_dis_binary = Path("/usr/local/llvm-obfuscator/bin/llvm-dis")
         self.ir_analyzer = IRAnalyzer(opt_binary, llvm_dis_binary)
+        self.overhead_predictor = OverheadPredictor(opt_binary)
+        self._baseline_costs: Optional[ModuleCosts] = None  # TTI costs of the baseline IR
         self._baseline_ir_metrics = {}  # Store baseline IR for later comparison
         self._baseline_ir_file = None  # Store baseline IR file path for BCF analysis
         self._obfuscated_ir_file = None  # Store obfuscated IR file path for BCF analysis
-        self._mlir_metrics = {}  # Store MLIR pass metrics (string/symbol encryption counts)
+        self._mlir_statistics: Dict[str, int] = {}  # mlir-obs Statistic counters of the last run
+        self._mlir_pass_statistics: Dict[str, Dict[str, int]] = {}  # The same, per pass
+        self._mlir_ir_counts: Dict[str, int] = {}  # Sites counted in the IR when there are no statistics
+        self._recovery_metrics = {}  # Post-obfuscation recovery pipeline results
+        self._pass_metrics: List[Dict] = []  # IR snapshots after every MLIR/LLVM pass of the last compile
+        self._profile_report: Dict = {}  # Tier coverage of the last profile-guided compile
+        self._policy_report: Dict = {}  # Per-function policies of the last compile
+        self._size_plan: Optional[SizePlan] = None  # Size budget plan of the last compile
+        self._size_plan_path: Optional[Path] = None
         # ✅ NEW: Initialize metrics collector for platform-aware entropy
         self._metrics_collector = MetricsCollector() if HAS_METRICS_COLLECTOR else None
 
@@ -200,6 +331,22 @@ class LLVMObfuscator:
             self.logger.debug(f"Could not locate MLIR plugin: {e}")
             return None
 
+    def _get_mlir_driver_path(self) -> Optional[Path]:
+        """Find the single-process mlir-obfuscate driver (mlir-obs/tools)."""
+        import shutil
+
+        search_paths = [
+            Path(__file__).parent.parent.parent.parent / "mlir-obs" / "build" / "tools" / "mlir-obfuscate",
+            Path("/app/mlir-obs/build/tools/mlir-obfuscate"),
+            Path("/usr/local/llvm-obfuscator/bin/mlir-obfuscate"),
+        ]
+        for path in search_paths:
+            if path.exists():
+                self.logger.info(f"Found MLIR driver: {path}")
+                return path
+        found = shutil.which("mlir-obfuscate")
+        return Path(found) if found else None
+
     def _get_target_triple(self, platform: Platform, arch: Architecture) -> str:
         """Build LLVM target triple from platform + architecture combination.
 
@@ -305,6 +452,15 @@ class LLVMObfuscator:
 
         source_content = source_file.read_text(encoding="utf-8", errors="ignore")
 
+        profile = config.profile.path
+        if profile is not None:
+            if not profile.exists():
+                raise ObfuscationError(f"Profile not found: {profile}")
+            if config.mlir_frontend != MLIRFrontend.CLANG:
+                warnings_log.append(
+                    f"Profile {profile.name} ignored: profile-guided tiers need the clang frontend"
+                )
+
         # Compile baseline (unobfuscated) binary for comparison
         self.logger.info("Compiling baseline binary for comparison...")
         # Use platform-specific extension for baseline (e.g., .exe for Windows)
@@ -334,7 +490,8 @@ class LLVMObfuscator:
 
         # Indirect call obfuscation (if enabled) - applied after string encryption
         indirect_call_result = None
-        if config.advanced.indirect_calls.enabled:
+        ir_indirect_calls = self._use_ir_indirect_calls(config)
+        if config.advanced.indirect_calls.enabled and not ir_indirect_calls:
             try:
                 from .indirect_call_obfuscator import obfuscate_indirect_calls
 
@@ -364,7 +521,8 @@ class LLVMObfuscator:
 
         # Insert anti-debugging code (if enabled) - BEFORE fake loops
         anti_debug_checks = []
-        if config.advanced.anti_debug.enabled:
+        ir_anti_debug = self._use_ir_anti_debug(config)
+        if config.advanced.anti_debug.enabled and not ir_anti_debug:
             self.logger.info(f"Injecting anti-debugging protection with techniques: {config.advanced.anti_debug.techniques}")
             anti_debug_source = output_directory / f"{working_source.stem}_antidebug{working_source.suffix}"
             try:
@@ -394,9 +552,11 @@ class LLVMObfuscator:
                 self.logger.error(f"Anti-debugging injection failed: {e}", exc_info=True)
                 # Continue with original source if injection fails
 
-        # Insert fake loops into source code (if enabled)
+        # Insert fake loops into source code (if enabled). With the mlir-obs
+        # plugin on the default frontend they are inserted at IR level instead.
         fake_loops = []
-        if config.advanced.fake_loops and config.advanced.fake_loops > 0:
+        ir_fake_loops = self._use_ir_fake_loops(config)
+        if config.advanced.fake_loops and config.advanced.fake_loops > 0 and not ir_fake_loops:
             self.logger.info(f"Inserting {config.advanced.fake_loops} fake loops into source code...")
             fake_loop_source = output_directory / f"{working_source.stem}_fakeloops{working_source.suffix}"
             try:
@@ -448,6 +608,89 @@ class LLVMObfuscator:
             cycles=effective_cycles,  # Pass cycles to apply OLLVM passes multiple times
         )
 
+        if ir_indirect_calls:
+            indirect_call_result = {
+                "mode": "ir",
+                "total_obfuscated": self._mlir_count("icall-table-entries"),
+                "sites_converted": self._mlir_count("icall-sites-converted"),
+                "sites_skipped_loop": self._mlir_count("icall-sites-skipped-loop"),
+                "sites_skipped_hot": self._mlir_count("icall-sites-skipped-hot"),
+                "guarded_fast_path": config.advanced.indirect_calls.guarded_fast_path,
+            }
+            self.logger.info(
+                "IR indirect calls: %d sites converted (%d targets), %d skipped in loops, %d in hot functions",
+                indirect_call_result["sites_converted"],
+                indirect_call_result["total_obfuscated"],
+                indirect_call_result["sites_skipped_loop"],
+                indirect_call_result["sites_skipped_hot"],
+            )
+
+        if ir_anti_debug:
+            sites = self._mlir_count("anti-debug-sites")
+            anti_debug_checks = [
+                AntiDebugCheck(check_type="sampled", location=f"{source_file.name}:ir_check_{index}", code_snippet="")
+                for index in range(sites)
+            ]
+            self.logger.info(
+                "IR anti-debug: %d functions checked (%s), budget %d us/s, /proc cache %d ms",
+                sites,
+                ", ".join(self._anti_debug_techniques(config)),
+                config.advanced.anti_debug.overhead_budget_us,
+                config.advanced.anti_debug.proc_cache_ms,
+            )
+
+        if ir_fake_loops:
+            inserted = self._mlir_count("fake-loops-inserted")
+            fake_loops = [
+                FakeLoop(loop_type="ir", location=f"{source_file.name}:ir_fake_loop_{index}", code_snippet="")
+                for index in range(inserted)
+            ]
+            self.logger.info(
+                "IR fake loops: %d inserted, %d blocks too hot, %d over cycle budget",
+                inserted,
+                self._mlir_count("fake-loops-skipped-hot"),
+                self._mlir_count("fake-loops-over-budget"),
+            )
+
+        profile_result = None
+        if self._profile_flags(config):
+            profile_result = dict(self._profile_report) or {"enabled": True, "status": "no profile data in IR"}
+        elif config.profile.static_estimate and "tier-cold-functions" in self._mlir_statistics:
+            profile_result = {"enabled": True, "source": "static"}
+        size_budget_result = None
+        if self._size_plan is not None:
+            plan = self._size_plan
+            size_budget_result = {
+                "enabled": True,
+                "plan_file": str(self._size_plan_path),
+                "replayed": config.size_budget.plan_file is not None,
+                "growth_percent": plan.growth_percent,
+                "baseline_bytes": plan.baseline_bytes,
+                "budget_bytes": plan.budget_bytes,
+                "estimated_growth_bytes": plan.growth_bytes,
+                "protection_score": round(plan.protection_score, 2),
+                "functions": plan.summary(),
+                "plan": plan.to_dict(),
+            }
+            if "budget-none-functions" in self._mlir_statistics:
+                size_budget_result["mlir_functions"] = {
+                    limit: self._mlir_statistics.get(f"budget-{limit}-functions", 0)
+                    for limit in SizeBudgetPlanner.LIMITS
+                }
+
+        policy_result = dict(self._policy_report) if self._policy_report else None
+        if "policy-none-functions" in self._mlir_statistics:
+            policy_result = policy_result or {"enabled": True}
+            policy_result["mlir_functions"] = {
+                policy: self._mlir_statistics.get(f"policy-{policy}-functions", 0)
+                for policy in FunctionPolicy.POLICIES
+            }
+        if profile_result is not None:
+            for tier in ProfileTiers.TIERS:
+                key = f"tier-{tier}-functions"
+                if key in self._mlir_statistics:
+                    profile_result.setdefault("mlir_functions", {})[tier] = self._mlir_statistics[key]
+
         # Track what actually happened
         cycle_ir_metrics = {}  # ✅ NEW: Extract IR metrics from compilation
         if cycle_result:
@@ -457,6 +700,22 @@ class LLVMObfuscator:
             # ✅ NEW: Extract IR metrics if available
             cycle_ir_metrics = cycle_result.get("ir_metrics", {})
 
+        # Self-checksum table is filled in from the final image; UPX restores
+        # the same image at run time, so this goes right before packing
+        self_checksum_result = None
+        if config.advanced.self_checksum.enabled:
+            if self._use_self_checksum(config):
+                try:
+                    self_checksum_result = self.self_checksum_sealer.seal(output_binary)
+                    self_checksum_result["mode"] = self._self_checksum_mode(config)
+                    if self_checksum_result["status"] != "success":
+                        warnings_log.append(f"Self-checksum not sealed: {self_checksum_result.get('error')}")
+                except Exception as e:
+                    self.logger.warning(f"Self-checksum sealing failed: {e}")
+                    warnings_log.append(f"Self-checksum sealing error: {str(e)}")
+            else:
+                warnings_log.append("Self-checksum skipped: Linux targets with the mlir-obs runtime only")
+
         # UPX packing (if enabled) - applied as FINAL step after all obfuscation
         upx_result = None
         if config.advanced.upx_packing.enabled:
@@ -488,6 +747,9 @@ class LLVMObfuscator:
                 self.logger.warning(f"UPX packing failed with exception: {e}")
                 warnings_log.append(f"UPX packing error: {str(e)}")
 
+        if profile_result is not None and config.profile.benchmark_args is not None:
+            profile_result["runtime"] = self._compare_runtime(baseline_binary, output_binary, config)
+
         binary_format = detect_binary_format(output_binary)
         file_size = get_file_size(output_binary)
         sections = list_sections(output_binary)
@@ -617,6 +879,16 @@ class LLVMObfuscator:
                 "checks_injected": len(anti_debug_checks),
             },
             "indirect_calls": indirect_call_result or {"enabled": False},
+            "self_checksum": self_checksum_result or {"enabled": False},
+            "profile_guided": profile_result or {"enabled": False},
+            "function_policy": policy_result or {"enabled": False},
+            "size_budget": size_budget_result or {"enabled": False},
+            "predicted_overhead": (cycle_result or {}).get("predicted_overhead") or {"enabled": False},
+            "pass_metrics": (cycle_result or {}).get("pass_metrics") or {"enabled": False},
+            "mlir_statistics": {
+                "passes": self._mlir_pass_statistics,
+                "totals": self._mlir_statistics,
+            } if self._mlir_statistics else {"enabled": False},
             "upx_packing": upx_result or {"enabled": False},
             "obfuscation_score": base_metrics["obfuscation_score"],
             "overall_protection_index": base_metrics["overall_protection_index"],
@@ -811,6 +1083,176 @@ class LLVMObfuscator:
         )
         return []
 
+    def _repair_translated_ir(
+        self,
+        raw_ir: Path,
+        repaired_ir: Path,
+        original_declarations: List[str],
+        target_triple: str,
+        data_layout: str,
+    ) -> None:
+        """
+        Textual repairs of mlir-translate output for the plugin chain;
+        mlir-obfuscate applies the same fixes to the in-memory module.
+        """
+        # Read, fix, and write - remove ALL target-specific attributes
+        with open(str(raw_ir), 'r') as f:
+            ir_content = f.read()
+
+        # ============================================================
+        # FIX: Restore missing external function declarations
+        # mlir-translate drops declarations like @strcmp, @printf, etc.
+        # We saved them earlier and now inject any that are missing.
+        # ============================================================
+        existing_declarations = set(re.findall(r'^declare\s+.+$', ir_content, re.MULTILINE))
+        missing_declarations = []
+        for decl in original_declarations:
+            # Extract function name from declaration (e.g., @strcmp from "declare i32 @strcmp(...)")
+            func_match = re.search(r'@([\w\.]+)', decl)
+            if func_match:
+                func_name = func_match.group(1)
+                # Check if this function is missing in the output
+                if not any(f'@{func_name}' in existing for existing in existing_declarations):
+                    missing_declarations.append(decl)
+
+        if missing_declarations:
+            decl_names = [re.search(r'@([\w\.]+)', d).group(1) for d in missing_declarations]
+            self.logger.debug(f"Restoring {len(missing_declarations)} missing declarations: {decl_names}")
+            # Insert declarations after the target triple/datalayout section
+            # Find position after last target line
+            insert_pos = 0
+            for match in re.finditer(r'^(target\s+(triple|datalayout)\s*=.*)$', ir_content, re.MULTILINE):
+                insert_pos = match.end()
+            if insert_pos > 0:
+                ir_content = ir_content[:insert_pos] + '\n\n' + '\n'.join(missing_declarations) + '\n' + ir_content[insert_pos:]
+            else:
+                # No target lines found, insert at beginning
+                ir_content = '\n'.join(missing_declarations) + '\n\n' + ir_content
+
+        # Fix target triple and datalayout
+        # Use re.DOTALL to handle multi-line target triple values (MLIR sometimes outputs newlines inside quotes)
+        ir_content = re.sub(r'target triple = "[^"]*"', f'target triple = "{target_triple}"', ir_content, flags=re.DOTALL)
+        ir_content = re.sub(r'target datalayout = "[^"]*"', f'target datalayout = "{data_layout}"', ir_content, flags=re.DOTALL)
+
+        # Remove corrupted CPU attributes
+        ir_content = re.sub(r'"target-cpu"="[^"]*"', '', ir_content)
+        ir_content = re.sub(r'"target-features"="[^"]*"', '', ir_content)
+        ir_content = re.sub(r'"tune-cpu"="[^"]*"', '', ir_content)
+
+        # ============================================================
+        # FIX: Remove problematic LLVM 22+ intrinsic attributes that
+        # cause "unterminated attribute group" errors in opt.
+        # These attributes are generated for math intrinsics (sin, cos,
+        # sqrt, pow, etc.) and are incompatible with the opt parser.
+        # See: https://discourse.llvm.org/t/unterminated-attribute-group/75338
+        # ============================================================
+
+        # Remove 'nocreateundeforpoison' attribute (LLVM 22+ feature)
+        # Use [ \t]* instead of \s* to avoid eating newlines (which breaks declare statements)
+        ir_content = re.sub(r'\bnocreateundeforpoison\b[ \t]*', '', ir_content)
+
+        # Remove 'memory(...)' attribute syntax (LLVM 16+ feature)
+        # This includes: memory(none), memory(read), memory(write),
+        # memory(argmem: read), memory(argmem: write), memory(argmem: readwrite),
+        # memory(inaccessiblemem: write), etc.
+        ir_content = re.sub(r'\bmemory\([^)]*\)[ \t]*', '', ir_content)
+
+        # Remove 'speculatable' attribute that often accompanies math intrinsics
+        ir_content = re.sub(r'\bspeculatable\b[ \t]*', '', ir_content)
+
+        # Remove 'convergent' attribute (for math intrinsics)
+        ir_content = re.sub(r'\bconvergent\b[ \t]*', '', ir_content)
+
+        # Clean up multiple spaces left by removed attributes
+        # IMPORTANT: Only collapse spaces OUTSIDE of string constants (c"...")
+        # to avoid corrupting string literal content
+        def collapse_spaces_outside_strings(content):
+            result = []
+            i = 0
+            while i < len(content):
+                # Check for string constant start: c"
+                if content[i:i+2] == 'c"':
+                    # Find the end of the string constant
+                    result.append('c"')
+                    i += 2
+                    while i < len(content) and content[i] != '"':
+                        if content[i] == '\\' and i + 1 < len(content):
+                            # Escape sequence - copy both characters
+                            result.append(content[i:i+2])
+                            i += 2
+                        else:
+                            result.append(content[i])
+                            i += 1
+                    if i < len(content):
+                        result.append('"')
+                        i += 1
+                # Check for multiple spaces outside strings
+                elif content[i] == ' ' and i + 1 < len(content) and content[i+1] == ' ':
+                    result.append(' ')
+                    while i < len(content) and content[i] == ' ':
+                        i += 1
+                else:
+                    result.append(content[i])
+                    i += 1
+            return ''.join(result)
+        ir_content = collapse_spaces_outside_strings(ir_content)
+
+        # Clean up empty attribute groups
+        ir_content = re.sub(r'attributes #\d+ = \{\s*\}', '', ir_content)
+
+        # ============================================================
+        # FIX: Bug #2 - MLIR string encryption size mismatch
+        # The MLIR string-encrypt pass sometimes generates incorrect array
+        # size declarations. For example: [23 x i8] but content is 22 bytes.
+        # This fix recalculates the actual byte count and fixes the size.
+        # ============================================================
+        def count_string_bytes(s):
+            """Count actual bytes in an LLVM IR string literal (inside c"...")."""
+            count = 0
+            i = 0
+            while i < len(s):
+                if s[i] == '\\' and i + 1 < len(s):
+                    next_char = s[i+1]
+                    # Handle escaped backslash: \\ = 1 byte
+                    if next_char == '\\':
+                        count += 1
+                        i += 2
+                        continue
+                    # Handle hex escape: \xx = 1 byte
+                    if i + 2 < len(s):
+                        hex_chars = s[i+1:i+3]
+                        if all(c in '0123456789abcdefABCDEF' for c in hex_chars):
+                            count += 1
+                            i += 3
+                            continue
+                # Regular character
+                count += 1
+                i += 1
+            return count
+
+        def fix_string_constant_size(match):
+            """Fix the array size in string constant declarations."""
+            prefix = match.group(1)  # Everything before [N x i8]
+            declared_size = int(match.group(2))  # The declared size N
+            string_content = match.group(3)  # The string inside c"..."
+            suffix = match.group(4)  # Everything after (e.g., ", align 1")
+
+            actual_size = count_string_bytes(string_content)
+
+            if actual_size != declared_size:
+                self.logger.debug(f"Fixing string size: [{declared_size} x i8] -> [{actual_size} x i8]")
+
+            return f'{prefix}[{actual_size} x i8] c"{string_content}"{suffix}'
+
+        # Pattern to match string constant declarations:
+        # @.str.X = ... constant [N x i8] c"...", align X
+        # Capture groups: (prefix)(size)(string_content)(suffix)
+        string_const_pattern = r'((?:@[^\s]+\s*=\s*)?(?:private\s+)?(?:unnamed_addr\s+)?(?:constant\s+)?)\[(\d+)\s+x\s+i8\]\s+c"([^"]*)"((?:\s*,\s*align\s+\d+)?)'
+        ir_content = re.sub(string_const_pattern, fix_string_constant_size, ir_content)
+
+        with open(str(repaired_ir), 'w') as f:
+            f.write(ir_content)
+
     def _has_exception_handling(self, ir_file: Path) -> bool:
         """
         Check if LLVM IR file contains C++ exception handling (invoke/landingpad).
@@ -821,59 +1263,14 @@ class LLVMObfuscator:
         Supports both .ll (text IR) and .bc (bitcode) files.
         """
         try:
-            # If it's a .bc file, try to use llvm-dis to convert to text
-            # Otherwise, read directly as text
-            if ir_file.suffix == '.bc':
-                import shutil
-                import subprocess
-
-                # Try to find LLVM 22 llvm-dis first (bundled with our LLVM 22 toolchain)
-                # System llvm-dis may be older (e.g., LLVM 19) and fail to read LLVM 22 bitcode
-                llvm_dis = None
-                bundled_llvm_dis_paths = [
-                    Path("/usr/local/llvm-obfuscator/bin/llvm-dis"),  # Docker production
-                    Path("/app/plugins/linux-x86_64/llvm-dis"),  # Docker backup
-                ]
-
-                for bundled_path in bundled_llvm_dis_paths:
-                    if bundled_path.exists():
-                        llvm_dis = str(bundled_path)
-                        self.logger.debug(f"Using bundled llvm-dis (LLVM 22): {llvm_dis}")
-                        break
-
-                # Fallback to system llvm-dis if no bundled version
-                if not llvm_dis:
-                    llvm_dis = shutil.which("llvm-dis")
-                    if llvm_dis:
-                        self.logger.debug(f"Using system llvm-dis: {llvm_dis}")
-
-                if llvm_dis:
-                    # Use llvm-dis to convert .bc to .ll temporarily
-                    temp_ll = ir_file.parent / f"{ir_file.stem}_temp.ll"
-                    try:
-                        subprocess.run(
-                            [llvm_dis, str(ir_file), "-o", str(temp_ll)],
-                            check=True,
-                            capture_output=True,
-                            timeout=30
-                        )
-                        ir_content = temp_ll.read_text(encoding='utf-8', errors='ignore')
-                        temp_ll.unlink()  # Clean up
-                    except Exception as e:
-                        self.logger.warning(f"Failed to convert .bc to .ll with llvm-dis: {e}")
-                        # For C++ code with exception handling, assume it has EH
-                        # This is safer than letting flattening crash
-                        # Check file extension heuristics from source
-                        self.logger.warning("Assuming C++ exception handling is present (safer for flattening)")
-                        return True
-                else:
-                    # No llvm-dis available - assume C++ has EH to be safe
-                    self.logger.warning("No llvm-dis available to check for exception handling")
-                    self.logger.warning("Assuming C++ exception handling is present (safer for flattening)")
-                    return True
-            else:
-                # Text IR file (.ll)
-                ir_content = ir_file.read_text(encoding='utf-8', errors='ignore')
+            # Bitcode is disassembled once and shared with the other IR analyses
+            ir_content = self.ir_analyzer.ir_text(ir_file)
+            if ir_content is None:
+                # For C++ code with exception handling, assume it has EH
+                # This is safer than letting flattening crash
+                self.logger.warning(f"Could not read {ir_file.name} as text (llvm-dis missing or failed)")
+                self.logger.warning("Assuming C++ exception handling is present (safer for flattening)")
+                return True
 
             # Check for invoke instructions (exception-aware function calls)
             has_invoke = ' invoke ' in ir_content
@@ -955,6 +1352,7 @@ class LLVMObfuscator:
 
         DEFAULT (config.mlir_frontend == CLANG): Existing pipeline (SAFE)
         NEW (config.mlir_frontend == CLANGIR): ClangIR pipeline
+        NEW (config.mlir_frontend == POLYGEIST): Polygeist two-stage pipeline
 
         Args:
             cycles: Number of times to apply OLLVM passes (for stronger obfuscation)
@@ -965,6 +1363,8 @@ class LLVMObfuscator:
         if config.mlir_frontend == MLIRFrontend.CLANGIR:
             # NEW: ClangIR pipeline
             return self._compile_with_clangir(source, destination, config, compiler_flags, enabled_passes, cycles)
+        elif config.mlir_frontend == MLIRFrontend.POLYGEIST:
+            return self._compile_with_polygeist(source, destination, config, compiler_flags, enabled_passes, cycles)
         else:
             # DEFAULT: Existing Clang → LLVM IR → MLIR pipeline (UNCHANGED)
             return self._compile_with_clang_llvm(source, destination, config, compiler_flags, enabled_passes, cycles)
@@ -1003,22 +1403,71 @@ class LLVMObfuscator:
 
         compiler = base_compiler
 
-        mlir_passes = [p for p in enabled_passes if p in ["string-encrypt", "symbol-obfuscate", "crypto-hash", "constant-obfuscate", "address-obfuscation"]]
+        mlir_passes = [p for p in enabled_passes if p in self.MLIR_PASSES]
         ollvm_passes = [p for p in enabled_passes if p not in mlir_passes]
+        mlir_passes = self._mlir_pass_options(mlir_passes, config)
+        if self._use_ir_indirect_calls(config):
+            indirect = config.advanced.indirect_calls
+            mlir_passes.append(
+                f"{self.INDIRECT_CALL_TABLE_PASS}{{stdlib={str(indirect.obfuscate_stdlib).lower()} "
+                f"custom={str(indirect.obfuscate_custom).lower()}}}"
+            )
+            mlir_passes.append(
+                f"{self.INDIRECT_CALL_PASS}{{fast-path={str(indirect.guarded_fast_path).lower()}}}"
+            )
+        if self._use_ir_fake_loops(config):
+            mlir_passes.append(f"{self.FAKE_LOOP_PLAN_PASS}{{count={config.advanced.fake_loops}}}")
+            mlir_passes.append(self.FAKE_LOOP_PASS)
+        if self._use_ir_anti_debug(config):
+            anti_debug = config.advanced.anti_debug
+            mlir_passes.append(
+                f"{self.ANTI_DEBUG_PASS}{{techniques={','.join(self._anti_debug_techniques(config))} "
+                f"budget-us={anti_debug.overhead_budget_us} "
+                f"proc-cache-ms={anti_debug.proc_cache_ms}}}"
+            )
+
+        profile_flags = self._profile_flags(config)
+        if (profile_flags or config.profile.static_estimate) and mlir_passes:
+            profile = config.profile
+            # auto: imported counts when the IR has them, the static estimate otherwise
+            source = "auto" if profile.static_estimate else "profile"
+            mlir_passes.insert(
+                0,
+                f"{self.PROFILE_TIER_PASS}{{hot-percent={profile.hot_percent} "
+                f"warm-percent={profile.warm_percent} hot-policy={profile.hot_policy} "
+                f"warm-policy={profile.warm_policy} source={source}}}",
+            )
+        if mlir_passes:
+            policy_pass = self.FUNCTION_POLICY_PASS
+            if config.policy_file:
+                policy_pass += f"{{policy-file={Path(config.policy_file).resolve()}}}"
+            mlir_passes.insert(0, policy_pass)
 
         # The input for the current stage of the pipeline
         current_input = source_abs
 
-        # Initialize MLIR metrics to empty dict (will be populated if MLIR stage runs)
-        self._mlir_metrics = {}
+        # Pass statistics, populated if the MLIR stage runs
+        self._mlir_statistics = {}
+        self._mlir_pass_statistics = {}
+        self._mlir_ir_counts = {}
+        self._recovery_metrics = {}
+        self._pass_metrics = []
+        self._profile_report = {}
+        self._policy_report = {}
+        self._size_plan = None
+        self._size_plan_path = None
+        limits_applied = False
+        recovered = False
+        opaque_before = 0
 
         # Stage 1: MLIR Obfuscation
         if mlir_passes:
             self.logger.info("Running MLIR pipeline with passes: %s", ", ".join(mlir_passes))
 
-            # Find MLIR plugin
-            mlir_plugin = self._get_mlir_plugin_path()
-            if not mlir_plugin:
+            # Prefer the single-process driver; fall back to the plugin chain
+            mlir_driver = self._get_mlir_driver_path()
+            mlir_plugin = None if mlir_driver else self._get_mlir_plugin_path()
+            if not mlir_driver and not mlir_plugin:
                 raise ObfuscationError(
                     "MLIR passes requested but plugin not found. "
                     "Please build the MLIR obfuscation library first:\n"
@@ -1026,9 +1475,16 @@ class LLVMObfuscator:
                     "  cmake .. && make"
                 )
 
-            # 1a: Compile source to LLVM IR
-            llvm_ir_temp = destination_abs.parent / f"{destination_abs.stem}_temp.ll"
-            ir_cmd = [compiler, str(current_input), "-S", "-emit-llvm", "-o", str(llvm_ir_temp)]
+            # 1a: Compile source to LLVM IR. The driver repairs its output in
+            # memory and takes bitcode; the plugin chain's textual repairs
+            # below need the original as text.
+            ir_suffix = self._ir_suffix(config) if mlir_driver else ".ll"
+            emit_flags = self._emit_ir_flags(config) if mlir_driver else ["-S", "-emit-llvm"]
+            llvm_ir_temp = destination_abs.parent / f"{destination_abs.stem}_temp{ir_suffix}"
+            # -O2 without the middle-end pipeline: no optnone/noinline on every
+            # function, so the recovery pipeline (or final -O) can still optimize
+            ir_cmd = [compiler, str(current_input), *emit_flags, "-O2", "-Xclang", "-disable-llvm-passes",
+                      "-o", str(llvm_ir_temp)]
             # Add resource-dir flag for bundled clang
             resource_dir_flags = self._get_resource_dir_flag(compiler)
             if resource_dir_flags:
@@ -1036,43 +1492,28 @@ class LLVMObfuscator:
             # Add cross-compilation flags (target triple + sysroot for macOS)
             cross_compile_flags = self._get_cross_compile_flags(config.platform, config.architecture)
             ir_cmd.extend(cross_compile_flags)
+            # Counts land on the IR as function_entry_count / branch_weights,
+            # which mlir-translate imports and profile-tiers reads
+            ir_cmd.extend(profile_flags)
             run_command(ir_cmd, cwd=source_abs.parent)
-
-            # Save external function declarations from original IR
-            # mlir-translate drops these, so we need to restore them later
-            with open(str(llvm_ir_temp), 'r') as f:
-                original_ir = f.read()
-            original_declarations = re.findall(r'^declare\s+.+$', original_ir, re.MULTILINE)
-            self.logger.debug(f"Saved {len(original_declarations)} external declarations from original IR")
-
-            # 1b: Convert LLVM IR to MLIR
-            mlir_file = destination_abs.parent / f"{destination_abs.stem}_temp.mlir"
-            translate_to_mlir_cmd = ["mlir-translate", "--import-llvm", str(llvm_ir_temp), "-o", str(mlir_file)]
-            run_command(translate_to_mlir_cmd, cwd=source_abs.parent)
-
-            # 1c: Apply MLIR obfuscation passes
-            obfuscated_mlir = destination_abs.parent / f"{destination_abs.stem}_obfuscated.mlir"
-
-            # Build pass pipeline: "builtin.module(string-encrypt,symbol-obfuscate)"
-            passes_str = ",".join(mlir_passes)
-            pass_pipeline = f"builtin.module({passes_str})"
-
-            opt_cmd = [
-                "mlir-opt",
-                str(mlir_file),
-                f"--load-pass-plugin={str(mlir_plugin)}",
-                f"--pass-pipeline={pass_pipeline}",
-                "-o", str(obfuscated_mlir)
-            ]
-            run_command(opt_cmd, cwd=source_abs.parent)
-
-            # 1d: Translate MLIR back to LLVM IR
+            self._apply_sample_profile(llvm_ir_temp, config, source_abs.parent)
+
+            if config.size_budget.enabled:
+                plan_path = self._plan_size_budget(llvm_ir_temp, config, mlir_passes, ollvm_passes, destination_abs)
+                dropped = [p for p in mlir_passes
+                           if p in SizeBudgetPlanner.MODULE_MLIR and p not in self._size_plan.module]
+                if dropped:
+                    self.logger.info("Size budget drops module-wide passes: %s", ", ".join(dropped))
+                    mlir_passes = [p for p in mlir_passes if p not in dropped]
+                    actually_applied_passes = [p for p in actually_applied_passes if p not in dropped]
+                mlir_passes.insert(0, f"{self.SIZE_BUDGET_PASS}{{plan-file={plan_path}}}")
+
+            # Build pass pipeline: "builtin.module(string-encrypt,symbol-obfuscate,obs-lower)"
+            pass_pipeline = self._mlir_pass_pipeline(mlir_passes, config.passes.constant_encode)
+            statistics_flags = ["--mlir-pass-statistics", "--mlir-pass-statistics-display=list"]
+            obfuscated_mlir = destination_abs.parent / f"{destination_abs.stem}_obfuscated{self._mlir_suffix(config)}"
             llvm_ir_raw = destination_abs.parent / f"{destination_abs.stem}_raw.ll"
-            translate_cmd = ["mlir-translate", "--mlir-to-llvmir", str(obfuscated_mlir), "-o", str(llvm_ir_raw)]
-            run_command(translate_cmd, cwd=source_abs.parent)
-
-            # Fix target triple and data layout (MLIR sometimes generates malformed output)
-            llvm_ir_file = destination_abs.parent / f"{destination_abs.stem}_from_mlir.ll"
+            llvm_ir_file = destination_abs.parent / f"{destination_abs.stem}_from_mlir{ir_suffix}"
 
             # Get target triple for cross-compilation
             target_triple = self._get_target_triple(config.platform, config.architecture)
@@ -1082,249 +1523,65 @@ class LLVMObfuscator:
             else:
                 data_layout = "e-m:e-p270:32:32-p271:32:32-p272:64:64-i64:64-f80:128-n8:16:32:64-S128"
 
-            # Read, fix, and write - remove ALL target-specific attributes
-            with open(str(llvm_ir_raw), 'r') as f:
-                ir_content = f.read()
-
-            # ============================================================
-            # FIX: Restore missing external function declarations
-            # mlir-translate drops declarations like @strcmp, @printf, etc.
-            # We saved them earlier and now inject any that are missing.
-            # ============================================================
-            existing_declarations = set(re.findall(r'^declare\s+.+$', ir_content, re.MULTILINE))
-            missing_declarations = []
-            for decl in original_declarations:
-                # Extract function name from declaration (e.g., @strcmp from "declare i32 @strcmp(...)")
-                func_match = re.search(r'@([\w\.]+)', decl)
-                if func_match:
-                    func_name = func_match.group(1)
-                    # Check if this function is missing in the output
-                    if not any(f'@{func_name}' in existing for existing in existing_declarations):
-                        missing_declarations.append(decl)
-
-            if missing_declarations:
-                decl_names = [re.search(r'@([\w\.]+)', d).group(1) for d in missing_declarations]
-                self.logger.debug(f"Restoring {len(missing_declarations)} missing declarations: {decl_names}")
-                # Insert declarations after the target triple/datalayout section
-                # Find position after last target line
-                insert_pos = 0
-                for match in re.finditer(r'^(target\s+(triple|datalayout)\s*=.*)$', ir_content, re.MULTILINE):
-                    insert_pos = match.end()
-                if insert_pos > 0:
-                    ir_content = ir_content[:insert_pos] + '\n\n' + '\n'.join(missing_declarations) + '\n' + ir_content[insert_pos:]
-                else:
-                    # No target lines found, insert at beginning
-                    ir_content = '\n'.join(missing_declarations) + '\n\n' + ir_content
-
-            # Fix target triple and datalayout
-            # Use re.DOTALL to handle multi-line target triple values (MLIR sometimes outputs newlines inside quotes)
-            ir_content = re.sub(r'target triple = "[^"]*"', f'target triple = "{target_triple}"', ir_content, flags=re.DOTALL)
-            ir_content = re.sub(r'target datalayout = "[^"]*"', f'target datalayout = "{data_layout}"', ir_content, flags=re.DOTALL)
-
-            # Remove corrupted CPU attributes
-            ir_content = re.sub(r'"target-cpu"="[^"]*"', '', ir_content)
-            ir_content = re.sub(r'"target-features"="[^"]*"', '', ir_content)
-            ir_content = re.sub(r'"tune-cpu"="[^"]*"', '', ir_content)
-
-            # ============================================================
-            # FIX: Remove problematic LLVM 22+ intrinsic attributes that
-            # cause "unterminated attribute group" errors in opt.
-            # These attributes are generated for math intrinsics (sin, cos,
-            # sqrt, pow, etc.) and are incompatible with the opt parser.
-            # See: https://discourse.llvm.org/t/unterminated-attribute-group/75338
-            # ============================================================
-
-            # Remove 'nocreateundeforpoison' attribute (LLVM 22+ feature)
-            # Use [ \t]* instead of \s* to avoid eating newlines (which breaks declare statements)
-            ir_content = re.sub(r'\bnocreateundeforpoison\b[ \t]*', '', ir_content)
-
-            # Remove 'memory(...)' attribute syntax (LLVM 16+ feature)
-            # This includes: memory(none), memory(read), memory(write),
-            # memory(argmem: read), memory(argmem: write), memory(argmem: readwrite),
-            # memory(inaccessiblemem: write), etc.
-            ir_content = re.sub(r'\bmemory\([^)]*\)[ \t]*', '', ir_content)
-
-            # Remove 'speculatable' attribute that often accompanies math intrinsics
-            ir_content = re.sub(r'\bspeculatable\b[ \t]*', '', ir_content)
-
-            # Remove 'convergent' attribute (for math intrinsics)
-            ir_content = re.sub(r'\bconvergent\b[ \t]*', '', ir_content)
-
-            # Clean up multiple spaces left by removed attributes
-            # IMPORTANT: Only collapse spaces OUTSIDE of string constants (c"...")
-            # to avoid corrupting string literal content
-            def collapse_spaces_outside_strings(content):
-                result = []
-                i = 0
-                while i < len(content):
-                    # Check for string constant start: c"
-                    if content[i:i+2] == 'c"':
-                        # Find the end of the string constant
-                        result.append('c"')
-                        i += 2
-                        while i < len(content) and content[i] != '"':
-                            if content[i] == '\\' and i + 1 < len(content):
-                                # Escape sequence - copy both characters
-                                result.append(content[i:i+2])
-                                i += 2
-                            else:
-                                result.append(content[i])
-                                i += 1
-                        if i < len(content):
-                            result.append('"')
-                            i += 1
-                    # Check for multiple spaces outside strings
-                    elif content[i] == ' ' and i + 1 < len(content) and content[i+1] == ' ':
-                        result.append(' ')
-                        while i < len(content) and content[i] == ' ':
-                            i += 1
-                    else:
-                        result.append(content[i])
-                        i += 1
-                return ''.join(result)
-            ir_content = collapse_spaces_outside_strings(ir_content)
-
-            # Clean up empty attribute groups
-            ir_content = re.sub(r'attributes #\d+ = \{\s*\}', '', ir_content)
-
-            # ============================================================
-            # FIX: Bug #2 - MLIR string encryption size mismatch
-            # The MLIR string-encrypt pass sometimes generates incorrect array
-            # size declarations. For example: [23 x i8] but content is 22 bytes.
-            # This fix recalculates the actual byte count and fixes the size.
-            # ============================================================
-            def count_string_bytes(s):
-                """Count actual bytes in an LLVM IR string literal (inside c"...")."""
-                count = 0
-                i = 0
-                while i < len(s):
-                    if s[i] == '\\' and i + 1 < len(s):
-                        next_char = s[i+1]
-                        # Handle escaped backslash: \\ = 1 byte
-                        if next_char == '\\':
-                            count += 1
-                            i += 2
-                            continue
-                        # Handle hex escape: \xx = 1 byte
-                        if i + 2 < len(s):
-                            hex_chars = s[i+1:i+3]
-                            if all(c in '0123456789abcdefABCDEF' for c in hex_chars):
-                                count += 1
-                                i += 3
-                                continue
-                    # Regular character
-                    count += 1
-                    i += 1
-                return count
-
-            def fix_string_constant_size(match):
-                """Fix the array size in string constant declarations."""
-                prefix = match.group(1)  # Everything before [N x i8]
-                declared_size = int(match.group(2))  # The declared size N
-                string_content = match.group(3)  # The string inside c"..."
-                suffix = match.group(4)  # Everything after (e.g., ", align 1")
-
-                actual_size = count_string_bytes(string_content)
-
-                if actual_size != declared_size:
-                    self.logger.debug(f"Fixing string size: [{declared_size} x i8] -> [{actual_size} x i8]")
-
-                return f'{prefix}[{actual_size} x i8] c"{string_content}"{suffix}'
-
-            # Pattern to match string constant declarations:
-            # @.str.X = ... constant [N x i8] c"...", align X
-            # Capture groups: (prefix)(size)(string_content)(suffix)
-            string_const_pattern = r'((?:@[^\s]+\s*=\s*)?(?:private\s+)?(?:unnamed_addr\s+)?(?:constant\s+)?)\[(\d+)\s+x\s+i8\]\s+c"([^"]*)"((?:\s*,\s*align\s+\d+)?)'
-            ir_content = re.sub(string_const_pattern, fix_string_constant_size, ir_content)
-
-            # ============================================================
-            # FIX: Bug #2 - MLIR string encryption size mismatch
-            # The MLIR string-encrypt pass sometimes generates incorrect array
-            # size declarations. For example: [23 x i8] but content is 22 bytes.
-            # This fix recalculates the actual byte count and fixes the size.
-            # ============================================================
-            def count_string_bytes(s):
-                """Count actual bytes in an LLVM IR string literal (inside c"...")."""
-                count = 0
-                i = 0
-                while i < len(s):
-                    if s[i] == '\\' and i + 1 < len(s):
-                        next_char = s[i+1]
-                        # Handle escaped backslash: \\ = 1 byte
-                        if next_char == '\\':
-                            count += 1
-                            i += 2
-                            continue
-                        # Handle hex escape: \xx = 1 byte
-                        if i + 2 < len(s):
-                            hex_chars = s[i+1:i+3]
-                            if all(c in '0123456789abcdefABCDEF' for c in hex_chars):
-                                count += 1
-                                i += 3
-                                continue
-                    # Regular character
-                    count += 1
-                    i += 1
-                return count
-
-            def fix_string_constant_size(match):
-                """Fix the array size in string constant declarations."""
-                prefix = match.group(1)  # Everything before [N x i8]
-                declared_size = int(match.group(2))  # The declared size N
-                string_content = match.group(3)  # The string inside c"..."
-                suffix = match.group(4)  # Everything after (e.g., ", align 1")
-
-                actual_size = count_string_bytes(string_content)
-
-                if actual_size != declared_size:
-                    self.logger.debug(f"Fixing string size: [{declared_size} x i8] -> [{actual_size} x i8]")
-
-                return f'{prefix}[{actual_size} x i8] c"{string_content}"{suffix}'
-
-            # Pattern to match string constant declarations:
-            # @.str.X = ... constant [N x i8] c"...", align X
-            # Capture groups: (prefix)(size)(string_content)(suffix)
-            string_const_pattern = r'((?:@[^\s]+\s*=\s*)?(?:private\s+)?(?:unnamed_addr\s+)?(?:constant\s+)?)\[(\d+)\s+x\s+i8\]\s+c"([^"]*)"((?:\s*,\s*align\s+\d+)?)'
-            ir_content = re.sub(string_const_pattern, fix_string_constant_size, ir_content)
+            statistics_json = destination_abs.parent / f"{destination_abs.stem}_mlir_stats.json"
+            mlir_metrics_json = destination_abs.parent / f"{destination_abs.stem}_mlir_pass_metrics.json"
+
+            if mlir_driver:
+                # 1b-1d: import, obfuscate, export and repair in one process,
+                # no .mlir or unrepaired IR on disk
+                driver_cmd = [
+                    str(mlir_driver),
+                    str(llvm_ir_temp),
+                    f"--pass-pipeline={pass_pipeline}",
+                    f"--statistics-json={statistics_json}",
+                    *self._pass_metrics_driver_flags(config, mlir_metrics_json),
+                    f"--target-triple={target_triple}",
+                    f"--data-layout={data_layout}",
+                    f"--strip-attrs={','.join(self.EXPORT_STRIP_ATTRIBUTES)}",
+                    "-o", str(llvm_ir_file),
+                ]
+                if ir_suffix == ".ll":
+                    driver_cmd.append("-S")
+                run_command(driver_cmd, cwd=source_abs.parent)
+                self._load_mlir_statistics_json(statistics_json)
+                self._collect_pass_metrics(mlir_metrics_json, "mlir", config)
+            else:
+                # Save external function declarations from original IR
+                # mlir-translate drops these, so we need to restore them later
+                with open(str(llvm_ir_temp), 'r') as f:
+                    original_ir = f.read()
+                original_declarations = re.findall(r'^declare\s+.+$', original_ir, re.MULTILINE)
+                self.logger.debug(f"Saved {len(original_declarations)} external declarations from original IR")
+
+                # 1b-1c: Convert LLVM IR to MLIR and apply the MLIR obfuscation
+                # passes. The imported text is piped, not written; the result
+                # is persisted as bytecode, which mlir-translate reads back.
+                translate_to_mlir_cmd = ["mlir-translate", "--import-llvm", str(llvm_ir_temp)]
+                opt_cmd = [
+                    "mlir-opt",
+                    "-",
+                    f"--load-pass-plugin={str(mlir_plugin)}",
+                    f"--pass-pipeline={pass_pipeline}",
+                    *statistics_flags,
+                    *self._emit_mlir_flags(config),
+                    "-o", str(obfuscated_mlir)
+                ]
+                _, _, opt_stderr = run_pipeline([translate_to_mlir_cmd, opt_cmd], cwd=source_abs.parent)
 
-            with open(str(llvm_ir_file), 'w') as f:
-                f.write(ir_content)
+                # 1d: Translate MLIR back to LLVM IR
+                translate_cmd = ["mlir-translate", "--mlir-to-llvmir", str(obfuscated_mlir), "-o", str(llvm_ir_raw)]
+                run_command(translate_cmd, cwd=source_abs.parent)
 
-            # ✅ NEW: Extract MLIR pass metrics BEFORE cleanup
-            # Store MLIR metrics for later analysis in _estimate_metrics
-            if obfuscated_mlir.exists():
-                try:
-                    # Extract string and symbol metrics from obfuscated MLIR
-                    mlir_content = obfuscated_mlir.read_text(errors='ignore')
-
-                    # Count globals in MLIR - more flexible pattern matching
-                    # Can be: llvm.global, llvm.mlir.global, or just @name declarations
-                    global_pattern = r'(@[\w\._]+)\s*='
-                    globals_found = re.findall(global_pattern, mlir_content)
-                    total_globals = len(set(globals_found))  # Unique globals
-
-                    # Count string constants - look for character array types in MLIR
-                    # Pattern: !llvm.array<N x i8> - these are string arrays (encrypted or not)
-                    string_arrays = re.findall(r'!llvm\.array\<\d+\s*x\s*i8\>', mlir_content)
-                    encrypted_strings_count = len(string_arrays)
-
-                    # Count functions - pattern: func.func @name(...)
-                    # Also try llvm.func if no func.func found
-                    func_pattern = r'(func\.func|llvm\.func)\s+@[\w\._]+'
-                    func_defs = re.findall(func_pattern, mlir_content)
-                    total_functions = len(func_defs)
-
-                    self._mlir_metrics = {
-                        'encrypted_strings_count': encrypted_strings_count,
-                        'total_globals': total_globals,
-                        'total_functions': total_functions,
-                    }
-                    self.logger.info(f"MLIR metrics captured: {self._mlir_metrics}")
-                except Exception as e:
-                    self.logger.debug(f"Failed to extract MLIR metrics: {e}")
-                    self._mlir_metrics = {}
+                # Fix target triple and data layout (MLIR sometimes generates malformed output)
+                self._repair_translated_ir(llvm_ir_raw, llvm_ir_file, original_declarations, target_triple, data_layout)
+                self._mlir_statistics = self._parse_mlir_statistics(opt_stderr)
+            if self._mlir_statistics:
+                self.logger.info("MLIR pass statistics: %s", self._mlir_statistics)
+            else:
+                self._mlir_ir_counts = self._count_mlir_sites(llvm_ir_file)
 
             current_input = llvm_ir_file
+            opaque_before = self._count_opaque_barriers(llvm_ir_file) or 0
 
             # Clean up raw IR
             if llvm_ir_raw.exists():
@@ -1333,8 +1590,6 @@ class LLVMObfuscator:
             # Clean up intermediate files
             if llvm_ir_temp.exists():
                 llvm_ir_temp.unlink()
-            if mlir_file.exists():
-                mlir_file.unlink()
             if obfuscated_mlir.exists():
                 obfuscated_mlir.unlink()
         else:
@@ -1364,12 +1619,46 @@ class LLVMObfuscator:
 
         if ollvm_passes:
 
+            # Determine opt binary path - check multiple locations
+            plugin_path_resolved = Path(plugin_path)
+            bundled_opt = plugin_path_resolved.parent / "opt"
+            bundled_clang = plugin_path_resolved.parent.parent / "bin" / "clang.real"
+            opt_binary = None
+
+            if bundled_opt.exists():
+                self.logger.info("Using bundled opt: %s", bundled_opt)
+                opt_binary = bundled_opt
+                if bundled_clang.exists():
+                    self.logger.info("Using bundled clang from LLVM 22: %s", bundled_clang)
+                    compiler = str(bundled_clang)
+            elif Path("/usr/local/llvm-obfuscator/bin/opt").exists():
+                opt_binary = Path("/usr/local/llvm-obfuscator/bin/opt")
+                self.logger.info("Using opt from Docker installation: %s", opt_binary)
+                docker_clang = Path("/usr/local/llvm-obfuscator/bin/clang")
+                if docker_clang.exists():
+                    compiler = str(docker_clang)
+                    self.logger.info("Using bundled clang from Docker installation (LLVM 22): %s", compiler)
+            elif "/llvm-project/build/lib/" in str(plugin_path_resolved):
+                llvm_build_dir = plugin_path_resolved.parent.parent
+                opt_binary = llvm_build_dir / "bin" / "opt"
+                llvm_clang = llvm_build_dir / "bin" / "clang"
+                if opt_binary.exists():
+                    self.logger.info("Using opt from LLVM build: %s", opt_binary)
+                    if llvm_clang.exists():
+                        compiler = str(llvm_clang)
+                else:
+                    raise ObfuscationError("Custom opt binary not found")
+            else:
+                raise ObfuscationError(f"OLLVM opt binary not found at {bundled_opt}")
+
             # If the input is still a source file, compile it to LLVM IR
+            # (bitcode, produced by the same LLVM as opt, unless text_ir is set)
             if current_input.suffix not in ['.ll', '.bc']:
-                ir_file = destination_abs.parent / f"{destination_abs.stem}_temp.ll"
+                ir_file = destination_abs.parent / f"{destination_abs.stem}_temp{self._ir_suffix(config)}"
                 # Apply -O3 BEFORE obfuscation for stable, optimized code
                 pre_obfuscation_flags = ["-O3", "-fno-builtin", "-fno-slp-vectorize", "-fno-vectorize"]
-                ir_cmd = [compiler, str(current_input), "-S", "-emit-llvm", "-o", str(ir_file)] + pre_obfuscation_flags
+                ir_cmd = [compiler, str(current_input), *self._emit_ir_flags(config), "-o", str(ir_file)] + pre_obfuscation_flags
+                ir_cmd.extend(profile_flags)
                 # Add resource-dir flag if using custom clang
                 resource_dir_flags = self._get_resource_dir_flag(compiler)
                 if resource_dir_flags:
@@ -1382,57 +1671,59 @@ class LLVMObfuscator:
 
                 # ============================================================
                 # FIX: Strip problematic LLVM 22+ attributes from clang-generated IR
-                # Same fix as MLIR path - math intrinsics have incompatible attributes
+                # Same fix as MLIR path - math intrinsics have incompatible attributes.
+                # Only the text parser trips over them; bitcode needs no fixing.
                 # ============================================================
-                with open(str(ir_file), 'r') as f:
-                    ir_content = f.read()
-
-                # Remove problematic attributes
-                ir_content = re.sub(r'\bnocreateundeforpoison\b\s*', '', ir_content)
-                ir_content = re.sub(r'\bmemory\([^)]*\)\s*', '', ir_content)
-                ir_content = re.sub(r'\bspeculatable\b\s*', '', ir_content)
-                ir_content = re.sub(r'\bconvergent\b\s*', '', ir_content)
-
-                # Clean up multiple spaces left by removed attributes
-                # IMPORTANT: Only collapse spaces OUTSIDE of string constants (c"...")
-                # to avoid corrupting string literal content
-                def collapse_spaces_outside_strings(content):
-                    result = []
-                    i = 0
-                    while i < len(content):
-                        # Check for string constant start: c"
-                        if content[i:i+2] == 'c"':
-                            # Find the end of the string constant
-                            result.append('c"')
-                            i += 2
-                            while i < len(content) and content[i] != '"':
-                                if content[i] == '\\' and i + 1 < len(content):
-                                    # Escape sequence - copy both characters
-                                    result.append(content[i:i+2])
-                                    i += 2
-                                else:
-                                    result.append(content[i])
+                if ir_file.suffix == ".ll":
+                    with open(str(ir_file), 'r') as f:
+                        ir_content = f.read()
+
+                    # Remove problematic attributes
+                    ir_content = re.sub(r'\bnocreateundeforpoison\b\s*', '', ir_content)
+                    ir_content = re.sub(r'\bmemory\([^)]*\)\s*', '', ir_content)
+                    ir_content = re.sub(r'\bspeculatable\b\s*', '', ir_content)
+                    ir_content = re.sub(r'\bconvergent\b\s*', '', ir_content)
+
+                    # Clean up multiple spaces left by removed attributes
+                    # IMPORTANT: Only collapse spaces OUTSIDE of string constants (c"...")
+                    # to avoid corrupting string literal content
+                    def collapse_spaces_outside_strings(content):
+                        result = []
+                        i = 0
+                        while i < len(content):
+                            # Check for string constant start: c"
+                            if content[i:i+2] == 'c"':
+                                # Find the end of the string constant
+                                result.append('c"')
+                                i += 2
+                                while i < len(content) and content[i] != '"':
+                                    if content[i] == '\\' and i + 1 < len(content):
+                                        # Escape sequence - copy both characters
+                                        result.append(content[i:i+2])
+                                        i += 2
+                                    else:
+                                        result.append(content[i])
+                                        i += 1
+                                if i < len(content):
+                                    result.append('"')
                                     i += 1
-                            if i < len(content):
-                                result.append('"')
-                                i += 1
-                        # Check for multiple spaces outside strings
-                        elif content[i] == ' ' and i + 1 < len(content) and content[i+1] == ' ':
-                            result.append(' ')
-                            while i < len(content) and content[i] == ' ':
+                            # Check for multiple spaces outside strings
+                            elif content[i] == ' ' and i + 1 < len(content) and content[i+1] == ' ':
+                                result.append(' ')
+                                while i < len(content) and content[i] == ' ':
+                                    i += 1
+                            else:
+                                result.append(content[i])
                                 i += 1
-                        else:
-                            result.append(content[i])
-                            i += 1
-                    return ''.join(result)
-                ir_content = collapse_spaces_outside_strings(ir_content)
+                        return ''.join(result)
+                    ir_content = collapse_spaces_outside_strings(ir_content)
 
-                ir_content = re.sub(r'attributes #\d+ = \{\s*\}', '', ir_content)
+                    ir_content = re.sub(r'attributes #\d+ = \{\s*\}', '', ir_content)
 
-                with open(str(ir_file), 'w') as f:
-                    f.write(ir_content)
+                    with open(str(ir_file), 'w') as f:
+                        f.write(ir_content)
 
-                self.logger.info("Stripped problematic LLVM 22+ intrinsic attributes from IR")
+                    self.logger.info("Stripped problematic LLVM 22+ intrinsic attributes from IR")
 
             # Check for C++ exception handling - Hikari approach
             # Flattening crashes on EH, but other passes work fine
@@ -1448,47 +1739,27 @@ class LLVMObfuscator:
                     ollvm_passes = [p for p in ollvm_passes if p != "flattening"]
                     actually_applied_passes = [p for p in actually_applied_passes if p != "flattening"]
 
-            # Determine opt binary path - check multiple locations
-            plugin_path_resolved = Path(plugin_path)
-            bundled_opt = plugin_path_resolved.parent / "opt"
-            bundled_clang = plugin_path_resolved.parent.parent / "bin" / "clang.real"
-            opt_binary = None
-
-            if bundled_opt.exists():
-                self.logger.info("Using bundled opt: %s", bundled_opt)
-                opt_binary = bundled_opt
-                if bundled_clang.exists():
-                    self.logger.info("Using bundled clang from LLVM 22: %s", bundled_clang)
-                    compiler = str(bundled_clang)
-            elif Path("/usr/local/llvm-obfuscator/bin/opt").exists():
-                opt_binary = Path("/usr/local/llvm-obfuscator/bin/opt")
-                self.logger.info("Using opt from Docker installation: %s", opt_binary)
-                docker_clang = Path("/usr/local/llvm-obfuscator/bin/clang")
-                if docker_clang.exists():
-                    compiler = str(docker_clang)
-                    self.logger.info("Using bundled clang from Docker installation (LLVM 22): %s", compiler)
-            elif "/llvm-project/build/lib/" in str(plugin_path_resolved):
-                llvm_build_dir = plugin_path_resolved.parent.parent
-                opt_binary = llvm_build_dir / "bin" / "opt"
-                llvm_clang = llvm_build_dir / "bin" / "clang"
-                if opt_binary.exists():
-                    self.logger.info("Using opt from LLVM build: %s", opt_binary)
-                    if llvm_clang.exists():
-                        compiler = str(llvm_clang)
-                else:
-                    raise ObfuscationError("Custom opt binary not found")
-            else:
-                raise ObfuscationError(f"OLLVM opt binary not found at {bundled_opt}")
+            if ollvm_passes and current_input.suffix in (".ll", ".bc"):
+                if config.size_budget.enabled and self._size_plan is None:
+                    self._plan_size_budget(current_input, config, [], ollvm_passes, destination_abs)
+                self._apply_function_limits(current_input, config, ollvm_passes, bool(profile_flags))
+                limits_applied = True
 
             # Only continue with OLLVM if we still have passes enabled
             if ollvm_passes:
                 # Apply OLLVM passes
                 obfuscated_ir = destination_abs.parent / f"{destination_abs.stem}_obfuscated.bc"
                 passes_pipeline = ",".join(ollvm_passes)
+                if config.advanced.recovery_pipeline:
+                    # Same opt process as the OLLVM passes, plugin already loaded
+                    passes_pipeline = f"{passes_pipeline},{self.RECOVERY_PIPELINE}"
+                    recovered = True
                 # NOTE: Not loading plugin - passes are built into libLLVM.so.22.0git
                 # Loading plugin would cause "Option registered more than once" error
+                llvm_metrics_json = destination_abs.parent / f"{destination_abs.stem}_llvm_pass_metrics.json"
                 opt_cmd = [
                     str(opt_binary),
+                    *self._pass_metrics_opt_flags(config, llvm_metrics_json),
                     f"-load-pass-plugin={str(plugin_path)}",
                     f"-passes={passes_pipeline}",
                     str(current_input),
@@ -1497,8 +1768,35 @@ class LLVMObfuscator:
                 self.logger.info(f"Applying OLLVM passes via opt with plugin: {plugin_path}")
                 self.logger.info(f"Command: {' '.join(opt_cmd)}")
                 run_command(opt_cmd, cwd=source_abs.parent)
+                self._collect_pass_metrics(llvm_metrics_json, "ollvm", config)
                 current_input = obfuscated_ir
 
+        # MLIR-only runs: report tiers and policies from the IR the final compile sees
+        if not limits_applied and current_input.suffix in (".ll", ".bc"):
+            self._apply_function_limits(current_input, config, [], bool(profile_flags))
+
+        # Stage 2b: Post-obfuscation recovery (when OLLVM did not already run it)
+        if config.advanced.recovery_pipeline and not recovered and current_input.suffix in ['.ll', '.bc']:
+            recovered_ir = self._run_recovery_pipeline(current_input, destination_abs, config, source_abs.parent)
+            if recovered_ir:
+                current_input = recovered_ir
+                recovered = True
+            else:
+                warnings.append("Recovery pipeline skipped: no opt binary found; final clang will re-optimize.")
+
+        if recovered:
+            opaque_after = self._count_opaque_barriers(current_input)
+            self._recovery_metrics = {
+                "pipeline": self.RECOVERY_PIPELINE,
+                "opaque_values_before": opaque_before,
+                "opaque_values_after": opaque_after,
+            }
+            if opaque_after is not None and opaque_after < opaque_before:
+                warnings.append(
+                    f"Recovery pipeline removed {opaque_before - opaque_after} of {opaque_before} opaque values"
+                )
+            self.logger.info(f"Recovery pipeline applied: {self._recovery_metrics}")
+
         # ═══════════════════════════════════════════════════════════
         # VM LAYER (OPTIONAL, ISOLATED, EXPERIMENTAL)
         # ═══════════════════════════════════════════════════════════
@@ -1507,12 +1805,20 @@ class LLVMObfuscator:
 
             virtualized_ll = destination_abs.parent / f"{destination_abs.stem}_virtualized.ll"
 
+            # The virtualizer parses textual IR
+            vm_input = current_input
+            if current_input.suffix == ".bc":
+                vm_input = destination_abs.parent / f"{destination_abs.stem}_vm_input.ll"
+                vm_input.write_text(self.ir_analyzer.ir_text(current_input) or "")
+
             vm_result = run_vm_isolated(
-                input_ll=current_input,
+                input_ll=vm_input,
                 output_ll=virtualized_ll,
                 functions=config.vm.functions,
                 timeout=config.vm.timeout,
             )
+            if vm_input != current_input:
+                vm_input.unlink(missing_ok=True)
 
             if vm_result.success:
                 current_input = virtualized_ll
@@ -1530,6 +1836,10 @@ class LLVMObfuscator:
         # Stage 3: Compile to binary
         self.logger.info("Compiling final IR to binary...")
         final_cmd = [compiler, str(current_input), "-o", str(destination_abs)] + compiler_flags
+        final_cmd[2:2] = self._runtime_link_args(compiler, destination_abs, config, source_abs.parent)
+        if recovered:
+            # Middle-end already ran (recovery pipeline); -O only drives codegen now
+            final_cmd.extend(["-Xclang", "-disable-llvm-passes"])
         # Add cross-compilation flags (target triple + sysroot for macOS)
         cross_compile_flags = self._get_cross_compile_flags(config.platform, config.architecture)
         final_cmd.extend(cross_compile_flags)
@@ -1577,6 +1887,8 @@ class LLVMObfuscator:
             except Exception as e:
                 self.logger.warning(f"Obfuscated IR analysis failed: {e}")
 
+        predicted_overhead = self._predict_overhead(current_input, config)
+
         # Cleanup any remaining intermediate files (unless preserve_ir is enabled)
         if not config.advanced.preserve_ir and current_input != source_abs and current_input.exists():
             current_input.unlink()
@@ -1594,7 +1906,547 @@ class LLVMObfuscator:
             },
             # ✅ NEW: Include BCF metrics in result
             "bcf_metrics": bcf_metrics,
+            "predicted_overhead": predicted_overhead,
+            "recovery": self._recovery_metrics,
+            "pass_metrics": self._write_pass_metrics(destination_abs),
+        }
+
+    def _find_recovery_opt(self, config: ObfuscationConfig) -> Optional[Path]:
+        """Locate an opt binary for the recovery pipeline (bundled LLVM 22 first)."""
+        import shutil
+
+        plugin_path = config.custom_pass_plugin or self._get_bundled_plugin_path(config.platform)
+        candidates = []
+        if plugin_path:
+            candidates.append(Path(plugin_path).parent / "opt")
+        candidates.append(Path("/usr/local/llvm-obfuscator/bin/opt"))
+        for candidate in candidates:
+            if candidate.exists():
+                return candidate
+        system_opt = shutil.which("opt")
+        return Path(system_opt) if system_opt else None
+
+    def _ir_passes_available(self, config: ObfuscationConfig) -> bool:
+        """Source-level transforms have mlir-obs replacements on the default frontend when the plugin exists."""
+        return config.mlir_frontend == MLIRFrontend.CLANG and self._get_mlir_plugin_path() is not None
+
+    def _use_ir_fake_loops(self, config: ObfuscationConfig) -> bool:
+        return config.advanced.fake_loops > 0 and self._ir_passes_available(config)
+
+    def _use_ir_indirect_calls(self, config: ObfuscationConfig) -> bool:
+        return config.advanced.indirect_calls.enabled and self._ir_passes_available(config)
+
+    def _anti_debug_techniques(self, config: ObfuscationConfig) -> List[str]:
+        techniques = config.advanced.anti_debug.techniques
+        return [t for t in techniques if t in self.ANTI_DEBUG_RUNTIME_TECHNIQUES]
+
+    def _use_ir_anti_debug(self, config: ObfuscationConfig) -> bool:
+        """The runtime is Linux-only; other targets keep the source-level injector."""
+        return (
+            config.advanced.anti_debug.enabled
+            and config.platform == Platform.LINUX
+            and bool(self._anti_debug_techniques(config))
+            and self._get_runtime_source(self.ANTI_DEBUG_RUNTIME) is not None
+            and self._ir_passes_available(config)
+        )
+
+    def _use_self_checksum(self, config: ObfuscationConfig) -> bool:
+        """The self-checksum runtime reads its own ELF image; Linux only, any frontend."""
+        return (
+            config.advanced.self_checksum.enabled
+            and config.platform == Platform.LINUX
+            and self._get_runtime_source(self.SELF_CHECKSUM_RUNTIME) is not None
+        )
+
+    def _self_checksum_mode(self, config: ObfuscationConfig) -> str:
+        """Piggyback needs the anti-debug runtime to drive it; otherwise use the thread."""
+        mode = config.advanced.self_checksum.mode
+        if mode not in self.SELF_CHECKSUM_MODES:
+            return "thread"
+        if mode == "piggyback" and not self._use_ir_anti_debug(config):
+            return "thread"
+        return mode
+
+    def _get_runtime_source(self, name: str) -> Optional[Path]:
+        """Find an mlir-obs runtime source next to the mlir-obs sources or a bundled copy."""
+        search_paths = [
+            Path(__file__).parent.parent / "runtime" / name,
+            Path(__file__).parent.parent.parent.parent / "mlir-obs" / "runtime" / name,
+            Path("/app/mlir-obs/runtime") / name,
+            Path("/usr/local/llvm-obfuscator/runtime") / name,
+        ]
+        for path in search_paths:
+            if path.exists():
+                return path
+        return None
+
+    def _compile_runtime(
+        self,
+        name: str,
+        compiler: str,
+        destination_abs: Path,
+        config: ObfuscationConfig,
+        cwd: Path,
+        defines: Optional[List[str]] = None,
+    ) -> Path:
+        """Build a runtime at -O2 on its own; the final link may run with the middle-end disabled."""
+        runtime_obj = destination_abs.parent / f"{destination_abs.stem}_{Path(name).stem}.o"
+        # -x c: compiler may be clang++ for C++ sources
+        cmd = [compiler, "-x", "c", "-O2", "-c", str(self._get_runtime_source(name)), "-o", str(runtime_obj)]
+        cmd.extend(defines or [])
+        cmd.extend(self._get_resource_dir_flag(compiler))
+        cmd.extend(self._get_cross_compile_flags(config.platform, config.architecture))
+        run_command(cmd, cwd=cwd)
+        return runtime_obj
+
+    def _runtime_link_args(
+        self, compiler: str, destination_abs: Path, config: ObfuscationConfig, cwd: Path
+    ) -> List[str]:
+        """Runtime objects (and flags) the final link needs for the enabled protections."""
+        args: List[str] = []
+        if self._use_ir_anti_debug(config):
+            args.append(str(self._compile_runtime(self.ANTI_DEBUG_RUNTIME, compiler, destination_abs, config, cwd)))
+        if self._use_self_checksum(config):
+            self_checksum = config.advanced.self_checksum
+            mode = self._self_checksum_mode(config)
+            defines = [
+                f"-DOBFS_SC_MODE=OBFS_SC_MODE_{mode.upper()}",
+                f"-DOBFS_SC_BUDGET_PERMILLE={self_checksum.cpu_budget_permille}",
+                f"-DOBFS_SC_CHUNKS_PER_STEP={self_checksum.chunks_per_step}",
+            ]
+            args.append(
+                str(self._compile_runtime(self.SELF_CHECKSUM_RUNTIME, compiler, destination_abs, config, cwd, defines))
+            )
+            if mode == "thread":
+                args.append("-pthread")
+        return args
+
+    def _profile_flags(self, config: ObfuscationConfig) -> List[str]:
+        """Clang flags that attach profile counts to the emitted IR (clang frontend only)."""
+        profile = config.profile.path
+        if profile is None or not profile.exists() or config.mlir_frontend != MLIRFrontend.CLANG:
+            return []
+        profile = profile.resolve()
+        if ProfileTiers.profile_kind(profile) == "instr":
+            return [
+                f"-fprofile-instr-use={profile}",
+                "-Wno-profile-instr-unprofiled",
+                "-Wno-profile-instr-out-of-date",
+            ]
+        return [f"-fprofile-sample-use={profile}", "-gline-tables-only"]
+
+    def _apply_sample_profile(self, ir_file: Path, config: ObfuscationConfig, cwd: Path) -> None:
+        """
+        Sample profiles are applied by an LLVM pass, which -disable-llvm-passes
+        skips; run just that pass so the MLIR stage sees the counts.
+        """
+        profile = config.profile.path
+        if not self._profile_flags(config) or ProfileTiers.profile_kind(profile) != "sample":
+            return
+        opt_binary = self._find_recovery_opt(config)
+        if not opt_binary:
+            self.logger.warning("No opt binary found; sample profile not applied to the MLIR stage")
+            return
+        annotated = ir_file.with_name(f"{ir_file.stem}_profiled{ir_file.suffix}")
+        text_flag = ["-S"] if ir_file.suffix == ".ll" else []
+        run_command(
+            [str(opt_binary), *text_flag, "-passes=sample-profile", f"-sample-profile-file={profile.resolve()}",
+             str(ir_file), "-o", str(annotated)],
+            cwd=cwd,
+        )
+        annotated.replace(ir_file)
+
+    def _apply_function_limits(
+        self, ir_file: Path, config: ObfuscationConfig, ollvm_passes: List[str], profiled: bool
+    ) -> None:
+        """
+        Tier (profile) and policy (annotations, policy file) limits of the
+        functions in the IR; limited functions are opted out of costly
+        OLLVM passes. A policy overrides the function's tier.
+        """
+        ir_text = self.ir_analyzer.ir_text(ir_file)
+        if ir_text is None:
+            self.logger.warning(f"Cannot read {ir_file.name} as text; function tiers and policies not applied")
+            return
+        limits: Dict[str, str] = {}
+        if profiled:
+            self._profile_report, limits = self._profile_tiers(ir_text, config)
+
+        policy = FunctionPolicy.from_file(Path(config.policy_file)) if config.policy_file else FunctionPolicy()
+        policies = policy.resolve(ir_text)
+        limits.update({name: FunctionPolicy.LIMITS[p] for name, p in policies.items()})
+
+        skips: Dict[str, List[str]] = {}
+        if self._size_plan is not None and ollvm_passes:
+            # Planned before the MLIR stage renamed anything: use what
+            # size-budget recorded on the functions, else the plan by name
+            recorded = function_string_attributes(ir_text, "obf-budget-ollvm")
+            if recorded:
+                skips = {name: [p for p in ollvm_passes if p not in allowed.split(",")]
+                         for name, allowed in recorded.items()}
+            else:
+                skips = self._size_plan.ollvm_skips(ollvm_passes, SizeBudgetPlanner().measure(ir_text))
+
+        annotated_text, annotations = ProfileTiers().annotate_ollvm(ir_text, limits, ollvm_passes, skips)
+        if annotations and not self.ir_analyzer.write_ir_text(ir_file, annotated_text):
+            self.logger.warning(f"Per-function OLLVM opt-outs not written to {ir_file.name}")
+        if self._profile_report:
+            self._profile_report["ollvm_annotations"] = annotations
+        if policies or config.policy_file:
+            self._policy_report = {
+                "enabled": True,
+                "policy_file": Path(config.policy_file).name if config.policy_file else None,
+                "functions": policy.summary(policies),
+                "ollvm_annotations": annotations,
+            }
+            self.logger.info(
+                "Function policies: %s",
+                ", ".join(f"{name} {count} fn" for name, count in self._policy_report["functions"].items()),
+            )
+
+    def _plan_size_budget(
+        self,
+        ir_file: Path,
+        config: ObfuscationConfig,
+        mlir_passes: List[str],
+        ollvm_passes: List[str],
+        destination: Path,
+    ) -> Path:
+        """Plan the size budget for the IR (or load the configured plan); returns the plan file."""
+        budget = config.size_budget
+        if budget.plan_file:
+            plan_path = Path(budget.plan_file).resolve()
+            self._size_plan = SizePlan.load(plan_path)
+            self.logger.info("Re-applying size plan %s", plan_path)
+        else:
+            planner = SizeBudgetPlanner(config.architecture)
+            transforms = [p.split("{", 1)[0] for p in mlir_passes]
+            ir_text = self.ir_analyzer.ir_text(ir_file)
+            if ir_text is None:
+                raise ObfuscationError(f"Cannot read {ir_file.name} to plan the size budget")
+            self._size_plan = planner.plan(ir_text, budget.growth_percent, transforms, ollvm_passes)
+            plan_path = destination.parent / f"{destination.stem}_size_plan.json"
+            self._size_plan.save(plan_path)
+        self._size_plan_path = plan_path
+        return plan_path
+
+    def _profile_tiers(self, ir_text: str, config: ObfuscationConfig) -> Tuple[Dict, Dict[str, str]]:
+        """Tier report and per-function transform limits from the profile counts in the IR."""
+        profile = config.profile
+        tiers_helper = ProfileTiers(profile.hot_percent, profile.warm_percent)
+        counts = tiers_helper.function_counts(ir_text)
+        if not counts:
+            self.logger.warning("Profile %s produced no counts in the IR (stale or mismatched?)", profile.path.name)
+            return {}, {}
+        tiers = tiers_helper.classify(counts)
+        policies = {"hot": profile.hot_policy, "warm": profile.warm_policy, "cold": "full"}
+        coverage = tiers_helper.coverage(counts, tiers)
+        self.logger.info(
+            "Profile tiers: %s",
+            ", ".join(f"{tier} {info['functions']} fn / {info['count_share_percent']}%" for tier, info in coverage.items()),
+        )
+        report = {
+            "enabled": True,
+            "profile": profile.path.name,
+            "kind": ProfileTiers.profile_kind(profile.path),
+            "policies": policies,
+            "coverage": coverage,
         }
+        return report, ProfileTiers.limits(tiers, policies)
+
+    def _median_runtime_ms(self, binary: Path, args: List[str], runs: int) -> Optional[float]:
+        times = []
+        for _ in range(runs):
+            start = time.perf_counter()
+            try:
+                subprocess.run([str(binary)] + args, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+                               timeout=300, check=False)
+            except (OSError, subprocess.TimeoutExpired) as e:
+                self.logger.warning(f"Runtime measurement of {binary.name} failed: {e}")
+                return None
+            times.append((time.perf_counter() - start) * 1000.0)
+        times.sort()
+        return times[len(times) // 2]
+
+    def _predict_overhead(self, ir_file: Path, config: ObfuscationConfig) -> Optional[Dict]:
+        """Per-function TTI cost of the obfuscated IR against the baseline's, ranked by added cost."""
+        prediction = config.advanced.overhead_prediction
+        if not prediction.enabled or ir_file.suffix not in (".ll", ".bc") or not ir_file.exists():
+            return None
+        if self._baseline_costs is None:
+            return {"status": "skipped", "error": "baseline IR costs unavailable (opt not found or analysis failed)"}
+        try:
+            obfuscated = self.overhead_predictor.function_costs(ir_file, mca=prediction.mca)
+        except ObfuscationError as e:
+            self.logger.warning(f"Obfuscated cost model analysis failed: {e}")
+            return {"status": "failed", "error": str(e)}
+        result = self.overhead_predictor.compare(self._baseline_costs, obfuscated, top=prediction.top)
+        if prediction.mca and not (self._baseline_costs.asm and obfuscated.asm):
+            result["mca_status"] = "skipped: llc or llvm-mca not found"
+        slowest = result["functions"][0] if result["functions"] else None
+        if slowest and slowest["added_cost"] > 0:
+            self.logger.info(
+                f"Predicted overhead: {result['functions_slower']} of {result['functions_compared']} functions slower, "
+                f"most added cost in {slowest['function']} (+{slowest['throughput_overhead_percent']}%)"
+            )
+        return result
+
+    def _compare_runtime(self, baseline: Path, obfuscated: Path, config: ObfuscationConfig) -> Dict:
+        """Median wall time of baseline vs. obfuscated binary (native Linux targets only)."""
+        if config.platform != Platform.LINUX or not sys.platform.startswith("linux"):
+            return {"status": "skipped", "error": "runtime is only measured for native Linux targets"}
+        if not baseline.exists() or not obfuscated.exists():
+            return {"status": "skipped", "error": "baseline or obfuscated binary missing"}
+        args = list(config.profile.benchmark_args or [])
+        runs = max(1, config.profile.benchmark_runs)
+        baseline_ms = self._median_runtime_ms(baseline, args, runs)
+        obfuscated_ms = self._median_runtime_ms(obfuscated, args, runs)
+        if baseline_ms is None or obfuscated_ms is None:
+            return {"status": "failed"}
+        return {
+            "status": "success",
+            "runs": runs,
+            "baseline_ms": round(baseline_ms, 3),
+            "obfuscated_ms": round(obfuscated_ms, 3),
+            "overhead_percent": round(100.0 * (obfuscated_ms - baseline_ms) / baseline_ms, 2) if baseline_ms else 0.0,
+        }
+
+    def _get_pass_metrics_plugin_path(self) -> Optional[Path]:
+        """Find the ObsPassMetrics opt plugin (mlir-obs/tools)."""
+        search_paths = [
+            Path(__file__).parent.parent.parent.parent / "mlir-obs" / "build" / "tools" / "ObsPassMetrics.so",
+            Path("/app/mlir-obs/build/tools/ObsPassMetrics.so"),
+            Path("/usr/local/llvm-obfuscator/lib/ObsPassMetrics.so"),
+        ]
+        for path in search_paths:
+            if path.exists():
+                return path
+        return None
+
+    @staticmethod
+    def _is_system_opt(opt_binary: Path) -> bool:
+        import shutil
+
+        system_opt = shutil.which("opt")
+        return system_opt is not None and Path(system_opt) == opt_binary
+
+    def _pass_metrics_driver_flags(self, config: ObfuscationConfig, metrics_file: Path) -> List[str]:
+        """mlir-obfuscate flags that snapshot the module after every pass, if per_pass_metrics is on."""
+        return [f"--pass-metrics-json={metrics_file}"] if config.advanced.per_pass_metrics else []
+
+    def _pass_metrics_opt_flags(self, config: ObfuscationConfig, metrics_file: Path) -> List[str]:
+        """opt flags that load ObsPassMetrics and snapshot the module after every pass."""
+        if not config.advanced.per_pass_metrics:
+            return []
+        plugin = self._get_pass_metrics_plugin_path()
+        if plugin is None:
+            return []
+        # -load registers -obs-pass-metrics while the command line is parsed;
+        # opt only does that for -load-pass-plugin since LLVM 15
+        return [f"-load={plugin}", f"-load-pass-plugin={plugin}", f"-obs-pass-metrics={metrics_file}"]
+
+    def _collect_pass_metrics(self, metrics_file: Path, stage: str, config: ObfuscationConfig) -> None:
+        """Append one stage's snapshots to the timeline, priced with the size-budget cost model."""
+        if not metrics_file.exists():
+            return
+        try:
+            with open(metrics_file, "r") as f:
+                data = json.load(f)
+        except (OSError, ValueError) as e:
+            self.logger.warning(f"Pass metrics of the {stage} stage unavailable: {e}")
+            return
+        finally:
+            metrics_file.unlink()
+        planner = SizeBudgetPlanner(config.architecture)
+        for snapshot in data.get("snapshots", []):
+            snapshot["stage"] = stage
+            sized = FunctionSize(opcodes=snapshot.get("opcodes", {}))
+            snapshot["code_size_bytes"] = round(planner.function_bytes(sized), 1)
+            self._pass_metrics.append(snapshot)
+
+    def _write_pass_metrics(self, destination: Path) -> Dict:
+        """Write the run's pass metrics timeline next to the output; returns its report entry."""
+        if not self._pass_metrics:
+            return {"enabled": False}
+        timeline_path = destination.parent / f"{destination.stem}_pass_metrics.json"
+        timeline_path.write_text(json.dumps({"snapshots": self._pass_metrics}, indent=2))
+        first, last = self._pass_metrics[0], self._pass_metrics[-1]
+        self.logger.info(
+            "Pass metrics: %d snapshots, %d -> %d instructions, %.0f -> %.0f estimated bytes (%s)",
+            len(self._pass_metrics), first["instructions"], last["instructions"],
+            first["code_size_bytes"], last["code_size_bytes"], timeline_path.name,
+        )
+        return {"enabled": True, "file": str(timeline_path), "snapshots": self._pass_metrics}
+
+    def _load_mlir_statistics_json(self, path: Path) -> None:
+        """Read mlir-obfuscate --statistics-json output into the statistics of this run."""
+        try:
+            with open(path, "r") as f:
+                data = json.load(f)
+        except (OSError, ValueError) as e:
+            self.logger.warning(f"MLIR pass statistics unavailable: {e}")
+            return
+        finally:
+            if path.exists():
+                path.unlink()
+        if not data.get("statistics-enabled", True):
+            self.logger.warning("MLIR pass statistics unavailable: mlir-obfuscate was built without LLVM statistics")
+            return
+        totals = self._counted_statistics({name: int(value) for name, value in data.get("totals", {}).items()})
+        if not totals:
+            return
+        self._mlir_statistics = totals
+        self._mlir_pass_statistics = {
+            name: {stat: int(value) for stat, value in stats.items()}
+            for name, stats in data.get("passes", {}).items()
+        }
+
+    def _parse_mlir_statistics(self, stderr: str) -> Dict[str, int]:
+        """Sum `(S) <n> <name> - ...` lines from --mlir-pass-statistics-display=list."""
+        stats: Dict[str, int] = {}
+        for match in self.MLIR_STATISTIC_PATTERN.finditer(stderr or ""):
+            stats[match.group(2)] = stats.get(match.group(2), 0) + int(match.group(1))
+        return self._counted_statistics(stats)
+
+    def _counted_statistics(self, stats: Dict[str, int]) -> Dict[str, int]:
+        """
+        The statistics, or none if every counter is 0: MLIR's Pass::Statistic
+        counts nothing in builds without LLVM statistics (NDEBUG), and the
+        report then falls back to scanning the IR.
+        """
+        if stats and not any(stats.values()):
+            self.logger.warning("MLIR pass statistics are all 0 (LLVM built without statistics); "
+                                "counting in the IR instead")
+            return {}
+        return stats
+
+    def _count_mlir_sites(self, ir_file: Path) -> Dict[str, int]:
+        """Count the sites MLIR_SITE_GLOBALS mark, and the icall table's entries, in textual or bitcode IR."""
+        ir_text = self.ir_analyzer.ir_text(ir_file) if ir_file.exists() else None
+        if ir_text is None:
+            return {}
+        counts = {}
+        for statistic, name in self.MLIR_SITE_GLOBALS.items():
+            uses = len(re.findall(rf"@{re.escape(name)}\b", ir_text))
+            definitions = len(re.findall(rf"^@{re.escape(name)}\s*=", ir_text, re.MULTILINE))
+            counts[statistic] = uses - definitions
+        table = self.ICALL_TABLE_PATTERN.search(ir_text)
+        counts["icall-table-entries"] = int(table.group(1)) if table else 0
+        return counts
+
+    def _mlir_count(self, statistic: str) -> int:
+        """A statistic of the last MLIR run, or its count in the IR if the run had no statistics."""
+        if statistic in self._mlir_statistics:
+            return self._mlir_statistics[statistic]
+        return self._mlir_ir_counts.get(statistic, 0)
+
+    def _mlir_pass_options(self, passes: List[str], config: ObfuscationConfig) -> List[str]:
+        """Attach the pass options set in the config to the mlir-obs pass names."""
+        if not config.passes.address_force_loops:
+            return passes
+        # Also mask vectorizable inner loops and estimated-hot blocks
+        return [f"{name}{{force-loops=true}}" if name == "address-obfuscation" else name for name in passes]
+
+    def _mlir_pass_pipeline(self, passes: List[str], encode_constants: bool = False) -> str:
+        """Wrap mlir-obs passes in a module pipeline that ends with obs-lower."""
+        stages = []
+        for name in self._fuse_mlir_passes(passes):
+            stages.append(self._nest_function_pass(name))
+            if not encode_constants:
+                continue
+            base, _, options = name.partition("{")
+            if base == "constant-obfuscate" or (base == self.FUSED_PASS and "constant-obfuscate" in options):
+                stages.append(self._nest_function_pass(self.CONSTANT_ENCODE_PASS))
+        return f"builtin.module({','.join(stages + [self.OBS_LOWER_PASS])})"
+
+    def _nest_function_pass(self, name: str) -> str:
+        """Anchor a FUNCTION_MLIR_PASSES entry on its op, after obs-hotness if it reads it."""
+        base = name.split("{", 1)[0]
+        anchor = self.FUNCTION_MLIR_PASSES.get(base)
+        if anchor is None:
+            return name
+        if base in self.HOTNESS_FUNCTION_PASSES:
+            return f"{self.HOTNESS_PASS},{anchor}({name})"
+        return f"{anchor}({name})"
+
+    def _fuse_mlir_passes(self, passes: List[str]) -> List[str]:
+        """Replace each run of two or more adjacent FUSABLE_MLIR_PASSES by FUSED_PASS."""
+        fused: List[str] = []
+        run: List[str] = []
+
+        def flush() -> None:
+            if len(run) > 1:
+                fused.append(f"{self.FUSED_PASS}{{transforms={','.join(run)}}}")
+            else:
+                fused.extend(run)
+            run.clear()
+
+        for name in passes:
+            if name in self.FUSABLE_MLIR_PASSES and name not in run:
+                run.append(name)
+                continue
+            flush()
+            if name in self.FUSABLE_MLIR_PASSES:
+                run.append(name)
+            else:
+                fused.append(name)
+        flush()
+        return fused
+
+    def _run_recovery_pipeline(
+        self,
+        ir_file: Path,
+        destination_abs: Path,
+        config: ObfuscationConfig,
+        cwd: Path,
+    ) -> Optional[Path]:
+        """Run RECOVERY_PIPELINE on obfuscated IR. Returns None if no opt binary is available."""
+        opt_binary = self._find_recovery_opt(config)
+        if not opt_binary:
+            self.logger.warning("Recovery pipeline requested but no opt binary found")
+            return None
+
+        recovered_ir = destination_abs.parent / f"{destination_abs.stem}_recovered.bc"
+        metrics_json = destination_abs.parent / f"{destination_abs.stem}_recovery_pass_metrics.json"
+        # The metrics plugin is built against the bundled LLVM, not whatever opt is on PATH
+        metrics_flags = [] if self._is_system_opt(opt_binary) else self._pass_metrics_opt_flags(config, metrics_json)
+        opt_cmd = [str(opt_binary), *metrics_flags, f"-passes={self.RECOVERY_PIPELINE}", str(ir_file), "-o", str(recovered_ir)]
+        self.logger.info(f"Running post-obfuscation recovery pipeline via {opt_binary}")
+        run_command(opt_cmd, cwd=cwd)
+        self._collect_pass_metrics(metrics_json, "recovery", config)
+        return recovered_ir
+
+    @staticmethod
+    def _ir_suffix(config: ObfuscationConfig) -> str:
+        """Suffix of IR handed between stages: bitcode unless text_ir asks for .ll."""
+        return ".ll" if config.advanced.text_ir else ".bc"
+
+    @staticmethod
+    def _emit_ir_flags(config: ObfuscationConfig) -> List[str]:
+        """clang flags that emit IR in the _ir_suffix format."""
+        return ["-S", "-emit-llvm"] if config.advanced.text_ir else ["-c", "-emit-llvm"]
+
+    @staticmethod
+    def _mlir_suffix(config: ObfuscationConfig) -> str:
+        """Suffix of persisted MLIR: bytecode unless text_ir asks for .mlir."""
+        return ".mlir" if config.advanced.text_ir else ".mlirbc"
+
+    @staticmethod
+    def _emit_mlir_flags(config: ObfuscationConfig) -> List[str]:
+        """mlir-opt flags that write MLIR in the _mlir_suffix format.
+
+        mlir-opt and mlir-translate detect bytecode on input, so readers need no flag.
+        """
+        return [] if config.advanced.text_ir else ["--emit-bytecode"]
+
+    def _count_opaque_barriers(self, ir_file: Path) -> Optional[int]:
+        """Count mlir-obs opaque barriers in textual or bitcode IR (None if it cannot be read)."""
+        if not ir_file.exists():
+            return None
+        ir_text = self.ir_analyzer.ir_text(ir_file)
+        if ir_text is None:
+            return None
+        return len(self.OPAQUE_BARRIER_PATTERN.findall(ir_text))
 
     def _compile_with_clangir(
         self,
@@ -1631,7 +2483,7 @@ class LLVMObfuscator:
 
         compiler = base_compiler
 
-        mlir_passes = [p for p in enabled_passes if p in ["string-encrypt", "symbol-obfuscate", "crypto-hash", "constant-obfuscate", "address-obfuscation"]]
+        mlir_passes = [p for p in enabled_passes if p in self.MLIR_PASSES]
         ollvm_passes = [p for p in enabled_passes if p not in mlir_passes]
 
         current_input = source_abs
@@ -1659,24 +2511,26 @@ class LLVMObfuscator:
         cir_input = cir_mlir_file
         if "address-obfuscation" in mlir_passes:
             self.logger.info("Applying Layer 1.5 address obfuscation to CIR...")
-            obfuscated_cir = destination_abs.parent / f"{destination_abs.stem}_cir_obfuscated.mlir"
+            obfuscated_cir = destination_abs.parent / f"{destination_abs.stem}_cir_obfuscated{self._mlir_suffix(config)}"
             cir_obf_cmd = [
                 "mlir-opt",
                 str(cir_input),
                 "--cir-address-obf",
+                *self._emit_mlir_flags(config),
                 "-o", str(obfuscated_cir)
             ]
             run_command(cir_obf_cmd, cwd=source_abs.parent)
             cir_input = obfuscated_cir
 
         # 1c: Lower CIR to Func dialect (or LLVM dialect if no Layer 1.5)
-        llvm_mlir_file = destination_abs.parent / f"{destination_abs.stem}_llvm.mlir"
+        llvm_mlir_file = destination_abs.parent / f"{destination_abs.stem}_llvm{self._mlir_suffix(config)}"
         if "address-obfuscation" in mlir_passes:
             # Use Layer 1.5 CIR-to-Func lowering
             lower_cmd = ["mlir-opt", str(cir_input), "--convert-cir-to-func", "-o", str(llvm_mlir_file)]
         else:
             # Use standard CIR-to-LLVM lowering
             lower_cmd = ["mlir-opt", str(cir_input), "--cir-to-llvm", "-o", str(llvm_mlir_file)]
+        lower_cmd[-2:-2] = self._emit_mlir_flags(config)
         run_command(lower_cmd, cwd=source_abs.parent)
 
         current_input = llvm_mlir_file
@@ -1691,18 +2545,21 @@ class LLVMObfuscator:
             if not mlir_plugin:
                 raise ObfuscationError("MLIR passes requested but plugin not found.")
 
-            obfuscated_mlir = destination_abs.parent / f"{destination_abs.stem}_obfuscated.mlir"
-            passes_str = ",".join(remaining_mlir_passes)
-            pass_pipeline = f"builtin.module({passes_str})"
+            obfuscated_mlir = destination_abs.parent / f"{destination_abs.stem}_obfuscated{self._mlir_suffix(config)}"
+            pass_pipeline = self._mlir_pass_pipeline(remaining_mlir_passes, config.passes.constant_encode)
 
             opt_cmd = [
                 "mlir-opt",
                 str(current_input),
                 f"--load-pass-plugin={str(mlir_plugin)}",
                 f"--pass-pipeline={pass_pipeline}",
+                "--mlir-pass-statistics",
+                "--mlir-pass-statistics-display=list",
+                *self._emit_mlir_flags(config),
                 "-o", str(obfuscated_mlir)
             ]
-            run_command(opt_cmd, cwd=source_abs.parent)
+            _, _, opt_stderr = run_command(opt_cmd, cwd=source_abs.parent)
+            self._mlir_statistics = self._parse_mlir_statistics(opt_stderr)
 
             current_input = obfuscated_mlir
 
@@ -1790,12 +2647,20 @@ class LLVMObfuscator:
 
             virtualized_ll = destination_abs.parent / f"{destination_abs.stem}_virtualized.ll"
 
+            # The virtualizer parses textual IR
+            vm_input = current_input
+            if current_input.suffix == ".bc":
+                vm_input = destination_abs.parent / f"{destination_abs.stem}_vm_input.ll"
+                vm_input.write_text(self.ir_analyzer.ir_text(current_input) or "")
+
             vm_result = run_vm_isolated(
-                input_ll=current_input,
+                input_ll=vm_input,
                 output_ll=virtualized_ll,
                 functions=config.vm.functions,
                 timeout=config.vm.timeout,
             )
+            if vm_input != current_input:
+                vm_input.unlink(missing_ok=True)
 
             if vm_result.success:
                 current_input = virtualized_ll
@@ -1813,6 +2678,7 @@ class LLVMObfuscator:
         # Stage 5: Compile to binary
         self.logger.info("Compiling final IR to binary...")
         final_cmd = [compiler, str(current_input), "-o", str(destination_abs)] + compiler_flags
+        final_cmd[2:2] = self._runtime_link_args(compiler, destination_abs, config, source_abs.parent)
         # Add cross-compilation flags (target triple + sysroot for macOS)
         cross_compile_flags = self._get_cross_compile_flags(config.platform, config.architecture)
         final_cmd.extend(cross_compile_flags)
@@ -1844,6 +2710,156 @@ class LLVMObfuscator:
             "disabled_passes": []
         }
 
+    def _compile_with_polygeist(
+        self,
+        source: Path,
+        destination: Path,
+        config: ObfuscationConfig,
+        compiler_flags: List[str],
+        enabled_passes: List[str],
+        cycles: int = 1,
+    ) -> Dict:
+        """
+        Polygeist two-stage pipeline - optimize loop nests first, then obfuscate.
+
+        Pipeline: C/C++ → cgeist (affine/SCF MLIR) → affine fusion/tiling/vectorization
+                  → scf-obfuscate{preserve-loop-nests} → LLVM dialect → MLIR passes → Binary
+
+        Obfuscating before the affine passes blocks tiling, fusion and vectorization,
+        so numeric kernels lose most of their speed. Here the loop optimizations run
+        first and SCF obfuscation stays out of the optimized nests.
+
+        Args:
+            cycles: Number of times to apply OLLVM passes (unused: OLLVM is not run in this pipeline)
+        """
+        import shutil
+
+        source_abs = source.resolve()
+        destination_abs = destination.resolve()
+        work_dir = destination_abs.parent
+        stem = destination_abs.stem
+
+        warnings = []
+        actually_applied_passes = list(enabled_passes)
+
+        if source_abs.suffix in ['.cpp', '.cxx', '.cc', '.c++']:
+            compiler = "clang++"
+            compiler_flags = compiler_flags + ["-lstdc++"]
+        else:
+            compiler = "clang"
+
+        mlir_passes = [p for p in enabled_passes if p in self.MLIR_PASSES]
+        ollvm_passes = [p for p in enabled_passes if p not in mlir_passes]
+        mlir_passes = self._mlir_pass_options(mlir_passes, config)
+        if ollvm_passes:
+            warning_msg = (
+                f"OLLVM passes ({', '.join(ollvm_passes)}) are not supported with the Polygeist frontend. "
+                "Skipping them."
+            )
+            self.logger.warning(warning_msg)
+            warnings.append(warning_msg)
+            actually_applied_passes = [p for p in actually_applied_passes if p not in ollvm_passes]
+
+        cgeist = shutil.which("cgeist") or shutil.which("mlir-clang")
+        if not cgeist:
+            raise ObfuscationError(
+                "Polygeist frontend requested but 'cgeist' command not found. "
+                "Please ensure Polygeist is built and available in PATH."
+            )
+
+        mlir_plugin = self._get_mlir_plugin_path()
+        if not mlir_plugin:
+            raise ObfuscationError("Polygeist frontend requires the MLIR obfuscation plugin, but it was not found.")
+
+        # cgeist writes text; everything mlir-opt persists after it is bytecode
+        mlir_suffix = self._mlir_suffix(config)
+        emit_mlir_flags = self._emit_mlir_flags(config)
+        polygeist_file = work_dir / f"{stem}_polygeist.mlir"
+        affine_file = work_dir / f"{stem}_affine{mlir_suffix}"
+        scf_file = work_dir / f"{stem}_scf_obfuscated{mlir_suffix}"
+        llvm_mlir_file = work_dir / f"{stem}_llvm{mlir_suffix}"
+        obfuscated_mlir = work_dir / f"{stem}_obfuscated{mlir_suffix}"
+        llvm_ir_file = work_dir / f"{stem}_from_polygeist.ll"
+
+        # Stage 1: C/C++ → affine/SCF MLIR, then optimize the loop nests
+        # The frontend records the target on the module (llvm.target_triple),
+        # and mlir-translate writes it into the IR
+        target_triple = self._get_target_triple(config.platform, config.architecture)
+        self.logger.info("Running Polygeist frontend...")
+        run_command(
+            [
+                cgeist, str(source_abs), "--function=*", "--raise-scf-to-affine",
+                f"--target={target_triple}", "-o", str(polygeist_file),
+            ],
+            cwd=source_abs.parent,
+        )
+        self.logger.info("Optimizing affine loop nests before obfuscation...")
+        run_command(
+            ["mlir-opt", str(polygeist_file)] + self.POLYGEIST_AFFINE_PASSES + emit_mlir_flags + ["-o", str(affine_file)],
+            cwd=source_abs.parent,
+        )
+
+        # Stage 2: SCF obfuscation around (not inside) the optimized nests
+        run_command(
+            [
+                "mlir-opt",
+                str(affine_file),
+                f"--load-pass-plugin={str(mlir_plugin)}",
+                "--pass-pipeline=" + self._mlir_pass_pipeline(
+                    ["scf-obfuscate{preserve-loop-nests=true}", "cse", "loop-invariant-code-motion"]
+                ),
+                *emit_mlir_flags,
+                "-o", str(scf_file),
+            ],
+            cwd=source_abs.parent,
+        )
+
+        # Stage 3: Lower to the LLVM dialect and run the remaining MLIR passes there
+        run_command(
+            ["mlir-opt", str(scf_file)] + self.POLYGEIST_LOWERING_PASSES + emit_mlir_flags + ["-o", str(llvm_mlir_file)],
+            cwd=source_abs.parent,
+        )
+        current_input = llvm_mlir_file
+
+        if mlir_passes:
+            self.logger.info("Applying MLIR obfuscation passes: %s", ", ".join(mlir_passes))
+            pass_pipeline = self._mlir_pass_pipeline(mlir_passes, config.passes.constant_encode)
+            run_command(
+                [
+                    "mlir-opt",
+                    str(current_input),
+                    f"--load-pass-plugin={str(mlir_plugin)}",
+                    f"--pass-pipeline={pass_pipeline}",
+                    *emit_mlir_flags,
+                    "-o", str(obfuscated_mlir),
+                ],
+                cwd=source_abs.parent,
+            )
+            current_input = obfuscated_mlir
+
+        # Stage 4: MLIR → LLVM IR → binary
+        run_command(
+            ["mlir-translate", "--mlir-to-llvmir", str(current_input), "-o", str(llvm_ir_file)],
+            cwd=source_abs.parent,
+        )
+
+        self.logger.info("Compiling final IR to binary...")
+        final_cmd = [compiler, str(llvm_ir_file), "-o", str(destination_abs)] + compiler_flags
+        final_cmd[2:2] = self._runtime_link_args(compiler, destination_abs, config, source_abs.parent)
+        final_cmd.extend(self._get_cross_compile_flags(config.platform, config.architecture))
+        self._add_remarks_flags(final_cmd, config, destination_abs)
+        run_command(final_cmd, cwd=source_abs.parent)
+
+        for intermediate in (polygeist_file, affine_file, scf_file, llvm_mlir_file, obfuscated_mlir, llvm_ir_file):
+            if intermediate.exists():
+                intermediate.unlink()
+
+        return {
+            "applied_passes": actually_applied_passes,
+            "warnings": warnings,
+            "disabled_passes": ollvm_passes,
+        }
+
     def _calculate_detection_difficulty(self, obf_score: float, symbol_reduction: float, entropy_increase: float) -> str:
         """Calculate how difficult it is to detect obfuscation (0-100 scale)."""
         if obf_score >= 85 and symbol_reduction >= 50 and entropy_increase >= 50:
@@ -2205,7 +3221,7 @@ class LLVMObfuscator:
             if not ir_file.exists():
                 return 0
 
-            ir_content = ir_file.read_text(errors='ignore')
+            ir_content = self.ir_analyzer.ir_text(ir_file) or ""
             # Count string constants in LLVM IR: @.str = private constant [X x i8] c"..."
             # Pattern: c"..." string literals
             string_pattern = r'c"([^"]*)"'
@@ -2332,6 +3348,8 @@ class LLVMObfuscator:
             # Add cross-compilation flags (target triple + sysroot for macOS)
             cross_compile_flags = self._get_cross_compile_flags(config.platform, config.architecture)
             compile_flags.extend(cross_compile_flags)
+            # Same profile as the obfuscated build, so runtime comparisons are fair
+            compile_flags.extend(self._profile_flags(config))
 
             # Add include paths for common directories in the project
             include_dirs = set()
@@ -2361,11 +3379,11 @@ class LLVMObfuscator:
             # Stage 1: Compile to LLVM IR (same pipeline as obfuscated, but without passes)
             # This ensures fair comparison since baseline and obfuscated use same compilation methodology
             self.logger.info("Compiling baseline to LLVM IR with -O3 optimization")
-            ir_file = baseline_abs.parent / f"{baseline_abs.stem}_baseline.ll"
+            ir_file = baseline_abs.parent / f"{baseline_abs.stem}_baseline{self._ir_suffix(config)}"
 
             # Compile to IR with -O3 (same flags as obfuscated pre-compilation)
             ir_compile_flags = compile_flags.copy()  # Includes -O3, target triple, include paths
-            ir_compile_flags.extend(["-S", "-emit-llvm"])  # Convert to text IR
+            ir_compile_flags.extend(self._emit_ir_flags(config))
 
             ir_cmd = [compiler, str(source_abs)] + additional_sources + ["-o", str(ir_file)] + ir_compile_flags
             self.logger.debug(f"Baseline IR compilation command: {' '.join(ir_cmd)}")
@@ -2402,6 +3420,15 @@ class LLVMObfuscator:
                         self.logger.warning(f"Baseline IR analysis failed: {e}")
                         self._baseline_ir_metrics = {}
 
+                # Costs are kept in memory; the baseline IR may be deleted below
+                self._baseline_costs = None
+                prediction = config.advanced.overhead_prediction
+                if prediction.enabled and self.overhead_predictor.available:
+                    try:
+                        self._baseline_costs = self.overhead_predictor.function_costs(ir_file, mca=prediction.mca)
+                    except ObfuscationError as e:
+                        self.logger.warning(f"Baseline cost model analysis failed: {e}")
+
                 # Clean up temporary IR file (unless preserve_ir is enabled)
                 if not config.advanced.preserve_ir:
                     try:
@@ -2515,11 +3542,12 @@ class LLVMObfuscator:
 
         if "string-encrypt" in passes:
             try:
-                # ✅ NEW: Use MLIR metrics if available (captured directly from MLIR pass)
-                # This is more reliable than IR file analysis since it's from the actual pass output
-                if self._mlir_metrics and self._mlir_metrics.get('encrypted_strings_count', 0) > 0:
-                    obfuscated_string_count = self._mlir_metrics.get('encrypted_strings_count', 0)
-                    self.logger.info(f"✓ String encryption applied: {obfuscated_string_count} strings encrypted via MLIR")
+                # The passes count what they encrypted; the rest is still visible
+                if "strings-encrypted" in self._mlir_statistics:
+                    encrypted = self._mlir_statistics["strings-encrypted"]
+                    obfuscated_string_count = max(baseline_string_count - encrypted, 0)
+                    self.logger.info(f"✓ String encryption applied: {encrypted} strings "
+                                     f"({self._mlir_statistics.get('bytes-encrypted', 0)} bytes) encrypted via MLIR")
                 else:
                     # Fallback: Try to find the obfuscated IR file generated during compilation
                     obfuscated_ir_candidates = [
@@ -2563,13 +3591,13 @@ class LLVMObfuscator:
 
         if "symbol-obfuscate" in passes:
             try:
-                # ✅ NEW: Use MLIR metrics if available (captured directly from MLIR pass)
-                if self._mlir_metrics and self._mlir_metrics.get('total_globals', 0) > 0:
-                    total_symbols = self._mlir_metrics.get('total_globals', 0)
-                    # Estimate based on globals count - in MLIR, symbol-obfuscate renames all public symbols
-                    symbols_obfuscated = int(total_symbols * 0.8)  # ~80% of symbols typically obfuscated
-                    symbol_obfuscation_percentage = round((symbols_obfuscated / total_symbols) * 100, 2)
-                    self.logger.info(f"✓ Using MLIR metrics: {symbols_obfuscated}/{total_symbols} symbols obfuscated ({symbol_obfuscation_percentage:.1f}%)")
+                # Renamed vs. defined functions left alone, as counted by the pass
+                if "symbols-renamed" in self._mlir_statistics:
+                    symbols_obfuscated = self._mlir_statistics["symbols-renamed"]
+                    total_symbols = symbols_obfuscated + self._mlir_statistics.get("symbols-kept", 0)
+                    if total_symbols > 0:
+                        symbol_obfuscation_percentage = round((symbols_obfuscated / total_symbols) * 100, 2)
+                    self.logger.info(f"✓ Using MLIR statistics: {symbols_obfuscated}/{total_symbols} symbols obfuscated ({symbol_obfuscation_percentage:.1f}%)")
                 else:
                     # Fallback: Try to find the obfuscated IR file generated during MLIR compilation
                     obfuscated_ir_candidates = [
@@ -0,0 +1,324 @@
+"""Static per-function overhead prediction: TTI costs weighted by block frequency, baseline vs. obfuscated IR."""
+
+from __future__ import annotations
+
+import difflib
+import re
+import shutil
+import subprocess
+import tempfile
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Dict, List, Optional, Tuple
+
+from .exceptions import ObfuscationError
+from .utils import create_logger
+
+_COST_FUNCTION = re.compile(r"^(?:Printing analysis 'Cost Model Analysis' for|Cost Model for) function '(.+)':?$")
+_COST = re.compile(r"^Cost Model: Found (?:an estimated cost of|costs of) (.+?) for(?: instruction)?: +(.*)$")
+_BFI_FUNCTION = re.compile(r"^block-frequency-info: (.+)$")
+_BFI_BLOCK = re.compile(r"^ - (.+?): float = ([0-9.eE+-]+)")
+_DEFINE = re.compile(r'^define\b([^@]*)@("?)([^"(]+)\2\(([^)]*)\)', re.MULTILINE)
+_TRIPLE = re.compile(r'^target triple = "([^"]+)"', re.MULTILINE)
+_ASM_LABEL = re.compile(r"^(?:[^\s#/]\S*:|# %bb\.\d+:|// %bb\.\d+:)")
+_ASM_BLOCK_NAME = re.compile(r"(?:#|//) %([\w.$-]+)\s*$")
+_MCA_THROUGHPUT = re.compile(r"Block RThroughput:\s*([0-9.]+)")
+
+TERMINATORS = {
+    "ret", "br", "switch", "indirectbr", "invoke", "resume", "unreachable",
+    "cleanupret", "catchret", "catchswitch", "callbr",
+}
+
+
+@dataclass
+class BlockCost:
+    name: str
+    frequency: float
+    throughput: float
+    latency: float
+
+
+@dataclass
+class FunctionCost:
+    name: str
+    signature: str
+    blocks: List[BlockCost] = field(default_factory=list)
+    # False when block frequencies could not be matched to the cost blocks;
+    # the costs are then a plain sum
+    weighted: bool = True
+
+    @property
+    def throughput(self) -> float:
+        return sum(b.frequency * b.throughput for b in self.blocks)
+
+    @property
+    def latency(self) -> float:
+        return sum(b.frequency * b.latency for b in self.blocks)
+
+    @property
+    def hottest_block(self) -> Optional[BlockCost]:
+        return max(self.blocks, key=lambda b: (b.frequency * b.throughput, b.frequency), default=None)
+
+
+@dataclass
+class ModuleCosts:
+    functions: Dict[str, FunctionCost]
+    triple: Optional[str] = None
+    asm: Optional[str] = None  # llc output of the named IR, for llvm-mca
+
+
+class OverheadPredictor:
+    """
+    Predicts which functions obfuscation slowed down without running them.
+    Each instruction gets LLVM's TargetTransformInfo reciprocal throughput
+    and latency (`print<cost-model>`), each block the static frequency
+    estimate relative to the function entry (`print<block-freq>`), so a
+    function's cost is roughly its cycles per call. Functions renamed by
+    symbol obfuscation are paired with their baseline by definition order
+    and signature. With llvm-mca, the hottest block on each side is also
+    scheduled on the target's machine model.
+    """
+
+    def __init__(self, opt: Optional[Path] = None, mca_iterations: int = 100) -> None:
+        self.logger = create_logger(__name__)
+        self.opt = str(opt) if opt and opt.exists() else shutil.which("opt")
+        self.llc = shutil.which("llc")
+        self.mca = shutil.which("llvm-mca")
+        self.mca_iterations = mca_iterations
+
+    @property
+    def available(self) -> bool:
+        return self.opt is not None
+
+    def function_costs(self, ir_file: Path, mca: bool = False) -> ModuleCosts:
+        """Per-function costs of a .ll/.bc module; blocks get names first so BFI and llc can refer to them."""
+        with tempfile.TemporaryDirectory(prefix="obf_overhead_") as tmp:
+            named = Path(tmp) / "named.ll"
+            self._run([self.opt, "-passes=instnamer", "-S", str(ir_file), "-o", str(named)])
+            ir_text = named.read_text(encoding="utf-8", errors="replace")
+            passes = "-passes=print<block-freq>,print<cost-model>"
+            try:
+                costs = self.parse(ir_text, self._run([self.opt, "-disable-output", "-cost-kind=all", passes, str(named)]))
+            except ObfuscationError:
+                # opt before LLVM 20 prints one cost kind per run
+                costs = self.parse(ir_text, self._run([self.opt, "-disable-output", passes, str(named)]))
+                latency = self._run([
+                    self.opt, "-disable-output", "-cost-kind=latency", "-passes=print<cost-model>", str(named),
+                ])
+                self._apply_latency(costs, latency)
+            triple = _TRIPLE.search(ir_text)
+            module = ModuleCosts(costs, triple.group(1) if triple else None)
+            if mca and self.llc and self.mca:
+                module.asm = self._run([self.llc, "-O2", str(named), "-o", "-"], stdout=True)
+            return module
+
+    def parse(self, ir_text: str, analysis: str) -> Dict[str, FunctionCost]:
+        signatures = {
+            match.group(3): f"{match.group(1).split()[-1] if match.group(1).split() else 'void'}/{match.group(4).count('%')}"
+            for match in _DEFINE.finditer(ir_text)
+        }
+        frequencies: Dict[str, List[Tuple[str, float]]] = {}
+        costs: Dict[str, List[Tuple[str, float, float]]] = {}
+        bfi_function = cost_function = None
+        for line in analysis.splitlines():
+            match = _BFI_FUNCTION.match(line)
+            if match:
+                bfi_function = match.group(1)
+                frequencies[bfi_function] = []
+                continue
+            match = _COST_FUNCTION.match(line)
+            if match:
+                cost_function = match.group(1)
+                costs[cost_function] = []
+                continue
+            match = _BFI_BLOCK.match(line)
+            if match and bfi_function is not None:
+                frequencies[bfi_function].append((match.group(1), float(match.group(2))))
+                continue
+            match = _COST.match(line)
+            if match and cost_function is not None:
+                throughput, latency = self._cost_values(match.group(1))
+                costs[cost_function].append((match.group(2), throughput, latency))
+
+        functions: Dict[str, FunctionCost] = {}
+        for name, instructions in costs.items():
+            if name not in signatures:
+                continue
+            function = FunctionCost(name, signatures[name])
+            blocks = self._split_blocks(instructions)
+            freqs = frequencies.get(name, [])
+            function.weighted = len(freqs) == len(blocks)
+            for index, (throughput, latency) in enumerate(blocks):
+                block_name, frequency = freqs[index] if function.weighted else (f"#{index}", 1.0)
+                function.blocks.append(BlockCost(block_name, frequency, throughput, latency))
+            functions[name] = function
+        return functions
+
+    def compare(self, baseline: ModuleCosts, obfuscated: ModuleCosts, top: int = 10) -> Dict:
+        """Paired functions ranked by added cost per call, most first."""
+        pairs, added, removed = self.pair(baseline.functions, obfuscated.functions)
+        rows = []
+        for before, after in pairs:
+            rows.append({
+                "function": before.name,
+                "obfuscated_name": after.name if after.name != before.name else None,
+                "baseline_throughput": round(before.throughput, 2),
+                "obfuscated_throughput": round(after.throughput, 2),
+                "throughput_overhead_percent": self._percent(before.throughput, after.throughput),
+                "baseline_latency": round(before.latency, 2),
+                "obfuscated_latency": round(after.latency, 2),
+                "latency_overhead_percent": self._percent(before.latency, after.latency),
+                "added_cost": round(after.throughput - before.throughput, 2),
+                "hottest_block": after.hottest_block.name if after.hottest_block else None,
+                "frequency_weighted": before.weighted and after.weighted,
+            })
+        rows.sort(key=lambda row: (-row["added_cost"], row["function"]))
+
+        if baseline.asm and obfuscated.asm:
+            by_name = {(before.name, after.name): (before, after) for before, after in pairs}
+            for row in rows[:top]:
+                before, after = by_name[(row["function"], row["obfuscated_name"] or row["function"])]
+                row["mca"] = {
+                    "baseline_block_rthroughput": self._mca_block(baseline, before),
+                    "obfuscated_block_rthroughput": self._mca_block(obfuscated, after),
+                }
+
+        slower = [row for row in rows if row["added_cost"] > 0]
+        return {
+            "status": "success",
+            "cost_model": "TTI reciprocal throughput and latency per call, weighted by estimated block frequency",
+            "functions_compared": len(rows),
+            "functions_slower": len(slower),
+            "top": top,
+            "max_throughput_overhead_percent": max((row["throughput_overhead_percent"] for row in rows), default=0.0),
+            "functions": rows,
+            "added_functions": added,
+            "removed_functions": removed,
+        }
+
+    @staticmethod
+    def pair(baseline: Dict[str, FunctionCost], obfuscated: Dict[str, FunctionCost]
+             ) -> Tuple[List[Tuple[FunctionCost, FunctionCost]], List[str], List[str]]:
+        """Same-name functions first, then the longest order-preserving run of matching signatures."""
+        pairs = [(baseline[name], obfuscated[name]) for name in baseline if name in obfuscated]
+        rest_before = [f for name, f in baseline.items() if name not in obfuscated]
+        rest_after = [f for name, f in obfuscated.items() if name not in baseline]
+        matcher = difflib.SequenceMatcher(
+            None, [f.signature for f in rest_before], [f.signature for f in rest_after], autojunk=False)
+        paired_before, paired_after = set(), set()
+        for block in matcher.get_matching_blocks():
+            for k in range(block.size):
+                pairs.append((rest_before[block.a + k], rest_after[block.b + k]))
+                paired_before.add(block.a + k)
+                paired_after.add(block.b + k)
+        added = [f.name for i, f in enumerate(rest_after) if i not in paired_after]
+        removed = [f.name for i, f in enumerate(rest_before) if i not in paired_before]
+        return pairs, added, removed
+
+    def _mca_block(self, module: ModuleCosts, function: FunctionCost) -> Optional[float]:
+        block = function.hottest_block
+        if block is None or module.asm is None:
+            return None
+        instructions = self._asm_block(module.asm, function.name, block.name)
+        if not instructions:
+            return None
+        with tempfile.NamedTemporaryFile("w", suffix=".s", delete=False) as handle:
+            handle.write("\n".join(instructions) + "\n")
+            path = Path(handle.name)
+        try:
+            command = [self.mca, f"-iterations={self.mca_iterations}", str(path)]
+            if module.triple:
+                command.insert(1, f"-mtriple={module.triple}")
+            output = self._run(command, stdout=True)
+        except ObfuscationError as exc:
+            self.logger.debug("llvm-mca failed on %s/%s: %s", function.name, block.name, exc)
+            return None
+        finally:
+            path.unlink(missing_ok=True)
+        match = _MCA_THROUGHPUT.search(output)
+        return float(match.group(1)) if match else None
+
+    @staticmethod
+    def _asm_block(asm: str, function: str, block: str) -> List[str]:
+        """Instructions of the block llc annotated with `# %<block>` inside `function`."""
+        lines = asm.splitlines()
+        header = re.compile(rf'^"?_?{re.escape(function)}"?:')
+        start = next((i for i, line in enumerate(lines) if header.match(line)), None)
+        if start is None:
+            return []
+        instructions: List[str] = []
+        inside = False
+        for line in lines[start + 1:]:
+            stripped = line.strip()
+            if stripped.startswith(".cfi_endproc") or stripped.startswith(".Lfunc_end"):
+                break
+            if _ASM_LABEL.match(line):
+                if inside:
+                    break
+                name = _ASM_BLOCK_NAME.search(line)
+                inside = name is not None and name.group(1) == block
+                continue
+            if inside and stripped and not stripped.startswith((".", "#", "//", ";")):
+                instructions.append(stripped)
+        return instructions
+
+    @staticmethod
+    def _split_blocks(instructions: List[Tuple[str, float, float]]) -> List[Tuple[float, float]]:
+        """Cost lines come in layout order and every block ends with its only terminator."""
+        blocks = []
+        throughput = latency = 0.0
+        for text, inst_throughput, inst_latency in instructions:
+            throughput += inst_throughput
+            latency += inst_latency
+            words = text.split("=", 1)[1].split() if text.startswith("%") and "=" in text else text.split()
+            if words and words[0] in TERMINATORS:
+                blocks.append((throughput, latency))
+                throughput = latency = 0.0
+        return blocks
+
+    @staticmethod
+    def _cost_values(text: str) -> Tuple[float, float]:
+        """(reciprocal throughput, latency) of `RThru:1 CodeSize:1 Lat:3 SizeLat:1`, `2` or `Invalid`."""
+        fields = dict(re.findall(r"(\w+):(\S+)", text))
+        if not fields:
+            fields = {"RThru": text, "Lat": text}
+
+        def value(key: str) -> float:
+            try:
+                return float(fields.get(key, 0))
+            except ValueError:
+                return 0.0
+
+        return value("RThru"), value("Lat")
+
+    def _apply_latency(self, costs: Dict[str, FunctionCost], analysis: str) -> None:
+        latencies: Dict[str, List[Tuple[str, float, float]]] = {}
+        function = None
+        for line in analysis.splitlines():
+            match = _COST_FUNCTION.match(line)
+            if match:
+                function = match.group(1)
+                latencies[function] = []
+                continue
+            match = _COST.match(line)
+            if match and function is not None:
+                latencies[function].append((match.group(2), self._cost_values(match.group(1))[0], 0.0))
+        for name, function_cost in costs.items():
+            blocks = self._split_blocks(latencies.get(name, []))
+            if len(blocks) == len(function_cost.blocks):
+                for block, (latency, _) in zip(function_cost.blocks, blocks):
+                    block.latency = latency
+
+    @staticmethod
+    def _percent(before: float, after: float) -> float:
+        return round(100.0 * (after - before) / before, 1) if before else 0.0
+
+    @staticmethod
+    def _run(command: List[str], stdout: bool = False) -> str:
+        try:
+            result = subprocess.run(command, capture_output=True, text=True, timeout=300)
+        except (OSError, subprocess.TimeoutExpired) as exc:
+            raise ObfuscationError(f"{command[0]}: {exc}") from exc
+        if result.returncode != 0:
+            raise ObfuscationError(f"{' '.join(command)}: {result.stderr.strip()[:500]}")
+        return result.stdout if stdout else result.stderr
@@ -0,0 +1,184 @@
+"""Profile-guided hot/warm/cold tiers for textual LLVM IR (mirrors mlir-obs profile-tiers)."""
+
+from __future__ import annotations
+
+import re
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional, Tuple
+
+from .utils import create_logger
+
+_DEFINE = re.compile(r'^define\b[^@]*@("?)([^"(]+)\1\(')
+_PROF_REF = re.compile(r'!prof\s+!(\d+)')
+_METADATA = re.compile(r'^!(\d+)\s*=\s*!\{!"(function_entry_count|branch_weights)"(.*)\}\s*$', re.MULTILINE)
+_COUNT = re.compile(r'\bi(?:32|64)\s+(\d+)')
+_ANNOTATIONS = re.compile(
+    r'^@llvm\.global\.annotations = appending global \[(\d+) x \{ ptr, ptr, ptr, i32, ptr \}\] '
+    r'\[(.*)\], section "llvm\.metadata"\s*$',
+    re.MULTILINE,
+)
+
+
+class ProfileTiers:
+    """
+    Ranks functions by their hottest block (entry count, or the largest
+    branch_weights sum, which clang emits as raw counts) and splits them at
+    hot_percent / warm_percent of the total. Same rule as the mlir-obs
+    profile-tiers pass, so reports and the OLLVM stage agree with it.
+    """
+
+    TIERS = ("hot", "warm", "cold")
+    POLICIES = ("none", "cheap", "full")
+    # OLLVM passes skip a function annotated "no<flag>"; split only adds
+    # unconditional branches, the rest cost on every execution.
+    OLLVM_FLAGS = {
+        "flattening": "fla",
+        "substitution": "sub",
+        "boguscf": "bcf",
+        "split": "split",
+        "linear-mba": "mba",
+    }
+    OLLVM_CHEAP_PASSES = ("split",)
+
+    def __init__(self, hot_percent: int = 90, warm_percent: int = 99) -> None:
+        self.hot_percent = hot_percent
+        self.warm_percent = warm_percent
+        self.logger = create_logger(__name__)
+
+    @staticmethod
+    def profile_kind(profile: Path) -> str:
+        """`instr` for llvm-profdata output, `sample` for AutoFDO/sample profiles."""
+        return "instr" if profile.suffix == ".profdata" else "sample"
+
+    def function_counts(self, ir_text: str) -> Dict[str, int]:
+        """Peak block count per defined function; empty when the IR carries no profile."""
+        entry_counts: Dict[str, int] = {}
+        branch_totals: Dict[str, int] = {}
+        for match in _METADATA.finditer(ir_text):
+            counts = [int(c) for c in _COUNT.findall(match.group(3))]
+            if match.group(2) == "function_entry_count":
+                entry_counts[match.group(1)] = counts[0] if counts else 0
+            else:
+                branch_totals[match.group(1)] = sum(counts)
+        if not entry_counts:
+            return {}
+
+        peaks: Dict[str, int] = {}
+        current: Optional[str] = None
+        for line in ir_text.splitlines():
+            if current is None:
+                define = _DEFINE.match(line)
+                if define:
+                    current = define.group(2)
+                    ref = _PROF_REF.search(line)
+                    peaks[current] = entry_counts.get(ref.group(1), 0) if ref else 0
+                continue
+            if line.startswith("}"):
+                current = None
+                continue
+            ref = _PROF_REF.search(line)
+            if ref and ref.group(1) in branch_totals:
+                peaks[current] = max(peaks[current], branch_totals[ref.group(1)])
+        return peaks
+
+    def classify(self, counts: Dict[str, int]) -> Dict[str, str]:
+        """Tier per function; a function is in the tier its own counts start in."""
+        ranked = sorted(counts.items(), key=lambda item: -item[1])
+        total = sum(counts.values())
+        tiers: Dict[str, str] = {}
+        covered = 0
+        for name, peak in ranked:
+            before = 100.0 * covered / total if total else 100.0
+            covered += peak
+            if peak and before < self.hot_percent:
+                tiers[name] = "hot"
+            elif peak and before < self.warm_percent:
+                tiers[name] = "warm"
+            else:
+                tiers[name] = "cold"
+        return tiers
+
+    def coverage(self, counts: Dict[str, int], tiers: Dict[str, str]) -> Dict[str, Dict]:
+        """Functions and share of profiled counts per tier."""
+        total = sum(counts.values())
+        report = {}
+        for tier in self.TIERS:
+            names = [name for name, t in tiers.items() if t == tier]
+            share = sum(counts[name] for name in names)
+            report[tier] = {
+                "functions": len(names),
+                "count_share_percent": round(100.0 * share / total, 2) if total else 0.0,
+            }
+        return report
+
+    @staticmethod
+    def limits(tiers: Dict[str, str], policies: Dict[str, str]) -> Dict[str, str]:
+        """Transform limit (none/cheap/full) per function from its tier."""
+        return {name: policies.get(tier, "full") for name, tier in tiers.items()}
+
+    def annotate_ollvm(
+        self,
+        ir_text: str,
+        limits: Dict[str, str],
+        passes: Iterable[str],
+        skips: Optional[Dict[str, Iterable[str]]] = None,
+    ) -> Tuple[str, int]:
+        """
+        Add `no<flag>` entries to @llvm.global.annotations for every OLLVM
+        pass a function's transform limit rules out, plus the passes listed
+        for it in `skips` (the size budget). Returns the new IR and the
+        number of annotations added.
+        """
+        flags_by_policy = {
+            "none": [self.OLLVM_FLAGS[p] for p in passes if p in self.OLLVM_FLAGS],
+            "cheap": [self.OLLVM_FLAGS[p] for p in passes
+                      if p in self.OLLVM_FLAGS and p not in self.OLLVM_CHEAP_PASSES],
+            "full": [],
+        }
+        entries: List[Tuple[str, str]] = []
+        skips = skips or {}
+        for name in sorted(set(limits) | set(skips)):
+            flags = list(flags_by_policy[limits.get(name, "full")])
+            flags += [self.OLLVM_FLAGS[p] for p in passes
+                      if p in self.OLLVM_FLAGS and p in skips.get(name, ()) and self.OLLVM_FLAGS[p] not in flags]
+            for flag in flags:
+                entries.append((name, f"no{flag}"))
+        if not entries:
+            return ir_text, 0
+
+        existing = _ANNOTATIONS.search(ir_text)
+        if "@llvm.global.annotations" in ir_text and not existing:
+            self.logger.warning("Unrecognized @llvm.global.annotations; OLLVM tier annotations skipped")
+            return ir_text, 0
+
+        strings = []
+        for flag in sorted({annotation for _, annotation in entries}):
+            strings.append(
+                f'@.obfs.tier.{flag} = private unnamed_addr constant [{len(flag) + 1} x i8] '
+                f'c"{flag}\\00", section "llvm.metadata"'
+            )
+        strings.append('@.obfs.tier.file = private unnamed_addr constant [1 x i8] zeroinitializer, '
+                       'section "llvm.metadata"')
+        elements = [
+            f'{{ ptr, ptr, ptr, i32, ptr }} {{ ptr @{self._quote(name)}, ptr @.obfs.tier.{flag}, '
+            f'ptr @.obfs.tier.file, i32 0, ptr null }}'
+            for name, flag in entries
+        ]
+
+        count = len(elements)
+        if existing:
+            count_total = int(existing.group(1)) + count
+            merged = existing.group(2) + ", " + ", ".join(elements)
+            ir_text = ir_text[:existing.start()] + ir_text[existing.end():]
+        else:
+            count_total = count
+            merged = ", ".join(elements)
+        globals_text = "\n".join(strings) + (
+            f'\n@llvm.global.annotations = appending global [{count_total} x {{ ptr, ptr, ptr, i32, ptr }}] '
+            f'[{merged}], section "llvm.metadata"\n'
+        )
+        return ir_text.rstrip("\n") + "\n\n" + globals_text, count
+
+    @staticmethod
+    def _quote(name: str) -> str:
+        return name if re.fullmatch(r'[\w.$]+', name) else f'"{name}"'
@@ -149,6 +149,9 @@ class ObfuscationReport:
                 "binary_structure": job_data.get("binary_structure"),
                 "pattern_resistance": job_data.get("pattern_resistance"),
                 "call_graph_metrics": job_data.get("call_graph_metrics"),
+                "predicted_overhead": job_data.get("predicted_overhead"),
+                "mlir_statistics": job_data.get("mlir_statistics"),
+                "pass_metrics": job_data.get("pass_metrics"),
             }
         except Exception as exc:  # pragma: no cover - defensive
             raise ReportGenerationError("Failed to assemble report") from exc
@@ -1197,6 +1200,9 @@ Comprehensive table showing all configuration parameters organized by obfuscatio
 ### Pattern Resistance
 {self._format_pattern_resistance_markdown(report.get('pattern_resistance'))}
 
+### Predicted Overhead
+{self._format_predicted_overhead_markdown(report.get('predicted_overhead'))}
+
 ---
 
 *🤖 Generated with LLVM Obfuscator API*
@@ -1745,6 +1751,32 @@ Comprehensive table showing all configuration parameters organized by obfuscatio
 - **Relocations:** {metrics.get('relocations', {}).get('relocation_count', 0)}
 - **Code-to-Data Ratio:** {metrics.get('code_to_data_ratio', 0):.2f}"""
 
+    def _format_predicted_overhead_markdown(self, metrics: Dict) -> str:
+        """Format the static per-function overhead prediction for markdown."""
+        if not metrics or metrics.get("status") != "success":
+            return "⚠️ Overhead prediction not available"
+
+        lines = [
+            f"{metrics.get('functions_slower', 0)} of {metrics.get('functions_compared', 0)} functions predicted slower "
+            "(TTI cost per call, weighted by estimated block frequency).",
+            "",
+            "| Function | Baseline | Obfuscated | Overhead | Latency | Hottest Block | MCA RThroughput |",
+            "|----------|----------|------------|----------|---------|---------------|-----------------|",
+        ]
+        for row in metrics.get("functions", [])[:metrics.get("top", 10)]:
+            name = row["function"]
+            if row.get("obfuscated_name"):
+                name += f" → {row['obfuscated_name']}"
+            mca = row.get("mca")
+            mca_text = (f"{mca.get('baseline_block_rthroughput')} → {mca.get('obfuscated_block_rthroughput')}"
+                        if mca else "-")
+            lines.append(
+                f"| `{name}` | {row['baseline_throughput']} | {row['obfuscated_throughput']} | "
+                f"{row['throughput_overhead_percent']:+}% | {row['latency_overhead_percent']:+}% | "
+                f"{row.get('hottest_block') or '-'} | {mca_text} |"
+            )
+        return "\n".join(lines)
+
     def _format_pattern_resistance_markdown(self, metrics: Dict) -> str:
         """Format pattern resistance metrics for markdown."""
         if not metrics:
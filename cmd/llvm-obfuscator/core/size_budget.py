@@ -0,0 +1,341 @@
+"""Code-size growth budget: which transforms run where, under a module growth cap."""
+
+from __future__ import annotations
+
+import json
+import math
+import re
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Dict, Iterable, List, Optional, Tuple
+
+from .config import Architecture
+from .exceptions import ObfuscationError
+from .utils import create_logger
+
+_DEFINE = re.compile(r'^define\b[^@]*@("?)([^"(]+)\1\(')
+_LABEL = re.compile(r'^[\w.$"-]+:')
+_OPCODE = re.compile(r'^\s+(?:%[\w.$"-]+ = )?(?:tail |musttail |notail )?(\w+)')
+_STRING_CONSTANT = re.compile(r'^@[^=]+= [^\n]*constant \[(\d+) x i8\] c"', re.MULTILINE)
+
+
+@dataclass
+class FunctionSize:
+    """IR instruction counts of one function, by the classes the growth model uses."""
+    instructions: int = 0
+    blocks: int = 1
+    calls: int = 0
+    memory: int = 0      # load, store, getelementptr
+    arithmetic: int = 0  # add, sub, and, or, xor
+    bitwise: int = 0     # and, or, xor
+    opcodes: Dict[str, int] = field(default_factory=dict)
+
+
+@dataclass
+class SizePlan:
+    """
+    Result of SizeBudgetPlanner.plan. `functions` maps each defined function
+    to its MLIR transform limit (none/cheap/full) and the OLLVM passes it
+    may get; `module` lists the module-wide transforms kept. Stored as JSON,
+    read back by the size-budget pass and by `size_budget.plan_file`.
+    """
+    architecture: str
+    growth_percent: float
+    baseline_bytes: int
+    budget_bytes: int
+    growth_bytes: int = 0
+    protection_score: float = 0.0
+    module: List[str] = field(default_factory=list)
+    functions: Dict[str, Dict] = field(default_factory=dict)
+    dropped: List[str] = field(default_factory=list)
+
+    VERSION = 1
+
+    def to_dict(self) -> Dict:
+        return {
+            "version": self.VERSION,
+            "architecture": self.architecture,
+            "growth_percent": self.growth_percent,
+            "baseline_bytes": self.baseline_bytes,
+            "budget_bytes": self.budget_bytes,
+            "growth_bytes": self.growth_bytes,
+            "protection_score": round(self.protection_score, 2),
+            "module": list(self.module),
+            "dropped": list(self.dropped),
+            "functions": {name: self.functions[name] for name in sorted(self.functions)},
+        }
+
+    @classmethod
+    def from_dict(cls, data: Dict) -> "SizePlan":
+        if data.get("version") != cls.VERSION:
+            raise ObfuscationError(f"Unsupported size plan version: {data.get('version')}")
+        return cls(
+            architecture=data["architecture"],
+            growth_percent=data["growth_percent"],
+            baseline_bytes=data["baseline_bytes"],
+            budget_bytes=data["budget_bytes"],
+            growth_bytes=data.get("growth_bytes", 0),
+            protection_score=data.get("protection_score", 0.0),
+            module=list(data.get("module", [])),
+            functions=dict(data.get("functions", {})),
+            dropped=list(data.get("dropped", [])),
+        )
+
+    def save(self, path: Path) -> None:
+        path.write_text(json.dumps(self.to_dict(), indent=2, sort_keys=False) + "\n")
+
+    @classmethod
+    def load(cls, path: Path) -> "SizePlan":
+        try:
+            return cls.from_dict(json.loads(path.read_text()))
+        except (OSError, ValueError, KeyError) as e:
+            raise ObfuscationError(f"Cannot read size plan {path}: {e}") from e
+
+    def ollvm_skips(self, passes: Iterable[str], functions: Iterable[str]) -> Dict[str, List[str]]:
+        """
+        OLLVM passes each defined function must be kept out of. Functions
+        missing from the plan were not budgeted and get none of them.
+        """
+        passes = list(passes)
+        return {
+            name: [p for p in passes if p not in self.functions.get(name, {}).get("ollvm", [])]
+            for name in functions
+        }
+
+    def summary(self) -> Dict[str, int]:
+        limits = {"none": 0, "cheap": 0, "full": 0}
+        for entry in self.functions.values():
+            limits[entry.get("limit", "none")] += 1
+        return limits
+
+
+class SizeBudgetPlanner:
+    """
+    Estimates what each transform adds to each function and picks the
+    (function, transform) pairs with the best protection per byte until
+    the module's estimated growth reaches growth_percent of its baseline.
+
+    Sizes come from the textual IR clang emits before obfuscation and a
+    per-target cost model (machine-code bytes per IR instruction after -O2).
+    Growth per transform is a linear model over the function's instruction
+    classes (rough per-transform estimates, see GROWTH). It also counts code
+    that tiers or policies later keep the transform out of, so the estimate
+    errs on the side of the budget.
+
+    MLIR passes are planned per cost class, matching isTransformAllowed:
+    a function's limit is none, cheap (fake-loops, anti-debug) or full
+    (also address-obfuscation, indirect-call, function-merge). OLLVM passes
+    are planned one by one, through `no<flag>` annotations. String and
+    constant encryption are module-wide and either kept or dropped.
+    """
+
+    # Bytes of machine code per IR instruction after -O2, by opcode class.
+    # Unlisted opcodes cost "default"; allocas and phis mostly disappear.
+    COST_MODEL: Dict[str, Dict[str, float]] = {
+        Architecture.X86_64.value: {"default": 3.2, "call": 6.0, "load": 2.0, "store": 2.5,
+                                    "getelementptr": 1.5, "br": 2.5, "switch": 8.0,
+                                    "alloca": 0.0, "phi": 0.5, "ret": 1.0},
+        Architecture.X86.value: {"default": 3.0, "call": 7.0, "load": 2.5, "store": 3.0,
+                                 "getelementptr": 2.0, "br": 2.5, "switch": 8.0,
+                                 "alloca": 0.0, "phi": 1.0, "ret": 1.0},
+        Architecture.ARM64.value: {"default": 4.0, "call": 4.0, "load": 3.0, "store": 3.0,
+                                   "getelementptr": 2.0, "br": 4.0, "switch": 12.0,
+                                   "alloca": 0.0, "phi": 1.0, "ret": 4.0},
+    }
+
+    # IR instructions a transform adds to a function:
+    # (fixed, per instruction, per block, per call, per memory op, per arithmetic op, per bitwise op)
+    GROWTH: Dict[str, Tuple[float, ...]] = {
+        # state variable, dispatcher switch, one store + branch per block
+        "flattening": (10.0, 0.0, 4.0, 0.0, 0.0, 0.0, 0.0),
+        # clones ~30% of blocks behind an opaque predicate (OLLVM bcf_prob)
+        "boguscf": (0.0, 0.3, 2.0, 0.0, 0.0, 0.0, 0.0),
+        # each add/sub/and/or/xor becomes a 3-4 instruction identity
+        "substitution": (0.0, 0.0, 0.0, 0.0, 0.0, 3.0, 0.0),
+        # new block + branch per split point
+        "split": (0.0, 0.0, 2.0, 0.0, 0.0, 0.0, 0.0),
+        # linear MBA rewrite of each bitwise op
+        "linear-mba": (0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 8.0),
+        # countdown decrement, compare, weighted branch, slow-path call
+        "anti-debug": (6.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0),
+        # opaque predicate plus one never-run counted loop
+        "fake-loops": (12.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0),
+        # slot load + key subtraction per call site
+        "indirect-call": (0.0, 0.0, 0.0, 3.0, 0.0, 0.0, 0.0),
+        # key pair at entry, two GEPs per masked access
+        "address-obfuscation": (2.0, 0.0, 0.0, 0.0, 2.0, 0.0, 0.0),
+        # merged bodies shrink more than the selector thunks add
+        "function-merge": (0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0),
+    }
+
+    # Protection points per protected function (scaled by function size)
+    # and per module for module-wide transforms.
+    PROTECTION: Dict[str, float] = {
+        "flattening": 10.0,
+        "boguscf": 8.0,
+        "linear-mba": 6.0,
+        "indirect-call": 5.0,
+        "substitution": 4.0,
+        "address-obfuscation": 4.0,
+        "anti-debug": 3.0,
+        "function-merge": 3.0,
+        "fake-loops": 2.0,
+        "split": 2.0,
+        "string-encrypt": 20.0,
+        "constant-obfuscate": 10.0,
+    }
+
+    CHEAP_MLIR = ("fake-loops", "anti-debug")
+    FULL_MLIR = ("address-obfuscation", "indirect-call", "function-merge")
+    MODULE_MLIR = ("string-encrypt", "constant-obfuscate")
+    # Decryptor plus per-string key/constructor code
+    STRING_ENCRYPT_GROWTH = (60.0, 10.0)  # fixed, per string
+    CONSTANT_OBFUSCATE_GROWTH = 2.0       # per arithmetic op with an immediate, roughly
+
+    LIMITS = ("none", "cheap", "full")
+
+    def __init__(self, architecture: Architecture = Architecture.X86_64) -> None:
+        self.architecture = architecture.value if isinstance(architecture, Architecture) else str(architecture)
+        self.cost = self.COST_MODEL.get(self.architecture, self.COST_MODEL[Architecture.X86_64.value])
+        self.logger = create_logger(__name__)
+
+    def measure(self, ir_text: str) -> Dict[str, FunctionSize]:
+        """Instruction counts per defined function."""
+        sizes: Dict[str, FunctionSize] = {}
+        current: Optional[FunctionSize] = None
+        for line in ir_text.splitlines():
+            if current is None:
+                define = _DEFINE.match(line)
+                if define:
+                    current = sizes.setdefault(define.group(2), FunctionSize())
+                continue
+            if line.startswith("}"):
+                current = None
+                continue
+            if _LABEL.match(line):
+                current.blocks += 1
+                continue
+            opcode = _OPCODE.match(line)
+            if not opcode:
+                continue
+            op = opcode.group(1)
+            current.instructions += 1
+            current.opcodes[op] = current.opcodes.get(op, 0) + 1
+            if op in ("call", "invoke"):
+                current.calls += 1
+            elif op in ("load", "store", "getelementptr"):
+                current.memory += 1
+            if op in ("add", "sub", "and", "or", "xor"):
+                current.arithmetic += 1
+            if op in ("and", "or", "xor"):
+                current.bitwise += 1
+        return sizes
+
+    def function_bytes(self, size: FunctionSize) -> float:
+        default = self.cost["default"]
+        return sum(count * self.cost.get(op, default) for op, count in size.opcodes.items())
+
+    def growth_bytes(self, transform: str, size: FunctionSize) -> float:
+        """Estimated bytes `transform` adds to the function."""
+        fixed, per_inst, per_block, per_call, per_memory, per_arith, per_bitwise = self.GROWTH[transform]
+        added = (fixed + per_inst * size.instructions + per_block * size.blocks + per_call * size.calls
+                 + per_memory * size.memory + per_arith * size.arithmetic + per_bitwise * size.bitwise)
+        return added * self.cost["default"]
+
+    def module_growth_bytes(self, transform: str, ir_text: str, sizes: Dict[str, FunctionSize]) -> float:
+        if transform == "string-encrypt":
+            fixed, per_string = self.STRING_ENCRYPT_GROWTH
+            strings = len(_STRING_CONSTANT.findall(ir_text))
+            return (fixed + per_string * strings) * self.cost["default"] if strings else 0.0
+        if transform == "constant-obfuscate":
+            arithmetic = sum(size.arithmetic for size in sizes.values())
+            return self.CONSTANT_OBFUSCATE_GROWTH * arithmetic * self.cost["default"]
+        return 0.0
+
+    def plan(
+        self,
+        ir_text: str,
+        growth_percent: float,
+        mlir_transforms: Iterable[str],
+        ollvm_passes: Iterable[str],
+    ) -> SizePlan:
+        """
+        Greedy knapsack over (function, transform) items by protection per
+        byte; ties break on name, so the same IR always gets the same plan.
+        A function's full MLIR limit is only picked on top of cheap.
+        """
+        sizes = self.measure(ir_text)
+        mlir_transforms = [t for t in mlir_transforms if t in self.GROWTH or t in self.MODULE_MLIR]
+        ollvm_passes = [p for p in ollvm_passes if p in self.GROWTH]
+        baseline = sum(self.function_bytes(size) for size in sizes.values())
+        budget = baseline * growth_percent / 100.0
+
+        # (key, function or "" for module-wide, unit, bytes, protection, prerequisite)
+        items: List[Tuple[str, str, str, float, float, Optional[str]]] = []
+        for transform in mlir_transforms:
+            if transform in self.MODULE_MLIR:
+                growth = self.module_growth_bytes(transform, ir_text, sizes)
+                items.append((f"module:{transform}", "", transform, growth, self.PROTECTION[transform], None))
+        for name, size in sizes.items():
+            scale = math.log2(2 + size.instructions)
+            for level, transforms, prerequisite in (
+                ("cheap", self.CHEAP_MLIR, None),
+                ("full", self.FULL_MLIR, f"{name}:mlir:cheap"),
+            ):
+                chosen = [t for t in transforms if t in mlir_transforms]
+                growth = sum(self.growth_bytes(t, size) for t in chosen)
+                protection = sum(self.PROTECTION[t] for t in chosen) * scale
+                items.append((f"{name}:mlir:{level}", name, f"mlir:{level}", growth, protection, prerequisite))
+            for p in ollvm_passes:
+                items.append((f"{name}:ollvm:{p}", name, f"ollvm:{p}", self.growth_bytes(p, size),
+                              self.PROTECTION[p] * scale, None))
+
+        def priority(item):
+            key, _, _, growth, protection, _ = item
+            ratio = protection / growth if growth > 0 else math.inf
+            return (-ratio, key)
+
+        items.sort(key=priority)
+        selected: Dict[str, float] = {}
+        function_growth: Dict[str, float] = {}
+        spent = 0.0
+        changed = True
+        while changed:
+            changed = False
+            for key, name, _, growth, protection, prerequisite in items:
+                if key in selected or (prerequisite and prerequisite not in selected):
+                    continue
+                if spent + growth > budget:
+                    continue
+                selected[key] = protection
+                function_growth[name] = function_growth.get(name, 0.0) + growth
+                spent += growth
+                changed = True
+
+        plan = SizePlan(
+            architecture=self.architecture,
+            growth_percent=growth_percent,
+            baseline_bytes=int(round(baseline)),
+            budget_bytes=int(round(budget)),
+            growth_bytes=int(round(spent)),
+            protection_score=sum(selected.values()),
+        )
+        for transform in mlir_transforms:
+            if transform in self.MODULE_MLIR:
+                (plan.module if f"module:{transform}" in selected else plan.dropped).append(transform)
+        for name, size in sorted(sizes.items()):
+            limit = "none"
+            if f"{name}:mlir:cheap" in selected:
+                limit = "full" if f"{name}:mlir:full" in selected else "cheap"
+            ollvm = [p for p in ollvm_passes if f"{name}:ollvm:{p}" in selected]
+            plan.functions[name] = {
+                "limit": limit,
+                "ollvm": ollvm,
+                "bytes": int(round(self.function_bytes(size))),
+                "growth_bytes": int(round(function_growth.get(name, 0.0))),
+            }
+        self.logger.info(
+            "Size budget: %d of %d bytes (%.1f%% of %d), protection %.1f",
+            plan.growth_bytes, plan.budget_bytes, growth_percent, plan.baseline_bytes, plan.protection_score,
+        )
+        return plan
@@ -41,6 +41,48 @@ def run_command(command: List[str], cwd: Optional[Path] = None, env: Optional[Di
     return process.returncode, stdout, stderr
 
 
+def run_pipeline(commands: List[List[str]], cwd: Optional[Path] = None, env: Optional[Dict[str, str]] = None) -> Tuple[int, str, str]:
+    """Run commands connected like a shell pipe; returns the last command's output."""
+    logger.debug("Executing pipeline: %s", " | ".join(" ".join(command) for command in commands))
+    processes = []
+    # stderr goes to files so a chatty early stage cannot block the pipe
+    stderr_files = [tempfile.TemporaryFile(mode="w+") for _ in commands]
+    try:
+        previous_stdout = None
+        for command, stderr_file in zip(commands, stderr_files):
+            process = subprocess.Popen(
+                command,
+                cwd=str(cwd) if cwd else None,
+                env=env,
+                stdin=previous_stdout,
+                stdout=subprocess.PIPE,
+                stderr=stderr_file,
+                text=True,
+            )
+            if previous_stdout is not None:
+                previous_stdout.close()  # the next stage owns it now
+            previous_stdout = process.stdout
+            processes.append(process)
+        stdout, _ = processes[-1].communicate()
+        for process in processes[:-1]:
+            process.wait()
+        stderrs = []
+        for stderr_file in stderr_files:
+            stderr_file.seek(0)
+            stderrs.append(stderr_file.read())
+    finally:
+        for stderr_file in stderr_files:
+            stderr_file.close()
+
+    logger.debug("Command stdout: %s", stdout)
+    for command, process, stderr in zip(commands, processes, stderrs):
+        if stderr:
+            logger.debug("Command stderr: %s", stderr)
+        if process.returncode != 0:
+            raise ObfuscationError(f"Command failed with exit code {process.returncode}: {' '.join(command)}\n{stderr}")
+    return processes[-1].returncode, stdout, stderrs[-1]
+
+
 def tool_exists(tool_name: str) -> bool:
     return shutil.which(tool_name) is not None
 
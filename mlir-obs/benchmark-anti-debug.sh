@@ -0,0 +1,108 @@
+#!/bin/bash
+# Cost of the anti-debug pass on a hot function: a tiny noinline function
+# called CALLS times, built without checks and with the anti-debug pass at
+# several overhead budgets.
+#
+# Usage: ./benchmark-anti-debug.sh
+#   BUDGETS="100 1000 10000" CALLS=500000000 ./benchmark-anti-debug.sh
+#
+# Environment:
+#   CALLS=<n>        calls to the hot function (default 200000000)
+#   RUNS=<n>         timed runs per binary (default 5, median reported)
+#   BUDGETS="<us>"   budget-us values to compare (default "100 1000 10000")
+#   TECHNIQUES=<l>   techniques option (default ptrace,proc_status)
+#   PROC_CACHE_MS=<n> proc-cache-ms option (default 100)
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+RUNTIME="$SCRIPT_DIR/runtime/obfs_antidebug.c"
+
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+CALLS="${CALLS:-200000000}"
+RUNS="${RUNS:-5}"
+BUDGETS="${BUDGETS:-100 1000 10000}"
+TECHNIQUES="${TECHNIQUES:-ptrace,proc_status}"
+PROC_CACHE_MS="${PROC_CACHE_MS:-100}"
+
+LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f 2>/dev/null | head -1)
+if [ -z "$LIBRARY" ]; then
+    echo -e "${RED}ERROR: MLIR library not found. Please run ./build.sh first${NC}"
+    exit 1
+fi
+
+TEMP_DIR="$(mktemp -d)"
+trap "rm -rf $TEMP_DIR" EXIT
+
+cat > "$TEMP_DIR/hot.c" << EOF
+#include <stdint.h>
+#include <stdio.h>
+
+__attribute__((noinline)) uint64_t hot(uint64_t x) {
+    return x * 2654435761u + 1;
+}
+
+int main(void) {
+    uint64_t x = 0;
+    for (long i = 0; i < ${CALLS}L; i++)
+        x = hot(x);
+    printf("%lu\n", (unsigned long)x);
+    return 0;
+}
+EOF
+
+# Median wall time in microseconds over $RUNS runs
+median_runtime() {
+    local binary="$1"
+    local times=()
+    for _ in $(seq "$RUNS"); do
+        local start end
+        start=$(date +%s%N)
+        "$binary" >/dev/null
+        end=$(date +%s%N)
+        times+=($(( (end - start) / 1000 )))
+    done
+    printf '%s\n' "${times[@]}" | sort -n | awk '{ a[NR] = $1 } END { print a[int((NR + 1) / 2)] }'
+}
+
+clang -O2 -Xclang -disable-llvm-passes -S -emit-llvm "$TEMP_DIR/hot.c" -o "$TEMP_DIR/hot.ll"
+mlir-translate --import-llvm "$TEMP_DIR/hot.ll" -o "$TEMP_DIR/hot.mlir"
+clang -O2 -c "$RUNTIME" -o "$TEMP_DIR/obfs_antidebug.o"
+
+# Baseline goes through the same MLIR round trip with only obs-lower
+mlir-opt "$TEMP_DIR/hot.mlir" --load-pass-plugin="$LIBRARY" \
+    --pass-pipeline="builtin.module(obs-lower)" -o "$TEMP_DIR/base.mlir"
+mlir-translate --mlir-to-llvmir "$TEMP_DIR/base.mlir" -o "$TEMP_DIR/base.ll"
+clang -O2 "$TEMP_DIR/base.ll" -o "$TEMP_DIR/base"
+base_us=$(median_runtime "$TEMP_DIR/base")
+
+echo "=========================================="
+echo "  Anti-Debug Benchmark ($CALLS calls)"
+echo "  techniques=$TECHNIQUES proc-cache-ms=$PROC_CACHE_MS"
+echo "=========================================="
+echo ""
+printf "%-12s %12s %10s %10s\n" "budget-us" "runtime us" "overhead" "ns/call"
+printf "%-12s %12s %10s %10s\n" "none" "$base_us" "-" "-"
+
+for budget in $BUDGETS; do
+    mlir-opt "$TEMP_DIR/hot.mlir" --load-pass-plugin="$LIBRARY" \
+        --pass-pipeline="builtin.module(anti-debug{techniques=$TECHNIQUES budget-us=$budget proc-cache-ms=$PROC_CACHE_MS},obs-lower)" \
+        -o "$TEMP_DIR/ad_$budget.mlir" || {
+        echo -e "${YELLOW}⚠ budget-us=$budget: anti-debug failed, skipped${NC}"
+        continue
+    }
+    mlir-translate --mlir-to-llvmir "$TEMP_DIR/ad_$budget.mlir" -o "$TEMP_DIR/ad_$budget.ll"
+    clang -O2 "$TEMP_DIR/ad_$budget.ll" "$TEMP_DIR/obfs_antidebug.o" -o "$TEMP_DIR/ad_$budget"
+    us=$(median_runtime "$TEMP_DIR/ad_$budget")
+    printf "%-12s %12s %9s%% %10s\n" "$budget" "$us" \
+        "$(awk -v a="$us" -v b="$base_us" 'BEGIN { printf "%.2f", (a - b) * 100 / b }')" \
+        "$(awk -v a="$us" -v b="$base_us" -v n="$CALLS" 'BEGIN { printf "%.3f", (a - b) * 1000 / n }')"
+done
+
+echo ""
+echo "Overhead above budget-us/10^4 % is the inline countdown (load, sub, store, branch)."
+echo -e "${GREEN}✓ Benchmark complete${NC}"
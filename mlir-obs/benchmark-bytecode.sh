@@ -0,0 +1,144 @@
+#!/bin/bash
+# Compare textual MLIR (.mlir) with MLIR bytecode (.mlirbc) for the modules
+# the MLIR stage persists: file size, parse time, and the time to print one
+# function from bytecode with lazy loading (mlir-obfuscate --print-functions).
+# Also checks that the passes give identical output on either format.
+#
+# Usage: ./benchmark-bytecode.sh [input ...]
+#   ./benchmark-bytecode.sh                       # benchmark suite programs
+#   ./benchmark-bytecode.sh app.bc big.ll foo.c   # .c/.cpp are compiled first
+#
+# Environment:
+#   PIPELINE=...  pass list used for the validation run (default
+#                 string-encrypt,symbol-obfuscate,constant-obfuscate,obs-lower)
+#   RUNS=<n>      timed runs per input, median reported (default 5)
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+PIPELINE="${PIPELINE:-string-encrypt,symbol-obfuscate,constant-obfuscate,obs-lower}"
+RUNS="${RUNS:-5}"
+
+LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f 2>/dev/null | head -1)
+DRIVER="$SCRIPT_DIR/build/tools/mlir-obfuscate"
+if [ -z "$LIBRARY" ] || [ ! -x "$DRIVER" ]; then
+    echo -e "${RED}ERROR: MLIR library or mlir-obfuscate not found. Please run ./build.sh first${NC}"
+    exit 1
+fi
+
+INPUTS=("$@")
+if [ ${#INPUTS[@]} -eq 0 ]; then
+    while IFS= read -r src; do
+        INPUTS+=("$src")
+    done < <(find "$SCRIPT_DIR/../benchmark_suite/test_programs" \
+                  -type f \( -name '*.c' -o -name '*.cpp' \) 2>/dev/null | sort)
+fi
+if [ ${#INPUTS[@]} -eq 0 ]; then
+    echo -e "${YELLOW}No benchmark programs found; pass inputs explicitly${NC}"
+    exit 1
+fi
+
+TEMP_DIR="$(mktemp -d)"
+trap "rm -rf $TEMP_DIR" EXIT
+
+now_ms() { echo $(( $(date +%s%N) / 1000000 )); }
+
+median() {
+    sort -n | awk '{ t[NR] = $1 } END { print t[int((NR + 1) / 2)] }'
+}
+
+# Median "Parser" time in ms that mlir-opt's own timer reports for a file
+parse_ms() {
+    for _ in $(seq "$RUNS"); do
+        mlir-opt "$1" --mlir-timing --mlir-timing-display=list -o /dev/null 2>&1 |
+            awk '$NF == "Parser" { printf "%.1f\n", $1 * 1000 }'
+    done | median
+}
+
+# Median wall time in ms of RUNS executions of "$@"
+median_ms() {
+    local start
+    for _ in $(seq "$RUNS"); do
+        start=$(now_ms)
+        "$@" >/dev/null 2>&1 || return 1
+        echo $(( $(now_ms) - start ))
+    done | median
+}
+
+echo "=========================================="
+echo "  MLIR intermediates: text vs. bytecode"
+echo "  median of $RUNS runs"
+echo "=========================================="
+echo ""
+printf "%-24s %10s %10s %7s %10s %10s %9s %8s\n" \
+    "input" "text KiB" "bc KiB" "ratio" "text ms" "bc ms" "lazy1 ms" "passes"
+
+failed=0
+for input in "${INPUTS[@]}"; do
+    name=$(basename "$input")
+    stem="${name%.*}"
+    case "$input" in
+        *.ll|*.bc) ir="$input" ;;
+        *)
+            compiler="clang"
+            case "$input" in
+                *.cpp|*.cc|*.cxx) compiler="clang++" ;;
+            esac
+            ir="$TEMP_DIR/$stem.input.ll"
+            # Same flags as the CLI's MLIR stage
+            $compiler "$input" -O2 -Xclang -disable-llvm-passes -S -emit-llvm -o "$ir" 2>/dev/null || {
+                echo -e "${YELLOW}⚠ $name: IR generation failed, skipped${NC}"
+                continue
+            }
+            ;;
+    esac
+
+    text="$TEMP_DIR/$stem.mlir"
+    bytecode="$TEMP_DIR/$stem.mlirbc"
+    mlir-translate --import-llvm "$ir" -o "$text" 2>/dev/null &&
+    mlir-opt "$text" --emit-bytecode -o "$bytecode" 2>/dev/null || {
+        echo -e "${YELLOW}⚠ $name: import failed, skipped${NC}"
+        continue
+    }
+
+    text_kib=$(( $(stat -c %s "$text") / 1024 ))
+    bc_kib=$(( $(stat -c %s "$bytecode") / 1024 ))
+    text_ms=$(parse_ms "$text")
+    bc_ms=$(parse_ms "$bytecode")
+
+    # Print the first defined function only; the rest stay unloaded
+    first_fn=$(grep -m1 -oE '^  llvm\.func (@[^ (]+|[a-z_]+ @[^ (]+)' "$text" | grep -oE '@[^ (]+' | tr -d '@"')
+    lazy_ms="-"
+    if [ -n "$first_fn" ]; then
+        lazy_ms=$(median_ms "$DRIVER" "$bytecode" --print-functions="$first_fn" -o /dev/null) || lazy_ms="fail"
+    fi
+
+    # The passes must not care which format they were read from
+    passes="same"
+    for format in mlir mlirbc; do
+        mlir-opt "$TEMP_DIR/$stem.$format" --load-pass-plugin="$LIBRARY" \
+            --pass-pipeline="builtin.module($PIPELINE)" --emit-bytecode -o "$TEMP_DIR/$stem.$format.obf" 2>/dev/null &&
+        mlir-translate --mlir-to-llvmir "$TEMP_DIR/$stem.$format.obf" -o "$TEMP_DIR/$stem.$format.ll" 2>/dev/null || passes="fail"
+    done
+    if [ "$passes" = "same" ] && ! cmp -s "$TEMP_DIR/$stem.mlir.ll" "$TEMP_DIR/$stem.mlirbc.ll"; then
+        passes="differ"
+    fi
+    [ "$passes" = "same" ] || failed=$((failed + 1))
+
+    printf "%-24s %10s %10s %7s %10s %10s %9s %8s\n" "$name" "$text_kib" "$bc_kib" \
+        "$(awk -v t="$text_kib" -v b="$bc_kib" 'BEGIN { print b ? sprintf("%.1fx", t / b) : "-" }')" \
+        "$text_ms" "$bc_ms" "$lazy_ms" "$passes"
+done
+
+echo ""
+if [ "$failed" -gt 0 ]; then
+    echo -e "${RED}✗ $failed input(s) gave different or failed pass output on bytecode${NC}"
+    exit 1
+fi
+echo -e "${GREEN}✓ Benchmark complete, pass output identical for text and bytecode${NC}"
@@ -0,0 +1,86 @@
+#!/bin/bash
+# Conversion throughput of convert-cir-to-func on a synthetic CIR module
+# with a large number of memory ops spread over many functions.
+#
+# Usage: ./benchmark-cir-to-func.sh [memory-ops] [ops-per-function]
+#   ./benchmark-cir-to-func.sh               # 1M ops, 1000 per function
+#
+# The pass runs through mlir-opt with the MLIRObfuscation plugin, which
+# registers the CIR passes; the CIR ops themselves stay unregistered.
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+
+GREEN='\033[0;32m'
+BLUE='\033[0;34m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+TOTAL_OPS="${1:-1000000}"
+OPS_PER_FUNC="${2:-1000}"
+LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f 2>/dev/null | head -1)
+if [ -z "$LIBRARY" ]; then
+    echo -e "${RED}ERROR: MLIR library not found. Please run ./build.sh first${NC}"
+    exit 1
+fi
+
+TEMP_DIR="$(mktemp -d)"
+trap "rm -rf $TEMP_DIR" EXIT
+
+INPUT="$TEMP_DIR/cir.mlir"
+
+# Generic form so the module parses without the CIR dialect loaded. Each
+# group is ptr_add, single- and two-index gep, load through the gep, store.
+echo -e "${BLUE}Generating module with $TOTAL_OPS CIR memory ops...${NC}"
+awk -v total="$TOTAL_OPS" -v per="$OPS_PER_FUNC" 'BEGIN {
+    funcs = int((total + per - 1) / per)
+    emitted = 0
+    for (f = 0; f < funcs; f++) {
+        print "\"cir.func\"() ({"
+        print "^bb0(%p: memref<?xi32>, %i: index, %j: index):"
+        for (n = 0; n < per && emitted < total; n += 5) {
+            printf "  %%a%d = \"cir.ptr_add\"(%%p, %%i) : (memref<?xi32>, index) -> memref<?xi32, strided<[1], offset: ?>>\n", n
+            printf "  %%g%d = \"cir.gep\"(%%p, %%j) : (memref<?xi32>, index) -> memref<?xi32, strided<[1], offset: ?>>\n", n
+            printf "  %%h%d = \"cir.gep\"(%%p, %%i, %%j) : (memref<?xi32>, index, index) -> memref<?xi32, strided<[1], offset: ?>>\n", n
+            printf "  %%v%d = \"cir.load\"(%%g%d, %%i) : (memref<?xi32, strided<[1], offset: ?>>, index) -> i32\n", n, n
+            printf "  \"cir.store\"(%%v%d, %%h%d, %%j) : (i32, memref<?xi32, strided<[1], offset: ?>>, index) -> ()\n", n, n
+            emitted += 5
+        }
+        print "  \"cir.return\"() : () -> ()"
+        printf "}) {sym_name = \"f%d\", function_type = (memref<?xi32>, index, index) -> ()} : () -> ()\n", f
+    }
+}' > "$INPUT"
+
+count_cir() {
+    grep -c '"cir\.' "$1" || true
+}
+
+run_pass() {
+    local label="$1"
+    shift
+    local output="$TEMP_DIR/out_$label.mlir"
+    local start end ms
+    start=$(date +%s%N)
+    mlir-opt "$INPUT" --load-pass-plugin="$LIBRARY" --allow-unregistered-dialect \
+        --pass-pipeline="builtin.module(convert-cir-to-func)" "$@" -o "$output"
+    end=$(date +%s%N)
+    ms=$(( (end - start) / 1000000 ))
+    printf "%-14s %10s ms %12s ops/s %10s cir left\n" "$label" "$ms" \
+        "$(awk -v n="$TOTAL_OPS" -v t="$ms" 'BEGIN { printf "%d", t ? n * 1000 / t : 0 }')" \
+        "$(count_cir "$output")"
+}
+
+echo ""
+printf "%-14s %13s %18s %19s\n" "run" "time" "throughput" "remaining"
+run_pass "1-thread" --mlir-disable-threading
+run_pass "threaded"
+
+echo ""
+echo "Per-pass breakdown (threaded):"
+mlir-opt "$INPUT" --load-pass-plugin="$LIBRARY" --allow-unregistered-dialect \
+    --pass-pipeline="builtin.module(convert-cir-to-func)" \
+    --mlir-timing -o /dev/null 2>&1 | grep -E "Total|convert-cir-to-func|Parser|Output"
+
+echo ""
+echo -e "${GREEN}✓ Benchmark complete${NC}"
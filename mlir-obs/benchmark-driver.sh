@@ -0,0 +1,125 @@
+#!/bin/bash
+# Time the MLIR stage end to end: the three-process chain the CLI used to
+# run (mlir-translate --import-llvm | mlir-opt --load-pass-plugin |
+# mlir-translate --mlir-to-llvmir, with .mlir text on disk in between)
+# against the single-process mlir-obfuscate driver on the same pipeline.
+#
+# Usage: ./benchmark-driver.sh [input ...]
+#   ./benchmark-driver.sh                       # benchmark suite programs
+#   ./benchmark-driver.sh app.bc big.ll foo.c   # .c/.cpp are compiled first
+#
+# Large inputs show the difference best; whole-program IR from
+# `llvm-link *.bc -o app.bc` works as is.
+#
+# Environment:
+#   PIPELINE=...  pass list (default string-encrypt,symbol-obfuscate,
+#                 constant-obfuscate,obs-lower)
+#   RUNS=<n>      timed runs per input, median reported (default 5)
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+PIPELINE="${PIPELINE:-string-encrypt,symbol-obfuscate,constant-obfuscate,obs-lower}"
+RUNS="${RUNS:-5}"
+
+LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f 2>/dev/null | head -1)
+DRIVER="$SCRIPT_DIR/build/tools/mlir-obfuscate"
+if [ -z "$LIBRARY" ] || [ ! -x "$DRIVER" ]; then
+    echo -e "${RED}ERROR: MLIR library or mlir-obfuscate not found. Please run ./build.sh first${NC}"
+    exit 1
+fi
+
+INPUTS=("$@")
+if [ ${#INPUTS[@]} -eq 0 ]; then
+    while IFS= read -r src; do
+        INPUTS+=("$src")
+    done < <(find "$SCRIPT_DIR/../benchmark_suite/test_programs" \
+                  -type f \( -name '*.c' -o -name '*.cpp' \) 2>/dev/null | sort)
+fi
+if [ ${#INPUTS[@]} -eq 0 ]; then
+    echo -e "${YELLOW}No benchmark programs found; pass inputs explicitly${NC}"
+    exit 1
+fi
+
+TEMP_DIR="$(mktemp -d)"
+trap "rm -rf $TEMP_DIR" EXIT
+
+now_ms() { echo $(( $(date +%s%N) / 1000000 )); }
+
+# Median wall time in ms of RUNS executions of "$@"
+median_ms() {
+    local times=() start
+    for _ in $(seq "$RUNS"); do
+        start=$(now_ms)
+        "$@" >/dev/null 2>&1 || return 1
+        times+=($(( $(now_ms) - start )))
+    done
+    printf "%s\n" "${times[@]}" | sort -n | awk '{ t[NR] = $1 } END { print t[int((NR + 1) / 2)] }'
+}
+
+chain() {
+    local input="$1" out="$2"
+    mlir-translate --import-llvm "$input" -o "$out.mlir" &&
+    mlir-opt "$out.mlir" --load-pass-plugin="$LIBRARY" \
+        --pass-pipeline="builtin.module($PIPELINE)" -o "$out.obf.mlir" &&
+    mlir-translate --mlir-to-llvmir "$out.obf.mlir" -o "$out.ll"
+}
+
+driver() {
+    local input="$1" out="$2"
+    "$DRIVER" "$input" --pass-pipeline="builtin.module($PIPELINE)" -S -o "$out.ll"
+}
+
+echo "=========================================="
+echo "  MLIR stage: 3-process chain vs. mlir-obfuscate"
+echo "  pipeline: $PIPELINE, median of $RUNS runs"
+echo "=========================================="
+echo ""
+printf "%-26s %10s %10s %10s %10s %9s\n" "input" "IR lines" "chain ms" "driver ms" "saved ms" "speedup"
+
+total_chain=0
+total_driver=0
+for input in "${INPUTS[@]}"; do
+    name=$(basename "$input")
+    stem="${name%.*}"
+    case "$input" in
+        *.ll|*.bc) ir="$input" ;;
+        *)
+            compiler="clang"
+            case "$input" in
+                *.cpp|*.cc|*.cxx) compiler="clang++" ;;
+            esac
+            ir="$TEMP_DIR/$stem.input.ll"
+            # Same flags as the CLI's MLIR stage
+            $compiler "$input" -O2 -Xclang -disable-llvm-passes -S -emit-llvm -o "$ir" 2>/dev/null || {
+                echo -e "${YELLOW}⚠ $name: IR generation failed, skipped${NC}"
+                continue
+            }
+            ;;
+    esac
+    lines=$(llvm-dis -o - "$ir" 2>/dev/null | wc -l || echo "-")
+
+    chain_ms=$(median_ms chain "$ir" "$TEMP_DIR/$stem.chain") || {
+        echo -e "${YELLOW}⚠ $name: chain failed, skipped${NC}"
+        continue
+    }
+    driver_ms=$(median_ms driver "$ir" "$TEMP_DIR/$stem.driver") || {
+        echo -e "${YELLOW}⚠ $name: mlir-obfuscate failed, skipped${NC}"
+        continue
+    }
+    total_chain=$((total_chain + chain_ms))
+    total_driver=$((total_driver + driver_ms))
+    printf "%-26s %10s %10s %10s %10s %9s\n" "$name" "$lines" "$chain_ms" "$driver_ms" \
+        "$((chain_ms - driver_ms))" \
+        "$(awk -v c="$chain_ms" -v d="$driver_ms" 'BEGIN { print d ? sprintf("%.2fx", c / d) : "-" }')"
+done
+
+echo ""
+echo "Total: chain ${total_chain} ms, mlir-obfuscate ${total_driver} ms"
+echo -e "${GREEN}✓ Benchmark complete${NC}"
@@ -0,0 +1,141 @@
+#!/bin/bash
+# Compare source-level FakeLoopGenerator (regex brace matching) with the
+# fake-loops pass: insertion time, .text size and runtime.
+#
+# Usage: ./benchmark-fake-loops.sh [source ...]
+#   ./benchmark-fake-loops.sh                    # test sources with 1000+ lines
+#   COUNT=20 ./benchmark-fake-loops.sh foo.c
+#
+# Environment:
+#   COUNT=<n>      fake loops per source (default 10, like --fake-loops)
+#   RUNS=<n>       timed runs per binary (default 5, median reported)
+#   MIN_LINES=<n>  line threshold for the default source set (default 1000)
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+CLI_DIR="$SCRIPT_DIR/../cmd/llvm-obfuscator"
+
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+COUNT="${COUNT:-10}"
+RUNS="${RUNS:-5}"
+MIN_LINES="${MIN_LINES:-1000}"
+
+LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f 2>/dev/null | head -1)
+if [ -z "$LIBRARY" ]; then
+    echo -e "${RED}ERROR: MLIR library not found. Please run ./build.sh first${NC}"
+    exit 1
+fi
+
+SOURCES=("$@")
+if [ ${#SOURCES[@]} -eq 0 ]; then
+    while IFS= read -r src; do
+        if [ "$(wc -l < "$src")" -ge "$MIN_LINES" ]; then
+            SOURCES+=("$src")
+        fi
+    done < <(find "$SCRIPT_DIR/../obfuscation_test_suite/test_programs" \
+                  "$SCRIPT_DIR/../benchmark_suite/test_programs" \
+                  -type f \( -name '*.c' -o -name '*.cpp' \) 2>/dev/null | sort)
+fi
+if [ ${#SOURCES[@]} -eq 0 ]; then
+    echo -e "${YELLOW}No sources with $MIN_LINES+ lines found; pass sources explicitly${NC}"
+    exit 1
+fi
+
+TEMP_DIR="$(mktemp -d)"
+trap "rm -rf $TEMP_DIR" EXIT
+
+text_size() {
+    size -A "$1" 2>/dev/null | awk '$1 == ".text" { print $2 }'
+}
+
+now_ms() {
+    echo $(( $(date +%s%N) / 1000000 ))
+}
+
+# Median wall time in microseconds over $RUNS runs
+median_runtime() {
+    local binary="$1"
+    local times=()
+    for _ in $(seq "$RUNS"); do
+        local start end
+        start=$(date +%s%N)
+        "$binary" >/dev/null 2>&1 || true
+        end=$(date +%s%N)
+        times+=($(( (end - start) / 1000 )))
+    done
+    printf '%s\n' "${times[@]}" | sort -n | awk '{ a[NR] = $1 } END { print a[int((NR + 1) / 2)] }'
+}
+
+echo "=========================================="
+echo "  Fake Loop Benchmark (count=$COUNT)"
+echo "=========================================="
+echo ""
+
+printf "%-26s %6s | %8s %9s %9s | %8s %9s %9s %6s\n" \
+    "program" "lines" "src ms" "src text" "src us" "ir ms" "ir text" "ir us" "loops"
+
+for src in "${SOURCES[@]}"; do
+    name=$(basename "$src")
+    stem="${name%.*}"
+    ext="${name##*.}"
+    compiler="clang"
+    case "$src" in
+        *.cpp|*.cc|*.cxx) compiler="clang++" ;;
+    esac
+    lines=$(wc -l < "$src")
+
+    # Source level: FakeLoopGenerator, then a normal -O2 build
+    src_out="$TEMP_DIR/${stem}_fl.$ext"
+    start=$(now_ms)
+    (cd "$CLI_DIR" && python3 -c "
+import sys
+from pathlib import Path
+from core.fake_loop_inserter import FakeLoopGenerator
+FakeLoopGenerator(seed=42).insert_fake_loops(Path(sys.argv[1]), int(sys.argv[2]), Path(sys.argv[3]))
+" "$src" "$COUNT" "$src_out") 2>/dev/null || cp "$src" "$src_out"
+    src_ms=$(( $(now_ms) - start ))
+    src_bin="$TEMP_DIR/${stem}_src"
+    if ! $compiler "$src_out" -O2 -o "$src_bin" -lm 2>/dev/null; then
+        echo -e "${YELLOW}⚠ $name: source-level build failed, skipped${NC}"
+        continue
+    fi
+
+    # IR level: fake-loops + obs-lower on the LLVM dialect
+    stats="$TEMP_DIR/${stem}_stats.txt"
+    $compiler "$src" -O2 -Xclang -disable-llvm-passes -S -emit-llvm -o "$TEMP_DIR/$stem.ll" 2>/dev/null &&
+    mlir-translate --import-llvm "$TEMP_DIR/$stem.ll" -o "$TEMP_DIR/$stem.mlir" || {
+        echo -e "${YELLOW}⚠ $name: IR import failed, skipped${NC}"
+        continue
+    }
+    start=$(now_ms)
+    mlir-opt "$TEMP_DIR/$stem.mlir" --load-pass-plugin="$LIBRARY" \
+        --pass-pipeline="builtin.module(fake-loops-plan{count=$COUNT},fake-loops,obs-lower)" \
+        --mlir-pass-statistics --mlir-pass-statistics-display=list \
+        -o "$TEMP_DIR/${stem}_fl.mlir" 2>"$stats" || {
+        echo -e "${YELLOW}⚠ $name: fake-loops failed, skipped${NC}"
+        continue
+    }
+    ir_ms=$(( $(now_ms) - start ))
+    ir_bin="$TEMP_DIR/${stem}_ir"
+    mlir-translate --mlir-to-llvmir "$TEMP_DIR/${stem}_fl.mlir" -o "$TEMP_DIR/${stem}_fl.ll" &&
+    $compiler "$TEMP_DIR/${stem}_fl.ll" -O2 -o "$ir_bin" -lm 2>/dev/null || {
+        echo -e "${YELLOW}⚠ $name: IR-level build failed, skipped${NC}"
+        continue
+    }
+    loops=$(awk '/\(S\)/ && /fake-loops-inserted/ { print $2 }' "$stats")
+
+    printf "%-26s %6s | %8s %9s %9s | %8s %9s %9s %6s\n" \
+        "$name" "$lines" \
+        "$src_ms" "$(text_size "$src_bin")" "$(median_runtime "$src_bin")" \
+        "$ir_ms" "$(text_size "$ir_bin")" "$(median_runtime "$ir_bin")" "${loops:-0}"
+    grep -E '^\s+\(S\)' "$stats" | grep fake-loops | sed "s/^/    /" || true
+done
+
+echo ""
+echo "src ms includes Python start-up; ir ms includes MLIR parse and print."
+echo -e "${GREEN}✓ Benchmark complete${NC}"
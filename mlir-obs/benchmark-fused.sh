@@ -0,0 +1,122 @@
+#!/bin/bash
+# Compare the string/symbol passes run one after another with the same
+# transforms run by fused-obfuscate, which walks the module once.
+#
+# Usage: ./benchmark-fused.sh [input ...]
+#   ./benchmark-fused.sh                       # benchmark suite programs
+#   ./benchmark-fused.sh app.bc big.ll foo.c   # .c/.cpp are compiled first
+#
+# Environment:
+#   TRANSFORMS=...  passes to compare (default string-encrypt,
+#                   constant-obfuscate,symbol-obfuscate,crypto-hash)
+#   RUNS=<n>        timed runs per input, median reported (default 5)
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+TRANSFORMS="${TRANSFORMS:-string-encrypt,constant-obfuscate,symbol-obfuscate,crypto-hash}"
+RUNS="${RUNS:-5}"
+
+LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f 2>/dev/null | head -1)
+if [ -z "$LIBRARY" ]; then
+    echo -e "${RED}ERROR: MLIR library not found. Please run ./build.sh first${NC}"
+    exit 1
+fi
+
+INPUTS=("$@")
+if [ ${#INPUTS[@]} -eq 0 ]; then
+    while IFS= read -r src; do
+        INPUTS+=("$src")
+    done < <(find "$SCRIPT_DIR/../benchmark_suite/test_programs" \
+                  -type f \( -name '*.c' -o -name '*.cpp' \) 2>/dev/null | sort)
+fi
+if [ ${#INPUTS[@]} -eq 0 ]; then
+    echo -e "${YELLOW}No benchmark programs found; pass inputs explicitly${NC}"
+    exit 1
+fi
+
+# Full-module walks per pass on LLVM-dialect input (func dialect adds
+# three more each to symbol-obfuscate and crypto-hash)
+walks_of() {
+    case "$1" in
+        string-encrypt|constant-obfuscate) echo 1 ;;
+        symbol-obfuscate) echo 6 ;;
+        crypto-hash) echo 4 ;;
+        *) echo 0 ;;
+    esac
+}
+SEQUENTIAL_WALKS=0
+for transform in ${TRANSFORMS//,/ }; do
+    SEQUENTIAL_WALKS=$((SEQUENTIAL_WALKS + $(walks_of "$transform")))
+done
+
+TEMP_DIR="$(mktemp -d)"
+trap "rm -rf $TEMP_DIR" EXIT
+
+# Median time in ms mlir-opt's timer attributes to the mlir-obs passes
+# (obs-lower excluded) for one pipeline
+pass_ms() {
+    local input="$1" pipeline="$2"
+    for _ in $(seq "$RUNS"); do
+        mlir-opt "$input" --load-pass-plugin="$LIBRARY" --pass-pipeline="builtin.module($pipeline)" \
+            --mlir-timing --mlir-timing-display=list -o /dev/null 2>&1 |
+            awk '/obs::/ && !/LowerObs/ { total += $1 } END { printf "%.1f\n", total * 1000 }'
+    done | sort -n | awk '{ t[NR] = $1 } END { print t[int((NR + 1) / 2)] }'
+}
+
+echo "=========================================="
+echo "  Sequential passes vs. fused-obfuscate"
+echo "  transforms: $TRANSFORMS, median of $RUNS runs"
+echo "  module walks: $SEQUENTIAL_WALKS sequential, 1 fused"
+echo "=========================================="
+echo ""
+printf "%-26s %10s %12s %10s %9s\n" "input" "IR lines" "sequential ms" "fused ms" "speedup"
+
+total_sequential=0
+total_fused=0
+for input in "${INPUTS[@]}"; do
+    name=$(basename "$input")
+    stem="${name%.*}"
+    case "$input" in
+        *.ll|*.bc) ir="$input" ;;
+        *)
+            compiler="clang"
+            case "$input" in
+                *.cpp|*.cc|*.cxx) compiler="clang++" ;;
+            esac
+            ir="$TEMP_DIR/$stem.input.ll"
+            # Same flags as the CLI's MLIR stage
+            $compiler "$input" -O2 -Xclang -disable-llvm-passes -S -emit-llvm -o "$ir" 2>/dev/null || {
+                echo -e "${YELLOW}⚠ $name: IR generation failed, skipped${NC}"
+                continue
+            }
+            ;;
+    esac
+    mlir="$TEMP_DIR/$stem.mlirbc"
+    mlir-translate --import-llvm "$ir" 2>/dev/null | mlir-opt --emit-bytecode -o "$mlir" 2>/dev/null || {
+        echo -e "${YELLOW}⚠ $name: import failed, skipped${NC}"
+        continue
+    }
+    lines=$(llvm-dis -o - "$ir" 2>/dev/null | wc -l || echo "-")
+
+    sequential_ms=$(pass_ms "$mlir" "$TRANSFORMS")
+    fused_ms=$(pass_ms "$mlir" "fused-obfuscate{transforms=$TRANSFORMS}")
+    if [ -z "$sequential_ms" ] || [ -z "$fused_ms" ]; then
+        echo -e "${YELLOW}⚠ $name: pipeline failed, skipped${NC}"
+        continue
+    fi
+    total_sequential=$(awk -v a="$total_sequential" -v b="$sequential_ms" 'BEGIN { print a + b }')
+    total_fused=$(awk -v a="$total_fused" -v b="$fused_ms" 'BEGIN { print a + b }')
+    printf "%-26s %10s %12s %10s %9s\n" "$name" "$lines" "$sequential_ms" "$fused_ms" \
+        "$(awk -v s="$sequential_ms" -v f="$fused_ms" 'BEGIN { print f > 0 ? sprintf("%.2fx", s / f) : "-" }')"
+done
+
+echo ""
+echo "Total: sequential ${total_sequential} ms, fused ${total_fused} ms"
+echo -e "${GREEN}✓ Benchmark complete${NC}"
@@ -0,0 +1,130 @@
+#!/bin/bash
+# Validate the static hotness estimate against real profiles: each program
+# is built with -fprofile-instr-generate and run, then profile-tiers tiers
+# the profiled IR twice, once from the counts (source=profile) and once
+# from HotnessAnalysis (source=static).
+#
+# Usage: ./benchmark-hotness.sh [source ...]
+#   ./benchmark-hotness.sh                     # benchmark suite programs
+#   HOT=80 ./benchmark-hotness.sh foo.c
+#
+# Environment:
+#   HOT=<n>    hot-percent (default 90)
+#   WARM=<n>   warm-percent (default 99)
+#   ARGS=...   arguments for the training run (default none)
+#
+# Columns: agree = functions given the same tier; hot recall = profiled-hot
+# functions estimated hot; hot+warm recall = profiled-hot functions
+# estimated hot or warm (the ones a static run still protects);
+# false hot = estimated-hot functions that were cold in the profile.
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+HOT="${HOT:-90}"
+WARM="${WARM:-99}"
+
+LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f 2>/dev/null | head -1)
+if [ -z "$LIBRARY" ]; then
+    echo -e "${RED}ERROR: MLIR library not found. Please run ./build.sh first${NC}"
+    exit 1
+fi
+
+SOURCES=("$@")
+if [ ${#SOURCES[@]} -eq 0 ]; then
+    while IFS= read -r src; do
+        SOURCES+=("$src")
+    done < <(find "$SCRIPT_DIR/../benchmark_suite/test_programs" \
+                  -type f \( -name '*.c' -o -name '*.cpp' \) 2>/dev/null | sort)
+fi
+if [ ${#SOURCES[@]} -eq 0 ]; then
+    echo -e "${YELLOW}No benchmark programs found; pass sources explicitly${NC}"
+    exit 1
+fi
+
+TEMP_DIR="$(mktemp -d)"
+trap "rm -rf $TEMP_DIR" EXIT
+
+# "name tier" per function tiered by profile-tiers
+tiers() {
+    local input="$1" source="$2"
+    mlir-opt "$input" --load-pass-plugin="$LIBRARY" \
+        --pass-pipeline="builtin.module(profile-tiers{hot-percent=$HOT warm-percent=$WARM source=$source})" \
+        2>/dev/null |
+        sed -n 's/^ *llvm\.func [a-z_ ]*@"\{0,1\}\([^"(]*\)"\{0,1\}(.*obs\.tier = "\([a-z]*\)".*/\1 \2/p' |
+        sort
+}
+
+echo "=========================================="
+echo "  Static hotness vs. profile (hot=$HOT% warm=$WARM%)"
+echo "=========================================="
+echo ""
+printf "%-26s %6s %6s %8s %11s %16s %10s\n" \
+    "program" "funcs" "agree" "hot" "hot recall" "hot+warm recall" "false hot"
+
+total_funcs=0
+total_agree=0
+for src in "${SOURCES[@]}"; do
+    name=$(basename "$src")
+    stem="${name%.*}"
+    compiler="clang"
+    case "$src" in
+        *.cpp|*.cc|*.cxx) compiler="clang++" ;;
+    esac
+
+    # Training run
+    if ! $compiler "$src" -O2 -fprofile-instr-generate -o "$TEMP_DIR/$stem.gen" -lm 2>/dev/null; then
+        echo -e "${YELLOW}⚠ $name: instrumented build failed, skipped${NC}"
+        continue
+    fi
+    (cd "$TEMP_DIR" && LLVM_PROFILE_FILE="$stem.profraw" "./$stem.gen" $ARGS >/dev/null 2>&1) || true
+    llvm-profdata merge -o "$TEMP_DIR/$stem.profdata" "$TEMP_DIR/$stem.profraw" 2>/dev/null || {
+        echo -e "${YELLOW}⚠ $name: no profile written, skipped${NC}"
+        continue
+    }
+
+    # Profiled IR, as the CLI's MLIR stage sees it
+    $compiler "$src" -O2 -Xclang -disable-llvm-passes -S -emit-llvm \
+        -fprofile-instr-use="$TEMP_DIR/$stem.profdata" -Wno-profile-instr-unprofiled \
+        -o "$TEMP_DIR/$stem.ll" 2>/dev/null &&
+    mlir-translate --import-llvm "$TEMP_DIR/$stem.ll" -o "$TEMP_DIR/$stem.mlir" || {
+        echo -e "${YELLOW}⚠ $name: IR import failed, skipped${NC}"
+        continue
+    }
+
+    tiers "$TEMP_DIR/$stem.mlir" profile > "$TEMP_DIR/$stem.profile"
+    tiers "$TEMP_DIR/$stem.mlir" static > "$TEMP_DIR/$stem.static"
+    if [ ! -s "$TEMP_DIR/$stem.profile" ]; then
+        echo -e "${YELLOW}⚠ $name: no functions tiered, skipped${NC}"
+        continue
+    fi
+
+    read -r funcs agree hot recall recall_warm false_hot < <(
+        join "$TEMP_DIR/$stem.profile" "$TEMP_DIR/$stem.static" | awk '
+            { n++ }
+            $2 == $3 { same++ }
+            $2 == "hot" { hot++; if ($3 == "hot") rec++; if ($3 != "cold") recw++ }
+            $3 == "hot" && $2 == "cold" { fh++ }
+            END {
+                printf "%d %d %d %s %s %d\n", n, same, hot,
+                    hot ? sprintf("%.0f%%", 100 * rec / hot) : "-",
+                    hot ? sprintf("%.0f%%", 100 * recw / hot) : "-", fh
+            }')
+    total_funcs=$((total_funcs + funcs))
+    total_agree=$((total_agree + agree))
+    printf "%-26s %6s %6s %8s %11s %16s %10s\n" \
+        "$name" "$funcs" "$agree" "$hot" "$recall" "$recall_warm" "$false_hot"
+done
+
+echo ""
+if [ "$total_funcs" -gt 0 ]; then
+    echo "Overall tier agreement: $total_agree / $total_funcs functions" \
+         "($(( 100 * total_agree / total_funcs ))%)"
+fi
+echo -e "${GREEN}✓ Benchmark complete${NC}"
@@ -0,0 +1,165 @@
+#!/bin/bash
+# Measure .text size and runtime of an mlir-obs pass pipeline against an
+# unobfuscated build of the same sources.
+#
+# Usage: ./benchmark-passes.sh "<pass-pipeline>" [source ...]
+#   ./benchmark-passes.sh "function-merge"
+#   ./benchmark-passes.sh "address-obfuscation" ../benchmark_suite/test_programs/03_matrix_medium.c
+#
+# Environment:
+#   RUNS=<n>       timed runs per binary (default 5, median reported)
+#   OPT_LEVEL=-O2  optimization level used for both builds
+#   RECOVERY=1     run the post-obfuscation recovery pipeline with opt and
+#                  let clang only do codegen (mirrors the Python CLI), and
+#                  report how many opaque barriers survived
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+
+GREEN='\033[0;32m'
+BLUE='\033[0;34m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+PIPELINE="${1:-}"
+shift || true
+
+if [ -z "$PIPELINE" ]; then
+    echo "Usage: $0 \"<pass-pipeline>\" [source ...]"
+    exit 1
+fi
+
+SOURCES=("$@")
+if [ ${#SOURCES[@]} -eq 0 ]; then
+    SOURCES=("$SCRIPT_DIR"/../obfuscation_test_suite/test_programs/cpp/*.cpp)
+fi
+
+RUNS="${RUNS:-5}"
+OPT_LEVEL="${OPT_LEVEL:--O2}"
+RECOVERY="${RECOVERY:-0}"
+CLI_DIR="$SCRIPT_DIR/../cmd/llvm-obfuscator"
+
+if [ "$RECOVERY" = "1" ]; then
+    # The pipeline the CLI ships, not a copy of it
+    RECOVERY_PIPELINE=$(cd "$CLI_DIR" && python3 -c "
+from core.obfuscator import LLVMObfuscator
+print(LLVMObfuscator.RECOVERY_PIPELINE)
+" 2>/dev/null | tail -1)
+    if [ -z "$RECOVERY_PIPELINE" ]; then
+        echo -e "${RED}ERROR: could not read RECOVERY_PIPELINE from $CLI_DIR/core/obfuscator.py${NC}"
+        exit 1
+    fi
+fi
+
+LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f 2>/dev/null | head -1)
+if [ -z "$LIBRARY" ]; then
+    echo -e "${RED}ERROR: MLIR library not found. Please run ./build.sh first${NC}"
+    exit 1
+fi
+
+TEMP_DIR="$(mktemp -d)"
+trap "rm -rf $TEMP_DIR" EXIT
+
+text_size() {
+    size -A "$1" 2>/dev/null | awk '$1 == ".text" { print $2 }'
+}
+
+# Median wall time in microseconds over $RUNS runs
+median_runtime() {
+    local binary="$1"
+    local times=()
+    for _ in $(seq "$RUNS"); do
+        local start end
+        start=$(date +%s%N)
+        "$binary" >/dev/null 2>&1 || true
+        end=$(date +%s%N)
+        times+=($(( (end - start) / 1000 )))
+    done
+    printf '%s\n' "${times[@]}" | sort -n | awk '{ a[NR] = $1 } END { print a[int((NR + 1) / 2)] }'
+}
+
+echo "=========================================="
+echo "  mlir-obs Pass Benchmark"
+echo "=========================================="
+echo ""
+echo "Pipeline: builtin.module($PIPELINE,obs-lower)"
+echo "Plugin:   $LIBRARY"
+echo "Runs:     $RUNS ($OPT_LEVEL)"
+if [ "$RECOVERY" = "1" ]; then
+    echo "Recovery: opt -passes=<recovery pipeline>, clang codegen only"
+fi
+echo ""
+
+printf "%-28s %10s %10s %8s %10s %10s %8s\n" \
+    "program" "text(base)" "text(obf)" "delta" "us(base)" "us(obf)" "delta"
+
+for src in "${SOURCES[@]}"; do
+    name=$(basename "$src")
+    stem="${name%.*}"
+    compiler="clang"
+    case "$src" in
+        *.cpp|*.cc|*.cxx) compiler="clang++" ;;
+    esac
+
+    base_bin="$TEMP_DIR/${stem}_base"
+    obf_bin="$TEMP_DIR/${stem}_obf"
+    stats="$TEMP_DIR/${stem}_stats.txt"
+
+    if ! $compiler "$src" $OPT_LEVEL -o "$base_bin" -lm 2>/dev/null; then
+        echo -e "${YELLOW}⚠ $name: baseline build failed, skipped${NC}"
+        continue
+    fi
+
+    if ! { $compiler "$src" $OPT_LEVEL -Xclang -disable-llvm-passes -S -emit-llvm -o "$TEMP_DIR/$stem.ll" &&
+           mlir-translate --import-llvm "$TEMP_DIR/$stem.ll" -o "$TEMP_DIR/$stem.mlir" &&
+           mlir-opt "$TEMP_DIR/$stem.mlir" \
+               --load-pass-plugin="$LIBRARY" \
+               --pass-pipeline="builtin.module($PIPELINE,obs-lower)" \
+               --mlir-pass-statistics --mlir-pass-statistics-display=list \
+               -o "$TEMP_DIR/${stem}_obf.mlir" 2>"$stats" &&
+           mlir-translate --mlir-to-llvmir "$TEMP_DIR/${stem}_obf.mlir" -o "$TEMP_DIR/${stem}_obf.ll"; } 2>/dev/null; then
+        echo -e "${YELLOW}⚠ $name: obfuscated build failed, skipped${NC}"
+        continue
+    fi
+
+    final_ir="$TEMP_DIR/${stem}_obf.ll"
+    final_flags="$OPT_LEVEL"
+    if [ "$RECOVERY" = "1" ]; then
+        opaque_before=$(grep -cE 'asm\s+"",\s*"=r,0"' "$final_ir" || true)
+        opt -S -passes="$RECOVERY_PIPELINE" "$final_ir" -o "$TEMP_DIR/${stem}_recovered.ll" 2>/dev/null || {
+            echo -e "${YELLOW}⚠ $name: recovery pipeline failed, skipped${NC}"
+            continue
+        }
+        final_ir="$TEMP_DIR/${stem}_recovered.ll"
+        final_flags="$OPT_LEVEL -Xclang -disable-llvm-passes"
+        opaque_after=$(grep -cE 'asm\s+"",\s*"=r,0"' "$final_ir" || true)
+    fi
+
+    if ! $compiler "$final_ir" $final_flags -o "$obf_bin" -lm 2>/dev/null; then
+        echo -e "${YELLOW}⚠ $name: obfuscated build failed, skipped${NC}"
+        continue
+    fi
+
+    base_text=$(text_size "$base_bin")
+    obf_text=$(text_size "$obf_bin")
+    base_us=$(median_runtime "$base_bin")
+    obf_us=$(median_runtime "$obf_bin")
+
+    printf "%-28s %10s %10s %7s%% %10s %10s %7s%%\n" \
+        "$name" "$base_text" "$obf_text" \
+        "$(awk -v a="$base_text" -v b="$obf_text" 'BEGIN { printf "%+.1f", a ? (b - a) * 100 / a : 0 }')" \
+        "$base_us" "$obf_us" \
+        "$(awk -v a="$base_us" -v b="$obf_us" 'BEGIN { printf "%+.1f", a ? (b - a) * 100 / a : 0 }')"
+
+    if [ "$RECOVERY" = "1" ]; then
+        echo "    opaque values: $opaque_after/$opaque_before kept after recovery"
+    fi
+
+    # Pass statistics (e.g. merged-functions, accesses masked)
+    grep -E '^\s+\(S\)' "$stats" | sed "s/^/    /" || true
+done
+
+echo ""
+echo -e "${GREEN}✓ Benchmark complete${NC}"
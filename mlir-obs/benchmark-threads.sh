@@ -0,0 +1,132 @@
+#!/bin/bash
+# Thread scaling of the mlir-obs pass pipeline in mlir-obfuscate. The
+# function passes run on every function in parallel, and obs-lower does its
+# per-function work in parallel. This
+# reports the "Pass pipeline" wall time for each --threads value and
+# checks that every thread count produces byte-identical output.
+#
+# Usage: ./benchmark-threads.sh [input ...]
+#   ./benchmark-threads.sh                       # benchmark suite programs
+#   ./benchmark-threads.sh app.bc big.ll foo.c   # .c/.cpp are compiled first
+#
+# Scaling only shows on modules with many functions; whole-program IR from
+# `llvm-link *.bc -o app.bc` works as is.
+#
+# Environment:
+#   PIPELINE=...   pass list (default obs-hotness,address-obfuscation,
+#                  indirect-call-table,indirect-call,fake-loops-plan,
+#                  fake-loops,obs-lower)
+#   THREADS="..."  thread counts (default "1 2 4 8 16 32")
+#   RUNS=<n>       timed runs per input and thread count, median reported
+#                  (default 5)
+
+set -e
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+RED='\033[0;31m'
+NC='\033[0m'
+
+PIPELINE="${PIPELINE:-obs-hotness,address-obfuscation,indirect-call-table,indirect-call,fake-loops-plan,fake-loops,obs-lower}"
+THREADS="${THREADS:-1 2 4 8 16 32}"
+RUNS="${RUNS:-5}"
+
+DRIVER="$SCRIPT_DIR/build/tools/mlir-obfuscate"
+if [ ! -x "$DRIVER" ]; then
+    echo -e "${RED}ERROR: mlir-obfuscate not found. Please run ./build.sh first${NC}"
+    exit 1
+fi
+
+INPUTS=("$@")
+if [ ${#INPUTS[@]} -eq 0 ]; then
+    while IFS= read -r src; do
+        INPUTS+=("$src")
+    done < <(find "$SCRIPT_DIR/../benchmark_suite/test_programs" \
+                  -type f \( -name '*.c' -o -name '*.cpp' \) 2>/dev/null | sort)
+fi
+if [ ${#INPUTS[@]} -eq 0 ]; then
+    echo -e "${YELLOW}No benchmark programs found; pass inputs explicitly${NC}"
+    exit 1
+fi
+
+TEMP_DIR="$(mktemp -d)"
+trap "rm -rf $TEMP_DIR" EXIT
+
+# Median "Pass pipeline" wall time in ms over RUNS runs with $2 threads.
+# The last "<seconds> (" on the line is the wall-clock column.
+pipeline_ms() {
+    local input="$1" threads="$2"
+    for _ in $(seq "$RUNS"); do
+        "$DRIVER" "$input" --pass-pipeline="builtin.module($PIPELINE)" \
+            --threads="$threads" --mlir-timing -o /dev/null 2>&1 |
+            grep "Pass pipeline" | grep -oE '[0-9]+\.[0-9]+ +\(' | tail -1 |
+            awk '{ printf "%.1f\n", $1 * 1000 }'
+    done | sort -n | awk '{ t[NR] = $1 } END { print t[int((NR + 1) / 2)] }'
+}
+
+echo "=========================================="
+echo "  mlir-obs pass pipeline vs. --threads"
+echo "  pipeline: $PIPELINE"
+echo "  median of $RUNS runs, pass pipeline wall time in ms"
+echo "=========================================="
+echo ""
+printf "%-26s %8s" "input" "funcs"
+for threads in $THREADS; do
+    printf " %8s" "${threads}t"
+done
+printf " %9s %s\n" "speedup" "output"
+
+for input in "${INPUTS[@]}"; do
+    name=$(basename "$input")
+    stem="${name%.*}"
+    case "$input" in
+        *.ll|*.bc|*.mlir|*.mlirbc) ir="$input" ;;
+        *)
+            compiler="clang"
+            case "$input" in
+                *.cpp|*.cc|*.cxx) compiler="clang++" ;;
+            esac
+            ir="$TEMP_DIR/$stem.input.ll"
+            # Same flags as the CLI's MLIR stage
+            $compiler "$input" -O2 -Xclang -disable-llvm-passes -S -emit-llvm -o "$ir" 2>/dev/null || {
+                echo -e "${YELLOW}⚠ $name: IR generation failed, skipped${NC}"
+                continue
+            }
+            ;;
+    esac
+    funcs=$(llvm-dis -o - "$ir" 2>/dev/null | grep -c '^define ' || echo "-")
+
+    printf "%-26s %8s" "$name" "$funcs"
+    first_ms=""
+    last_ms=""
+    reference=""
+    deterministic="identical"
+    for threads in $THREADS; do
+        "$DRIVER" "$ir" --pass-pipeline="builtin.module($PIPELINE)" --threads="$threads" \
+            -S -o "$TEMP_DIR/$stem.$threads.ll" 2>/dev/null || {
+            printf " %8s" "fail"
+            deterministic="failed"
+            continue
+        }
+        if [ -z "$reference" ]; then
+            reference="$TEMP_DIR/$stem.$threads.ll"
+        elif ! cmp -s "$reference" "$TEMP_DIR/$stem.$threads.ll"; then
+            deterministic="DIFFERS at ${threads}t"
+        fi
+        ms=$(pipeline_ms "$ir" "$threads")
+        [ -z "$first_ms" ] && first_ms="$ms"
+        last_ms="$ms"
+        printf " %8s" "$ms"
+    done
+    speedup=$(awk -v a="$first_ms" -v b="$last_ms" 'BEGIN { print (b > 0 ? sprintf("%.2fx", a / b) : "-") }')
+    if [ "$deterministic" = "identical" ]; then
+        printf " %9s ${GREEN}%s${NC}\n" "$speedup" "$deterministic"
+    else
+        printf " %9s ${RED}%s${NC}\n" "$speedup" "$deterministic"
+    fi
+done
+
+echo ""
+echo -e "${GREEN}✓ Benchmark complete${NC}"
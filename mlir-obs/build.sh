@@ -138,6 +138,12 @@ if [ -n "$LLVM_DIR" ]; then
     CMAKE_ARGS+=(-DLLVM_DIR="$LLVM_DIR")
 fi
 
+# lit runs the FileCheck tests (check-mlir-obs); LLVM installs rarely ship it
+LIT_BIN="$(command -v llvm-lit || command -v lit || true)"
+if [ -n "$LIT_BIN" ]; then
+    CMAKE_ARGS+=(-DLLVM_EXTERNAL_LIT="$LIT_BIN")
+fi
+
 # Try to use Ninja if available (faster)
 if command -v ninja >/dev/null 2>&1; then
     CMAKE_ARGS+=(-G Ninja)
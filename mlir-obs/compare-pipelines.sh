@@ -1,6 +1,10 @@
 #!/bin/bash
 # Compare traditional LLVM pipeline vs Polygeist pipeline
 # This demonstrates the benefits of Polygeist for obfuscation
+#
+# With the plugin built, also times the obfuscated binaries of the clang
+# pipeline and the single-/two-stage Polygeist pipelines against clang -O2,
+# e.g. ./compare-pipelines.sh ../benchmark_suite/test_programs/03_matrix_medium.c
 
 set -e
 
@@ -90,6 +94,67 @@ echo "  MemRef ops (memory abstraction): $POLY_MEMREF"
 echo "  Dialects: func, scf, memref, affine, arith (high-level)"
 echo ""
 
+# ============================================================================
+# RUNTIME OVERHEAD (obfuscated kernels)
+# ============================================================================
+echo -e "${BLUE}━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━${NC}"
+echo -e "${BLUE}Runtime Overhead${NC}"
+echo -e "${BLUE}━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━${NC}"
+echo ""
+
+LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f 2>/dev/null | head -1)
+RUNS="${RUNS:-5}"
+
+# Median wall time in microseconds over $RUNS runs
+median_runtime() {
+    local binary="$1"
+    local times=()
+    for _ in $(seq "$RUNS"); do
+        local start end
+        start=$(date +%s%N)
+        "$binary" >/dev/null 2>&1 || true
+        end=$(date +%s%N)
+        times+=($(( (end - start) / 1000 )))
+    done
+    printf '%s\n' "${times[@]}" | sort -n | awk '{ a[NR] = $1 } END { print a[int((NR + 1) / 2)] }'
+}
+
+if [ -z "$LIBRARY" ]; then
+    echo "⚠ MLIR library not built - skipping runtime comparison"
+    echo ""
+else
+    OBF_PASSES="symbol-obfuscate,string-encrypt"
+
+    clang -O2 "$INPUT_FILE" -o "$TEMP_DIR/bin_baseline" -lm 2>/dev/null
+
+    # Clang pipeline: the same passes on the LLVM dialect
+    clang -O2 -Xclang -disable-llvm-passes -S -emit-llvm "$INPUT_FILE" -o "$TEMP_DIR/clang_obf_in.ll" 2>/dev/null &&
+    mlir-translate --import-llvm "$TEMP_DIR/clang_obf_in.ll" -o "$TEMP_DIR/clang_obf_in.mlir" &&
+    mlir-opt "$TEMP_DIR/clang_obf_in.mlir" --load-pass-plugin="$LIBRARY" \
+        --pass-pipeline="builtin.module($OBF_PASSES)" -o "$TEMP_DIR/clang_obf.mlir" &&
+    mlir-translate --mlir-to-llvmir "$TEMP_DIR/clang_obf.mlir" -o "$TEMP_DIR/clang_obf.ll" &&
+    clang -O2 "$TEMP_DIR/clang_obf.ll" -o "$TEMP_DIR/bin_clang" -lm 2>/dev/null || true
+
+    "$SCRIPT_DIR/polygeist-pipeline.sh" "$INPUT_FILE" "$TEMP_DIR/bin_polygeist" >/dev/null 2>&1 || true
+    "$SCRIPT_DIR/polygeist-pipeline.sh" "$INPUT_FILE" "$TEMP_DIR/bin_two_stage" --two-stage >/dev/null 2>&1 || true
+
+    BASE_US=$(median_runtime "$TEMP_DIR/bin_baseline")
+    printf "  %-26s %12s %10s\n" "Build" "us (median)" "overhead"
+    printf "  %-26s %12s %10s\n" "clang -O2 (baseline)" "$BASE_US" "-"
+    for variant in clang:"Clang pipeline" polygeist:"Polygeist" two_stage:"Polygeist two-stage"; do
+        bin="$TEMP_DIR/bin_${variant%%:*}"
+        label="${variant#*:}"
+        if [ ! -x "$bin" ]; then
+            printf "  %-26s %12s %10s\n" "$label" "failed" "-"
+            continue
+        fi
+        us=$(median_runtime "$bin")
+        printf "  %-26s %12s %9s%%\n" "$label" "$us" \
+            "$(awk -v a="$BASE_US" -v b="$us" 'BEGIN { printf "%+.1f", a ? (b - a) * 100 / a : 0 }')"
+    done
+    echo ""
+fi
+
 # ============================================================================
 # COMPARISON
 # ============================================================================
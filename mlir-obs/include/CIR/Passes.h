@@ -42,13 +42,9 @@ std::unique_ptr<Pass> createConvertCIRToFuncPass();
 // Pass Registration Functions
 //===----------------------------------------------------------------------===//
 
-/// Register all CIR passes with the MLIR pass registry
-///
-/// Call this function to make CIR passes available in mlir-opt and
-/// other MLIR tools.
-void registerCIRPasses();
-
-/// Generate pass registration code (for mlir-opt integration)
+/// Generated from Passes.td: registerCIRAddressObfuscationPass(),
+/// registerConvertCIRToFuncPass() and registerCIRPasses() for both. The
+/// MLIRObfuscation plugin calls them from registerObfuscationPasses().
 #define GEN_PASS_REGISTRATION
 #include "CIR/Passes.h.inc"
 
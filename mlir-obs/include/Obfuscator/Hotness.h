@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Obfuscator/ProfileTiers.h"
+
+#include "mlir/Analysis/CFGLoopInfo.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/IR/Dominance.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Pass/AnalysisManager.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <memory>
+
+namespace mlir {
+namespace obs {
+
+// Whether `name` is in the function's passthrough attributes ("hot",
+// "cold", "naked", "returns_twice", ...).
+bool hasPassthrough(LLVM::LLVMFuncOp func, StringRef name);
+
+// Sets the `"key"="value"` string function attribute in passthrough,
+// replacing an earlier value. Carries per-function decisions into the
+// translated LLVM IR, where they survive symbol renaming.
+void setPassthroughString(LLVM::LLVMFuncOp func, StringRef key,
+                          StringRef value);
+
+// Static block frequencies of one function, relative to a single call.
+// Probabilities follow forward edges in RPO, split evenly unless the
+// terminator carries branch_weights. Every CFG or structured loop level
+// multiplies by a trip estimate (8, or 64 for main's outermost loop, which
+// is usually the program's work loop). Blocks ending in unreachable get 0.
+//
+// Per-function analysis: getChildAnalysis<BlockFrequencyEstimate>(func)
+// from a module pass, so passes and HotnessAnalysis share one instance.
+class BlockFrequencyEstimate {
+public:
+  explicit BlockFrequencyEstimate(Operation *func);
+
+  double getFrequency(Block *block) const { return freq.lookup(block); }
+  unsigned getLoopDepth(Block *block) const { return depth.lookup(block); }
+  bool isInLoop(Block *block) const { return getLoopDepth(block) != 0; }
+  // False for blocks not reachable from the entry (never estimated).
+  bool isReachable(Block *block) const { return freq.count(block); }
+  // Frequency of the hottest block.
+  double getPeakFrequency() const { return peak; }
+  // CFG loops of the function body; null for single-block bodies.
+  const CFGLoopInfo *getLoopInfo() const { return loopInfo.get(); }
+
+private:
+  void estimateRegion(Region &region, double scale, unsigned outerDepth,
+                      const CFGLoopInfo *loops);
+  double tripEstimate(unsigned level) const;
+
+  std::unique_ptr<DominanceInfo> domInfo;
+  std::unique_ptr<CFGLoopInfo> loopInfo;
+  DenseMap<Block *, double> freq;
+  DenseMap<Block *, unsigned> depth;
+  double peak = 0.0;
+  bool isMain = false;
+};
+
+// Computes the BlockFrequencyEstimate of every function in `funcs` on the
+// context's thread pool. The per-function AnalysisManagers are nested up
+// front, since nesting is not thread-safe; the estimates themselves only
+// read their own function. getChildAnalysis afterwards returns the cached
+// result.
+void computeBlockFrequencies(ArrayRef<Operation *> funcs, AnalysisManager am);
+
+// Module-wide hotness estimate for code without a profile. Each function's
+// entry frequency is propagated over the call graph, callers first: main
+// and functions without direct callers run once, a call site adds the
+// caller's entry frequency times its block frequency, and recursive SCCs
+// count as one more loop level. Blocks are then ranked by estimated
+// executed ops and tiered with classifyByShare (90% / 99%); functions by
+// their hottest block. "hot"/"cold" passthrough attributes override both.
+//
+// Module analysis: getAnalysis<HotnessAnalysis>(). Function passes read it
+// with getCachedParentAnalysis<HotnessAnalysis>() after obs-hotness.
+class HotnessAnalysis {
+public:
+  HotnessAnalysis(Operation *module, AnalysisManager &am);
+
+  // Estimated calls per program run (main = 1).
+  double getEntryFrequency(Operation *func) const;
+  // Estimated executions of the block per program run.
+  double getFrequency(Block *block) const;
+  // Estimated executions of the function's hottest block per program run.
+  double getPeakFrequency(Operation *func) const;
+
+  // Tier of the block containing `op`; blocks created after the analysis
+  // ran are cold.
+  Tier getTier(Operation *op) const;
+  Tier getFunctionTier(Operation *func) const;
+
+  // Full-cost transforms stay out of estimated-hot blocks; cheap ones are
+  // always allowed, the estimate is too coarse to rule code out entirely.
+  // Defers to isTransformAllowed when profile-tiers ran with real counts
+  // and for functions with an explicit obs.policy.
+  bool allows(Operation *op, TransformCost cost) const;
+
+  const BlockFrequencyEstimate *getBlockFrequencies(Operation *func) const {
+    return estimates.lookup(func);
+  }
+
+private:
+  DenseMap<Operation *, const BlockFrequencyEstimate *> estimates;
+  DenseMap<Operation *, double> entryFreq;
+  DenseMap<Block *, Tier> blockTiers;
+  DenseMap<Operation *, Tier> functionTiers;
+  bool profileGuided = false;
+};
+
+} // namespace obs
+} // namespace mlir
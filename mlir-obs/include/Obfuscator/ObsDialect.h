@@ -0,0 +1,23 @@
+#pragma once
+
+#include "mlir/Bytecode/BytecodeOpInterface.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+
+#include "Obfuscator/ObsOpsDialect.h.inc"
+
+#define GET_OP_CLASSES
+#include "Obfuscator/ObsOps.h.inc"
+
+namespace mlir {
+namespace obs {
+
+// Prefix of the per-import resolver functions referenced by
+// obs.resolve_import.
+inline constexpr llvm::StringLiteral kResolverPrefix = "__obfs_resolve_";
+
+} // namespace obs
+} // namespace mlir
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/Value.h"
+
+namespace mlir {
+namespace obs {
+
+// Discardable attribute marking obfuscation-generated barriers in MLIR.
+inline constexpr llvm::StringLiteral kOpaqueAttrName = "obfs.opaque";
+
+// Routes an obfuscation-generated value (key, predicate input, key pointer)
+// through an empty `llvm.inline_asm "", "=r,0"`. The barrier costs nothing
+// at run time, but instcombine, GVN, SCCP and the global ctor evaluator
+// cannot see through it, so the post-obfuscation recovery pipeline can
+// optimize everything around it without folding the encoding away.
+// Only integer and pointer values that fit a register are supported.
+Value createOpaqueValue(OpBuilder &builder, Location loc, Value value);
+
+bool isOpaqueValue(Operation *op);
+
+} // namespace obs
+} // namespace mlir
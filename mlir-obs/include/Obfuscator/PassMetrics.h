@@ -0,0 +1,70 @@
+#pragma once
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/JSON.h"
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace llvm {
+class Function;
+} // namespace llvm
+
+namespace mlir {
+namespace obs {
+
+// Structural size of a module or function: what a per-pass snapshot
+// records. Signed, so the difference of two snapshots is a count too.
+struct IRCounts {
+  // Opcode classes of the CLI's code-size model (SizeBudgetPlanner.COST_MODEL);
+  // everything else is "default"
+  static constexpr std::array<const char *, 10> kCostClasses = {
+      "call", "load", "store", "getelementptr", "br",
+      "switch", "alloca", "phi", "ret", "default"};
+
+  int64_t functions = 0;
+  int64_t instructions = 0;
+  int64_t blocks = 0;
+  int64_t edges = 0;
+  int64_t calls = 0;
+  int64_t globals = 0;
+  std::array<int64_t, kCostClasses.size()> costClasses = {};
+
+  // Counts one instruction (LLVM opcode name or MLIR op name without its
+  // dialect, e.g. "cond_br") under its cost class.
+  void addInstruction(llvm::StringRef opcode);
+
+  IRCounts &operator+=(const IRCounts &other);
+  IRCounts &operator-=(const IRCounts &other);
+
+  llvm::json::Object toJSON() const;
+};
+
+IRCounts operator-(IRCounts lhs, const IRCounts &rhs);
+
+// Counts of one defined function (functions == 1); nothing for a declaration.
+IRCounts countFunction(const llvm::Function &function);
+
+// Module counts after each pass of one pipeline, in run order. The first
+// snapshot is the input.
+class PassMetricsTimeline {
+public:
+  explicit PassMetricsTimeline(llvm::StringRef stage) : stage(stage.str()) {}
+
+  void add(llvm::StringRef pass, const IRCounts &counts);
+  bool empty() const { return snapshots.empty(); }
+
+  // {"stage": ..., "snapshots": [{"pass": ..., <counts>}, ...]}
+  llvm::json::Value toJSON() const;
+  // Returns an error message, empty on success.
+  std::string write(llvm::StringRef path) const;
+
+private:
+  std::string stage;
+  std::vector<std::pair<std::string, IRCounts>> snapshots;
+};
+
+} // namespace obs
+} // namespace mlir
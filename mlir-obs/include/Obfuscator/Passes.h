@@ -4,6 +4,8 @@
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/Operation.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
 
 namespace mlir {
 namespace obs {
@@ -14,7 +16,8 @@ struct StringEncryptPass
 
   StringEncryptPass() = default;
   StringEncryptPass(const std::string &key) : key(key) {}
-
+  StringEncryptPass(const StringEncryptPass &other)
+      : PassWrapper(other), key(other.key) {}
 
   StringRef getArgument() const override { return "string-encrypt"; }
   StringRef getDescription() const override {
@@ -24,6 +27,9 @@ struct StringEncryptPass
   void runOnOperation() override;
 
   std::string key = "default_key";
+
+  Statistic numStrings{this, "strings-encrypted", "Number of string globals encrypted"};
+  Statistic numBytes{this, "bytes-encrypted", "Number of string bytes encrypted"};
 };
 
 std::unique_ptr<Pass> createStringEncryptPass(llvm::StringRef key);
@@ -36,6 +42,8 @@ struct ConstantObfuscationPass
 
   ConstantObfuscationPass() = default;
   ConstantObfuscationPass(const std::string &key) : key(key) {}
+  ConstantObfuscationPass(const ConstantObfuscationPass &other)
+      : PassWrapper(other), key(other.key) {}
 
   StringRef getArgument() const override { return "constant-obfuscate"; }
   StringRef getDescription() const override {
@@ -45,18 +53,57 @@ struct ConstantObfuscationPass
   void runOnOperation() override;
 
   std::string key = "default_key";
+
+  Statistic numStrings{this, "strings-encrypted", "Number of string globals encrypted"};
+  Statistic numBytes{this, "bytes-encrypted", "Number of string bytes encrypted"};
 };
 
 std::unique_ptr<Pass> createConstantObfuscationPass(llvm::StringRef key);
 
 
 
+// Function part of constant-obfuscate: runs on each llvm.func on its own,
+// in parallel under the pass manager. Reads the module hotness estimate if
+// obs-hotness ran before it.
+struct ConstantEncodePass
+    : public PassWrapper<ConstantEncodePass, OperationPass<LLVM::LLVMFuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(ConstantEncodePass)
+
+  ConstantEncodePass() = default;
+  ConstantEncodePass(StringRef encodeKey) { key = encodeKey.str(); }
+  ConstantEncodePass(const ConstantEncodePass &other) : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "constant-encode"; }
+  StringRef getDescription() const override {
+    return "Replace integer constants outside loops and hot code with "
+           "obs.encoded_const (LLVM dialect)";
+  }
+
+  void getDependentDialects(DialectRegistry &registry) const override;
+  void runOnOperation() override;
+
+  Option<std::string> key{*this, "key",
+                          llvm::cl::desc("Seed of the per-function constant keys"),
+                          llvm::cl::init("default_key")};
+
+  Statistic numEncoded{this, "constants-obfuscated", "Number of integer constants replaced by obs.encoded_const"};
+  Statistic numSkippedLoop{this, "constants-skipped-loop", "Number of constants left alone because a user is in a loop"};
+  Statistic numSkippedHot{this, "constants-skipped-hot", "Number of constants left alone because a user is in an estimated-hot block"};
+};
+
+std::unique_ptr<Pass> createConstantEncodePass(
+    llvm::StringRef key = "default_key");
+
+
+
 struct SymbolObfuscatePass
     : public PassWrapper<SymbolObfuscatePass, OperationPass<ModuleOp>> {
   MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(SymbolObfuscatePass)
 
   SymbolObfuscatePass() = default;
   SymbolObfuscatePass(const std::string &key) : key(key) {}
+  SymbolObfuscatePass(const SymbolObfuscatePass &other)
+      : PassWrapper(other), key(other.key) {}
 
   StringRef getArgument() const override { return "symbol-obfuscate"; }
   StringRef getDescription() const override {
@@ -67,6 +114,9 @@ struct SymbolObfuscatePass
 
   std::string key = "seed";
 
+  Statistic numRenamed{this, "symbols-renamed", "Number of functions and globals renamed"};
+  Statistic numKept{this, "symbols-kept", "Number of defined functions left with their name"};
+
 private:
   
   void processFuncDialect();
@@ -92,6 +142,9 @@ struct CryptoHashPass
   CryptoHashPass() = default;
   CryptoHashPass(HashAlgorithm algo, const std::string &salt, unsigned hashLength)
       : algorithm(algo), salt(salt), hashLength(hashLength) {}
+  CryptoHashPass(const CryptoHashPass &other)
+      : PassWrapper(other), algorithm(other.algorithm), salt(other.salt),
+        hashLength(other.hashLength) {}
 
   StringRef getArgument() const override { return "crypto-hash"; }
   StringRef getDescription() const override {
@@ -102,7 +155,9 @@ struct CryptoHashPass
 
   HashAlgorithm algorithm = HashAlgorithm::SHA256;
   std::string salt = "";
-  unsigned hashLength = 12;  
+  unsigned hashLength = 12;
+
+  Statistic numHashed{this, "symbols-hashed", "Number of functions renamed to a hash of their name"};
 };
 
 std::unique_ptr<Pass> createCryptoHashPass(
@@ -113,21 +168,83 @@ std::unique_ptr<Pass> createCryptoHashPass(
 
 
 
+struct FusedObfuscatePass
+    : public PassWrapper<FusedObfuscatePass, OperationPass<ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FusedObfuscatePass)
+
+  FusedObfuscatePass() = default;
+  FusedObfuscatePass(ArrayRef<std::string> enabled) { transforms = enabled; }
+  FusedObfuscatePass(const FusedObfuscatePass &other) : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "fused-obfuscate"; }
+  StringRef getDescription() const override {
+    return "Run string-encrypt, constant-obfuscate, symbol-obfuscate and "
+           "crypto-hash from a single walk of the module";
+  }
+
+  void runOnOperation() override;
+
+  // Applied in this order whatever the list order: string-encrypt,
+  // constant-obfuscate, symbol-obfuscate, crypto-hash. Same results as
+  // those passes in that order, with the string helpers emitted once.
+  ListOption<std::string> transforms{
+      *this, "transforms",
+      llvm::cl::desc("Transforms to apply: string-encrypt, constant-obfuscate, "
+                     "symbol-obfuscate, crypto-hash")};
+  // Defaults match the standalone passes'
+  Option<std::string> key{*this, "key",
+                          llvm::cl::desc("String encryption key"),
+                          llvm::cl::init("default_key")};
+  Option<std::string> symbolSeed{*this, "symbol-seed",
+                                 llvm::cl::desc("Seed of the symbol-obfuscate names"),
+                                 llvm::cl::init("seed")};
+  Option<std::string> salt{*this, "salt",
+                           llvm::cl::desc("crypto-hash salt"),
+                           llvm::cl::init("")};
+  Option<unsigned> hashLength{*this, "hash-length",
+                              llvm::cl::desc("crypto-hash digest characters kept"),
+                              llvm::cl::init(12)};
+
+  Statistic numStrings{this, "strings-encrypted", "Number of string globals encrypted"};
+  Statistic numBytes{this, "bytes-encrypted", "Number of string bytes encrypted"};
+  Statistic numSymbols{this, "symbols-renamed", "Number of functions and globals renamed"};
+  Statistic numKept{this, "symbols-kept", "Number of defined functions left with their name"};
+};
+
+std::unique_ptr<Pass> createFusedObfuscatePass(ArrayRef<std::string> transforms);
+
+
+
+// Runs on each function on its own, in parallel under the pass manager.
+// Reads the module hotness estimate if obs-hotness ran before it.
 struct SCFObfuscatePass
-    : public PassWrapper<SCFObfuscatePass, OperationPass<ModuleOp>> {
+    : public PassWrapper<SCFObfuscatePass,
+                         InterfacePass<FunctionOpInterface>> {
   MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(SCFObfuscatePass)
 
   SCFObfuscatePass() = default;
+  SCFObfuscatePass(bool preserveLoops) { preserveLoopNests = preserveLoops; }
+  SCFObfuscatePass(const SCFObfuscatePass &other) : PassWrapper(other) {}
 
   StringRef getArgument() const override { return "scf-obfuscate"; }
   StringRef getDescription() const override {
     return "Obfuscate SCF control flow with opaque predicates";
   }
 
+  void getDependentDialects(DialectRegistry &registry) const override;
   void runOnOperation() override;
+
+  // Second stage of the Polygeist two-stage pipeline: loop nests were
+  // already tiled/fused/vectorized, so nothing nested in a loop is touched.
+  Option<bool> preserveLoopNests{
+      *this, "preserve-loop-nests",
+      llvm::cl::desc("Leave ops nested inside loops untouched"),
+      llvm::cl::init(false)};
+
+  Statistic numPredicates{this, "predicates-inserted", "Number of scf.if conditions guarded by an opaque predicate"};
 };
 
-std::unique_ptr<Pass> createSCFObfuscatePass();
+std::unique_ptr<Pass> createSCFObfuscatePass(bool preserveLoopNests = false);
 
 
 
@@ -138,16 +255,23 @@ struct ImportObfuscationPass
   ImportObfuscationPass() = default;
   ImportObfuscationPass(bool encryptStrings, const std::string &key)
       : encryptStrings(encryptStrings), key(key) {}
+  ImportObfuscationPass(const ImportObfuscationPass &other)
+      : PassWrapper(other), encryptStrings(other.encryptStrings),
+        key(other.key) {}
 
   StringRef getArgument() const override { return "import-obfuscate"; }
   StringRef getDescription() const override {
     return "Hide import table by replacing external calls with dlsym lookups";
   }
 
+  void getDependentDialects(DialectRegistry &registry) const override;
   void runOnOperation() override;
 
   bool encryptStrings = true;
   std::string key = "default_key";
+
+  Statistic numImports{this, "imports-hidden", "Number of external functions resolved at run time instead of imported"};
+  Statistic numCalls{this, "import-calls-rewritten", "Number of calls routed through a resolved pointer"};
 };
 
 std::unique_ptr<Pass> createImportObfuscationPass(
@@ -156,5 +280,442 @@ std::unique_ptr<Pass> createImportObfuscationPass(
 );
 
 
+
+struct FunctionMergePass
+    : public PassWrapper<FunctionMergePass, OperationPass<ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FunctionMergePass)
+
+  FunctionMergePass() = default;
+  FunctionMergePass(unsigned minOps, unsigned maxGroupSize)
+      : minOps(minOps), maxGroupSize(maxGroupSize) {}
+  FunctionMergePass(const FunctionMergePass &other)
+      : PassWrapper(other), minOps(other.minOps),
+        maxGroupSize(other.maxGroupSize) {}
+
+  StringRef getArgument() const override { return "function-merge"; }
+  StringRef getDescription() const override {
+    return "Merge structurally similar LLVM functions behind a selector "
+           "argument and forwarding thunks";
+  }
+
+  void runOnOperation() override;
+
+  // Functions smaller than this are cheaper to keep than to thunk.
+  unsigned minOps = 8;
+  // Upper bound on the select chain emitted for each differing constant.
+  unsigned maxGroupSize = 8;
+
+  Statistic numGroups{this, "merge-groups", "Number of merged function bodies created"};
+  Statistic numMerged{this, "merged-functions", "Number of functions turned into forwarding thunks"};
+};
+
+std::unique_ptr<Pass> createFunctionMergePass(unsigned minOps = 8,
+                                              unsigned maxGroupSize = 8);
+
+
+
+// Computes HotnessAnalysis for the module and keeps it cached, so the
+// function passes scheduled after it (address-obfuscation, scf-obfuscate)
+// can read it with getCachedParentAnalysis. Changes nothing.
+struct HotnessPass
+    : public PassWrapper<HotnessPass, OperationPass<ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(HotnessPass)
+
+  StringRef getArgument() const override { return "obs-hotness"; }
+  StringRef getDescription() const override {
+    return "Compute the static hotness estimate for the function passes "
+           "that follow";
+  }
+
+  void runOnOperation() override;
+};
+
+std::unique_ptr<Pass> createHotnessPass();
+
+
+
+// Runs on each llvm.func on its own, in parallel under the pass manager.
+// Reads the module hotness estimate if obs-hotness ran before it.
+struct AddressObfuscationPass
+    : public PassWrapper<AddressObfuscationPass,
+                         OperationPass<LLVM::LLVMFuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(AddressObfuscationPass)
+
+  AddressObfuscationPass() = default;
+  AddressObfuscationPass(StringRef addressKey, bool force) {
+    key = addressKey.str();
+    forceLoops = force;
+  }
+  AddressObfuscationPass(const AddressObfuscationPass &other)
+      : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "address-obfuscation"; }
+  StringRef getDescription() const override {
+    return "Mask llvm.getelementptr indices and load/store addresses with a "
+           "per-function key (LLVM dialect)";
+  }
+
+  void getDependentDialects(DialectRegistry &registry) const override;
+  void runOnOperation() override;
+
+  Option<std::string> key{*this, "key",
+                          llvm::cl::desc("Seed of the address masking key"),
+                          llvm::cl::init("default_key")};
+  // Also mask accesses inside innermost loops that look vectorizable and
+  // in blocks HotnessAnalysis estimates hot.
+  Option<bool> forceLoops{
+      *this, "force-loops",
+      llvm::cl::desc("Mask accesses in vectorizable inner loops and "
+                     "estimated-hot blocks too"),
+      llvm::cl::init(false)};
+
+  Statistic numMasked{this, "accesses-masked", "Number of GEP indices and pointers masked"};
+  Statistic numSkippedInLoops{this, "accesses-skipped-in-loops", "Number of accesses left alone inside vectorizable inner loops"};
+  Statistic numSkippedHot{this, "accesses-skipped-hot", "Number of accesses left alone in estimated-hot blocks"};
+};
+
+std::unique_ptr<Pass> createAddressObfuscationPass(
+    llvm::StringRef key = "default_key",
+    bool forceLoops = false
+);
+
+
+
+// Module part of indirect-call: picks the call sites, numbers the slots
+// and creates the shared table. Marks each site for indirect-call, which
+// must run right after it.
+struct IndirectCallTablePass
+    : public PassWrapper<IndirectCallTablePass, OperationPass<ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(IndirectCallTablePass)
+
+  IndirectCallTablePass() = default;
+  IndirectCallTablePass(bool obfuscateStdlib, bool obfuscateCustom) {
+    stdlib = obfuscateStdlib;
+    custom = obfuscateCustom;
+  }
+  IndirectCallTablePass(const IndirectCallTablePass &other)
+      : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "indirect-call-table"; }
+  StringRef getDescription() const override {
+    return "Build the encoded, cache-line-packed function pointer table "
+           "indirect-call routes llvm.call through";
+  }
+
+  void runOnOperation() override;
+
+  Option<bool> stdlib{*this, "stdlib",
+                      llvm::cl::desc("Convert calls to external functions"),
+                      llvm::cl::init(true)};
+  Option<bool> custom{*this, "custom",
+                      llvm::cl::desc("Convert calls to functions defined in the module"),
+                      llvm::cl::init(true)};
+
+  Statistic numSkippedLoop{this, "icall-sites-skipped-loop", "Number of call sites left direct inside loops"};
+  Statistic numSkippedHot{this, "icall-sites-skipped-hot", "Number of call sites left direct in hot functions or estimated-hot blocks"};
+  Statistic numTableEntries{this, "icall-table-entries", "Number of function pointer table entries"};
+};
+
+std::unique_ptr<Pass> createIndirectCallTablePass(bool obfuscateStdlib = true,
+                                                  bool obfuscateCustom = true);
+
+// Runs on each llvm.func on its own, in parallel under the pass manager.
+// Rewrites the calls indirect-call-table marked.
+struct IndirectCallPass
+    : public PassWrapper<IndirectCallPass, OperationPass<LLVM::LLVMFuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(IndirectCallPass)
+
+  IndirectCallPass() = default;
+  IndirectCallPass(bool guardedFastPath) { fastPath = guardedFastPath; }
+  IndirectCallPass(const IndirectCallPass &other) : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "indirect-call"; }
+  StringRef getDescription() const override {
+    return "Route the llvm.call sites indirect-call-table chose through its "
+           "function pointer table";
+  }
+
+  void getDependentDialects(DialectRegistry &registry) const override;
+  void runOnOperation() override;
+
+  // Keeps `fp == @f ? call @f : call fp`, the shape PGO indirect-call
+  // promotion produces, so the direct call can still be inlined.
+  Option<bool> fastPath{*this, "fast-path",
+                        llvm::cl::desc("Keep a guarded direct call next to each indirect call"),
+                        llvm::cl::init(false)};
+
+  Statistic numConverted{this, "icall-sites-converted", "Number of call sites routed through the table"};
+};
+
+std::unique_ptr<Pass> createIndirectCallPass(bool guardedFastPath = false);
+
+
+
+// Module part of fake-loops: picks the cold blocks under the module-wide
+// count and per-function cycle budget and creates the shared sink. Marks
+// each block for fake-loops, which must run right after it.
+struct FakeLoopPlanPass
+    : public PassWrapper<FakeLoopPlanPass, OperationPass<ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FakeLoopPlanPass)
+
+  FakeLoopPlanPass() = default;
+  FakeLoopPlanPass(unsigned loopCount, unsigned budget) {
+    count = loopCount;
+    cycleBudget = budget;
+  }
+  FakeLoopPlanPass(const FakeLoopPlanPass &other) : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "fake-loops-plan"; }
+  StringRef getDescription() const override {
+    return "Choose the cold LLVM-dialect blocks fake-loops inserts loops "
+           "into";
+  }
+
+  void runOnOperation() override;
+
+  Option<unsigned> count{*this, "count",
+                         llvm::cl::desc("Fake loops to insert per module"),
+                         llvm::cl::init(5)};
+  // Estimated cycles per call a function may spend on fake-loop guards,
+  // including the shared predicate at entry.
+  Option<unsigned> cycleBudget{
+      *this, "cycle-budget",
+      llvm::cl::desc("Per-function cycle budget for fake-loop guards"),
+      llvm::cl::init(8)};
+
+  Statistic numPlanned{this, "fake-loops-planned", "Number of blocks chosen for a fake loop"};
+  Statistic numSkippedHot{this, "fake-loops-skipped-hot", "Number of blocks rejected as too hot"};
+  Statistic numOverBudget{this, "fake-loops-over-budget", "Number of cold blocks rejected by the cycle budget"};
+};
+
+std::unique_ptr<Pass> createFakeLoopPlanPass(unsigned count = 5,
+                                             unsigned cycleBudget = 8);
+
+// Runs on each llvm.func on its own, in parallel under the pass manager.
+// Inserts a loop into every block fake-loops-plan marked.
+struct FakeLoopPass
+    : public PassWrapper<FakeLoopPass, OperationPass<LLVM::LLVMFuncOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FakeLoopPass)
+
+  FakeLoopPass() = default;
+  FakeLoopPass(const FakeLoopPass &other) : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "fake-loops"; }
+  StringRef getDescription() const override {
+    return "Insert never-entered loops behind opaque predicates into the "
+           "blocks fake-loops-plan chose";
+  }
+
+  void getDependentDialects(DialectRegistry &registry) const override;
+  void runOnOperation() override;
+
+  Statistic numInserted{this, "fake-loops-inserted", "Number of fake loops inserted"};
+};
+
+std::unique_ptr<Pass> createFakeLoopPass();
+
+
+
+struct AntiDebugPass
+    : public PassWrapper<AntiDebugPass, OperationPass<ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(AntiDebugPass)
+
+  AntiDebugPass() = default;
+  AntiDebugPass(ArrayRef<std::string> checks, unsigned budget,
+                unsigned procCache) {
+    techniques = checks;
+    budgetUs = budget;
+    procCacheMs = procCache;
+  }
+  AntiDebugPass(const AntiDebugPass &other) : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "anti-debug"; }
+  StringRef getDescription() const override {
+    return "Insert sampled calls to the obfs_antidebug runtime at function "
+           "entry";
+  }
+
+  void getDependentDialects(DialectRegistry &registry) const override;
+  void runOnOperation() override;
+
+  ListOption<std::string> techniques{
+      *this, "techniques",
+      llvm::cl::desc("Checks to run: ptrace, proc_status, parent_check, timing")};
+  // The runtime spaces samples so that checks cost at most this much time
+  // per second of wall time on each thread.
+  Option<unsigned> budgetUs{
+      *this, "budget-us",
+      llvm::cl::desc("Anti-debug overhead budget in microseconds per second"),
+      llvm::cl::init(1000)};
+  Option<unsigned> procCacheMs{
+      *this, "proc-cache-ms",
+      llvm::cl::desc("How long a /proc check result is reused (ms)"),
+      llvm::cl::init(100)};
+
+  Statistic numSites{this, "anti-debug-sites", "Number of functions given a sampled anti-debug check"};
+  Statistic numSkipped{this, "anti-debug-skipped", "Number of functions left without a check"};
+};
+
+std::unique_ptr<Pass> createAntiDebugPass(ArrayRef<std::string> techniques,
+                                          unsigned budgetUs = 1000,
+                                          unsigned procCacheMs = 100);
+
+
+
+struct ProfileTierPass
+    : public PassWrapper<ProfileTierPass, OperationPass<ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(ProfileTierPass)
+
+  ProfileTierPass() = default;
+  ProfileTierPass(unsigned hot, unsigned warm, StringRef hotLimit,
+                  StringRef warmLimit, StringRef tierSource) {
+    hotPercent = hot;
+    warmPercent = warm;
+    hotPolicy = hotLimit.str();
+    warmPolicy = warmLimit.str();
+    source = tierSource.str();
+  }
+  ProfileTierPass(const ProfileTierPass &other) : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "profile-tiers"; }
+  StringRef getDescription() const override {
+    return "Classify LLVM functions as hot/warm/cold from imported profile "
+           "counts (or the static hotness estimate) and limit the "
+           "transforms each tier receives";
+  }
+
+  void runOnOperation() override;
+
+  // Functions are ranked by their hottest block; the hottest ones covering
+  // hot-percent of all profiled block executions are hot, the next ones up
+  // to warm-percent are warm, the rest (including unprofiled) are cold.
+  Option<unsigned> hotPercent{
+      *this, "hot-percent",
+      llvm::cl::desc("Share of profiled execution counts covered by hot functions"),
+      llvm::cl::init(90)};
+  Option<unsigned> warmPercent{
+      *this, "warm-percent",
+      llvm::cl::desc("Share covered by hot and warm functions together"),
+      llvm::cl::init(99)};
+  Option<std::string> hotPolicy{
+      *this, "hot-policy",
+      llvm::cl::desc("Transforms allowed in hot functions: none, cheap, full"),
+      llvm::cl::init("none")};
+  Option<std::string> warmPolicy{
+      *this, "warm-policy",
+      llvm::cl::desc("Transforms allowed in warm functions: none, cheap, full"),
+      llvm::cl::init("cheap")};
+  // profile: imported counts only (no-op without them); static: always the
+  // HotnessAnalysis estimate; auto: counts when present, else the estimate.
+  Option<std::string> source{
+      *this, "source",
+      llvm::cl::desc("Where function weights come from: profile, static, auto"),
+      llvm::cl::init("profile")};
+
+  Statistic numHot{this, "tier-hot-functions", "Number of functions classified hot"};
+  Statistic numWarm{this, "tier-warm-functions", "Number of functions classified warm"};
+  Statistic numCold{this, "tier-cold-functions", "Number of functions classified cold"};
+};
+
+std::unique_ptr<Pass> createProfileTierPass(unsigned hotPercent = 90,
+                                            unsigned warmPercent = 99,
+                                            StringRef hotPolicy = "none",
+                                            StringRef warmPolicy = "cheap",
+                                            StringRef source = "profile");
+
+
+
+struct FunctionPolicyPass
+    : public PassWrapper<FunctionPolicyPass, OperationPass<ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(FunctionPolicyPass)
+
+  FunctionPolicyPass() = default;
+  FunctionPolicyPass(StringRef file) { policyFile = file.str(); }
+  FunctionPolicyPass(const FunctionPolicyPass &other) : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "function-policy"; }
+  StringRef getDescription() const override {
+    return "Attach per-function obfuscation policies (none, light, max) from "
+           "annotate(\"obf:...\") and a glob policy file";
+  }
+
+  void runOnOperation() override;
+
+  // One rule per line: `<glob> <none|light|max>`, '#' starts a comment.
+  // Globs match the symbol or its demangled name; the first matching rule
+  // wins, and a source annotation beats every rule.
+  Option<std::string> policyFile{
+      *this, "policy-file",
+      llvm::cl::desc("Path to a function-name glob to policy file"),
+      llvm::cl::init("")};
+
+  Statistic numNone{this, "policy-none-functions", "Number of functions with policy none"};
+  Statistic numLight{this, "policy-light-functions", "Number of functions with policy light"};
+  Statistic numMax{this, "policy-max-functions", "Number of functions with policy max"};
+};
+
+std::unique_ptr<Pass> createFunctionPolicyPass(StringRef policyFile = "");
+
+
+
+struct SizeBudgetPass
+    : public PassWrapper<SizeBudgetPass, OperationPass<ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(SizeBudgetPass)
+
+  SizeBudgetPass() = default;
+  SizeBudgetPass(StringRef file) { planFile = file.str(); }
+  SizeBudgetPass(const SizeBudgetPass &other) : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "size-budget"; }
+  StringRef getDescription() const override {
+    return "Cap per-function transforms with a code-size growth plan";
+  }
+
+  void runOnOperation() override;
+
+  // JSON plan from the CLI's size budget planner (core/size_budget.py):
+  // {"functions": {"<name>": {"limit": "none|cheap|full",
+  //                           "ollvm": ["<pass>", ...]}, ...}}.
+  // Functions missing from the plan were not budgeted and get "none".
+  Option<std::string> planFile{
+      *this, "plan-file",
+      llvm::cl::desc("Path to the size plan (JSON)"),
+      llvm::cl::init("")};
+
+  Statistic numNone{this, "budget-none-functions", "Number of functions the size plan leaves untransformed"};
+  Statistic numCheap{this, "budget-cheap-functions", "Number of functions the size plan limits to cheap transforms"};
+  Statistic numFull{this, "budget-full-functions", "Number of functions the size plan allows every transform"};
+};
+
+std::unique_ptr<Pass> createSizeBudgetPass(StringRef planFile = "");
+
+
+
+struct LowerObsPass
+    : public PassWrapper<LowerObsPass, OperationPass<ModuleOp>> {
+  MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(LowerObsPass)
+
+  LowerObsPass() = default;
+  LowerObsPass(const LowerObsPass &other) : PassWrapper(other) {}
+
+  StringRef getArgument() const override { return "obs-lower"; }
+  StringRef getDescription() const override {
+    return "Hoist, deduplicate and expand obs dialect ops into LLVM dialect";
+  }
+
+  void getDependentDialects(DialectRegistry &registry) const override;
+  void runOnOperation() override;
+
+  Statistic numLowered{this, "obs-ops-lowered", "Number of obs ops expanded after hoisting and deduplication"};
+  Statistic numPredicates{this, "opaque-predicates-lowered", "Number of obs.opaque_pred ops expanded"};
+  Statistic numConstants{this, "constants-encoded", "Number of obs.encoded_const ops expanded"};
+};
+
+std::unique_ptr<Pass> createLowerObsPass();
+
+/// Registers every obfuscation pass with the global pass registry; shared by
+/// the mlir-opt plugin entry point and the mlir-obfuscate driver.
+void registerObfuscationPasses();
+
 } // namespace obs
 } // namespace mlir
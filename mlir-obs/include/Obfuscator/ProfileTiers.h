@@ -0,0 +1,65 @@
+#pragma once
+
+#include "mlir/IR/Operation.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+
+namespace mlir {
+namespace obs {
+
+// Discardable attributes set on llvm.func by the profile-tiers pass.
+// kTierAttrName is "hot", "warm" or "cold"; kTransformLimitAttrName is the
+// most expensive TransformCost the tier allows: "none", "cheap" or "full".
+inline constexpr llvm::StringLiteral kTierAttrName = "obs.tier";
+inline constexpr llvm::StringLiteral kTransformLimitAttrName =
+    "obs.transform_limit";
+// Explicit per-function policy set by function-policy from
+// annotate("obf:<policy>") or a policy file: "none" (no transforms),
+// "light" (cheap ones only) or "max" (everything, whatever the tier).
+// Takes precedence over kTransformLimitAttrName and static hotness.
+inline constexpr llvm::StringLiteral kPolicyAttrName = "obs.policy";
+// Set by size-budget from the CLI's code-size plan: the most expensive
+// TransformCost that fits the function's share of the growth budget
+// ("none", "cheap" or "full"). A hard cap, applied on top of the policy.
+inline constexpr llvm::StringLiteral kBudgetLimitAttrName = "obs.budget_limit";
+// Set on the module by profile-tiers: "profile" when the tiers come from
+// imported counts, "static" when they come from HotnessAnalysis.
+inline constexpr llvm::StringLiteral kTierSourceAttrName = "obs.tier_source";
+
+enum class Tier { Cold, Warm, Hot };
+
+StringRef stringifyTier(Tier tier);
+
+// Ranks `weights` in descending order and assigns each entry the tier its
+// own weight starts in: hot below hotPercent of the running total, warm
+// below warmPercent, cold after that. Zero weights are always cold. Result
+// is in input order. Shared by profile-tiers and HotnessAnalysis so profiled
+// and estimated tiers follow the same rule.
+SmallVector<Tier> classifyByShare(ArrayRef<double> weights, double hotPercent,
+                                  double warmPercent);
+
+// What a transform adds to each execution of the code it rewrites.
+enum class TransformCost {
+  // Nothing at run time (renamed symbols, hashed names).
+  Free,
+  // A few instructions at entry, in never-taken blocks or behind a cache
+  // (anti-debug countdown, fake-loop guards, resolved imports).
+  Cheap,
+  // Work on every access, call or branch (address masks, encoded call
+  // table, opaque predicates, merged-function selectors).
+  Full,
+};
+
+// Whether the function containing `op` (or `op` itself, if it is a
+// function) may be rewritten by a transform of `cost`. An obs.policy wins;
+// otherwise the tier limit applies, which never rules out Free transforms.
+// Functions with neither, i.e. every function when no profile or policy
+// was supplied, allow everything. obs.budget_limit caps the result.
+bool isTransformAllowed(Operation *op, TransformCost cost);
+
+// The function's obs.policy, or an empty StringRef.
+StringRef getFunctionPolicy(Operation *op);
+
+} // namespace obs
+} // namespace mlir
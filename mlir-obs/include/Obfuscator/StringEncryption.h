@@ -0,0 +1,61 @@
+#pragma once
+
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/IR/BuiltinOps.h"
+
+#include "llvm/ADT/StringSet.h"
+
+#include <string>
+#include <vector>
+
+namespace mlir {
+namespace obs {
+
+// XOR-encrypts string globals in place and emits what decrypts them at
+// startup: the __obfs_key global, __obfs_decrypt and the __obfs_init
+// constructor. Shared by string-encrypt, constant-obfuscate and
+// fused-obfuscate, so running more than one of them extends the helpers a
+// previous run created instead of duplicating or skipping them: strings
+// already decrypted by __obfs_init are left alone, an existing __obfs_key
+// is reused, and __obfs_init is registered as a constructor once.
+class StringEncryptor {
+public:
+  StringEncryptor(ModuleOp module, StringRef key);
+
+  // Whether `global` is a string constant this encryptor would rewrite.
+  bool isCandidate(LLVM::GlobalOp global) const;
+
+  // Encrypts `global` if it is a candidate; returns whether it did.
+  bool encrypt(LLVM::GlobalOp global);
+
+  // Creates or extends the helpers for every string encrypted so far.
+  // Does nothing if nothing was encrypted.
+  void finalize();
+
+  size_t getNumEncrypted() const { return numEncrypted; }
+  size_t getNumBytesEncrypted() const { return bytesEncrypted; }
+  // Null until finalize() created them or found them in the module
+  LLVM::LLVMFuncOp getDecryptFunc() const { return decryptFunc; }
+  LLVM::LLVMFuncOp getInitFunc() const { return initFunc; }
+
+private:
+  struct EncryptedGlobal {
+    std::string name;
+    size_t length;
+  };
+
+  ModuleOp module;
+  // The key of an existing __obfs_key, else the one passed in
+  std::string key;
+  LLVM::GlobalOp keyGlobal;
+  LLVM::LLVMFuncOp decryptFunc;
+  LLVM::LLVMFuncOp initFunc;
+  llvm::StringSet<> alreadyDecrypted;
+  // Encrypted since the last finalize()
+  std::vector<EncryptedGlobal> encrypted;
+  size_t numEncrypted = 0;
+  size_t bytesEncrypted = 0;
+};
+
+} // namespace obs
+} // namespace mlir
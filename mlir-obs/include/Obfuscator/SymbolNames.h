@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Obfuscator/Passes.h"
+
+#include "mlir/IR/Operation.h"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringRef.h"
+
+#include <random>
+#include <string>
+
+namespace mlir {
+namespace obs {
+
+// Next random name for symbol-obfuscate: `<prefix>_%08x` ("f" for
+// functions, "g" for globals). One draw from `rng` per name, so the same
+// key renames the same symbols in the same order identically.
+std::string generateObfuscatedName(std::mt19937 &rng, llvm::StringRef prefix);
+
+// crypto-hash name of `name`: "f_" and the first `hashLength` hex digits
+// of the salted digest.
+std::string generateHashedName(llvm::StringRef name,
+                               CryptoHashPass::HashAlgorithm algorithm,
+                               llvm::StringRef salt, unsigned hashLength);
+
+// Rewrites every reference to a symbol in `renames` (old name to new name)
+// held in the attributes of `users`, including nested ones such as the
+// entries of llvm.mlir.global_ctors. The symbols themselves keep their
+// names; callers rename them afterwards.
+void replaceSymbolUses(llvm::ArrayRef<Operation *> users,
+                       const llvm::StringMap<std::string> &renames);
+
+// The same for every op nested in `root`.
+void replaceSymbolUses(Operation *root,
+                       const llvm::StringMap<std::string> &renames);
+
+} // namespace obs
+} // namespace mlir
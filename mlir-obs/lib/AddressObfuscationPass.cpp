@@ -0,0 +1,225 @@
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/Hotness.h"
+#include "Obfuscator/ObsDialect.h"
+#include "Obfuscator/ProfileTiers.h"
+
+#include "mlir/Analysis/CFGLoopInfo.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+static uint64_t deriveAddressKey(StringRef seed) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (char c : seed) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001B3ULL;
+  }
+  return hash | 1;
+}
+
+// Materializes the key pair once at the top of the entry block and hands
+// out (truncated) copies per index type. Every access in the function
+// reuses the same loop-invariant values.
+//
+// Masking is additive: idx' = (idx + key) + nkey with key + nkey == 0. An
+// xor mask turns an affine index into something SCEV cannot model and
+// kills vectorization and LSR; the additive form stays an add-recurrence
+// with an unknown invariant start, so stride analysis still works. The two
+// halves are separate obs.encoded_const ops; obs-lower puts each behind its
+// own opaque barrier so instcombine cannot prove they cancel.
+class KeyMaterializer {
+public:
+  KeyMaterializer(LLVM::LLVMFuncOp func, uint64_t keyValue)
+      : builder(func.getContext()), loc(func.getLoc()), keyValue(keyValue) {
+    builder.setInsertionPointToStart(&func.getBody().front());
+  }
+
+  std::pair<Value, Value> get(IntegerType type) {
+    auto it = keysByType.find(type);
+    if (it != keysByType.end())
+      return it->second;
+
+    if (!key) {
+      key = encode(keyValue);
+      negKey = encode(0 - keyValue);
+    }
+
+    std::pair<Value, Value> keys = {key, negKey};
+    if (type.getWidth() < 64) {
+      keys.first = builder.create<LLVM::TruncOp>(loc, type, key);
+      keys.second = builder.create<LLVM::TruncOp>(loc, type, negKey);
+    }
+    keysByType[type] = keys;
+    return keys;
+  }
+
+private:
+  Value encode(uint64_t value) {
+    uint64_t salt = (value * 0x9E3779B97F4A7C15ULL) | 1;
+    return builder.create<EncodedConstOp>(
+        loc, builder.getI64Type(),
+        builder.getI64IntegerAttr(static_cast<int64_t>(value ^ salt)),
+        builder.getI64IntegerAttr(static_cast<int64_t>(salt)));
+  }
+
+  OpBuilder builder;
+  Location loc;
+  uint64_t keyValue;
+  Value key;
+  Value negKey;
+  DenseMap<Type, std::pair<Value, Value>> keysByType;
+};
+
+// Innermost loops with a small body and no calls are what the loop
+// vectorizer takes. Masking there costs two adds per access on the hottest
+// path and makes the cost model less eager, so they are left alone unless
+// forced.
+static bool isVectorizableInnerLoop(CFGLoop *loop) {
+  if (!loop->isInnermost() || loop->getNumBlocks() > 4)
+    return false;
+  for (Block *block : loop->getBlocks()) {
+    for (Operation &op : *block) {
+      if (isa<LLVM::CallOp, LLVM::InvokeOp, LLVM::InlineAsmOp>(op))
+        return false;
+    }
+  }
+  return true;
+}
+
+static void collectSkippedBlocks(const BlockFrequencyEstimate &freq,
+                                 llvm::SmallPtrSetImpl<Block *> &skipped) {
+  const CFGLoopInfo *loopInfo = freq.getLoopInfo();
+  if (!loopInfo)
+    return;
+
+  for (CFGLoop *loop : loopInfo->getLoopsInPreorder()) {
+    if (isVectorizableInnerLoop(loop))
+      skipped.insert(loop->getBlocks().begin(), loop->getBlocks().end());
+  }
+}
+
+// Loads and stores straight from a stack slot or a global keep their plain
+// address so SROA, mem2reg and GVN still see it. GEP results are covered by
+// masking their indices; that includes dynamic indices into global arrays,
+// which is where table lookups are, and leaves out GEPs into stack slots.
+static bool shouldMaskPointer(Value ptr) {
+  Operation *def = ptr.getDefiningOp();
+  return !isa_and_nonnull<LLVM::AllocaOp, LLVM::GEPOp, LLVM::AddressOfOp>(def);
+}
+
+static Value maskIndex(OpBuilder &builder, Location loc, Value index,
+                       std::pair<Value, Value> keys) {
+  Value shifted = builder.create<LLVM::AddOp>(loc, index, keys.first);
+  return builder.create<LLVM::AddOp>(loc, shifted, keys.second);
+}
+
+static Value maskPointer(OpBuilder &builder, Location loc, Value ptr,
+                         std::pair<Value, Value> keys) {
+  auto i8Type = IntegerType::get(builder.getContext(), 8);
+  Value shifted = builder.create<LLVM::GEPOp>(loc, ptr.getType(), i8Type, ptr,
+                                              ValueRange{keys.first});
+  return builder.create<LLVM::GEPOp>(loc, ptr.getType(), i8Type, shifted,
+                                     ValueRange{keys.second});
+}
+
+static std::optional<unsigned> getAddressOperandIndex(Operation *op) {
+  if (auto load = dyn_cast<LLVM::LoadOp>(op))
+    return load.getAddrMutable().getOperandNumber();
+  if (auto store = dyn_cast<LLVM::StoreOp>(op))
+    return store.getAddrMutable().getOperandNumber();
+  return std::nullopt;
+}
+
+} // namespace
+
+void AddressObfuscationPass::getDependentDialects(
+    DialectRegistry &registry) const {
+  registry.insert<ObsDialect, LLVM::LLVMDialect>();
+}
+
+void AddressObfuscationPass::runOnOperation() {
+  LLVM::LLVMFuncOp func = getOperation();
+  if (func.isExternal() || func.getName().starts_with("__obfs_") ||
+      !isTransformAllowed(func, TransformCost::Full))
+    return;
+
+  // Module-wide, so only readable when obs-hotness ran before this pass;
+  // without it only the function's own tier and policy apply.
+  const HotnessAnalysis *hotness = nullptr;
+  if (auto cached = getCachedParentAnalysis<HotnessAnalysis>())
+    hotness = &cached->get();
+
+  MLIRContext *ctx = &getContext();
+  OpBuilder builder(ctx);
+  auto i64Type = IntegerType::get(ctx, 64);
+  uint64_t keyValue = deriveAddressKey(key);
+
+  llvm::SmallPtrSet<Block *, 16> skippedBlocks;
+  if (!forceLoops)
+    collectSkippedBlocks(getAnalysis<BlockFrequencyEstimate>(), skippedBlocks);
+
+  SmallVector<Operation *> accesses;
+  func.walk([&](Operation *op) {
+    if (isa<LLVM::GEPOp, LLVM::LoadOp, LLVM::StoreOp>(op))
+      accesses.push_back(op);
+  });
+
+  KeyMaterializer keys(func, keyValue);
+  for (Operation *op : accesses) {
+    if (skippedBlocks.contains(op->getBlock())) {
+      ++numSkippedInLoops;
+      continue;
+    }
+    if (!forceLoops && hotness && !hotness->allows(op, TransformCost::Full)) {
+      ++numSkippedHot;
+      continue;
+    }
+    builder.setInsertionPoint(op);
+
+    if (auto gep = dyn_cast<LLVM::GEPOp>(op)) {
+      if (isa_and_nonnull<LLVM::AllocaOp>(gep.getBase().getDefiningOp()))
+        continue;
+      OperandRange indices = gep.getDynamicIndices();
+      unsigned first = indices.getBeginOperandIndex();
+      for (unsigned i = 0, e = indices.size(); i < e; ++i) {
+        OpOperand &operand = gep->getOpOperand(first + i);
+        auto indexType = dyn_cast<IntegerType>(operand.get().getType());
+        if (!indexType || indexType.getWidth() > 64)
+          continue;
+        operand.set(maskIndex(builder, gep.getLoc(), operand.get(),
+                              keys.get(indexType)));
+        ++numMasked;
+      }
+      continue;
+    }
+
+    std::optional<unsigned> addrIndex = getAddressOperandIndex(op);
+    OpOperand &addr = op->getOpOperand(*addrIndex);
+    if (!shouldMaskPointer(addr.get()))
+      continue;
+    addr.set(maskPointer(builder, op->getLoc(), addr.get(),
+                         keys.get(i64Type)));
+    ++numMasked;
+  }
+}
+
+std::unique_ptr<Pass> mlir::obs::createAddressObfuscationPass(
+    llvm::StringRef key, bool forceLoops) {
+  return std::make_unique<AddressObfuscationPass>(key, forceLoops);
+}
@@ -0,0 +1,190 @@
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/Hotness.h"
+#include "Obfuscator/ProfileTiers.h"
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Matchers.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+#include "llvm/ADT/StringSwitch.h"
+
+#include <cstdint>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+// Must match OBFS_AD_* in runtime/obfs_antidebug.c.
+enum Technique : uint32_t {
+  kPtrace = 1u << 0,
+  kProcStatus = 1u << 1,
+  kParentCheck = 1u << 2,
+  kTiming = 1u << 3,
+};
+
+constexpr llvm::StringLiteral kCountdownName = "__obfs_ad_countdown";
+constexpr llvm::StringLiteral kSlowPathName = "__obfs_ad_slow";
+// Countdown hits zero once per sampling interval; the interval is at least
+// 16 calls (see obfs_antidebug.c), so 1:4096 is conservative.
+constexpr uint32_t kTakenWeight = 1;
+constexpr uint32_t kNotTakenWeight = 4096;
+
+static std::optional<uint32_t> parseTechniques(ArrayRef<std::string> names,
+                                               ModuleOp module) {
+  uint32_t mask = 0;
+  for (const std::string &name : names) {
+    uint32_t bit = llvm::StringSwitch<uint32_t>(name)
+                       .Case("ptrace", kPtrace)
+                       .Case("proc_status", kProcStatus)
+                       .Case("parent_check", kParentCheck)
+                       .Case("timing", kTiming)
+                       .Default(0);
+    if (!bit) {
+      module.emitError() << "anti-debug: unknown technique '" << name << "'";
+      return std::nullopt;
+    }
+    mask |= bit;
+  }
+  return mask;
+}
+
+// Zero-initialized so it lives in .tbss and every new thread checks on its
+// first instrumented call.
+static void getOrCreateCountdown(ModuleOp module, OpBuilder &builder) {
+  if (module.lookupSymbol<LLVM::GlobalOp>(kCountdownName))
+    return;
+  OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointToStart(module.getBody());
+  builder.create<LLVM::GlobalOp>(
+      module.getLoc(), builder.getI32Type(), /*isConstant=*/false,
+      LLVM::Linkage::Internal, kCountdownName, builder.getI32IntegerAttr(0),
+      /*alignment=*/4, /*addrSpace=*/0, /*dsoLocal=*/true,
+      /*threadLocal=*/true);
+}
+
+// int32_t __obfs_ad_slow(uint32_t techniques, uint32_t budget_us,
+//                        uint32_t proc_cache_ms)
+static LLVM::LLVMFuncOp getOrCreateSlowPath(ModuleOp module,
+                                            OpBuilder &builder) {
+  if (auto slowPath = module.lookupSymbol<LLVM::LLVMFuncOp>(kSlowPathName))
+    return slowPath;
+  OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointToStart(module.getBody());
+  auto i32Type = builder.getI32Type();
+  auto fnType = LLVM::LLVMFunctionType::get(i32Type,
+                                            {i32Type, i32Type, i32Type});
+  return builder.create<LLVM::LLVMFuncOp>(module.getLoc(), kSlowPathName,
+                                          fnType);
+}
+
+// Static allocas must stay in the entry block for SROA/mem2reg, so the
+// check goes right after them (and the constants that size them).
+static Operation *findSplitPoint(Block &entry) {
+  for (Operation &op : entry) {
+    if (isa<LLVM::ConstantOp>(op))
+      continue;
+    auto alloca = dyn_cast<LLVM::AllocaOp>(op);
+    if (!alloca || !matchPattern(alloca.getArraySize(), m_Constant()))
+      return &op;
+  }
+  return entry.getTerminator();
+}
+
+// entry:  <allocas>
+//         %tls = llvm.intr.threadlocal.address @__obfs_ad_countdown
+//         %n = llvm.load %tls - 1;  llvm.store %n, %tls
+//         llvm.cond_br (%n <= 0) weights(1, 4096), ^check, ^body
+// ^check: %next = llvm.call @__obfs_ad_slow(mask, budget, cache)
+//         llvm.store %next, %tls;  llvm.br ^body
+// ^body:  <original entry ops>
+static void insertCheck(OpBuilder &builder, LLVM::LLVMFuncOp func,
+                        LLVM::LLVMFuncOp slowPath, uint32_t mask,
+                        unsigned budgetUs, unsigned procCacheMs) {
+  Block &entry = func.getBody().front();
+  Operation *splitAt = findSplitPoint(entry);
+  Location loc = splitAt->getLoc();
+  MLIRContext *ctx = builder.getContext();
+  auto i32Type = IntegerType::get(ctx, 32);
+  auto ptrType = LLVM::LLVMPointerType::get(ctx);
+
+  Block *body = entry.splitBlock(splitAt);
+  Block *check = builder.createBlock(body);
+
+  auto constant = [&](uint32_t value) -> Value {
+    return builder.create<LLVM::ConstantOp>(
+        loc, i32Type, builder.getI32IntegerAttr(static_cast<int32_t>(value)));
+  };
+
+  builder.setInsertionPointToEnd(&entry);
+  Value global = builder.create<LLVM::AddressOfOp>(loc, ptrType, kCountdownName);
+  Value tls = builder.create<LLVM::ThreadlocalAddressOp>(loc, ptrType, global);
+  Value count = builder.create<LLVM::LoadOp>(loc, i32Type, tls, /*alignment=*/4);
+  Value next = builder.create<LLVM::SubOp>(loc, count, constant(1));
+  builder.create<LLVM::StoreOp>(loc, next, tls, /*alignment=*/4);
+  Value due = builder.create<LLVM::ICmpOp>(loc, LLVM::ICmpPredicate::sle, next,
+                                           constant(0));
+  builder.create<LLVM::CondBrOp>(
+      loc, due, check, ValueRange{}, body, ValueRange{},
+      std::make_pair(kTakenWeight, kNotTakenWeight));
+
+  builder.setInsertionPointToStart(check);
+  auto call = builder.create<LLVM::CallOp>(
+      loc, slowPath,
+      ValueRange{constant(mask), constant(budgetUs), constant(procCacheMs)});
+  builder.create<LLVM::StoreOp>(loc, call.getResult(), tls, /*alignment=*/4);
+  builder.create<LLVM::BrOp>(loc, ValueRange{}, body);
+}
+
+} // namespace
+
+void AntiDebugPass::getDependentDialects(DialectRegistry &registry) const {
+  registry.insert<LLVM::LLVMDialect>();
+}
+
+void AntiDebugPass::runOnOperation() {
+  ModuleOp module = getOperation();
+  OpBuilder builder(&getContext());
+
+  SmallVector<std::string> names(techniques.begin(), techniques.end());
+  std::optional<uint32_t> mask = parseTechniques(names, module);
+  if (!mask) {
+    signalPassFailure();
+    return;
+  }
+  if (*mask == 0 || module.lookupSymbol(kCountdownName))
+    return;
+
+  SmallVector<LLVM::LLVMFuncOp> targets;
+  for (auto func : module.getOps<LLVM::LLVMFuncOp>()) {
+    if (func.isExternal() || func.getName().starts_with("__obfs_"))
+      continue;
+    // Naked functions have no prologue to put a check in.
+    if (hasPassthrough(func, "naked") ||
+        !isTransformAllowed(func, TransformCost::Cheap)) {
+      ++numSkipped;
+      continue;
+    }
+    targets.push_back(func);
+  }
+  if (targets.empty())
+    return;
+
+  getOrCreateCountdown(module, builder);
+  LLVM::LLVMFuncOp slowPath = getOrCreateSlowPath(module, builder);
+  for (LLVM::LLVMFuncOp func : targets) {
+    insertCheck(builder, func, slowPath, *mask, budgetUs, procCacheMs);
+    ++numSites;
+  }
+}
+
+std::unique_ptr<Pass>
+mlir::obs::createAntiDebugPass(ArrayRef<std::string> techniques,
+                               unsigned budgetUs, unsigned procCacheMs) {
+  return std::make_unique<AntiDebugPass>(techniques, budgetUs, procCacheMs);
+}
@@ -1,16 +1,21 @@
-
-
-#include "mlir/Conversion/LLVMCommon/TypeConverter.h"
+#include "CIR/Passes.h"
+#include "mlir/AsmParser/AsmParser.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
+#include "mlir/Dialect/Arith/Utils/Utils.h"
 #include "mlir/Dialect/ControlFlow/IR/ControlFlow.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/MemRef/IR/MemRef.h"
+#include "mlir/Dialect/Utils/StaticValueUtils.h"
 #include "mlir/IR/BuiltinDialect.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Threading.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/DialectConversion.h"
+#include "mlir/Transforms/GreedyPatternRewriteDriver.h"
 #include <memory>
+#include <optional>
 
 
 
@@ -18,28 +23,25 @@ namespace mlir {
 namespace cir {
 
 
+/// Maps `!cir.ptr<T>` to `memref<?xT>` and leaves every other type alone.
+/// Without ClangIR loaded the pointer type is an opaque `cir` type, so its
+/// element type is parsed back out of the type data.
 class CIRToFuncTypeConverter : public TypeConverter {
 public:
   CIRToFuncTypeConverter() {
-    
     addConversion([](Type type) { return type; });
 
-    
-    addConversion([](Type type) -> std::optional<Type> {
-      
-
-      
-      if (auto cirPtrType = type.dyn_cast<Type>()) {
-        
-        
-        if (auto intType = type.dyn_cast<IntegerType>()) {
-          return MemRefType::get({ShapedType::kDynamic}, intType);
-        }
-      }
-      return std::nullopt;
+    addConversion([](OpaqueType type) -> std::optional<Type> {
+      StringRef data = type.getTypeData();
+      if (type.getDialectNamespace().getValue() != "cir" ||
+          !data.consume_front("ptr<") || !data.consume_back(">"))
+        return std::nullopt;
+      Type element = parseType(data, type.getContext());
+      if (!element || !MemRefType::isValidElementType(element))
+        return std::nullopt;
+      return MemRefType::get({ShapedType::kDynamic}, element);
     });
 
-    
     addConversion([this](FunctionType type) -> std::optional<Type> {
       SmallVector<Type> inputs;
       SmallVector<Type> results;
@@ -52,249 +54,217 @@ public:
       return FunctionType::get(type.getContext(), inputs, results);
     });
 
-    
-    addTargetMaterialization([](OpBuilder& builder, Type resultType,
-                                ValueRange inputs, Location loc) -> Value {
-      if (inputs.size() == 1)
-        return inputs[0];
-      return nullptr;
-    });
-
-    addSourceMaterialization([](OpBuilder& builder, Type resultType,
-                                ValueRange inputs, Location loc) -> Value {
-      if (inputs.size() == 1)
-        return inputs[0];
-      return nullptr;
-    });
+    // Body ops still expect the CIR types after the signature step; they
+    // see the converted values through a cast the body patterns look past.
+    auto castMaterialization = [](OpBuilder& builder, Type resultType,
+                                  ValueRange inputs, Location loc) -> Value {
+      return builder
+          .create<UnrealizedConversionCastOp>(loc, resultType, inputs)
+          .getResult(0);
+    };
+    addTargetMaterialization(castMaterialization);
+    addSourceMaterialization(castMaterialization);
   }
 };
 
-class CIRLoadOpConversion : public OpConversionPattern<Operation> {
-public:
-  using OpConversionPattern::OpConversionPattern;
+/// The converted value behind a signature-step cast, or `value` itself.
+static Value stripCast(Value value) {
+  auto cast = value.getDefiningOp<UnrealizedConversionCastOp>();
+  if (cast && cast->getNumOperands() == 1 && cast->getNumResults() == 1)
+    return cast->getOperand(0);
+  return value;
+}
 
-  LogicalResult matchAndRewrite(Operation* op, ArrayRef<Value> operands,
-                                ConversionPatternRewriter& rewriter) const override {
-    
-    if (op->getName().getStringRef() != "cir.load")
-      return failure();
+/// The memref an op's pointer operand was converted to, or null.
+static Value getMemRef(Operation* op, unsigned index) {
+  Value value = stripCast(op->getOperand(index));
+  return isa<MemRefType>(value.getType()) ? value : Value();
+}
 
-    Location loc = op->getLoc();
+/// memref ops take `index`; CIR indices may be any integer type.
+static Value toIndex(PatternRewriter& rewriter, Location loc, Value value) {
+  if (value.getType().isIndex())
+    return value;
+  return rewriter.create<arith::IndexCastOp>(loc, rewriter.getIndexType(),
+                                             value);
+}
 
-    
-    if (operands.size() < 2)
-      return failure();
+/// Shared by the subview-producing patterns: a 1-D view of `base` from
+/// `offset` to its end. The size is dynamic, `dim(base, 0) - offset`.
+static Value createOffsetView(PatternRewriter& rewriter, Location loc,
+                              Value base, OpFoldResult offset) {
+  Value dim = rewriter.create<memref::DimOp>(loc, base, 0);
+  Value size = rewriter.create<arith::SubIOp>(
+      loc, dim, getValueOrCreateConstantIndexOp(rewriter, loc, offset));
+  SmallVector<OpFoldResult> offsets = {offset};
+  SmallVector<OpFoldResult> sizes = {size};
+  SmallVector<OpFoldResult> strides = {rewriter.getIndexAttr(1)};
+  return rewriter.create<memref::SubViewOp>(loc, base, offsets, sizes, strides);
+}
 
-    Value basePtr = operands[0]; 
-    Value index = operands[1];    
+// Body patterns are rooted on their CIR operation name, so the greedy driver
+// only offers each op to the patterns that can match it. They run after the
+// signature conversion, when block arguments already carry converted types.
 
-    
-    Value loadResult = rewriter.create<memref::LoadOp>(loc, basePtr, ValueRange{index});
+/// Pattern to convert cir.load → memref.load
+class CIRLoadOpLowering : public RewritePattern {
+public:
+  CIRLoadOpLowering(MLIRContext* context)
+      : RewritePattern("cir.load", /*benefit=*/1, context) {}
 
-   
-    rewriter.replaceOp(op, loadResult);
+  LogicalResult matchAndRewrite(Operation* op,
+                                PatternRewriter& rewriter) const override {
+    Value base = op->getNumOperands() >= 2 ? getMemRef(op, 0) : Value();
+    if (!base)
+      return failure();
 
+    Value index = toIndex(rewriter, op->getLoc(), op->getOperand(1));
+    rewriter.replaceOpWithNewOp<memref::LoadOp>(op, base, ValueRange{index});
     return success();
   }
 };
 
-
-class CIRStoreOpConversion : public OpConversionPattern<Operation> {
+/// Pattern to convert cir.store → memref.store
+class CIRStoreOpLowering : public RewritePattern {
 public:
-  using OpConversionPattern::OpConversionPattern;
-
-  LogicalResult matchAndRewrite(Operation* op, ArrayRef<Value> operands,
-                                ConversionPatternRewriter& rewriter) const override {
-    
-    if (op->getName().getStringRef() != "cir.store")
-      return failure();
-
-    Location loc = op->getLoc();
+  CIRStoreOpLowering(MLIRContext* context)
+      : RewritePattern("cir.store", /*benefit=*/1, context) {}
 
-    
-    if (operands.size() < 3)
+  LogicalResult matchAndRewrite(Operation* op,
+                                PatternRewriter& rewriter) const override {
+    Value base = op->getNumOperands() >= 3 ? getMemRef(op, 1) : Value();
+    if (!base)
       return failure();
 
-    Value valueToStore = operands[0];
-    Value basePtr = operands[1];     
-    Value index = operands[2];       
-
-    
-    rewriter.create<memref::StoreOp>(loc, valueToStore, basePtr, ValueRange{index});
-
-    
-    rewriter.eraseOp(op);
-
+    Value index = toIndex(rewriter, op->getLoc(), op->getOperand(2));
+    rewriter.replaceOpWithNewOp<memref::StoreOp>(op, op->getOperand(0), base,
+                                                 ValueRange{index});
     return success();
   }
 };
 
-
-class CIRPtrAddOpConversion : public OpConversionPattern<Operation> {
+/// Pattern to convert cir.ptr_add → memref.subview
+class CIRPtrAddOpLowering : public RewritePattern {
 public:
-  using OpConversionPattern::OpConversionPattern;
+  CIRPtrAddOpLowering(MLIRContext* context)
+      : RewritePattern("cir.ptr_add", /*benefit=*/1, context) {}
 
-  LogicalResult matchAndRewrite(Operation* op, ArrayRef<Value> operands,
-                                ConversionPatternRewriter& rewriter) const override {
-    if (op->getName().getStringRef() != "cir.ptr_add")
+  LogicalResult matchAndRewrite(Operation* op,
+                                PatternRewriter& rewriter) const override {
+    Value base = op->getNumOperands() >= 2 ? getMemRef(op, 0) : Value();
+    if (!base)
       return failure();
 
     Location loc = op->getLoc();
-
-    if (operands.size() < 2)
-      return failure();
-
-    Value basePtr = operands[0];
-    Value offset = operands[1];
-
-    
-    auto memrefType = basePtr.getType().dyn_cast<MemRefType>();
-    if (!memrefType)
-      return failure();
-
-    
-    SmallVector<OpFoldResult> offsets = {offset};
-    SmallVector<OpFoldResult> sizes = {rewriter.getIndexAttr(ShapedType::kDynamic)};
-    SmallVector<OpFoldResult> strides = {rewriter.getIndexAttr(1)};
-
-    Value subview = rewriter.create<memref::SubViewOp>(
-        loc, basePtr, offsets, sizes, strides);
-
-    rewriter.replaceOp(op, subview);
-
+    Value offset = toIndex(rewriter, loc, op->getOperand(1));
+    rewriter.replaceOp(op, createOffsetView(rewriter, loc, base, offset));
     return success();
   }
 };
 
-
-class CIRGetElementPtrOpConversion : public OpConversionPattern<Operation> {
+/// Pattern to convert single-index cir.gep → memref.subview. Takes
+/// precedence over the general form, which would otherwise match too, and
+/// keeps a constant index as a static subview offset.
+class CIRGetElementPtrSingleIndexLowering : public RewritePattern {
 public:
-  using OpConversionPattern::OpConversionPattern;
+  CIRGetElementPtrSingleIndexLowering(MLIRContext* context)
+      : RewritePattern("cir.gep", /*benefit=*/2, context) {}
 
-  LogicalResult matchAndRewrite(Operation* op, ArrayRef<Value> operands,
-                                ConversionPatternRewriter& rewriter) const override {
-    if (op->getName().getStringRef() != "cir.gep")
+  LogicalResult matchAndRewrite(Operation* op,
+                                PatternRewriter& rewriter) const override {
+    Value base = op->getNumOperands() == 2 ? getMemRef(op, 0) : Value();
+    if (!base)
       return failure();
 
     Location loc = op->getLoc();
+    OpFoldResult offset;
+    if (std::optional<int64_t> constant =
+            getConstantIntValue(op->getOperand(1)))
+      offset = rewriter.getIndexAttr(*constant);
+    else
+      offset = toIndex(rewriter, loc, op->getOperand(1));
+    rewriter.replaceOp(op, createOffsetView(rewriter, loc, base, offset));
+    return success();
+  }
+};
 
-    if (operands.empty())
-      return failure();
-
-   
-    Value base = operands[0];
-
-    
-    SmallVector<Value> indices(operands.begin() + 1, operands.end());
-
-   
+/// Pattern to convert multi-index cir.gep → summed offset + memref.subview
+class CIRGetElementPtrOpLowering : public RewritePattern {
+public:
+  CIRGetElementPtrOpLowering(MLIRContext* context)
+      : RewritePattern("cir.gep", /*benefit=*/1, context) {}
 
-    auto memrefType = base.getType().dyn_cast<MemRefType>();
-    if (!memrefType)
+  LogicalResult matchAndRewrite(Operation* op,
+                                PatternRewriter& rewriter) const override {
+    Value base = op->getNumOperands() >= 2 ? getMemRef(op, 0) : Value();
+    if (!base)
       return failure();
 
-    
-    if (indices.size() == 1) {
-      
-      SmallVector<OpFoldResult> offsets = {indices[0]};
-      SmallVector<OpFoldResult> sizes = {rewriter.getIndexAttr(ShapedType::kDynamic)};
-      SmallVector<OpFoldResult> strides = {rewriter.getIndexAttr(1)};
-
-      Value subview = rewriter.create<memref::SubViewOp>(
-          loc, base, offsets, sizes, strides);
-
-      rewriter.replaceOp(op, subview);
-    } else {
-      
-      Value linearOffset = nullptr;
-
-      for (size_t i = 0; i < indices.size(); ++i) {
-        
-        if (linearOffset) {
-          linearOffset = rewriter.create<arith::AddIOp>(loc, linearOffset, indices[i]);
-        } else {
-          linearOffset = indices[i];
-        }
-      }
-
-      
-      SmallVector<OpFoldResult> offsets = {linearOffset};
-      SmallVector<OpFoldResult> sizes = {rewriter.getIndexAttr(ShapedType::kDynamic)};
-      SmallVector<OpFoldResult> strides = {rewriter.getIndexAttr(1)};
-
-      Value subview = rewriter.create<memref::SubViewOp>(
-          loc, base, offsets, sizes, strides);
+    Location loc = op->getLoc();
+    Value linearOffset = toIndex(rewriter, loc, op->getOperand(1));
+    for (Value index : op->getOperands().drop_front(2))
+      linearOffset = rewriter.create<arith::AddIOp>(
+          loc, linearOffset, toIndex(rewriter, loc, index));
 
-      rewriter.replaceOp(op, subview);
-    }
+    rewriter.replaceOp(op, createOffsetView(rewriter, loc, base,
+                                            linearOffset));
+    return success();
+  }
+};
 
+/// Pattern to convert cir.return → func.return
+class CIRReturnOpLowering : public RewritePattern {
+public:
+  CIRReturnOpLowering(MLIRContext* context)
+      : RewritePattern("cir.return", /*benefit=*/1, context) {}
+
+  LogicalResult matchAndRewrite(Operation* op,
+                                PatternRewriter& rewriter) const override {
+    SmallVector<Value> operands;
+    for (Value operand : op->getOperands())
+      operands.push_back(stripCast(operand));
+    rewriter.replaceOpWithNewOp<func::ReturnOp>(op, operands);
     return success();
   }
 };
 
-class CIRFuncOpConversion : public OpConversionPattern<Operation> {
+/// Pattern to convert cir.func → func.func. This is the only pattern that
+/// changes types, so it is the only one run through the conversion driver.
+class CIRFuncOpConversion : public ConversionPattern {
 public:
-  using OpConversionPattern::OpConversionPattern;
+  CIRFuncOpConversion(const TypeConverter& typeConverter, MLIRContext* context)
+      : ConversionPattern(typeConverter, "cir.func", /*benefit=*/1, context) {}
 
   LogicalResult matchAndRewrite(Operation* op, ArrayRef<Value> operands,
                                 ConversionPatternRewriter& rewriter) const override {
-    if (op->getName().getStringRef() != "cir.func")
+    auto name = op->getAttrOfType<StringAttr>(SymbolTable::getSymbolAttrName());
+    auto typeAttr = op->getAttrOfType<TypeAttr>("function_type");
+    if (!name || !typeAttr || op->getNumRegions() != 1)
       return failure();
 
-    Location loc = op->getLoc();
-
-   
-    auto funcOp = dyn_cast<func::FuncOp>(op);
-    if (!funcOp)
-      return failure();
-
-    
-    TypeConverter* typeConverter = getTypeConverter();
-    auto convertedType = typeConverter->convertType(funcOp.getFunctionType());
-    if (!convertedType)
+    Type convertedType = getTypeConverter()->convertType(typeAttr.getValue());
+    auto functionType = dyn_cast_or_null<FunctionType>(convertedType);
+    if (!functionType)
       return failure();
 
-    auto newFuncOp = rewriter.create<func::FuncOp>(
-        loc, funcOp.getName(), convertedType.cast<FunctionType>());
+    auto newFuncOp = rewriter.create<func::FuncOp>(op->getLoc(),
+                                                   name.getValue(), functionType);
 
-    
-    for (auto namedAttr : funcOp->getAttrs()) {
-      if (namedAttr.getName() != "type" && namedAttr.getName() != "function_type")
+    for (auto namedAttr : op->getAttrs()) {
+      if (namedAttr.getName() != SymbolTable::getSymbolAttrName() &&
+          namedAttr.getName() != "function_type")
         newFuncOp->setAttr(namedAttr.getName(), namedAttr.getValue());
     }
 
-    
-    Region& oldRegion = funcOp.getBody();
+    Region& oldRegion = op->getRegion(0);
     Region& newRegion = newFuncOp.getBody();
-
     if (!oldRegion.empty()) {
       rewriter.inlineRegionBefore(oldRegion, newRegion, newRegion.end());
-
-      
-      TypeConverter* converter = getTypeConverter();
-      if (failed(rewriter.convertRegionTypes(&newRegion, *converter)))
+      if (failed(rewriter.convertRegionTypes(&newRegion, *getTypeConverter())))
         return failure();
     }
 
-    rewriter.replaceOp(op, newFuncOp);
-
-    return success();
-  }
-};
-
-/// Pattern to convert cir.return → func.return
-class CIRReturnOpConversion : public OpConversionPattern<Operation> {
-public:
-  using OpConversionPattern::OpConversionPattern;
-
-  LogicalResult matchAndRewrite(Operation* op, ArrayRef<Value> operands,
-                                ConversionPatternRewriter& rewriter) const override {
-    if (op->getName().getStringRef() != "cir.return")
-      return failure();
-
-    // Create func.return with converted operands
-    rewriter.replaceOpWithNewOp<func::ReturnOp>(op, operands);
-
+    rewriter.eraseOp(op);
     return success();
   }
 };
@@ -315,46 +285,81 @@ public:
                     cf::ControlFlowDialect, memref::MemRefDialect>();
   }
 
+  LogicalResult initialize(MLIRContext* context) override {
+    RewritePatternSet patterns(context);
+    patterns.add<CIRLoadOpLowering, CIRStoreOpLowering, CIRPtrAddOpLowering,
+                 CIRGetElementPtrSingleIndexLowering,
+                 CIRGetElementPtrOpLowering, CIRReturnOpLowering>(context);
+    bodyPatterns = FrozenRewritePatternSet(std::move(patterns));
+    return success();
+  }
+
   void runOnOperation() override {
     ModuleOp module = getOperation();
     MLIRContext* context = &getContext();
 
-    // Step 1: Create type converter
+    // Step 1: Convert function signatures. Only cir.func is illegal here;
+    // body ops are left for the per-function lowering below.
     CIRToFuncTypeConverter typeConverter;
-
-    // Step 2: Define conversion target
     ConversionTarget target(*context);
+    target.markUnknownOpDynamicallyLegal([](Operation*) { return true; });
+    target.setOpAction(OperationName("cir.func", context),
+                       ConversionTarget::LegalizationAction::Illegal);
+
+    RewritePatternSet signaturePatterns(context);
+    signaturePatterns.add<CIRFuncOpConversion>(typeConverter, context);
+    if (failed(applyPartialConversion(module, target,
+                                      std::move(signaturePatterns)))) {
+      signalPassFailure();
+      return;
+    }
 
-    // Mark target dialects as legal
-    target.addLegalDialect<func::FuncDialect, arith::ArithDialect,
-                          cf::ControlFlowDialect, memref::MemRefDialect,
-                          BuiltinDialect>();
-
-    // Mark CIR dialect and operations as illegal (must be converted)
-    target.addIllegalDialect<DenseStringElementsAttr>();  // Placeholder for CIR dialect
+    // Step 2: Lower function bodies in parallel, one greedy sweep each.
+    // Top-down so producers (ptr_add, gep) are memrefs before their users
+    // are visited; no folding, so nothing is hoisted across functions.
+    SmallVector<func::FuncOp> functions;
+    for (auto func : module.getOps<func::FuncOp>())
+      if (!func.isExternal())
+        functions.push_back(func);
+
+    GreedyRewriteConfig config;
+    config.setUseTopDownTraversal(true)
+        .setStrictness(GreedyRewriteStrictness::ExistingOps)
+        .setRegionSimplificationLevel(GreedySimplifyRegionLevel::Disabled)
+        .enableFolding(false)
+        .enableConstantCSE(false);
+
+    if (failed(failableParallelForEach(context, functions, [&](func::FuncOp func) {
+          return applyPatternsGreedily(func, bodyPatterns, config);
+        }))) {
+      signalPassFailure();
+      return;
+    }
 
-    // Mark specific CIR operations as illegal
-    target.addDynamicallyLegalOp<Operation>([](Operation* op) {
-      StringRef opName = op->getName().getStringRef();
-      return !opName.starts_with("cir.");
+    // Step 3: Anything left in the cir namespace had no applicable pattern.
+    // Signature casts whose users were all lowered are dead by now.
+    SmallVector<UnrealizedConversionCastOp> deadCasts;
+    WalkResult result = module.walk([&](Operation* op) {
+      if (auto cast = dyn_cast<UnrealizedConversionCastOp>(op)) {
+        if (cast->use_empty())
+          deadCasts.push_back(cast);
+        return WalkResult::advance();
+      }
+      if (op->getName().getDialectNamespace() != "cir")
+        return WalkResult::advance();
+      op->emitOpError("failed to lower to func/memref");
+      return WalkResult::interrupt();
     });
-
-    // Step 3: Register conversion patterns
-    RewritePatternSet patterns(context);
-
-    patterns.add<CIRLoadOpConversion>(typeConverter, context);
-    patterns.add<CIRStoreOpConversion>(typeConverter, context);
-    patterns.add<CIRPtrAddOpConversion>(typeConverter, context);
-    patterns.add<CIRGetElementPtrOpConversion>(typeConverter, context);
-    patterns.add<CIRFuncOpConversion>(typeConverter, context);
-    patterns.add<CIRReturnOpConversion>(typeConverter, context);
-
-    // Step 4: Apply partial conversion
-    if (failed(applyPartialConversion(module, target, std::move(patterns)))) {
+    if (result.wasInterrupted()) {
       signalPassFailure();
       return;
     }
+    for (UnrealizedConversionCastOp cast : deadCasts)
+      cast->erase();
   }
+
+private:
+  FrozenRewritePatternSet bodyPatterns;
 };
 
 /// Factory function to create the conversion pass
@@ -1,11 +1,16 @@
 
 
+#include "CIR/Passes.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
 #include "mlir/Pass/Pass.h"
 #include "mlir/Transforms/GreedyPatternRewriteDriver.h"
+#include "llvm/ADT/APInt.h"
+#include "llvm/ADT/DenseMap.h"
 #include <cstdint>
 #include <ctime>
 #include <memory>
@@ -51,7 +56,9 @@ public:
   MLIR_DEFINE_EXPLICIT_INTERNAL_INLINE_TYPE_ID(CIRAddressObfuscationPass)
 
   CIRAddressObfuscationPass() = default;
-  CIRAddressObfuscationPass(bool enabled) : obfuscationEnabled(enabled) {}
+  CIRAddressObfuscationPass(const CIRAddressObfuscationPass &other)
+      : PassWrapper(other) {}
+  CIRAddressObfuscationPass(bool enabled) { obfuscationEnabled = enabled; }
 
   StringRef getArgument() const final { return "cir-address-obf"; }
   StringRef getDescription() const final {
@@ -70,19 +77,16 @@ public:
 
     obfuscationKey = KeyGenerator::generateKey();
 
-    // Walk all operations and apply obfuscation
-    module.walk([&](Operation* op) {
-      StringRef opName = op->getName().getStringRef();
+    // Functions are independent: every key and mask lives inside the
+    // function that uses it, so they can be rewritten in parallel.
+    SmallVector<FunctionOpInterface> functions;
+    module.walk([&](FunctionOpInterface func) {
+      if (!func.isExternal())
+        functions.push_back(func);
+    });
 
-      if (opName == CIROps::LoadOpName) {
-        obfuscateLoadOp(op);
-      } else if (opName == CIROps::StoreOpName) {
-        obfuscateStoreOp(op);
-      } else if (opName == CIROps::PtrAddOpName) {
-        obfuscatePtrArithmetic(op);
-      } else if (opName == CIROps::GetElementPtrOpName) {
-        obfuscateGetElementPtr(op);
-      }
+    parallelForEach(context, functions, [&](FunctionOpInterface func) {
+      obfuscateFunction(func);
     });
   }
 
@@ -91,94 +95,94 @@ public:
   }
 
 private:
-  bool obfuscationEnabled = true;
+  Option<bool> obfuscationEnabled{
+      *this, "enable",
+      llvm::cl::desc("Enable address obfuscation (controlled by frontend toggle)"),
+      llvm::cl::init(true)};
   uint64_t obfuscationKey = 0;
 
-  Value createKeyConstant(OpBuilder& builder, Location loc, Type indexType) {
-    // Create an arith.constant with the obfuscation key
-    IntegerAttr keyAttr = builder.getIntegerAttr(indexType, obfuscationKey);
-    return builder.create<arith::ConstantOp>(loc, indexType, keyAttr);
-  }
-
-  void obfuscateLoadOp(Operation* loadOp) {
-    OpBuilder builder(loadOp);
-    Location loc = loadOp->getLoc();
-
-    if (loadOp->getNumOperands() >= 2) {
-      Value indexOperand = loadOp->getOperand(1); // Index/offset operand
-      Type indexType = indexOperand.getType();
-
-      // Create key constant
-      Value keyConst = createKeyConstant(builder, loc, indexType);
-
-      // Create XOR operation: masked_index = index XOR key
-      Value maskedIndex = builder.create<arith::XOrIOp>(loc, indexOperand, keyConst);
-
-      // Replace the index operand with masked version
-      loadOp->setOperand(1, maskedIndex);
+  /// Per-function cache of key constants, one per index type, materialized
+  /// at the top of the entry block so they dominate every masked access.
+  class KeyCache {
+  public:
+    KeyCache(FunctionOpInterface func, uint64_t key)
+        : builder(func->getContext()), loc(func.getLoc()), key(key) {
+      builder.setInsertionPointToStart(&func.getFunctionBody().front());
     }
-  }
-
-  void obfuscateStoreOp(Operation* storeOp) {
-    OpBuilder builder(storeOp);
-    Location loc = storeOp->getLoc();
-
-    if (storeOp->getNumOperands() >= 3) {
-      Value indexOperand = storeOp->getOperand(2); // Index/offset operand
-      Type indexType = indexOperand.getType();
-
-      // Create key constant
-      Value keyConst = createKeyConstant(builder, loc, indexType);
-
-      // Create XOR operation
-      Value maskedIndex = builder.create<arith::XOrIOp>(loc, indexOperand, keyConst);
 
-      // Replace the index operand
-      storeOp->setOperand(2, maskedIndex);
+    Value get(Type indexType) {
+      Value& keyConst = constants[indexType];
+      if (!keyConst) {
+        IntegerAttr keyAttr = getKeyAttr(indexType);
+        keyConst = builder.create<arith::ConstantOp>(loc, indexType, keyAttr);
+      }
+      return keyConst;
     }
-  }
 
-  void obfuscatePtrArithmetic(Operation* ptrAddOp) {
-    OpBuilder builder(ptrAddOp);
-    Location loc = ptrAddOp->getLoc();
+  private:
+    IntegerAttr getKeyAttr(Type indexType) {
+      if (indexType.isIndex())
+        return builder.getIndexAttr(static_cast<int64_t>(key));
+      unsigned width = indexType.getIntOrFloatBitWidth();
+      return builder.getIntegerAttr(indexType,
+                                    llvm::APInt(64, key).zextOrTrunc(width));
+    }
 
-    if (ptrAddOp->getNumOperands() >= 2) {
-      Value offsetOperand = ptrAddOp->getOperand(1);
-      Type offsetType = offsetOperand.getType();
+    OpBuilder builder;
+    Location loc;
+    uint64_t key;
+    DenseMap<Type, Value> constants;
+  };
 
-      // Create key constant
-      Value keyConst = createKeyConstant(builder, loc, offsetType);
+  void obfuscateFunction(FunctionOpInterface func) {
+    // Collect first: masking inserts ops next to the ones being visited.
+    SmallVector<Operation*> accesses;
+    func->walk([&](Operation* op) {
+      StringRef opName = op->getName().getStringRef();
+      if (opName == CIROps::LoadOpName || opName == CIROps::StoreOpName ||
+          opName == CIROps::PtrAddOpName ||
+          opName == CIROps::GetElementPtrOpName)
+        accesses.push_back(op);
+    });
+    if (accesses.empty())
+      return;
 
-      // Create XOR operation
-      Value maskedOffset = builder.create<arith::XOrIOp>(loc, offsetOperand, keyConst);
+    KeyCache keys(func, obfuscationKey);
+    for (Operation* op : accesses) {
+      StringRef opName = op->getName().getStringRef();
 
-      // Replace offset operand
-      ptrAddOp->setOperand(1, maskedOffset);
+      if (opName == CIROps::LoadOpName) {
+        if (op->getNumOperands() >= 2)
+          maskOperand(op, 1, keys); // Index/offset operand
+      } else if (opName == CIROps::StoreOpName) {
+        if (op->getNumOperands() >= 3)
+          maskOperand(op, 2, keys); // Index/offset operand
+      } else if (opName == CIROps::PtrAddOpName) {
+        if (op->getNumOperands() >= 2)
+          maskOperand(op, 1, keys);
+      } else {
+        for (unsigned i = 1; i < op->getNumOperands(); ++i)
+          maskOperand(op, i, keys);
+      }
     }
   }
 
-  void obfuscateGetElementPtr(Operation* gepOp) {
-    OpBuilder builder(gepOp);
-    Location loc = gepOp->getLoc();
-
-    for (unsigned i = 1; i < gepOp->getNumOperands(); ++i) {
-      Value indexOperand = gepOp->getOperand(i);
-      Type indexType = indexOperand.getType();
-
-      // Create key constant
-      Value keyConst = createKeyConstant(builder, loc, indexType);
-
-      // Create XOR operation
-      Value maskedIndex = builder.create<arith::XOrIOp>(loc, indexOperand, keyConst);
+  void maskOperand(Operation* op, unsigned index, KeyCache& keys) {
+    Value indexOperand = op->getOperand(index);
+    Type indexType = indexOperand.getType();
+    if (!indexType.isSignlessIntOrIndex())
+      return;
 
-      // Replace index operand
-      gepOp->setOperand(i, maskedIndex);
-    }
+    // masked_index = index XOR key, reusing the function's key constant
+    OpBuilder builder(op);
+    Value maskedIndex = builder.create<arith::XOrIOp>(
+        op->getLoc(), indexOperand, keys.get(indexType));
+    op->setOperand(index, maskedIndex);
   }
 };
 
 /// Factory function to create the pass with configuration
-std::unique_ptr<Pass> createCIRAddressObfuscationPass(bool enabled = true) {
+std::unique_ptr<Pass> createCIRAddressObfuscationPass(bool enabled) {
   return std::make_unique<CIRAddressObfuscationPass>(enabled);
 }
 
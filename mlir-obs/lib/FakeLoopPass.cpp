@@ -0,0 +1,222 @@
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/Hotness.h"
+#include "Obfuscator/ObsDialect.h"
+#include "Obfuscator/ProfileTiers.h"
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+#include "llvm/ADT/DenseMap.h"
+
+#include <algorithm>
+#include <cstdint>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+// Blocks at or below this fraction of the function's entry count are cold:
+// behind two unbiased branches, or marked unlikely by branch weights.
+constexpr double kColdFrequency = 0.25;
+// obs.opaque_pred is shared per function and lowered at entry.
+constexpr double kPredicateCycles = 4.0;
+// Each guard is a not-taken conditional branch on the shared predicate.
+constexpr double kGuardCycles = 2.0;
+
+constexpr llvm::StringLiteral kSinkName = "__obfs_fl_sink";
+// Set by fake-loops-plan on the first op of each chosen block; the value
+// is the loop's seed. fake-loops consumes it.
+constexpr llvm::StringLiteral kFakeLoopAttr = "obs.fake_loop";
+
+struct Candidate {
+  LLVM::LLVMFuncOp func;
+  Block *block;
+  double frequency;
+};
+
+static uint32_t mix(uint32_t h, uint32_t v) {
+  h ^= v + 0x9E3779B9u + (h << 6) + (h >> 2);
+  return h;
+}
+
+static uint32_t hashName(StringRef name) {
+  uint32_t hash = 0x811C9DC5u;
+  for (char c : name) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x01000193u;
+  }
+  return hash;
+}
+
+static bool canHostLoop(Block *block) {
+  if (block->isEntryBlock() || block->empty())
+    return false;
+  // Landing pads must stay first in their block.
+  return !isa<LLVM::LandingpadOp>(block->front());
+}
+
+static LLVM::GlobalOp getOrCreateSink(ModuleOp module, OpBuilder &builder) {
+  if (auto sink = module.lookupSymbol<LLVM::GlobalOp>(kSinkName))
+    return sink;
+  OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointToStart(module.getBody());
+  return builder.create<LLVM::GlobalOp>(
+      module.getLoc(), builder.getI32Type(), false, LLVM::Linkage::Internal,
+      kSinkName, builder.getI32IntegerAttr(0));
+}
+
+// Splits `block` at its first op and routes it through
+//
+//   %p = obs.opaque_pred false
+//   llvm.cond_br %p, ^loop(%init), ^rest
+// ^loop(%i):
+//   llvm.store volatile (%i * a) ^ b, @__obfs_fl_sink
+//   %n = %i + step
+//   llvm.cond_br %n < bound, ^loop(%n), ^rest
+//
+// The loop is never entered. The volatile store keeps loop deletion away.
+static void insertFakeLoop(OpBuilder &builder, Block *block, uint32_t seed) {
+  Location loc = block->front().getLoc();
+  MLIRContext *ctx = builder.getContext();
+  auto i32Type = IntegerType::get(ctx, 32);
+  auto ptrType = LLVM::LLVMPointerType::get(ctx);
+
+  Block *rest = block->splitBlock(&block->front());
+  Block *loop = builder.createBlock(rest, {i32Type}, {loc});
+
+  auto constant = [&](uint32_t value) -> Value {
+    return builder.create<LLVM::ConstantOp>(
+        loc, i32Type, builder.getI32IntegerAttr(static_cast<int32_t>(value)));
+  };
+
+  builder.setInsertionPointToEnd(block);
+  Value pred = builder.create<OpaquePredOp>(loc, builder.getI1Type(),
+                                            builder.getBoolAttr(false));
+  Value init = constant(seed & 0xFF);
+  builder.create<LLVM::CondBrOp>(loc, pred, loop, ValueRange{init}, rest,
+                                 ValueRange{});
+
+  builder.setInsertionPointToStart(loop);
+  Value iv = loop->getArgument(0);
+  Value scaled = builder.create<LLVM::MulOp>(loc, iv, constant(seed | 1));
+  Value mixed = builder.create<LLVM::XOrOp>(loc, scaled, constant(seed >> 7));
+  Value sinkAddr = builder.create<LLVM::AddressOfOp>(loc, ptrType, kSinkName);
+  builder.create<LLVM::StoreOp>(loc, mixed, sinkAddr, /*alignment=*/4,
+                                /*isVolatile=*/true);
+  Value next = builder.create<LLVM::AddOp>(loc, iv, constant(1 + (seed & 3)));
+  Value more = builder.create<LLVM::ICmpOp>(
+      loc, LLVM::ICmpPredicate::slt, next, constant(256 + (seed >> 24)));
+  builder.create<LLVM::CondBrOp>(loc, more, loop, ValueRange{next}, rest,
+                                 ValueRange{});
+}
+
+} // namespace
+
+void FakeLoopPlanPass::runOnOperation() {
+  ModuleOp module = getOperation();
+  OpBuilder builder(&getContext());
+
+  if (count == 0)
+    return;
+
+  // The module-wide `count` and cycle budget need every function's
+  // estimate before a block is picked; the estimates, which are most of
+  // the work, are computed in parallel. fake-loops then inserts the loops
+  // one function per task under the pass manager.
+  SmallVector<LLVM::LLVMFuncOp> funcs;
+  SmallVector<Operation *> funcOps;
+  module.walk([&](LLVM::LLVMFuncOp func) {
+    if (func.isExternal() || func.getName().starts_with("__obfs_") ||
+        !isTransformAllowed(func, TransformCost::Cheap))
+      return;
+    funcs.push_back(func);
+    funcOps.push_back(func);
+  });
+  computeBlockFrequencies(funcOps, getAnalysisManager());
+
+  SmallVector<Candidate> candidates;
+  for (LLVM::LLVMFuncOp func : funcs) {
+    const auto &freq = getChildAnalysis<BlockFrequencyEstimate>(func);
+    for (Block &block : func.getBody()) {
+      if (!freq.isReachable(&block) || !canHostLoop(&block))
+        continue;
+      double frequency = freq.getFrequency(&block);
+      if (frequency > kColdFrequency) {
+        ++numSkippedHot;
+        continue;
+      }
+      candidates.push_back({func, &block, frequency});
+    }
+  }
+
+  // Coldest first; stable so placement is deterministic.
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [](const Candidate &a, const Candidate &b) {
+                     return a.frequency < b.frequency;
+                   });
+
+  DenseMap<Operation *, double> spent;
+  unsigned planned = 0;
+  for (const Candidate &candidate : candidates) {
+    if (planned == count)
+      break;
+
+    Operation *funcOp = candidate.func.getOperation();
+    auto it = spent.find(funcOp);
+    double cost = (it == spent.end() ? kPredicateCycles : it->second) +
+                  kGuardCycles * candidate.frequency;
+    if (cost > cycleBudget) {
+      ++numOverBudget;
+      continue;
+    }
+    spent[funcOp] = cost;
+
+    getOrCreateSink(module, builder);
+    uint32_t seed = mix(hashName(candidate.func.getName()), planned);
+    candidate.block->front().setAttr(
+        kFakeLoopAttr, builder.getI32IntegerAttr(static_cast<int32_t>(seed)));
+    ++planned;
+    ++numPlanned;
+  }
+}
+
+std::unique_ptr<Pass> mlir::obs::createFakeLoopPlanPass(unsigned count,
+                                                        unsigned cycleBudget) {
+  return std::make_unique<FakeLoopPlanPass>(count, cycleBudget);
+}
+
+void FakeLoopPass::getDependentDialects(DialectRegistry &registry) const {
+  registry.insert<ObsDialect, LLVM::LLVMDialect>();
+}
+
+void FakeLoopPass::runOnOperation() {
+  LLVM::LLVMFuncOp func = getOperation();
+
+  SmallVector<Operation *> marked;
+  func.walk([&](Operation *op) {
+    if (op->hasAttr(kFakeLoopAttr))
+      marked.push_back(op);
+  });
+
+  OpBuilder builder(&getContext());
+  for (Operation *op : marked) {
+    auto seed = op->getAttrOfType<IntegerAttr>(kFakeLoopAttr);
+    op->removeAttr(kFakeLoopAttr);
+    // The plan is only valid right after fake-loops-plan
+    if (!seed || op != &op->getBlock()->front() || !canHostLoop(op->getBlock()))
+      continue;
+    insertFakeLoop(builder, op->getBlock(),
+                   static_cast<uint32_t>(seed.getInt()));
+    ++numInserted;
+  }
+}
+
+std::unique_ptr<Pass> mlir::obs::createFakeLoopPass() {
+  return std::make_unique<FakeLoopPass>();
+}
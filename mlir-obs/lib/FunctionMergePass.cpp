@@ -0,0 +1,404 @@
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/Hotness.h"
+#include "Obfuscator/ProfileTiers.h"
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/IRMapping.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Hashing.h"
+#include "llvm/ADT/MapVector.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+#include <algorithm>
+#include <string>
+#include <tuple>
+#include <vector>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+// Flattened view of a function body. Operands are named by the position of
+// their defining op / block instead of by SSA value, so two functions can be
+// compared op-by-op.
+struct FunctionShape {
+  SmallVector<Block *> blocks;
+  SmallVector<Operation *> ops;
+  DenseMap<Block *, unsigned> blockIndex;
+  DenseMap<Operation *, unsigned> opIndex;
+
+  explicit FunctionShape(LLVM::LLVMFuncOp func) {
+    for (Block &block : func.getBody()) {
+      blockIndex.try_emplace(&block, blocks.size());
+      blocks.push_back(&block);
+      for (Operation &op : block) {
+        opIndex.try_emplace(&op, ops.size());
+        ops.push_back(&op);
+      }
+    }
+  }
+
+  std::tuple<unsigned, unsigned, unsigned> key(Value value) const {
+    if (auto arg = llvm::dyn_cast<BlockArgument>(value))
+      return {0, blockIndex.lookup(arg.getOwner()), arg.getArgNumber()};
+    auto result = llvm::cast<OpResult>(value);
+    return {1, opIndex.lookup(result.getOwner()), result.getResultNumber()};
+  }
+};
+
+// Ops whose only difference between two functions may be turned into a
+// selector-driven choice.
+static StringRef getParamAttrName(Operation *op) {
+  if (auto constOp = llvm::dyn_cast<LLVM::ConstantOp>(op))
+    return constOp.getValueAttrName().getValue();
+  if (auto addrOp = llvm::dyn_cast<LLVM::AddressOfOp>(op))
+    return addrOp.getGlobalNameAttrName().getValue();
+  return {};
+}
+
+static DictionaryAttr getShapeAttrs(Operation *op) {
+  DictionaryAttr attrs = op->getAttrDictionary();
+  StringRef param = getParamAttrName(op);
+  if (param.empty())
+    return attrs;
+
+  NamedAttrList filtered;
+  for (NamedAttribute attr : attrs) {
+    if (attr.getName() != param)
+      filtered.push_back(attr);
+  }
+  return filtered.getDictionary(op->getContext());
+}
+
+static bool isCandidate(LLVM::LLVMFuncOp func, unsigned minOps) {
+  if (func.isExternal() || func.isVarArg())
+    return false;
+
+  StringRef name = func.getSymName();
+  if (name == "main" || name.starts_with("llvm.") || name.starts_with("__obfs_"))
+    return false;
+  if (!isTransformAllowed(func, TransformCost::Full))
+    return false;
+  // sret must stay on the first or second parameter, and the selector in
+  // front moves every parameter back by one
+  if (func.getNumArguments() > 1 &&
+      func.getArgAttr(1, LLVM::LLVMDialect::getStructRetAttrName()))
+    return false;
+
+  unsigned numOps = 0;
+  bool hasNestedRegions = false;
+  func.walk([&](Operation *op) {
+    if (op == func.getOperation())
+      return;
+    ++numOps;
+    if (op->getNumRegions() != 0)
+      hasNestedRegions = true;
+  });
+
+  return !hasNestedRegions && numOps >= minOps;
+}
+
+static size_t fingerprint(LLVM::LLVMFuncOp func, const FunctionShape &shape) {
+  llvm::hash_code hash = llvm::hash_combine(
+      func.getFunctionType(), func.getPersonalityAttr(), func.getArgAttrsAttr(),
+      func.getResAttrsAttr(), shape.blocks.size(), shape.ops.size());
+
+  for (Block *block : shape.blocks) {
+    for (Type type : block->getArgumentTypes())
+      hash = llvm::hash_combine(hash, type);
+  }
+
+  for (Operation *op : shape.ops) {
+    hash = llvm::hash_combine(hash, op->getName(), getShapeAttrs(op),
+                              op->getNumOperands(), op->getNumSuccessors());
+    for (Type type : op->getResultTypes())
+      hash = llvm::hash_combine(hash, type);
+    for (Value operand : op->getOperands()) {
+      auto [kind, owner, number] = shape.key(operand);
+      hash = llvm::hash_combine(hash, kind, owner, number);
+    }
+    for (Block *succ : op->getSuccessors())
+      hash = llvm::hash_combine(hash, shape.blockIndex.lookup(succ));
+  }
+
+  return static_cast<size_t>(hash);
+}
+
+// Full comparison behind the fingerprint. Positions where the two bodies
+// only differ in a constant value or global address are returned in params.
+static bool isMergeable(LLVM::LLVMFuncOp lhsFunc, const FunctionShape &lhs,
+                        LLVM::LLVMFuncOp rhsFunc, const FunctionShape &rhs,
+                        SmallVectorImpl<unsigned> &params) {
+  if (lhsFunc.getFunctionType() != rhsFunc.getFunctionType() ||
+      lhsFunc.getPersonalityAttr() != rhsFunc.getPersonalityAttr())
+    return false;
+  // Parameter attributes are part of the calling convention (sret, byval,
+  // inreg, ...) or promises the callers made (noundef, nonnull); the merged
+  // body can only keep them if every member has the same ones.
+  if (lhsFunc.getArgAttrsAttr() != rhsFunc.getArgAttrsAttr() ||
+      lhsFunc.getResAttrsAttr() != rhsFunc.getResAttrsAttr())
+    return false;
+  if (lhs.blocks.size() != rhs.blocks.size() || lhs.ops.size() != rhs.ops.size())
+    return false;
+
+  for (unsigned i = 0, e = lhs.blocks.size(); i < e; ++i) {
+    if (lhs.blocks[i]->getArgumentTypes() != rhs.blocks[i]->getArgumentTypes())
+      return false;
+  }
+
+  for (unsigned i = 0, e = lhs.ops.size(); i < e; ++i) {
+    Operation *a = lhs.ops[i];
+    Operation *b = rhs.ops[i];
+
+    if (a->getName() != b->getName() ||
+        a->getResultTypes() != b->getResultTypes() ||
+        a->getNumOperands() != b->getNumOperands() ||
+        a->getNumSuccessors() != b->getNumSuccessors())
+      return false;
+
+    for (unsigned j = 0, n = a->getNumOperands(); j < n; ++j) {
+      if (lhs.key(a->getOperand(j)) != rhs.key(b->getOperand(j)))
+        return false;
+    }
+    for (unsigned j = 0, n = a->getNumSuccessors(); j < n; ++j) {
+      if (lhs.blockIndex.lookup(a->getSuccessor(j)) !=
+          rhs.blockIndex.lookup(b->getSuccessor(j)))
+        return false;
+    }
+
+    if (a->getAttrDictionary() == b->getAttrDictionary())
+      continue;
+    if (getParamAttrName(a).empty() || getShapeAttrs(a) != getShapeAttrs(b))
+      return false;
+    params.push_back(i);
+  }
+
+  return true;
+}
+
+// A constant can only become a runtime select if none of its users require
+// an immediate (intrinsic immargs, inline asm constraints) or would turn a
+// static alloca into a dynamic one.
+static bool canParameterize(Operation *op) {
+  for (Operation *user : op->getUsers()) {
+    if (llvm::isa<LLVM::AllocaOp, LLVM::InlineAsmOp>(user))
+      return false;
+    if (user->getName().getStringRef().starts_with("llvm.intr."))
+      return false;
+  }
+  return true;
+}
+
+struct MergeGroup {
+  SmallVector<unsigned> members;
+  SmallVector<unsigned> params;
+};
+
+static LLVM::LLVMFuncOp buildMergedFunction(ArrayRef<LLVM::LLVMFuncOp> members,
+                                            ArrayRef<const FunctionShape *> shapes,
+                                            ArrayRef<unsigned> params,
+                                            StringRef name, OpBuilder &builder) {
+  LLVM::LLVMFuncOp rep = members.front();
+  MLIRContext *ctx = rep.getContext();
+  Location loc = rep.getLoc();
+  auto i32Type = IntegerType::get(ctx, 32);
+
+  LLVM::LLVMFunctionType oldType = rep.getFunctionType();
+  SmallVector<Type> inputs{i32Type};
+  llvm::append_range(inputs, oldType.getParams());
+  auto mergedType = LLVM::LLVMFunctionType::get(oldType.getReturnType(), inputs, false);
+
+  builder.setInsertionPoint(rep);
+  auto merged = builder.create<LLVM::LLVMFuncOp>(
+      loc, name, mergedType, LLVM::Linkage::Internal);
+
+  for (StringAttr attrName : {rep.getPersonalityAttrName(),
+                              rep.getPassthroughAttrName(),
+                              rep.getFramePointerAttrName(),
+                              rep.getUwtableKindAttrName()}) {
+    if (Attribute attr = rep->getAttr(attrName))
+      merged->setAttr(attrName, attr);
+  }
+  // Members agree on their parameter attributes; the selector has none
+  if (ArrayAttr argAttrs = rep.getArgAttrsAttr()) {
+    SmallVector<Attribute> shifted{DictionaryAttr::get(ctx)};
+    llvm::append_range(shifted, argAttrs);
+    merged.setArgAttrsAttr(ArrayAttr::get(ctx, shifted));
+  }
+  if (ArrayAttr resAttrs = rep.getResAttrsAttr())
+    merged.setResAttrsAttr(resAttrs);
+  // Keep one shared body; letting the inliner re-specialise it per thunk
+  // would give the size back.
+  merged.setNoInline(true);
+
+  IRMapping mapping;
+  rep.getBody().cloneInto(&merged.getBody(), mapping);
+  Value selector = merged.getBody().front().insertArgument(0u, i32Type, loc);
+
+  FunctionShape mergedShape(merged);
+  for (unsigned idx : params) {
+    Operation *base = mergedShape.ops[idx];
+    builder.setInsertionPointAfter(base);
+
+    Value chosen = base->getResult(0);
+    llvm::SmallPtrSet<Operation *, 8> chain;
+    for (unsigned k = 1; k < members.size(); ++k) {
+      Operation *alt = builder.clone(*shapes[k]->ops[idx]);
+      Value kVal = builder.create<LLVM::ConstantOp>(
+          loc, i32Type, builder.getI32IntegerAttr(k));
+      Value isK = builder.create<LLVM::ICmpOp>(
+          loc, LLVM::ICmpPredicate::eq, selector, kVal);
+      auto select = builder.create<LLVM::SelectOp>(loc, isK, alt->getResult(0), chosen);
+      chain.insert(select);
+      chosen = select;
+    }
+
+    base->getResult(0).replaceUsesWithIf(chosen, [&](OpOperand &use) {
+      return !chain.contains(use.getOwner());
+    });
+  }
+
+  return merged;
+}
+
+static void rewriteAsThunk(LLVM::LLVMFuncOp func, LLVM::LLVMFuncOp merged,
+                           unsigned selectorValue, OpBuilder &builder) {
+  Location loc = func.getLoc();
+  auto i32Type = IntegerType::get(func.getContext(), 32);
+
+  Region &body = func.getBody();
+  body.dropAllReferences();
+  body.getBlocks().clear();
+
+  Block *entryBlock = func.addEntryBlock(builder);
+  builder.setInsertionPointToStart(entryBlock);
+
+  SmallVector<Value> args;
+  args.push_back(builder.create<LLVM::ConstantOp>(
+      loc, i32Type, builder.getI32IntegerAttr(selectorValue)));
+  llvm::append_range(args, entryBlock->getArguments());
+
+  auto call = builder.create<LLVM::CallOp>(loc, merged, args);
+  // byval/sret arguments are passed on with the same ABI they arrived with
+  if (ArrayAttr argAttrs = merged.getArgAttrsAttr())
+    call.setArgAttrsAttr(argAttrs);
+  if (ArrayAttr resAttrs = merged.getResAttrsAttr())
+    call.setResAttrsAttr(resAttrs);
+  if (llvm::isa<LLVM::LLVMVoidType>(func.getFunctionType().getReturnType()))
+    builder.create<LLVM::ReturnOp>(loc, ValueRange{});
+  else
+    builder.create<LLVM::ReturnOp>(loc, call.getResults());
+
+  // Callers see straight through the thunk and call the merged body with a
+  // constant selector; the symbol itself stays for address-taken uses.
+  func.setNoInline(false);
+  func.setAlwaysInline(true);
+}
+
+}
+
+void FunctionMergePass::runOnOperation() {
+  ModuleOp module = getOperation();
+  MLIRContext *ctx = module.getContext();
+  OpBuilder builder(ctx);
+
+  // A merged body dispatches on a selector on every call, so functions
+  // estimated hot keep their own body.
+  auto &hotness = getAnalysis<HotnessAnalysis>();
+  SmallVector<LLVM::LLVMFuncOp> candidates;
+  for (auto func : module.getOps<LLVM::LLVMFuncOp>()) {
+    if (isCandidate(func, minOps) &&
+        hotness.allows(func, TransformCost::Full))
+      candidates.push_back(func);
+  }
+
+  if (candidates.size() < 2)
+    return;
+
+  std::vector<FunctionShape> shapes;
+  shapes.reserve(candidates.size());
+  llvm::MapVector<size_t, SmallVector<unsigned>> buckets;
+  for (unsigned i = 0, e = candidates.size(); i < e; ++i) {
+    shapes.emplace_back(candidates[i]);
+    buckets[fingerprint(candidates[i], shapes.back())].push_back(i);
+  }
+
+  SmallVector<MergeGroup> groups;
+  for (auto &bucket : buckets) {
+    if (bucket.second.size() < 2)
+      continue;
+
+    SmallVector<MergeGroup> bucketGroups;
+    for (unsigned idx : bucket.second) {
+      bool placed = false;
+      for (MergeGroup &group : bucketGroups) {
+        if (group.members.size() >= maxGroupSize)
+          continue;
+
+        unsigned rep = group.members.front();
+        SmallVector<unsigned> diff;
+        if (!isMergeable(candidates[rep], shapes[rep], candidates[idx], shapes[idx], diff))
+          continue;
+        if (!llvm::all_of(diff, [&](unsigned i) {
+              return canParameterize(shapes[rep].ops[i]);
+            }))
+          continue;
+
+        group.members.push_back(idx);
+        group.params.append(diff.begin(), diff.end());
+        placed = true;
+        break;
+      }
+
+      if (!placed)
+        bucketGroups.push_back({{idx}, {}});
+    }
+
+    for (MergeGroup &group : bucketGroups) {
+      if (group.members.size() >= 2)
+        groups.push_back(std::move(group));
+    }
+  }
+
+  unsigned nameCounter = 0;
+  for (MergeGroup &group : groups) {
+    llvm::sort(group.params);
+    group.params.erase(std::unique(group.params.begin(), group.params.end()),
+                       group.params.end());
+
+    SmallVector<LLVM::LLVMFuncOp> members;
+    SmallVector<const FunctionShape *> memberShapes;
+    for (unsigned idx : group.members) {
+      members.push_back(candidates[idx]);
+      memberShapes.push_back(&shapes[idx]);
+    }
+
+    std::string name;
+    do {
+      name = "__obfs_merged_" + std::to_string(nameCounter++);
+    } while (module.lookupSymbol(name));
+
+    LLVM::LLVMFuncOp merged =
+        buildMergedFunction(members, memberShapes, group.params, name, builder);
+
+    for (unsigned k = 0; k < members.size(); ++k)
+      rewriteAsThunk(members[k], merged, k, builder);
+
+    ++numGroups;
+    numMerged += members.size();
+  }
+}
+
+std::unique_ptr<Pass> mlir::obs::createFunctionMergePass(unsigned minOps,
+                                                         unsigned maxGroupSize) {
+  return std::make_unique<FunctionMergePass>(minOps, maxGroupSize);
+}
@@ -0,0 +1,166 @@
+#include "Obfuscator/Hotness.h"
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/ProfileTiers.h"
+
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Demangle/Demangle.h"
+#include "llvm/Support/GlobPattern.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+constexpr llvm::StringLiteral kAnnotationPrefix = "obf:";
+// String function attribute carrying the resolved policy into LLVM IR, where
+// it survives symbol renaming for the OLLVM stage.
+constexpr llvm::StringLiteral kPolicyPassthrough = "obf-policy";
+
+struct PolicyRule {
+  llvm::GlobPattern pattern;
+  std::string policy;
+};
+
+static bool isPolicy(StringRef policy) {
+  return policy == "none" || policy == "light" || policy == "max";
+}
+
+// annotate("obf:<policy>") entries of @llvm.global.annotations. The
+// importer builds each { ptr fn, ptr str, ptr file, i32 line, ptr args }
+// element with llvm.insertvalue chains inside the global's initializer.
+static void collectAnnotations(ModuleOp module,
+                               llvm::StringMap<std::string> &policies) {
+  auto annotations =
+      module.lookupSymbol<LLVM::GlobalOp>("llvm.global.annotations");
+  if (!annotations || !annotations.getInitializerBlock())
+    return;
+
+  annotations.getInitializerBlock()->walk([&](LLVM::InsertValueOp insert) {
+    if (!isa<LLVM::LLVMArrayType>(insert.getContainer().getType()))
+      return;
+
+    std::optional<StringRef> funcName, annotationName;
+    Value element = insert.getValue();
+    while (auto field = element.getDefiningOp<LLVM::InsertValueOp>()) {
+      ArrayRef<int64_t> position = field.getPosition();
+      auto addr = field.getValue().getDefiningOp<LLVM::AddressOfOp>();
+      if (addr && position.size() == 1 && position[0] == 0)
+        funcName = addr.getGlobalName();
+      else if (addr && position.size() == 1 && position[0] == 1)
+        annotationName = addr.getGlobalName();
+      element = field.getContainer();
+    }
+    if (!funcName || !annotationName)
+      return;
+
+    auto str = module.lookupSymbol<LLVM::GlobalOp>(*annotationName);
+    auto value = str ? dyn_cast_or_null<StringAttr>(str.getValueOrNull())
+                     : StringAttr();
+    if (!value)
+      return;
+    StringRef text = value.getValue().split('\0').first;
+    if (!text.consume_front(kAnnotationPrefix))
+      return;
+    if (!isPolicy(text)) {
+      str.emitWarning() << "function-policy: ignoring unknown policy '"
+                        << text << "' on @" << *funcName;
+      return;
+    }
+    policies[*funcName] = text.str();
+  });
+}
+
+static LogicalResult parsePolicyFile(StringRef path, ModuleOp module,
+                                     std::vector<PolicyRule> &rules) {
+  auto buffer = llvm::MemoryBuffer::getFile(path, /*IsText=*/true);
+  if (!buffer) {
+    return module.emitError() << "function-policy: cannot read '" << path
+                              << "': " << buffer.getError().message();
+  }
+
+  SmallVector<StringRef> lines;
+  (*buffer)->getBuffer().split(lines, '\n');
+  for (auto [index, rawLine] : llvm::enumerate(lines)) {
+    StringRef line = rawLine.split('#').first.trim();
+    if (line.empty())
+      continue;
+    auto [glob, policy] = line.split(' ');
+    policy = policy.trim();
+    if (!isPolicy(policy)) {
+      return module.emitError()
+             << "function-policy: " << path << ":" << index + 1
+             << ": expected '<glob> none|light|max'";
+    }
+    auto pattern = llvm::GlobPattern::create(glob);
+    if (!pattern) {
+      return module.emitError()
+             << "function-policy: " << path << ":" << index + 1 << ": "
+             << llvm::toString(pattern.takeError());
+    }
+    rules.push_back({std::move(*pattern), policy.str()});
+  }
+  return success();
+}
+
+} // namespace
+
+void FunctionPolicyPass::runOnOperation() {
+  ModuleOp module = getOperation();
+  MLIRContext *ctx = &getContext();
+
+  std::vector<PolicyRule> rules;
+  if (!policyFile.empty() &&
+      failed(parsePolicyFile(policyFile, module, rules)))
+    return signalPassFailure();
+
+  llvm::StringMap<std::string> annotated;
+  collectAnnotations(module, annotated);
+  if (rules.empty() && annotated.empty())
+    return;
+
+  module.walk([&](FunctionOpInterface func) {
+    if (func.isExternal())
+      return;
+    StringRef name = func.getName();
+
+    std::string policy = annotated.lookup(name);
+    if (policy.empty() && !rules.empty()) {
+      std::string demangled = llvm::demangle(name);
+      for (const PolicyRule &rule : rules) {
+        if (rule.pattern.match(name) || rule.pattern.match(demangled)) {
+          policy = rule.policy;
+          break;
+        }
+      }
+    }
+    if (policy.empty())
+      return;
+
+    func->setAttr(kPolicyAttrName, StringAttr::get(ctx, policy));
+    if (auto llvmFunc = dyn_cast<LLVM::LLVMFuncOp>(func.getOperation()))
+      setPassthroughString(llvmFunc, kPolicyPassthrough, policy);
+    if (policy == "none")
+      ++numNone;
+    else if (policy == "light")
+      ++numLight;
+    else
+      ++numMax;
+  });
+}
+
+std::unique_ptr<Pass> mlir::obs::createFunctionPolicyPass(StringRef policyFile) {
+  return std::make_unique<FunctionPolicyPass>(policyFile);
+}
@@ -0,0 +1,195 @@
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/ProfileTiers.h"
+#include "Obfuscator/StringEncryption.h"
+#include "Obfuscator/SymbolNames.h"
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Dialect/Func/IR/FuncOps.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+
+#include <random>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+// Everything the transforms look at, gathered by one walk of the module.
+struct ModuleCandidates {
+  SmallVector<LLVM::GlobalOp> globals;
+  SmallVector<LLVM::LLVMFuncOp> llvmFuncs;
+  SmallVector<func::FuncOp> funcFuncs;
+  // Ops with a symbol reference anywhere in their attributes
+  llvm::SetVector<Operation *> symbolUsers;
+};
+
+static bool hasSymbolUse(Operation *op) {
+  return op->getAttrDictionary()
+      .walk([](SymbolRefAttr) { return WalkResult::interrupt(); })
+      .wasInterrupted();
+}
+
+static void collectSymbolUsers(Operation *root, ModuleCandidates &candidates) {
+  root->walk([&](Operation *op) {
+    if (hasSymbolUse(op))
+      candidates.symbolUsers.insert(op);
+  });
+}
+
+} // namespace
+
+void FusedObfuscatePass::runOnOperation() {
+  ModuleOp module = getOperation();
+
+  llvm::StringSet<> enabled;
+  for (const std::string &name : transforms) {
+    if (name != "string-encrypt" && name != "constant-obfuscate" &&
+        name != "symbol-obfuscate" && name != "crypto-hash") {
+      module.emitError("fused-obfuscate: unknown transform '") << name << "'";
+      return signalPassFailure();
+    }
+    enabled.insert(name);
+  }
+  bool encryptStrings = enabled.contains("string-encrypt") ||
+                        enabled.contains("constant-obfuscate");
+  bool randomNames = enabled.contains("symbol-obfuscate");
+  bool hashNames = enabled.contains("crypto-hash");
+
+  // The only walk over the whole module
+  ModuleCandidates candidates;
+  module.walk([&](Operation *op) {
+    if (auto global = dyn_cast<LLVM::GlobalOp>(op))
+      candidates.globals.push_back(global);
+    else if (auto llvmFunc = dyn_cast<LLVM::LLVMFuncOp>(op))
+      candidates.llvmFuncs.push_back(llvmFunc);
+    else if (auto funcOp = dyn_cast<func::FuncOp>(op))
+      candidates.funcFuncs.push_back(funcOp);
+    if ((randomNames || hashNames) && hasSymbolUse(op))
+      candidates.symbolUsers.insert(op);
+  });
+
+  // string-encrypt and constant-obfuscate do the same rewrite; one
+  // encryptor means each string is encrypted and decrypted once.
+  if (encryptStrings) {
+    StringEncryptor encryptor(module, key);
+    bool hadDecrypt = static_cast<bool>(encryptor.getDecryptFunc());
+    bool hadInit = static_cast<bool>(encryptor.getInitFunc());
+    for (LLVM::GlobalOp global : candidates.globals)
+      encryptor.encrypt(global);
+    encryptor.finalize();
+    numStrings += encryptor.getNumEncrypted();
+    numBytes += encryptor.getNumBytesEncrypted();
+
+    // New helpers are renamed like any other function: __obfs_decrypt
+    // is inserted at the top of the module, __obfs_init at the bottom.
+    if (!hadDecrypt && encryptor.getDecryptFunc()) {
+      candidates.llvmFuncs.insert(candidates.llvmFuncs.begin(), encryptor.getDecryptFunc());
+      collectSymbolUsers(encryptor.getDecryptFunc(), candidates);
+    }
+    if (!hadInit && encryptor.getInitFunc()) {
+      candidates.llvmFuncs.push_back(encryptor.getInitFunc());
+      collectSymbolUsers(encryptor.getInitFunc(), candidates);
+    }
+    for (Operation &op : module.getBody()->getOperations()) {
+      if (isa<LLVM::GlobalCtorsOp>(op))
+        candidates.symbolUsers.insert(&op);
+    }
+  }
+
+  if (!randomNames && !hashNames)
+    return;
+
+  // Final name of every renamed symbol, composed in pass order
+  llvm::StringMap<std::string> renames;
+  auto currentName = [&](StringRef name) -> StringRef {
+    auto it = renames.find(name);
+    return it == renames.end() ? name : StringRef(it->second);
+  };
+
+  if (randomNames) {
+    // symbol-obfuscate draws func-dialect and LLVM-dialect names from
+    // separate generators seeded alike
+    std::seed_seq funcSeq(symbolSeed.begin(), symbolSeed.end());
+    std::mt19937 funcRng(funcSeq);
+    for (func::FuncOp func : candidates.funcFuncs) {
+      StringRef name = func.getSymName();
+      if (func.isDeclaration() || renames.count(name))
+        continue;
+      if (name == "main" || !isTransformAllowed(func, TransformCost::Free)) {
+        ++numKept;
+        continue;
+      }
+      renames[name] = generateObfuscatedName(funcRng, "f");
+    }
+
+    std::seed_seq llvmSeq(symbolSeed.begin(), symbolSeed.end());
+    std::mt19937 llvmRng(llvmSeq);
+    for (LLVM::LLVMFuncOp func : candidates.llvmFuncs) {
+      StringRef name = func.getSymName();
+      if (func.isExternal() || renames.count(name))
+        continue;
+      if (name == "main" || !isTransformAllowed(func, TransformCost::Free)) {
+        ++numKept;
+        continue;
+      }
+      renames[name] = generateObfuscatedName(llvmRng, "f");
+    }
+    for (LLVM::GlobalOp global : candidates.globals) {
+      StringRef name = global.getSymName();
+      if (name.starts_with("llvm.") || name.starts_with("__obfs_") || renames.count(name))
+        continue;
+      renames[name] = generateObfuscatedName(llvmRng, "g");
+    }
+  }
+
+  if (hashNames) {
+    auto hash = [&](StringRef name) {
+      std::string hashed = generateHashedName(currentName(name), CryptoHashPass::HashAlgorithm::SHA256,
+                                              salt, hashLength);
+      renames[name] = hashed;
+    };
+    for (func::FuncOp func : candidates.funcFuncs) {
+      StringRef name = func.getSymName();
+      if (name == "main" || name.starts_with("llvm.") || name.starts_with("mlir.") ||
+          !isTransformAllowed(func, TransformCost::Free))
+        continue;
+      hash(name);
+    }
+    for (LLVM::LLVMFuncOp func : candidates.llvmFuncs) {
+      StringRef name = func.getSymName();
+      if (name == "main" || name.starts_with("llvm.") ||
+          !isTransformAllowed(func, TransformCost::Free))
+        continue;
+      hash(name);
+    }
+  }
+
+  if (renames.empty())
+    return;
+  numSymbols += renames.size();
+
+  // Uses first, nested references (e.g. global_ctors entries) included
+  replaceSymbolUses(candidates.symbolUsers.getArrayRef(), renames);
+
+  auto renameSymbol = [&](Operation *op, StringRef name) {
+    auto it = renames.find(name);
+    if (it != renames.end())
+      SymbolTable::setSymbolName(op, it->second);
+  };
+  for (func::FuncOp func : candidates.funcFuncs)
+    renameSymbol(func, func.getSymName());
+  for (LLVM::LLVMFuncOp func : candidates.llvmFuncs)
+    renameSymbol(func, func.getSymName());
+  for (LLVM::GlobalOp global : candidates.globals)
+    renameSymbol(global, global.getSymName());
+}
+
+std::unique_ptr<Pass> mlir::obs::createFusedObfuscatePass(ArrayRef<std::string> transforms) {
+  return std::make_unique<FusedObfuscatePass>(transforms);
+}
@@ -0,0 +1,316 @@
+#include "Obfuscator/Hotness.h"
+
+#include "mlir/Analysis/CallGraph.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/RegionGraphTraits.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/Interfaces/CallInterfaces.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+#include "mlir/Interfaces/LoopLikeInterface.h"
+
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+
+#include <algorithm>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+// Back-edge estimate for loops without profile data (~8 iterations).
+constexpr double kLoopTripEstimate = 8.0;
+// main's outermost loop is usually the program's work or event loop.
+constexpr double kMainLoopTripEstimate = 64.0;
+// A recursive SCC counts as one more loop level for everything in it.
+constexpr double kRecursionEstimate = 8.0;
+// Shares of estimated executed ops covered by hot and hot+warm blocks.
+constexpr double kHotPercent = 90.0;
+constexpr double kWarmPercent = 99.0;
+
+struct CallSite {
+  Block *block;
+  Operation *callee;
+};
+
+static Tier passthroughTier(Operation *func, Tier tier) {
+  auto llvmFunc = dyn_cast<LLVM::LLVMFuncOp>(func);
+  if (!llvmFunc)
+    return tier;
+  if (hasPassthrough(llvmFunc, "cold"))
+    return Tier::Cold;
+  if (hasPassthrough(llvmFunc, "hot"))
+    return Tier::Hot;
+  return tier;
+}
+
+} // namespace
+
+bool mlir::obs::hasPassthrough(LLVM::LLVMFuncOp func, StringRef name) {
+  std::optional<ArrayAttr> passthrough = func.getPassthrough();
+  if (!passthrough)
+    return false;
+  for (Attribute attr : *passthrough) {
+    if (auto str = dyn_cast<StringAttr>(attr); str && str.getValue() == name)
+      return true;
+  }
+  return false;
+}
+
+void mlir::obs::setPassthroughString(LLVM::LLVMFuncOp func, StringRef key,
+                                     StringRef value) {
+  MLIRContext *ctx = func.getContext();
+  SmallVector<Attribute> entries;
+  if (std::optional<ArrayAttr> passthrough = func.getPassthrough()) {
+    for (Attribute attr : *passthrough) {
+      auto pair = dyn_cast<ArrayAttr>(attr);
+      auto name = pair && pair.size() == 2 ? dyn_cast<StringAttr>(pair[0])
+                                           : StringAttr();
+      if (!name || name.getValue() != key)
+        entries.push_back(attr);
+    }
+  }
+  entries.push_back(ArrayAttr::get(
+      ctx, {StringAttr::get(ctx, key), StringAttr::get(ctx, value)}));
+  func.setPassthroughAttr(ArrayAttr::get(ctx, entries));
+}
+
+BlockFrequencyEstimate::BlockFrequencyEstimate(Operation *op) {
+  auto func = dyn_cast<FunctionOpInterface>(op);
+  if (!func || func.isExternal())
+    return;
+  isMain = func.getName() == "main";
+
+  Region &body = func.getFunctionBody();
+  domInfo = std::make_unique<DominanceInfo>(op);
+  if (!body.hasOneBlock())
+    loopInfo = std::make_unique<CFGLoopInfo>(domInfo->getDomTree(&body));
+  estimateRegion(body, 1.0, 0, loopInfo.get());
+}
+
+double BlockFrequencyEstimate::tripEstimate(unsigned level) const {
+  return isMain && level == 0 ? kMainLoopTripEstimate : kLoopTripEstimate;
+}
+
+// `scale` is the frequency of the region's entry, `outerDepth` the loop
+// depth of the op owning the region. CFG loops are only computed for the
+// function body; nested regions are structured (scf) and get their loop
+// depth from LoopLikeOpInterface parents.
+void BlockFrequencyEstimate::estimateRegion(Region &region, double scale,
+                                            unsigned outerDepth,
+                                            const CFGLoopInfo *loops) {
+  auto isBackEdge = [&](Block *from, Block *to) {
+    if (!loops)
+      return false;
+    CFGLoop *loop = loops->getLoopFor(to);
+    return loop && loop->getHeader() == to && loop->contains(from);
+  };
+
+  DenseMap<Block *, double> prob;
+  Block *entry = &region.front();
+  prob[entry] = 1.0;
+  llvm::ReversePostOrderTraversal<Block *> rpot(entry);
+  for (Block *block : rpot) {
+    double blockProb = prob.lookup(block);
+    unsigned cfgDepth = loops ? loops->getLoopDepth(block) : 0;
+    double scaled = scale * blockProb;
+    for (unsigned i = 0; i < cfgDepth; ++i)
+      scaled *= tripEstimate(outerDepth + i);
+    Operation *term =
+        block->mightHaveTerminator() ? block->getTerminator() : nullptr;
+    if (isa_and_nonnull<LLVM::UnreachableOp>(term))
+      scaled = 0.0;
+
+    unsigned blockDepth = outerDepth + cfgDepth;
+    freq[block] = scaled;
+    depth[block] = blockDepth;
+    peak = std::max(peak, scaled);
+
+    // A loop body runs ~trip times per execution of the loop op; other
+    // region holders (if/else, switch) run one of their regions.
+    for (Operation &op : *block) {
+      if (op.getNumRegions() == 0 ||
+          op.hasTrait<OpTrait::IsIsolatedFromAbove>())
+        continue;
+      bool isLoop = isa<LoopLikeOpInterface>(op);
+      double nestedScale = isLoop ? scaled * tripEstimate(blockDepth)
+                                  : scaled / op.getNumRegions();
+      for (Region &nested : op.getRegions()) {
+        if (!nested.empty())
+          estimateRegion(nested, nestedScale, blockDepth + (isLoop ? 1 : 0),
+                         nullptr);
+      }
+    }
+
+    if (!term)
+      continue;
+    unsigned numSuccs = term->getNumSuccessors();
+    if (numSuccs == 0)
+      continue;
+
+    auto weights = term->getAttrOfType<DenseI32ArrayAttr>("branch_weights");
+    double total = 0.0;
+    if (weights && weights.size() == static_cast<int64_t>(numSuccs))
+      for (int32_t w : weights.asArrayRef())
+        total += static_cast<uint32_t>(w);
+
+    for (unsigned i = 0; i < numSuccs; ++i) {
+      Block *succ = term->getSuccessor(i);
+      if (isBackEdge(block, succ))
+        continue;
+      double share = total > 0.0
+                         ? static_cast<uint32_t>(weights[i]) / total
+                         : 1.0 / numSuccs;
+      prob[succ] += blockProb * share;
+    }
+  }
+}
+
+void mlir::obs::computeBlockFrequencies(ArrayRef<Operation *> funcs,
+                                        AnalysisManager am) {
+  if (funcs.empty())
+    return;
+  SmallVector<AnalysisManager> nested;
+  nested.reserve(funcs.size());
+  for (Operation *func : funcs)
+    nested.push_back(am.nest(func));
+  parallelForEach(funcs.front()->getContext(), nested,
+                  [](AnalysisManager &funcAm) {
+                    funcAm.getAnalysis<BlockFrequencyEstimate>();
+                  });
+}
+
+HotnessAnalysis::HotnessAnalysis(Operation *module, AnalysisManager &am) {
+  if (auto source = module->getAttrOfType<StringAttr>(kTierSourceAttrName))
+    profileGuided = source.getValue() == "profile";
+
+  SmallVector<FunctionOpInterface> funcs;
+  SmallVector<Operation *> funcOps;
+  module->walk([&](FunctionOpInterface func) {
+    if (func.isExternal())
+      return;
+    funcs.push_back(func);
+    funcOps.push_back(func);
+  });
+  computeBlockFrequencies(funcOps, am);
+  for (FunctionOpInterface func : funcs)
+    estimates[func] = &am.getChildAnalysis<BlockFrequencyEstimate>(func);
+
+  // Direct call sites per caller; indirect calls have no edge.
+  SymbolTableCollection symbolTables;
+  DenseMap<Operation *, SmallVector<CallSite>> callSites;
+  llvm::DenseSet<Operation *> called;
+  module->walk([&](CallOpInterface call) {
+    Operation *callee = call.resolveCallableInTable(&symbolTables);
+    auto caller = call->getParentOfType<FunctionOpInterface>();
+    if (!callee || !caller || !estimates.count(callee))
+      return;
+    callSites[caller].push_back({call->getBlock(), callee});
+    called.insert(callee);
+  });
+
+  // scc_iterator yields callees before callers; walk it backwards so every
+  // caller's entry frequency is final before it is pushed into callees.
+  CallGraph &callGraph = am.getAnalysis<CallGraph>();
+  SmallVector<std::pair<SmallVector<Operation *>, bool>> sccs;
+  for (auto it = llvm::scc_begin(static_cast<const CallGraph *>(&callGraph));
+       !it.isAtEnd(); ++it) {
+    SmallVector<Operation *> members;
+    for (const CallGraphNode *node : *it) {
+      if (node->isExternal())
+        continue;
+      Operation *func = node->getCallableRegion()->getParentOp();
+      if (estimates.count(func))
+        members.push_back(func);
+    }
+    if (!members.empty())
+      sccs.push_back({std::move(members), it.hasCycle()});
+  }
+
+  auto isRoot = [&](Operation *func) {
+    return !called.contains(func) ||
+           cast<FunctionOpInterface>(func).getName() == "main";
+  };
+  for (auto &[members, recursive] : llvm::reverse(sccs)) {
+    llvm::SmallPtrSet<Operation *, 4> inScc(members.begin(), members.end());
+    for (Operation *func : members) {
+      double &entry = entryFreq[func];
+      if (isRoot(func))
+        entry += 1.0;
+      if (recursive)
+        entry *= kRecursionEstimate;
+    }
+    for (Operation *func : members) {
+      const BlockFrequencyEstimate *blocks = estimates.lookup(func);
+      for (const CallSite &site : callSites.lookup(func)) {
+        if (!inScc.contains(site.callee))
+          entryFreq[site.callee] +=
+              entryFreq[func] * blocks->getFrequency(site.block);
+      }
+    }
+  }
+  // Unreachable from the call graph's roots (unused private code).
+  for (FunctionOpInterface func : funcs)
+    entryFreq.try_emplace(func, 1.0);
+
+  SmallVector<std::pair<Block *, Operation *>> blocks;
+  SmallVector<double> blockWeights;
+  SmallVector<double> funcWeights;
+  for (FunctionOpInterface func : funcs) {
+    funcWeights.push_back(getPeakFrequency(func));
+    func->walk([&](Block *block) {
+      blocks.push_back({block, func});
+      blockWeights.push_back(getFrequency(block) *
+                             block->getOperations().size());
+    });
+  }
+
+  SmallVector<Tier> tiers =
+      classifyByShare(blockWeights, kHotPercent, kWarmPercent);
+  for (auto [entry, tier] : llvm::zip(blocks, tiers))
+    blockTiers[entry.first] = passthroughTier(entry.second, tier);
+  tiers = classifyByShare(funcWeights, kHotPercent, kWarmPercent);
+  for (auto [func, tier] : llvm::zip(funcs, tiers))
+    functionTiers[func] = passthroughTier(func, tier);
+}
+
+double HotnessAnalysis::getEntryFrequency(Operation *func) const {
+  return entryFreq.lookup(func);
+}
+
+double HotnessAnalysis::getFrequency(Block *block) const {
+  Operation *func = block->getParentOp();
+  if (!isa<FunctionOpInterface>(func))
+    func = func->getParentOfType<FunctionOpInterface>();
+  const BlockFrequencyEstimate *blocks = estimates.lookup(func);
+  return blocks ? entryFreq.lookup(func) * blocks->getFrequency(block) : 0.0;
+}
+
+double HotnessAnalysis::getPeakFrequency(Operation *func) const {
+  const BlockFrequencyEstimate *blocks = estimates.lookup(func);
+  return blocks ? entryFreq.lookup(func) * blocks->getPeakFrequency() : 0.0;
+}
+
+Tier HotnessAnalysis::getTier(Operation *op) const {
+  if (isa<FunctionOpInterface>(op))
+    return getFunctionTier(op);
+  auto it = blockTiers.find(op->getBlock());
+  return it == blockTiers.end() ? Tier::Cold : it->second;
+}
+
+Tier HotnessAnalysis::getFunctionTier(Operation *func) const {
+  auto it = functionTiers.find(func);
+  return it == functionTiers.end() ? Tier::Cold : it->second;
+}
+
+bool HotnessAnalysis::allows(Operation *op, TransformCost cost) const {
+  if (profileGuided || cost != TransformCost::Full ||
+      !getFunctionPolicy(op).empty())
+    return true;
+  return getTier(op) != Tier::Hot;
+}
@@ -0,0 +1,17 @@
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/Hotness.h"
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/Pass/Pass.h"
+
+using namespace mlir;
+using namespace mlir::obs;
+
+void HotnessPass::runOnOperation() {
+  getAnalysis<HotnessAnalysis>();
+  markAllAnalysesPreserved();
+}
+
+std::unique_ptr<Pass> mlir::obs::createHotnessPass() {
+  return std::make_unique<HotnessPass>();
+}
@@ -1,4 +1,6 @@
 #include "Obfuscator/Passes.h"
+#include "Obfuscator/ObsDialect.h"
+#include "Obfuscator/ProfileTiers.h"
 
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/BuiltinOps.h"
@@ -183,16 +185,19 @@ void ImportObfuscationPass::runOnOperation() {
 
     auto funcType = extFunc.getFunctionType();
 
-    std::string wrapperName = "__obfs_wrap_" + funcName.str();
+    // The resolver only looks up and caches the function pointer; call
+    // sites reach it through obs.resolve_import, which obs-lower hoists out
+    // of loops and shares between the calls it dominates.
+    std::string resolverName = (kResolverPrefix + funcName).str();
 
     builder.setInsertionPointToStart(module.getBody());
-    auto wrapperFunc = builder.create<LLVM::LLVMFuncOp>(
-        loc, wrapperName, funcType, LLVM::Linkage::Internal);
+    auto resolverType = LLVM::LLVMFunctionType::get(ptrType, {}, false);
+    auto resolverFunc = builder.create<LLVM::LLVMFuncOp>(
+        loc, resolverName, resolverType, LLVM::Linkage::Internal);
 
-    Block *entryBlock = wrapperFunc.addEntryBlock(builder);
+    Block *entryBlock = resolverFunc.addEntryBlock(builder);
     builder.setInsertionPointToStart(entryBlock);
 
-    auto i64Type = IntegerType::get(ctx, 64);
     auto i32Type = IntegerType::get(ctx, 32);
 
     Value fpAddr = builder.create<LLVM::AddressOfOp>(loc, ptrType, fpGlobal.getSymName());
@@ -202,10 +207,10 @@ void ImportObfuscationPass::runOnOperation() {
     Value isNull = builder.create<LLVM::ICmpOp>(
         loc, LLVM::ICmpPredicate::eq, cachedFp, nullPtr);
 
-    Block *resolveBlock = wrapperFunc.addBlock();
-    Block *callBlock = wrapperFunc.addBlock();
+    Block *resolveBlock = resolverFunc.addBlock();
+    Block *returnBlock = resolverFunc.addBlock();
 
-    builder.create<LLVM::CondBrOp>(loc, isNull, resolveBlock, callBlock);
+    builder.create<LLVM::CondBrOp>(loc, isNull, resolveBlock, returnBlock);
 
     builder.setInsertionPointToStart(resolveBlock);
 
@@ -216,8 +221,8 @@ void ImportObfuscationPass::runOnOperation() {
     Value libIsNull = builder.create<LLVM::ICmpOp>(
         loc, LLVM::ICmpPredicate::eq, libHandleVal, nullPtr);
 
-    Block *dlopenBlock = wrapperFunc.addBlock();
-    Block *dlsymBlock = wrapperFunc.addBlock();
+    Block *dlopenBlock = resolverFunc.addBlock();
+    Block *dlsymBlock = resolverFunc.addBlock();
 
     builder.create<LLVM::CondBrOp>(loc, libIsNull, dlopenBlock, dlsymBlock);
 
@@ -250,38 +255,22 @@ void ImportObfuscationPass::runOnOperation() {
 
     builder.create<LLVM::StoreOp>(loc, resolvedFp, fpAddr);
 
-    builder.create<LLVM::BrOp>(loc, ValueRange{}, callBlock);
+    builder.create<LLVM::BrOp>(loc, ValueRange{}, returnBlock);
 
-    builder.setInsertionPointToStart(callBlock);
+    builder.setInsertionPointToStart(returnBlock);
 
     Value finalFp = builder.create<LLVM::LoadOp>(loc, ptrType, fpAddr);
-
-    SmallVector<Value> args;
-    for (auto arg : entryBlock->getArguments()) {
-      args.push_back(arg);
-    }
-
-    auto resultType = funcType.getReturnType();
-    SmallVector<Value> callArgs;
-    callArgs.push_back(finalFp);
-    callArgs.append(args.begin(), args.end());
-
-    if (llvm::isa<LLVM::LLVMVoidType>(resultType)) {
-      auto indirectCall = builder.create<LLVM::CallOp>(
-          loc, TypeRange{}, ValueRange{callArgs});
-      (void)indirectCall;
-      builder.create<LLVM::ReturnOp>(loc, ValueRange{});
-    } else {
-      auto callResult = builder.create<LLVM::CallOp>(
-          loc, TypeRange{resultType}, ValueRange{callArgs});
-      builder.create<LLVM::ReturnOp>(loc, callResult.getResults());
-    }
+    builder.create<LLVM::ReturnOp>(loc, finalFp);
 
     SmallVector<LLVM::CallOp> callsToReplace;
 
+    // Calls with operand bundles stay direct, as in indirect-call: the
+    // bundles would have to be rebuilt around the extra callee operand.
     module.walk([&](LLVM::CallOp callOp) {
       auto callee = callOp.getCallee();
-      if (callee && *callee == funcName) {
+      if (callee && *callee == funcName &&
+          callOp.getOpBundleOperands().empty() &&
+          isTransformAllowed(callOp, TransformCost::Cheap)) {
         callsToReplace.push_back(callOp);
       }
     });
@@ -289,16 +278,40 @@ void ImportObfuscationPass::runOnOperation() {
     for (LLVM::CallOp callOp : callsToReplace) {
       builder.setInsertionPoint(callOp);
 
+      Value fp = builder.create<ResolveImportOp>(
+          callOp.getLoc(), ptrType,
+          FlatSymbolRefAttr::get(ctx, resolverName));
+
+      SmallVector<Value> callArgs;
+      callArgs.push_back(fp);
+      callArgs.append(callOp.getArgOperands().begin(),
+                      callOp.getArgOperands().end());
+
+      // The calleeType builder keeps var_callee_type for variadic imports.
       auto newCall = builder.create<LLVM::CallOp>(
-          callOp.getLoc(),
-          callOp.getResultTypes(),
-          wrapperName,
-          callOp.getOperands());
+          callOp.getLoc(), funcType, ValueRange{callArgs});
+      // Everything but the callee carries over: fastmath flags, arg/res
+      // attributes, branch weights, tail-call kind and discardable attrs.
+      // The operand segments differ by the callee pointer.
+      for (NamedAttribute attr : callOp->getAttrs()) {
+        if (attr.getName() == callOp.getCalleeAttrName() ||
+            attr.getName() == callOp.getVarCalleeTypeAttrName() ||
+            attr.getName() == "operandSegmentSizes")
+          continue;
+        newCall->setAttr(attr.getName(), attr.getValue());
+      }
 
       callOp.replaceAllUsesWith(newCall);
       callOp.erase();
     }
+    numCalls += callsToReplace.size();
   }
+  numImports += externalFuncs.size();
+}
+
+void ImportObfuscationPass::getDependentDialects(
+    DialectRegistry &registry) const {
+  registry.insert<ObsDialect, LLVM::LLVMDialect>();
 }
 
 std::unique_ptr<Pass> mlir::obs::createImportObfuscationPass(
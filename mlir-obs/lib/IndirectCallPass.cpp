@@ -0,0 +1,317 @@
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/Hotness.h"
+#include "Obfuscator/ObsDialect.h"
+#include "Obfuscator/ProfileTiers.h"
+
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+#include "llvm/ADT/StringMap.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+constexpr llvm::StringLiteral kTableName = "__obfs_icall_table";
+// Set by indirect-call-table on each call it assigned a slot; the value is
+// the slot. indirect-call consumes it.
+constexpr llvm::StringLiteral kSlotAttr = "obs.icall_slot";
+// 8 x i64 slots per 64-byte line
+constexpr uint64_t kCacheLineBytes = 64;
+
+static uint64_t hashName(StringRef name) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (char c : name) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+// Calling these through a pointer changes their semantics or breaks the
+// callee's assumptions about its caller's frame.
+static bool isUnsafeTarget(LLVM::LLVMFuncOp callee) {
+  StringRef name = callee.getName();
+  if (name.starts_with("llvm.") || name.starts_with("__obfs_"))
+    return true;
+  if (name == "setjmp" || name == "_setjmp" || name == "sigsetjmp" ||
+      name == "__sigsetjmp" || name == "vfork" || name == "getcontext" ||
+      name == "savectx")
+    return true;
+  return hasPassthrough(callee, "returns_twice");
+}
+
+struct Site {
+  LLVM::CallOp call;
+  LLVM::LLVMFuncOp callee;
+  unsigned slot;
+};
+
+// What indirect-call needs of a marked call; the callee's name and type
+// come from the call itself, so no symbol lookup leaves the function.
+struct Rewrite {
+  LLVM::CallOp call;
+  StringRef callee;
+  unsigned slot;
+};
+
+static uint64_t slotKey(StringRef callee, unsigned slot) {
+  return (hashName(callee) + slot * 0x9E3779B97F4A7C15ULL) | 1;
+}
+
+// Table entries are ptrtoint(@f) + key, folded into relocations by the
+// linker. The key is an obs.encoded_const at each use, so the recovery
+// pipeline cannot turn a load + sub back into a direct call.
+static void createTable(ModuleOp module, OpBuilder &builder,
+                        ArrayRef<LLVM::LLVMFuncOp> targets) {
+  MLIRContext *ctx = module.getContext();
+  Location loc = module.getLoc();
+  auto i64Type = IntegerType::get(ctx, 64);
+  auto ptrType = LLVM::LLVMPointerType::get(ctx);
+  auto tableType = LLVM::LLVMArrayType::get(i64Type, targets.size());
+
+  OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointToStart(module.getBody());
+  auto table = builder.create<LLVM::GlobalOp>(
+      loc, tableType, /*isConstant=*/false, LLVM::Linkage::Internal,
+      kTableName, Attribute(), kCacheLineBytes);
+
+  builder.createBlock(&table.getInitializerRegion());
+  Value array = builder.create<LLVM::UndefOp>(loc, tableType);
+  for (auto [slot, target] : llvm::enumerate(targets)) {
+    Value addr = builder.create<LLVM::AddressOfOp>(loc, ptrType,
+                                                   target.getName());
+    Value raw = builder.create<LLVM::PtrToIntOp>(loc, i64Type, addr);
+    Value key = builder.create<LLVM::ConstantOp>(
+        loc, i64Type,
+        builder.getI64IntegerAttr(
+            static_cast<int64_t>(slotKey(target.getName(), slot))));
+    Value encoded = builder.create<LLVM::AddOp>(loc, raw, key);
+    array = builder.create<LLVM::InsertValueOp>(
+        loc, array, encoded, ArrayRef<int64_t>{static_cast<int64_t>(slot)});
+  }
+  builder.create<LLVM::ReturnOp>(loc, array);
+}
+
+static Value loadTarget(OpBuilder &builder, Location loc,
+                        const Rewrite &site) {
+  MLIRContext *ctx = builder.getContext();
+  auto i64Type = IntegerType::get(ctx, 64);
+  auto ptrType = LLVM::LLVMPointerType::get(ctx);
+
+  uint64_t key = slotKey(site.callee, site.slot);
+  uint64_t salt = (key * 0xC2B2AE3D27D4EB4FULL) | 1;
+  Value keyValue = builder.create<EncodedConstOp>(
+      loc, i64Type, builder.getI64IntegerAttr(static_cast<int64_t>(key ^ salt)),
+      builder.getI64IntegerAttr(static_cast<int64_t>(salt)));
+
+  // Indexed as i64 slots, so the table's length is not needed here
+  Value tableAddr = builder.create<LLVM::AddressOfOp>(loc, ptrType, kTableName);
+  Value slotAddr = builder.create<LLVM::GEPOp>(
+      loc, ptrType, i64Type, tableAddr,
+      ArrayRef<LLVM::GEPArg>{static_cast<int32_t>(site.slot)});
+  Value encoded = builder.create<LLVM::LoadOp>(loc, i64Type, slotAddr);
+  Value raw = builder.create<LLVM::SubOp>(loc, encoded, keyValue);
+  return builder.create<LLVM::IntToPtrOp>(loc, ptrType, raw);
+}
+
+static LLVM::CallOp createIndirectCall(OpBuilder &builder, LLVM::CallOp call,
+                                       Value fp) {
+  SmallVector<Value> operands{fp};
+  operands.append(call.getOperands().begin(), call.getOperands().end());
+  // The calleeType builder keeps var_callee_type for variadic callees.
+  auto indirect = builder.create<LLVM::CallOp>(
+      call.getLoc(), call.getCalleeFunctionType(), ValueRange{operands});
+  // Everything but the callee carries over, as in import-obfuscate
+  for (NamedAttribute attr : call->getAttrs()) {
+    if (attr.getName() == call.getCalleeAttrName() ||
+        attr.getName() == call.getVarCalleeTypeAttrName() ||
+        attr.getName() == "operandSegmentSizes")
+      continue;
+    indirect->setAttr(attr.getName(), attr.getValue());
+  }
+  return indirect;
+}
+
+// block:   ...; %fp = <decoded>; llvm.cond_br (%fp == @f), ^direct, ^indirect
+// ^direct:   <original call>;  llvm.br ^tail(%r)
+// ^indirect: llvm.call %fp(...); llvm.br ^tail(%r')
+// ^tail(%r): <ops after the call>
+static void rewriteWithFastPath(OpBuilder &builder, const Rewrite &site,
+                                Value fp) {
+  LLVM::CallOp call = site.call;
+  Location loc = call.getLoc();
+  Block *block = call->getBlock();
+  Block *tail = block->splitBlock(std::next(Block::iterator(call)));
+
+  Value result = call.getNumResults() ? call.getResult() : Value();
+  if (result) {
+    BlockArgument merged = tail->addArgument(result.getType(), loc);
+    result.replaceAllUsesWith(merged);
+  }
+  auto forward = [&](Value v) {
+    return v ? SmallVector<Value>{v} : SmallVector<Value>{};
+  };
+
+  Block *direct = builder.createBlock(tail);
+  Block *indirect = builder.createBlock(tail);
+
+  builder.setInsertionPointToEnd(block);
+  auto ptrType = LLVM::LLVMPointerType::get(builder.getContext());
+  Value expected =
+      builder.create<LLVM::AddressOfOp>(loc, ptrType, site.callee);
+  Value isDirect = builder.create<LLVM::ICmpOp>(loc, LLVM::ICmpPredicate::eq,
+                                                fp, expected);
+  builder.create<LLVM::CondBrOp>(loc, isDirect, direct, ValueRange{}, indirect,
+                                 ValueRange{});
+
+  call->moveBefore(direct, direct->end());
+  builder.setInsertionPointToEnd(direct);
+  builder.create<LLVM::BrOp>(loc, forward(result), tail);
+
+  builder.setInsertionPointToEnd(indirect);
+  LLVM::CallOp indirectCall = createIndirectCall(builder, call, fp);
+  builder.create<LLVM::BrOp>(
+      loc, forward(indirectCall.getNumResults() ? indirectCall.getResult()
+                                                : Value()),
+      tail);
+}
+
+} // namespace
+
+void IndirectCallTablePass::runOnOperation() {
+  ModuleOp module = getOperation();
+  MLIRContext *ctx = &getContext();
+
+  if (module.lookupSymbol(kTableName))
+    return;
+
+  SmallVector<LLVM::LLVMFuncOp> funcs;
+  for (auto func : module.getOps<LLVM::LLVMFuncOp>()) {
+    if (!func.isExternal() && !func.getName().starts_with("__obfs_"))
+      funcs.push_back(func);
+  }
+
+  // Sites are collected one function per task on the context's thread
+  // pool; slot numbering and the table, which every function shares, are
+  // done serially. indirect-call rewrites the marked calls afterwards.
+  SymbolTable symbols(module);
+  auto &hotness = getAnalysis<HotnessAnalysis>();
+  SmallVector<SmallVector<Site>> sitesPerFunc(funcs.size());
+  parallelFor(ctx, 0, funcs.size(), [&](size_t i) {
+    LLVM::LLVMFuncOp func = funcs[i];
+    bool hot = hasPassthrough(func, "hot") ||
+               !isTransformAllowed(func, TransformCost::Full);
+    const BlockFrequencyEstimate *freq = hotness.getBlockFrequencies(func);
+
+    func.walk([&](LLVM::CallOp call) {
+      std::optional<StringRef> calleeName = call.getCallee();
+      if (!calleeName)
+        return;
+      auto callee = symbols.lookup<LLVM::LLVMFuncOp>(*calleeName);
+      if (!callee || isUnsafeTarget(callee))
+        return;
+      if (callee.isExternal() ? !stdlib : !custom)
+        return;
+      if (!call.getOpBundleOperands().empty() ||
+          call.getTailCallKind() == LLVM::tailcallkind::TailCallKind::MustTail)
+        return;
+      if (hot) {
+        ++numSkippedHot;
+        return;
+      }
+      if (freq->isInLoop(call->getBlock())) {
+        ++numSkippedLoop;
+        return;
+      }
+      // Straight-line code that still runs often, e.g. a callee of
+      // main's work loop.
+      if (!hotness.allows(call, TransformCost::Full)) {
+        ++numSkippedHot;
+        return;
+      }
+      sitesPerFunc[i].push_back({call, callee, 0});
+    });
+  });
+
+  // Slots are handed out in first-use order, function by function in
+  // module order, so the targets one function calls sit next to each other
+  // in the table and share cache lines. Independent of the thread count.
+  llvm::StringMap<unsigned> slots;
+  SmallVector<LLVM::LLVMFuncOp> targets;
+  for (SmallVector<Site> &sites : sitesPerFunc) {
+    for (Site &site : sites) {
+      auto [it, inserted] =
+          slots.try_emplace(site.callee.getName(), targets.size());
+      if (inserted)
+        targets.push_back(site.callee);
+      site.slot = it->second;
+    }
+  }
+
+  if (targets.empty())
+    return;
+
+  OpBuilder builder(ctx);
+  createTable(module, builder, targets);
+  numTableEntries += targets.size();
+
+  for (SmallVector<Site> &sites : sitesPerFunc) {
+    for (Site &site : sites)
+      site.call->setAttr(kSlotAttr, builder.getI32IntegerAttr(site.slot));
+  }
+}
+
+std::unique_ptr<Pass>
+mlir::obs::createIndirectCallTablePass(bool obfuscateStdlib,
+                                       bool obfuscateCustom) {
+  return std::make_unique<IndirectCallTablePass>(obfuscateStdlib,
+                                                 obfuscateCustom);
+}
+
+void IndirectCallPass::getDependentDialects(DialectRegistry &registry) const {
+  registry.insert<ObsDialect, LLVM::LLVMDialect>();
+}
+
+void IndirectCallPass::runOnOperation() {
+  LLVM::LLVMFuncOp func = getOperation();
+
+  SmallVector<Rewrite> sites;
+  func.walk([&](LLVM::CallOp call) {
+    auto slot = call->getAttrOfType<IntegerAttr>(kSlotAttr);
+    if (!slot)
+      return;
+    call->removeAttr(kSlotAttr);
+    if (std::optional<StringRef> callee = call.getCallee())
+      sites.push_back({call, *callee, static_cast<unsigned>(slot.getInt())});
+  });
+
+  OpBuilder builder(&getContext());
+  for (const Rewrite &site : sites) {
+    builder.setInsertionPoint(site.call);
+    Value fp = loadTarget(builder, site.call.getLoc(), site);
+    if (fastPath) {
+      rewriteWithFastPath(builder, site, fp);
+    } else {
+      LLVM::CallOp indirect = createIndirectCall(builder, site.call, fp);
+      site.call->replaceAllUsesWith(indirect);
+      site.call.erase();
+    }
+    ++numConverted;
+  }
+}
+
+std::unique_ptr<Pass> mlir::obs::createIndirectCallPass(bool guardedFastPath) {
+  return std::make_unique<IndirectCallPass>(guardedFastPath);
+}
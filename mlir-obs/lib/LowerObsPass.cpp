@@ -0,0 +1,358 @@
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/ObsDialect.h"
+#include "Obfuscator/OpaqueValue.h"
+
+#include "mlir/Analysis/CFGLoopInfo.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/BuiltinTypes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Dominance.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/OperationSupport.h"
+#include "mlir/IR/Threading.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+#include "mlir/Interfaces/SideEffectInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/StringMap.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+static uint32_t hashName(StringRef name) {
+  uint32_t hash = 0x811C9DC5u;
+  for (char c : name) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x01000193u;
+  }
+  return hash;
+}
+
+// The block to evaluate a loop-invariant op from `block` in: the nearest
+// dominator outside every loop, or `block` itself outside loops.
+static Block *hoistTarget(Block *block, CFGLoopInfo &loopInfo,
+                          DominanceInfo &domInfo) {
+  while (CFGLoop *loop = loopInfo.getLoopFor(block)) {
+    Block *header = loop->getOutermostLoop()->getHeader();
+    DominanceInfoNode *idom = domInfo.getNode(header)->getIDom();
+    if (!idom)
+      break;
+    block = idom->getBlock();
+  }
+  return block;
+}
+
+// opaque_pred, encoded_const and decrypt are operand-free and pure, so each
+// distinct one is evaluated once at function entry. This is what CSE plus
+// LICM would do on structured control flow; LLVM-dialect CFG loops are
+// invisible to MLIR's LICM, so the lowering does it itself before expanding
+// anything.
+//
+// resolve_import calls dlopen/dlsym the first time it runs, so it only
+// moves out of loops, to the nearest dominating block outside them, and is
+// only replaced by an equivalent op that dominates it.
+static void hoistAndDedup(FunctionOpInterface func) {
+  Region &body = func.getFunctionBody();
+  if (body.empty())
+    return;
+
+  SmallVector<Operation *> pureOps, resolveOps;
+  func->walk([&](Operation *op) {
+    if (!isa_and_nonnull<ObsDialect>(op->getDialect()) ||
+        op->getParentWithTrait<OpTrait::IsIsolatedFromAbove>() != func)
+      return;
+    if (isPure(op))
+      pureOps.push_back(op);
+    else if (isa<ResolveImportOp>(op) && op->getParentRegion() == &body)
+      resolveOps.push_back(op);
+  });
+
+  Block &entry = body.front();
+  SmallVector<Operation *> kept;
+  for (Operation *op : pureOps) {
+    Operation *existing = nullptr;
+    for (Operation *candidate : kept) {
+      if (OperationEquivalence::isEquivalentTo(
+              op, candidate, OperationEquivalence::IgnoreLocations)) {
+        existing = candidate;
+        break;
+      }
+    }
+    if (existing) {
+      op->replaceAllUsesWith(existing);
+      op->erase();
+      continue;
+    }
+    if (kept.empty())
+      op->moveBefore(&entry, entry.begin());
+    else
+      op->moveAfter(kept.back());
+    kept.push_back(op);
+  }
+
+  if (resolveOps.empty())
+    return;
+  DominanceInfo domInfo(func);
+  if (!body.hasOneBlock()) {
+    CFGLoopInfo loopInfo(domInfo.getDomTree(&body));
+    for (Operation *op : resolveOps) {
+      Block *target = hoistTarget(op->getBlock(), loopInfo, domInfo);
+      if (target != op->getBlock())
+        op->moveBefore(target->getTerminator());
+    }
+  }
+  // Dominance is a strict order, so the outermost op of each chain of
+  // equivalent ones survives and takes over the uses of the rest.
+  llvm::SmallPtrSet<Operation *, 8> erased;
+  for (Operation *op : resolveOps) {
+    for (Operation *candidate : resolveOps) {
+      if (candidate == op || erased.contains(candidate) ||
+          !OperationEquivalence::isEquivalentTo(
+              op, candidate, OperationEquivalence::IgnoreLocations) ||
+          !domInfo.properlyDominates(candidate, op))
+        continue;
+      op->replaceAllUsesWith(candidate);
+      erased.insert(op);
+      op->erase();
+      break;
+    }
+  }
+}
+
+// x * (x + 1) is always even. x is opaque, so nothing can prove it.
+static Value lowerOpaquePred(OpBuilder &builder, OpaquePredOp op,
+                             uint32_t seed) {
+  Location loc = op.getLoc();
+  auto i32Type = builder.getI32Type();
+  Value x = createOpaqueValue(
+      builder, loc,
+      builder.create<LLVM::ConstantOp>(
+          loc, i32Type, builder.getI32IntegerAttr(static_cast<int32_t>(seed))));
+  Value one = builder.create<LLVM::ConstantOp>(loc, i32Type,
+                                               builder.getI32IntegerAttr(1));
+  Value zero = builder.create<LLVM::ConstantOp>(loc, i32Type,
+                                                builder.getI32IntegerAttr(0));
+  Value xPlusOne = builder.create<LLVM::AddOp>(loc, x, one);
+  Value product = builder.create<LLVM::MulOp>(loc, x, xPlusOne);
+  Value lowBit = builder.create<LLVM::AndOp>(loc, product, one);
+  return builder.create<LLVM::ICmpOp>(
+      loc, op.getValue() ? LLVM::ICmpPredicate::eq : LLVM::ICmpPredicate::ne,
+      lowBit, zero);
+}
+
+static Value lowerEncodedConst(OpBuilder &builder, EncodedConstOp op) {
+  Location loc = op.getLoc();
+  Type type = op.getType();
+  Value encoded = createOpaqueValue(
+      builder, loc,
+      builder.create<LLVM::ConstantOp>(loc, type, op.getValueAttr()));
+  Value key = builder.create<LLVM::ConstantOp>(loc, type, op.getKeyAttr());
+  return builder.create<LLVM::XOrOp>(loc, encoded, key);
+}
+
+// One `__obfs_decrypt_once_<global>` helper per global. Its state word is
+// 0 while encrypted, 1 while a thread decrypts and 2 once done. The thread
+// whose cmpxchg takes it from 0 to 1 decrypts and publishes 2 with release
+// ordering; everyone else waits for 2 with acquire loads, so the plaintext
+// is visible before the address is returned.
+static LLVM::LLVMFuncOp getOrCreateDecryptOnce(ModuleOp module,
+                                               OpBuilder &builder,
+                                               DecryptOp op) {
+  std::string name = ("__obfs_decrypt_once_" + op.getGlobal()).str();
+  if (auto existing = module.lookupSymbol<LLVM::LLVMFuncOp>(name))
+    return existing;
+
+  MLIRContext *ctx = module.getContext();
+  Location loc = op.getLoc();
+  auto ptrType = LLVM::LLVMPointerType::get(ctx);
+  auto i32Type = IntegerType::get(ctx, 32);
+
+  OpBuilder::InsertionGuard guard(builder);
+  builder.setInsertionPointToEnd(module.getBody());
+
+  std::string stateName = ("__obfs_dstate_" + op.getGlobal()).str();
+  builder.create<LLVM::GlobalOp>(loc, i32Type, false, LLVM::Linkage::Internal,
+                                 stateName, builder.getI32IntegerAttr(0));
+
+  auto funcType = LLVM::LLVMFunctionType::get(ptrType, {}, false);
+  auto func = builder.create<LLVM::LLVMFuncOp>(loc, name, funcType,
+                                               LLVM::Linkage::Internal);
+  func.setNoInline(true);
+
+  Block *entry = func.addEntryBlock(builder);
+  Block *claim = func.addBlock();
+  Block *decrypt = func.addBlock();
+  Block *wait = func.addBlock();
+  Block *done = func.addBlock();
+
+  auto loadState = [&](Value stateAddr) {
+    auto load = builder.create<LLVM::LoadOp>(loc, i32Type, stateAddr);
+    load.setOrdering(LLVM::AtomicOrdering::acquire);
+    load.setAlignment(4);
+    return load.getResult();
+  };
+
+  builder.setInsertionPointToStart(entry);
+  Value stateAddr = builder.create<LLVM::AddressOfOp>(loc, ptrType, stateName);
+  Value encrypted = builder.create<LLVM::ConstantOp>(
+      loc, i32Type, builder.getI32IntegerAttr(0));
+  Value decrypting = builder.create<LLVM::ConstantOp>(
+      loc, i32Type, builder.getI32IntegerAttr(1));
+  Value decrypted = builder.create<LLVM::ConstantOp>(
+      loc, i32Type, builder.getI32IntegerAttr(2));
+  Value isDone = builder.create<LLVM::ICmpOp>(
+      loc, LLVM::ICmpPredicate::eq, loadState(stateAddr), decrypted);
+  builder.create<LLVM::CondBrOp>(loc, isDone, done, claim);
+
+  builder.setInsertionPointToStart(claim);
+  Value exchange = builder.create<LLVM::AtomicCmpXchgOp>(
+      loc, stateAddr, encrypted, decrypting, LLVM::AtomicOrdering::acq_rel,
+      LLVM::AtomicOrdering::acquire);
+  Value won = builder.create<LLVM::ExtractValueOp>(loc, exchange,
+                                                   ArrayRef<int64_t>{1});
+  builder.create<LLVM::CondBrOp>(loc, won, decrypt, wait);
+
+  builder.setInsertionPointToStart(decrypt);
+  Value globalAddr =
+      builder.create<LLVM::AddressOfOp>(loc, ptrType, op.getGlobal());
+  Value length = builder.create<LLVM::ConstantOp>(
+      loc, i32Type, builder.getI32IntegerAttr(op.getLength()));
+  builder.create<LLVM::CallOp>(loc, TypeRange{}, "__obfs_decrypt",
+                               ValueRange{globalAddr, length});
+  auto publish = builder.create<LLVM::StoreOp>(loc, decrypted, stateAddr);
+  publish.setOrdering(LLVM::AtomicOrdering::release);
+  publish.setAlignment(4);
+  builder.create<LLVM::BrOp>(loc, ValueRange{}, done);
+
+  // Another thread is decrypting; decryption is short, so spin
+  builder.setInsertionPointToStart(wait);
+  Value nowDone = builder.create<LLVM::ICmpOp>(
+      loc, LLVM::ICmpPredicate::eq, loadState(stateAddr), decrypted);
+  builder.create<LLVM::CondBrOp>(loc, nowDone, done, wait);
+
+  builder.setInsertionPointToStart(done);
+  Value result =
+      builder.create<LLVM::AddressOfOp>(loc, ptrType, op.getGlobal());
+  builder.create<LLVM::ReturnOp>(loc, result);
+  return func;
+}
+
+} // namespace
+
+void LowerObsPass::getDependentDialects(DialectRegistry &registry) const {
+  registry.insert<ObsDialect, LLVM::LLVMDialect>();
+}
+
+void LowerObsPass::runOnOperation() {
+  ModuleOp module = getOperation();
+  MLIRContext *ctx = &getContext();
+
+  SmallVector<FunctionOpInterface> funcs(
+      module.getOps<FunctionOpInterface>());
+
+  // Functions are hoisted, collected and lowered one per task on the
+  // context's thread pool. Only the decrypt-once helpers are module-level;
+  // they are created in between, serially, in the order of first use.
+  SmallVector<SmallVector<Operation *>> obsOpsPerFunc(funcs.size());
+  parallelFor(ctx, 0, funcs.size(), [&](size_t i) {
+    FunctionOpInterface func = funcs[i];
+    hoistAndDedup(func);
+    func->walk([&](Operation *op) {
+      if (isa_and_nonnull<ObsDialect>(op->getDialect()))
+        obsOpsPerFunc[i].push_back(op);
+    });
+  });
+  // obs ops outside the functions, e.g. in a global initializer
+  SmallVector<Operation *> moduleObsOps;
+  for (Operation &top : module.getBody()->getOperations()) {
+    if (isa<FunctionOpInterface>(top))
+      continue;
+    top.walk([&](Operation *op) {
+      if (isa_and_nonnull<ObsDialect>(op->getDialect()))
+        moduleObsOps.push_back(op);
+    });
+  }
+
+  // Module-level, so created serially, in the order the helpers are used
+  SmallVector<DecryptOp> decrypts;
+  auto collectDecrypts = [&](ArrayRef<Operation *> ops) {
+    for (Operation *op : ops) {
+      auto decrypt = dyn_cast<DecryptOp>(op);
+      if (decrypt && decrypt.getLength() != 0)
+        decrypts.push_back(decrypt);
+    }
+  };
+  for (ArrayRef<Operation *> ops : obsOpsPerFunc)
+    collectDecrypts(ops);
+  collectDecrypts(moduleObsOps);
+
+  if (!decrypts.empty() &&
+      !module.lookupSymbol<LLVM::LLVMFuncOp>("__obfs_decrypt")) {
+    module.emitError("obs.decrypt requires __obfs_decrypt; run string-encrypt "
+                     "or constant-obfuscate before obs-lower");
+    return signalPassFailure();
+  }
+  OpBuilder helperBuilder(ctx);
+  llvm::StringMap<LLVM::LLVMFuncOp> decryptHelpers;
+  for (DecryptOp decrypt : decrypts) {
+    if (!decryptHelpers.count(decrypt.getGlobal()))
+      decryptHelpers[decrypt.getGlobal()] =
+          getOrCreateDecryptOnce(module, helperBuilder, decrypt);
+  }
+
+  // Reads decryptHelpers only; every task writes inside its own function
+  auto lowerAll = [&](ArrayRef<Operation *> ops) -> LogicalResult {
+    OpBuilder builder(ctx);
+    for (Operation *op : ops) {
+      builder.setInsertionPoint(op);
+      Value lowered;
+      if (auto pred = dyn_cast<OpaquePredOp>(op)) {
+        auto func = op->getParentOfType<FunctionOpInterface>();
+        lowered = lowerOpaquePred(builder, pred,
+                                  hashName(func ? func.getName() : ""));
+        ++numPredicates;
+      } else if (auto encoded = dyn_cast<EncodedConstOp>(op)) {
+        lowered = lowerEncodedConst(builder, encoded);
+        ++numConstants;
+      } else if (auto decrypt = dyn_cast<DecryptOp>(op)) {
+        // Nothing to decrypt, as canonicalize would have folded it
+        if (decrypt.getLength() == 0) {
+          lowered = builder.create<LLVM::AddressOfOp>(
+              op->getLoc(), decrypt.getType(), decrypt.getGlobal());
+        } else {
+          LLVM::LLVMFuncOp helper = decryptHelpers.lookup(decrypt.getGlobal());
+          lowered =
+              builder.create<LLVM::CallOp>(op->getLoc(), helper, ValueRange{})
+                  .getResult();
+        }
+      } else if (auto resolve = dyn_cast<ResolveImportOp>(op)) {
+        lowered = builder
+                      .create<LLVM::CallOp>(op->getLoc(),
+                                            TypeRange{resolve.getType()},
+                                            resolve.getResolver(), ValueRange{})
+                      .getResult();
+      } else {
+        return op->emitOpError("has no lowering");
+      }
+      op->getResult(0).replaceAllUsesWith(lowered);
+      op->erase();
+      ++numLowered;
+    }
+    return success();
+  };
+  if (failed(failableParallelForEach(ctx, obsOpsPerFunc, lowerAll)) ||
+      failed(lowerAll(moduleObsOps)))
+    return signalPassFailure();
+}
+
+std::unique_ptr<Pass> mlir::obs::createLowerObsPass() {
+  return std::make_unique<LowerObsPass>();
+}
@@ -0,0 +1,105 @@
+#include "Obfuscator/ObsDialect.h"
+
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/OpImplementation.h"
+#include "mlir/IR/PatternMatch.h"
+
+using namespace mlir;
+using namespace mlir::obs;
+
+#include "Obfuscator/ObsOpsDialect.cpp.inc"
+
+void ObsDialect::initialize() {
+  addOperations<
+#define GET_OP_LIST
+#include "Obfuscator/ObsOps.cpp.inc"
+      >();
+}
+
+// Folded obs.encoded_const results become plain LLVM constants; everything
+// downstream of the producers is LLVM dialect anyway.
+Operation *ObsDialect::materializeConstant(OpBuilder &builder, Attribute value,
+                                           Type type, Location loc) {
+  if (!isa<IntegerAttr>(value))
+    return nullptr;
+  return builder.create<LLVM::ConstantOp>(loc, type, value);
+}
+
+//===----------------------------------------------------------------------===//
+// EncodedConstOp
+//===----------------------------------------------------------------------===//
+
+LogicalResult EncodedConstOp::verify() {
+  Type type = getResult().getType();
+  if (getValueAttr().getType() != type || getKeyAttr().getType() != type)
+    return emitOpError("value and key must have the result type ") << type;
+  return success();
+}
+
+OpFoldResult EncodedConstOp::fold(FoldAdaptor adaptor) {
+  if (getKeyAttr().getValue().isZero())
+    return getValueAttr();
+  return {};
+}
+
+//===----------------------------------------------------------------------===//
+// DecryptOp
+//===----------------------------------------------------------------------===//
+
+LogicalResult DecryptOp::verify() {
+  if (!isa<LLVM::LLVMPointerType>(getResult().getType()))
+    return emitOpError("result must be an !llvm.ptr");
+  return success();
+}
+
+LogicalResult
+DecryptOp::verifySymbolUses(SymbolTableCollection &symbolTable) {
+  auto global = symbolTable.lookupNearestSymbolFrom<LLVM::GlobalOp>(
+      *this, getGlobalAttr());
+  if (!global)
+    return emitOpError("'") << getGlobal()
+                            << "' does not reference an llvm.mlir.global";
+  // Decrypted in place, so it must be writable
+  if (global.getConstant() && getLength() != 0)
+    return emitOpError("'") << getGlobal() << "' is constant";
+  return success();
+}
+
+// Nothing to decrypt: the plaintext is the global itself.
+LogicalResult DecryptOp::canonicalize(DecryptOp op, PatternRewriter &rewriter) {
+  if (op.getLength() != 0)
+    return failure();
+  rewriter.replaceOpWithNewOp<LLVM::AddressOfOp>(op, op.getType(),
+                                                 op.getGlobal());
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// ResolveImportOp
+//===----------------------------------------------------------------------===//
+
+LogicalResult ResolveImportOp::verify() {
+  if (!isa<LLVM::LLVMPointerType>(getResult().getType()))
+    return emitOpError("result must be an !llvm.ptr");
+  return success();
+}
+
+LogicalResult
+ResolveImportOp::verifySymbolUses(SymbolTableCollection &symbolTable) {
+  auto resolver = symbolTable.lookupNearestSymbolFrom<LLVM::LLVMFuncOp>(
+      *this, getResolverAttr());
+  if (!resolver)
+    return emitOpError("'") << getResolver()
+                            << "' does not reference an llvm.func";
+  LLVM::LLVMFunctionType type = resolver.getFunctionType();
+  if (type.getNumParams() != 0 ||
+      !isa<LLVM::LLVMPointerType>(type.getReturnType()))
+    return emitOpError("resolver '")
+           << getResolver() << "' must have type !llvm.func<ptr ()>";
+  return success();
+}
+
+#define GET_OP_CLASSES
+#include "Obfuscator/ObsOps.cpp.inc"
@@ -0,0 +1,22 @@
+#include "Obfuscator/OpaqueValue.h"
+
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+using namespace mlir;
+using namespace mlir::obs;
+
+Value mlir::obs::createOpaqueValue(OpBuilder &builder, Location loc,
+                                   Value value) {
+  NamedAttrList attrs;
+  attrs.append("asm_string", builder.getStringAttr(""));
+  attrs.append("constraints", builder.getStringAttr("=r,0"));
+  auto asmOp = builder.create<LLVM::InlineAsmOp>(
+      loc, TypeRange{value.getType()}, ValueRange{value}, attrs.getAttrs());
+  asmOp->setAttr(kOpaqueAttrName, builder.getUnitAttr());
+  return asmOp.getResult(0);
+}
+
+bool mlir::obs::isOpaqueValue(Operation *op) {
+  return op && op->hasAttr(kOpaqueAttrName) && llvm::isa<LLVM::InlineAsmOp>(op);
+}
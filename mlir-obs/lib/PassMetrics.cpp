@@ -0,0 +1,109 @@
+#include "Obfuscator/PassMetrics.h"
+
+#include "llvm/IR/Function.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir::obs;
+
+void IRCounts::addInstruction(llvm::StringRef opcode) {
+  // MLIR spells a few of these differently from LLVM
+  if (opcode == "cond_br")
+    opcode = "br";
+  else if (opcode == "return")
+    opcode = "ret";
+  else if (opcode == "invoke")
+    opcode = "call";
+  ++instructions;
+  size_t last = kCostClasses.size() - 1;
+  for (size_t i = 0; i < last; ++i) {
+    if (opcode == kCostClasses[i]) {
+      ++costClasses[i];
+      return;
+    }
+  }
+  ++costClasses[last];
+}
+
+IRCounts &IRCounts::operator+=(const IRCounts &other) {
+  functions += other.functions;
+  instructions += other.instructions;
+  blocks += other.blocks;
+  edges += other.edges;
+  calls += other.calls;
+  globals += other.globals;
+  for (size_t i = 0; i < costClasses.size(); ++i)
+    costClasses[i] += other.costClasses[i];
+  return *this;
+}
+
+IRCounts &IRCounts::operator-=(const IRCounts &other) {
+  functions -= other.functions;
+  instructions -= other.instructions;
+  blocks -= other.blocks;
+  edges -= other.edges;
+  calls -= other.calls;
+  globals -= other.globals;
+  for (size_t i = 0; i < costClasses.size(); ++i)
+    costClasses[i] -= other.costClasses[i];
+  return *this;
+}
+
+IRCounts mlir::obs::operator-(IRCounts lhs, const IRCounts &rhs) {
+  lhs -= rhs;
+  return lhs;
+}
+
+llvm::json::Object IRCounts::toJSON() const {
+  llvm::json::Object opcodes;
+  for (size_t i = 0; i < costClasses.size(); ++i)
+    opcodes[kCostClasses[i]] = costClasses[i];
+  return llvm::json::Object{{"functions", functions}, {"instructions", instructions},
+                            {"blocks", blocks},       {"edges", edges},
+                            {"calls", calls},         {"globals", globals},
+                            {"opcodes", std::move(opcodes)}};
+}
+
+IRCounts mlir::obs::countFunction(const llvm::Function &function) {
+  IRCounts counts;
+  if (function.isDeclaration())
+    return counts;
+  counts.functions = 1;
+  counts.blocks = function.size();
+  for (const llvm::BasicBlock &block : function) {
+    for (const llvm::Instruction &inst : block) {
+      counts.addInstruction(inst.getOpcodeName());
+      if (llvm::isa<llvm::CallBase>(inst))
+        ++counts.calls;
+    }
+    if (const llvm::Instruction *terminator = block.getTerminator())
+      counts.edges += terminator->getNumSuccessors();
+  }
+  return counts;
+}
+
+void PassMetricsTimeline::add(llvm::StringRef pass, const IRCounts &counts) {
+  snapshots.emplace_back(pass.str(), counts);
+}
+
+llvm::json::Value PassMetricsTimeline::toJSON() const {
+  llvm::json::Array array;
+  for (const auto &snapshot : snapshots) {
+    llvm::json::Object object = snapshot.second.toJSON();
+    object["pass"] = snapshot.first;
+    array.push_back(std::move(object));
+  }
+  return llvm::json::Object{{"stage", stage}, {"snapshots", std::move(array)}};
+}
+
+std::string PassMetricsTimeline::write(llvm::StringRef path) const {
+  std::error_code error;
+  llvm::raw_fd_ostream os(path, error, llvm::sys::fs::OF_Text);
+  if (error)
+    return error.message();
+  os << llvm::formatv("{0:2}", toJSON()) << "\n";
+  return "";
+}
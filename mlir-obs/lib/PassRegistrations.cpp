@@ -1,5 +1,8 @@
 #include "Obfuscator/Passes.h"
+#include "Obfuscator/ObsDialect.h"
+#include "CIR/Passes.h"
 #include "mlir/Pass/Pass.h"
+#include "mlir/Tools/Plugins/DialectPlugin.h"
 #include "mlir/Tools/Plugins/PassPlugin.h"
 
 namespace mlir {
@@ -35,6 +38,14 @@ void registerConstantObfuscationPass() {
   PassRegistration<ConstantObfuscationPass>();
 }
 
+void registerConstantEncodePass() {
+  PassRegistration<ConstantEncodePass>();
+}
+
+void registerFusedObfuscatePass() {
+  PassRegistration<FusedObfuscatePass>();
+}
+
 void registerSCFObfuscatePass() {
   PassRegistration<SCFObfuscatePass>();
 }
@@ -43,6 +54,80 @@ void registerImportObfuscationPass() {
   PassRegistration<ImportObfuscationPass>();
 }
 
+void registerFunctionMergePass() {
+  PassRegistration<FunctionMergePass>();
+}
+
+void registerHotnessPass() {
+  PassRegistration<HotnessPass>();
+}
+
+void registerAddressObfuscationPass() {
+  PassRegistration<AddressObfuscationPass>();
+}
+
+void registerIndirectCallTablePass() {
+  PassRegistration<IndirectCallTablePass>();
+}
+
+void registerIndirectCallPass() {
+  PassRegistration<IndirectCallPass>();
+}
+
+void registerFakeLoopPlanPass() {
+  PassRegistration<FakeLoopPlanPass>();
+}
+
+void registerFakeLoopPass() {
+  PassRegistration<FakeLoopPass>();
+}
+
+void registerAntiDebugPass() {
+  PassRegistration<AntiDebugPass>();
+}
+
+void registerProfileTierPass() {
+  PassRegistration<ProfileTierPass>();
+}
+
+void registerFunctionPolicyPass() {
+  PassRegistration<FunctionPolicyPass>();
+}
+
+void registerSizeBudgetPass() {
+  PassRegistration<SizeBudgetPass>();
+}
+
+void registerLowerObsPass() {
+  PassRegistration<LowerObsPass>();
+}
+
+void registerObfuscationPasses() {
+  registerStringEncryptPass();
+  registerSymbolObfuscatePass();
+  registerCryptoHashPass();
+  registerConstantObfuscationPass();
+  registerConstantEncodePass();
+  registerFusedObfuscatePass();
+  registerSCFObfuscatePass();
+  registerImportObfuscationPass();
+  registerFunctionMergePass();
+  registerHotnessPass();
+  registerAddressObfuscationPass();
+  registerIndirectCallTablePass();
+  registerIndirectCallPass();
+  registerFakeLoopPlanPass();
+  registerFakeLoopPass();
+  registerAntiDebugPass();
+  registerProfileTierPass();
+  registerFunctionPolicyPass();
+  registerSizeBudgetPass();
+  registerLowerObsPass();
+  // CIR ops are matched by name, so the input only needs
+  // --allow-unregistered-dialect when ClangIR is not loaded
+  cir::registerCIRPasses();
+}
+
 }
 }
 
@@ -50,11 +135,16 @@ extern "C" LLVM_ATTRIBUTE_WEAK ::mlir::PassPluginLibraryInfo
 mlirGetPassPluginInfo() {
   return {MLIR_PLUGIN_API_VERSION, "MLIRObfuscation", LLVM_VERSION_STRING,
           []() {
-            mlir::obs::registerStringEncryptPass();
-            mlir::obs::registerSymbolObfuscatePass();
-            mlir::obs::registerCryptoHashPass();
-            mlir::obs::registerConstantObfuscationPass();
-            mlir::obs::registerSCFObfuscatePass();
-            mlir::obs::registerImportObfuscationPass();
+            mlir::obs::registerObfuscationPasses();
+          }};
+}
+
+// Lets `mlir-opt --load-dialect-plugin` parse IR that still contains obs ops
+// (e.g. output of a pipeline that stopped before obs-lower).
+extern "C" LLVM_ATTRIBUTE_WEAK ::mlir::DialectPluginLibraryInfo
+mlirGetDialectPluginInfo() {
+  return {MLIR_PLUGIN_API_VERSION, "ObsDialect", LLVM_VERSION_STRING,
+          [](::mlir::DialectRegistry *registry) {
+            registry->insert<mlir::obs::ObsDialect>();
           }};
 }
@@ -0,0 +1,210 @@
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/Hotness.h"
+#include "Obfuscator/ProfileTiers.h"
+
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+// Execution count of the hottest block: the entry count, or the sum of the
+// branch_weights on any terminator (clang's PGO weights are raw counts).
+static uint64_t peakCount(LLVM::LLVMFuncOp func) {
+  uint64_t peak = func.getFunctionEntryCount().value_or(0);
+  for (Block &block : func.getBody()) {
+    Operation *term = block.getTerminator();
+    auto weights = term->getAttrOfType<DenseI32ArrayAttr>("branch_weights");
+    if (!weights)
+      continue;
+    uint64_t total = 0;
+    for (int32_t w : weights.asArrayRef())
+      total += static_cast<uint32_t>(w);
+    peak = std::max(peak, total);
+  }
+  return peak;
+}
+
+static bool isPolicy(StringRef policy) {
+  return policy == "none" || policy == "cheap" || policy == "full";
+}
+
+static bool isSource(StringRef source) {
+  return source == "profile" || source == "static" || source == "auto";
+}
+
+} // namespace
+
+StringRef mlir::obs::stringifyTier(Tier tier) {
+  switch (tier) {
+  case Tier::Hot:
+    return "hot";
+  case Tier::Warm:
+    return "warm";
+  case Tier::Cold:
+    return "cold";
+  }
+  llvm_unreachable("unknown tier");
+}
+
+SmallVector<Tier> mlir::obs::classifyByShare(ArrayRef<double> weights,
+                                             double hotPercent,
+                                             double warmPercent) {
+  SmallVector<unsigned> order(weights.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+    return weights[a] > weights[b];
+  });
+
+  double total = 0.0;
+  for (double weight : weights)
+    total += weight;
+
+  // An entry belongs to the tier its own weight starts in, so the one that
+  // crosses the hot-percent line is still hot.
+  SmallVector<Tier> tiers(weights.size(), Tier::Cold);
+  double covered = 0.0;
+  for (unsigned index : order) {
+    double before = total > 0.0 ? 100.0 * covered / total : 100.0;
+    covered += weights[index];
+    if (weights[index] > 0.0 && before < hotPercent)
+      tiers[index] = Tier::Hot;
+    else if (weights[index] > 0.0 && before < warmPercent)
+      tiers[index] = Tier::Warm;
+  }
+  return tiers;
+}
+
+static Operation *getEnclosingFunction(Operation *op) {
+  return isa<FunctionOpInterface>(op)
+             ? op
+             : op->getParentOfType<FunctionOpInterface>();
+}
+
+StringRef mlir::obs::getFunctionPolicy(Operation *op) {
+  Operation *func = getEnclosingFunction(op);
+  if (!func)
+    return {};
+  auto policy = func->getAttrOfType<StringAttr>(kPolicyAttrName);
+  return policy ? policy.getValue() : StringRef();
+}
+
+// Whether a none/cheap/full limit admits `cost`; Free always fits.
+static bool limitAllows(StringAttr limit, TransformCost cost) {
+  if (cost == TransformCost::Free || !limit || limit.getValue() == "full")
+    return true;
+  if (limit.getValue() == "cheap")
+    return cost == TransformCost::Cheap;
+  return false;
+}
+
+bool mlir::obs::isTransformAllowed(Operation *op, TransformCost cost) {
+  Operation *func = getEnclosingFunction(op);
+  if (!func)
+    return true;
+
+  if (!limitAllows(func->getAttrOfType<StringAttr>(kBudgetLimitAttrName), cost))
+    return false;
+
+  StringRef policy = getFunctionPolicy(func);
+  if (policy == "none")
+    return false;
+  if (policy == "light")
+    return cost != TransformCost::Full;
+  if (policy == "max")
+    return true;
+
+  return limitAllows(func->getAttrOfType<StringAttr>(kTransformLimitAttrName),
+                     cost);
+}
+
+void ProfileTierPass::runOnOperation() {
+  ModuleOp module = getOperation();
+  MLIRContext *ctx = &getContext();
+
+  if (!isPolicy(hotPolicy) || !isPolicy(warmPolicy)) {
+    module.emitError() << "profile-tiers: policies must be none, cheap or full";
+    return signalPassFailure();
+  }
+  if (!isSource(source)) {
+    module.emitError() << "profile-tiers: source must be profile, static or "
+                          "auto";
+    return signalPassFailure();
+  }
+  if (hotPercent > warmPercent || warmPercent > 100) {
+    module.emitError() << "profile-tiers: expected hot-percent <= "
+                          "warm-percent <= 100";
+    return signalPassFailure();
+  }
+
+  SmallVector<LLVM::LLVMFuncOp> funcs;
+  bool profiled = false;
+  for (auto func : module.getOps<LLVM::LLVMFuncOp>()) {
+    if (func.isExternal() || func.getName().starts_with("__obfs_"))
+      continue;
+    profiled |= func.getFunctionEntryCount().has_value();
+    funcs.push_back(func);
+  }
+
+  // Without a single entry count there is no profile to act on; unless a
+  // static estimate was asked for, leave the module untouched so every pass
+  // behaves as before.
+  bool useProfile = profiled && source != "static";
+  if (!useProfile && source == "profile")
+    return;
+
+  SmallVector<double> weights;
+  if (useProfile) {
+    for (LLVM::LLVMFuncOp func : funcs)
+      weights.push_back(static_cast<double>(peakCount(func)));
+  } else {
+    auto &hotness = getAnalysis<HotnessAnalysis>();
+    for (LLVM::LLVMFuncOp func : funcs)
+      weights.push_back(hotness.getPeakFrequency(func));
+    // Only discardable attributes change below; later passes reuse the
+    // estimate instead of recomputing it.
+    markAllAnalysesPreserved();
+  }
+  module->setAttr(kTierSourceAttrName,
+                  StringAttr::get(ctx, useProfile ? "profile" : "static"));
+
+  SmallVector<Tier> tiers = classifyByShare(weights, hotPercent, warmPercent);
+  for (auto [func, tier] : llvm::zip(funcs, tiers)) {
+    StringRef limit = "full";
+    switch (tier) {
+    case Tier::Hot:
+      limit = hotPolicy;
+      ++numHot;
+      break;
+    case Tier::Warm:
+      limit = warmPolicy;
+      ++numWarm;
+      break;
+    case Tier::Cold:
+      ++numCold;
+      break;
+    }
+    func->setAttr(kTierAttrName, StringAttr::get(ctx, stringifyTier(tier)));
+    func->setAttr(kTransformLimitAttrName, StringAttr::get(ctx, limit));
+  }
+}
+
+std::unique_ptr<Pass> mlir::obs::createProfileTierPass(unsigned hotPercent,
+                                                       unsigned warmPercent,
+                                                       StringRef hotPolicy,
+                                                       StringRef warmPolicy,
+                                                       StringRef source) {
+  return std::make_unique<ProfileTierPass>(hotPercent, warmPercent, hotPolicy,
+                                           warmPolicy, source);
+}
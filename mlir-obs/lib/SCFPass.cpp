@@ -1,4 +1,7 @@
 #include "Obfuscator/Passes.h"
+#include "Obfuscator/Hotness.h"
+#include "Obfuscator/ObsDialect.h"
+#include "Obfuscator/ProfileTiers.h"
 
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/Operation.h"
@@ -7,6 +10,7 @@
 #include "mlir/Dialect/SCF/IR/SCF.h"
 #include "mlir/Dialect/Arith/IR/Arith.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/Interfaces/LoopLikeInterface.h"
 
 #include <random>
 
@@ -21,13 +25,10 @@ void insertOpaquePredicates(scf::IfOp ifOp, OpBuilder &builder) {
 
   builder.setInsertionPoint(ifOp);
 
-  auto c1 = builder.create<arith::ConstantIntOp>(loc, 1, 32);
-  auto c2 = builder.create<arith::ConstantIntOp>(loc, 2, 32);
-
-  auto mul = builder.create<arith::MulIOp>(loc, c1, c2);
-  auto div = builder.create<arith::DivSIOp>(loc, mul, c2);
-  auto opaquePred = builder.create<arith::CmpIOp>(
-      loc, arith::CmpIPredicate::eq, div, c1);
+  // Kept as obs.opaque_pred so CSE/LICM can share one predicate per
+  // region; obs-lower expands it behind an opaque barrier.
+  Value opaquePred = builder.create<OpaquePredOp>(loc, builder.getI1Type(),
+                                                  builder.getBoolAttr(true));
 
   auto newCond = builder.create<arith::AndIOp>(loc, condition, opaquePred);
 
@@ -39,23 +40,40 @@ void obfuscateLoop(scf::ForOp forOp, OpBuilder &builder) {
 
 }
 
-void SCFObfuscatePass::runOnOperation() {
-  ModuleOp module = getOperation();
-  MLIRContext *ctx = module.getContext();
-  OpBuilder builder(ctx);
+void SCFObfuscatePass::getDependentDialects(DialectRegistry &registry) const {
+  registry.insert<arith::ArithDialect, ObsDialect>();
+}
 
-  module.walk([&](scf::IfOp ifOp) {
+void SCFObfuscatePass::runOnOperation() {
+  FunctionOpInterface func = getOperation();
+  OpBuilder builder(&getContext());
+
+  // Without obs-hotness before this pass only the tier and policy apply
+  const HotnessAnalysis *hotness = nullptr;
+  if (auto cached = getCachedParentAnalysis<HotnessAnalysis>())
+    hotness = &cached->get();
+
+  func.walk([&](scf::IfOp ifOp) {
+    if (preserveLoopNests && ifOp->getParentOfType<LoopLikeOpInterface>())
+      return;
+    if (!isTransformAllowed(ifOp, TransformCost::Full) ||
+        (hotness && !hotness->allows(ifOp, TransformCost::Full)))
+      return;
     insertOpaquePredicates(ifOp, builder);
+    ++numPredicates;
   });
 
-  module.walk([&](scf::ForOp forOp) {
+  if (preserveLoopNests)
+    return;
+
+  func.walk([&](scf::ForOp forOp) {
     obfuscateLoop(forOp, builder);
   });
 
-  module.walk([&](scf::WhileOp whileOp) {
+  func.walk([&](scf::WhileOp whileOp) {
   });
 }
 
-std::unique_ptr<Pass> mlir::obs::createSCFObfuscatePass() {
-  return std::make_unique<SCFObfuscatePass>();
+std::unique_ptr<Pass> mlir::obs::createSCFObfuscatePass(bool preserveLoopNests) {
+  return std::make_unique<SCFObfuscatePass>(preserveLoopNests);
 }
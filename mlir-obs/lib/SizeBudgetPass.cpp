@@ -0,0 +1,100 @@
+#include "Obfuscator/Hotness.h"
+#include "Obfuscator/Passes.h"
+#include "Obfuscator/ProfileTiers.h"
+
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/Dialect/LLVMIR/LLVMDialect.h"
+
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include <string>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+namespace {
+
+// Allowed OLLVM passes, comma-separated; the CLI's OLLVM stage reads it
+// back from the translated IR after symbol-obfuscate renamed functions.
+constexpr llvm::StringLiteral kOllvmPassthrough = "obf-budget-ollvm";
+
+static bool isLimit(StringRef limit) {
+  return limit == "none" || limit == "cheap" || limit == "full";
+}
+
+} // namespace
+
+void SizeBudgetPass::runOnOperation() {
+  ModuleOp module = getOperation();
+  MLIRContext *ctx = &getContext();
+
+  if (planFile.empty())
+    return;
+
+  auto buffer = llvm::MemoryBuffer::getFile(planFile, /*IsText=*/true);
+  if (!buffer) {
+    module.emitError() << "size-budget: cannot read '" << planFile
+                       << "': " << buffer.getError().message();
+    return signalPassFailure();
+  }
+  llvm::Expected<llvm::json::Value> plan =
+      llvm::json::parse((*buffer)->getBuffer());
+  if (!plan) {
+    module.emitError() << "size-budget: " << planFile << ": "
+                       << llvm::toString(plan.takeError());
+    return signalPassFailure();
+  }
+  const llvm::json::Object *root = plan->getAsObject();
+  const llvm::json::Object *functions =
+      root ? root->getObject("functions") : nullptr;
+  if (!functions) {
+    module.emitError() << "size-budget: " << planFile
+                       << ": expected a \"functions\" object";
+    return signalPassFailure();
+  }
+
+  WalkResult result = module.walk([&](FunctionOpInterface func) {
+    if (func.isExternal())
+      return WalkResult::advance();
+
+    StringRef limit = "none";
+    SmallVector<StringRef> ollvm;
+    if (const llvm::json::Object *entry = functions->getObject(func.getName())) {
+      if (std::optional<StringRef> planned = entry->getString("limit"))
+        limit = *planned;
+      if (const llvm::json::Array *passes = entry->getArray("ollvm")) {
+        for (const llvm::json::Value &pass : *passes) {
+          if (std::optional<StringRef> name = pass.getAsString())
+            ollvm.push_back(*name);
+        }
+      }
+    }
+    if (!isLimit(limit)) {
+      func.emitError() << "size-budget: limit must be none, cheap or full";
+      return WalkResult::interrupt();
+    }
+
+    func->setAttr(kBudgetLimitAttrName, StringAttr::get(ctx, limit));
+    if (auto llvmFunc = dyn_cast<LLVM::LLVMFuncOp>(func.getOperation()))
+      setPassthroughString(llvmFunc, kOllvmPassthrough, llvm::join(ollvm, ","));
+    if (limit == "none")
+      ++numNone;
+    else if (limit == "cheap")
+      ++numCheap;
+    else
+      ++numFull;
+    return WalkResult::advance();
+  });
+  if (result.wasInterrupted())
+    signalPassFailure();
+}
+
+std::unique_ptr<Pass> mlir::obs::createSizeBudgetPass(StringRef planFile) {
+  return std::make_unique<SizeBudgetPass>(planFile);
+}
@@ -0,0 +1,229 @@
+#include "Obfuscator/StringEncryption.h"
+#include "Obfuscator/OpaqueValue.h"
+
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/BuiltinAttributes.h"
+#include "mlir/IR/BuiltinTypes.h"
+
+using namespace mlir;
+using namespace mlir::obs;
+
+static std::string xorEncrypt(StringRef input, StringRef key) {
+  std::string out = input.str();
+  for (size_t i = 0; i < input.size(); i++) {
+    out[i] = input[i] ^ key[i % key.size()];
+  }
+  return out;
+}
+
+StringEncryptor::StringEncryptor(ModuleOp module, StringRef key)
+    : module(module), key(key.str()) {
+  keyGlobal = module.lookupSymbol<LLVM::GlobalOp>("__obfs_key");
+  decryptFunc = module.lookupSymbol<LLVM::LLVMFuncOp>("__obfs_decrypt");
+  initFunc = module.lookupSymbol<LLVM::LLVMFuncOp>("__obfs_init");
+
+  // Strings must be decryptable with the key already in the module
+  if (keyGlobal) {
+    if (auto existing = llvm::dyn_cast_or_null<StringAttr>(keyGlobal.getValueOrNull()))
+      this->key = existing.getValue().str();
+  }
+  if (initFunc) {
+    initFunc.walk([&](LLVM::AddressOfOp addr) {
+      alreadyDecrypted.insert(addr.getGlobalName());
+    });
+  }
+}
+
+bool StringEncryptor::isCandidate(LLVM::GlobalOp globalOp) const {
+  StringRef symName = globalOp.getSymName();
+
+  if (symName.starts_with("__obfs_") || symName.starts_with("llvm."))
+    return false;
+
+  if (symName.starts_with("__cxx_global_var_init") ||
+      symName.starts_with("_GLOBAL__sub_I_") ||
+      symName.starts_with("__cxx_global_array_dtor") ||
+      symName.starts_with("__dtor_") ||
+      symName.starts_with("__ctor_") ||
+      symName.starts_with("GCC_except_table") ||
+      symName.starts_with("__func__") ||
+      symName.starts_with("__PRETTY_FUNCTION__") ||
+      symName.starts_with("__FUNCTION__"))
+    return false;
+
+  if (globalOp.getSection().has_value())
+    return false;
+
+  if (alreadyDecrypted.contains(symName))
+    return false;
+
+  auto stringAttr = llvm::dyn_cast_or_null<StringAttr>(globalOp.getValueOrNull());
+  return stringAttr && stringAttr.getValue().size() >= 2;
+}
+
+bool StringEncryptor::encrypt(LLVM::GlobalOp globalOp) {
+  if (!isCandidate(globalOp))
+    return false;
+
+  StringRef original = llvm::cast<StringAttr>(globalOp.getValueOrNull()).getValue();
+  globalOp.setValueAttr(StringAttr::get(module.getContext(), xorEncrypt(original, key)));
+  globalOp.setConstant(false);
+
+  encrypted.push_back({globalOp.getSymName().str(), original.size()});
+  alreadyDecrypted.insert(globalOp.getSymName());
+  numEncrypted++;
+  bytesEncrypted += original.size();
+  return true;
+}
+
+void StringEncryptor::finalize() {
+  if (encrypted.empty())
+    return;
+
+  MLIRContext *ctx = module.getContext();
+  OpBuilder builder(ctx);
+  builder.setInsertionPointToStart(module.getBody());
+  Location loc = module.getLoc();
+
+  auto i8Type = IntegerType::get(ctx, 8);
+  auto i32Type = IntegerType::get(ctx, 32);
+  auto i64Type = IntegerType::get(ctx, 64);
+  auto i8PtrType = LLVM::LLVMPointerType::get(ctx);
+  auto voidType = LLVM::LLVMVoidType::get(ctx);
+
+  if (!keyGlobal) {
+    auto keyArrayType = LLVM::LLVMArrayType::get(i8Type, key.size());
+    keyGlobal = builder.create<LLVM::GlobalOp>(
+        loc,
+        keyArrayType,
+        true,
+        LLVM::Linkage::Private,
+        "__obfs_key",
+        builder.getStringAttr(key)
+    );
+    keyGlobal.setUnnamedAddr(LLVM::UnnamedAddr::Global);
+  }
+
+  if (!decryptFunc) {
+    auto funcType = LLVM::LLVMFunctionType::get(voidType, {i8PtrType, i32Type}, false);
+    decryptFunc = builder.create<LLVM::LLVMFuncOp>(
+        loc, "__obfs_decrypt", funcType, LLVM::Linkage::Internal);
+    decryptFunc.setNoInline(true);
+
+    Block *entryBlock = decryptFunc.addEntryBlock(builder);
+    builder.setInsertionPointToStart(entryBlock);
+
+    Value strPtr = entryBlock->getArgument(0);
+    Value len = entryBlock->getArgument(1);
+    // Opaque so the recovery pipeline / global ctor evaluator cannot
+    // decrypt the strings at compile time.
+    Value keyAddr = createOpaqueValue(
+        builder, loc,
+        builder.create<LLVM::AddressOfOp>(loc, i8PtrType, "__obfs_key"));
+
+    Value zero32 = builder.create<LLVM::ConstantOp>(loc, i32Type, builder.getI32IntegerAttr(0));
+    Value one32 = builder.create<LLVM::ConstantOp>(loc, i32Type, builder.getI32IntegerAttr(1));
+    Value keyLenVal = builder.create<LLVM::ConstantOp>(loc, i32Type, builder.getI32IntegerAttr(key.size()));
+
+    Value iPtr = builder.create<LLVM::AllocaOp>(loc, i8PtrType, i32Type, one32);
+    builder.create<LLVM::StoreOp>(loc, zero32, iPtr);
+
+    Block *loopCond = decryptFunc.addBlock();
+    Block *loopBody = decryptFunc.addBlock();
+    Block *loopEnd = decryptFunc.addBlock();
+
+    builder.create<LLVM::BrOp>(loc, loopCond);
+
+    builder.setInsertionPointToStart(loopCond);
+    Value i = builder.create<LLVM::LoadOp>(loc, i32Type, iPtr);
+    Value cond = builder.create<LLVM::ICmpOp>(loc, LLVM::ICmpPredicate::slt, i, len);
+    builder.create<LLVM::CondBrOp>(loc, cond, loopBody, loopEnd);
+
+    builder.setInsertionPointToStart(loopBody);
+    Value iLoad = builder.create<LLVM::LoadOp>(loc, i32Type, iPtr);
+
+    Value iExt = builder.create<LLVM::SExtOp>(loc, i64Type, iLoad);
+    Value strElemPtr = builder.create<LLVM::GEPOp>(loc, i8PtrType, i8Type, strPtr, ValueRange{iExt});
+    Value strChar = builder.create<LLVM::LoadOp>(loc, i8Type, strElemPtr);
+
+    Value keyIdx = builder.create<LLVM::SRemOp>(loc, iLoad, keyLenVal);
+    Value keyIdxExt = builder.create<LLVM::SExtOp>(loc, i64Type, keyIdx);
+    Value keyElemPtr = builder.create<LLVM::GEPOp>(loc, i8PtrType, i8Type, keyAddr, ValueRange{keyIdxExt});
+    Value keyChar = builder.create<LLVM::LoadOp>(loc, i8Type, keyElemPtr);
+
+    Value xored = builder.create<LLVM::XOrOp>(loc, strChar, keyChar);
+    builder.create<LLVM::StoreOp>(loc, xored, strElemPtr);
+
+    Value iNext = builder.create<LLVM::AddOp>(loc, iLoad, one32);
+    builder.create<LLVM::StoreOp>(loc, iNext, iPtr);
+    builder.create<LLVM::BrOp>(loc, loopCond);
+
+    builder.setInsertionPointToStart(loopEnd);
+    builder.create<LLVM::ReturnOp>(loc, ValueRange{});
+  }
+
+  // A previous run's __obfs_init gets the new strings before its return
+  if (initFunc) {
+    builder.setInsertionPoint(initFunc.getBody().back().getTerminator());
+  } else {
+    builder.setInsertionPointToEnd(module.getBody());
+    auto initFuncType = LLVM::LLVMFunctionType::get(voidType, {}, false);
+    initFunc = builder.create<LLVM::LLVMFuncOp>(
+        loc, "__obfs_init", initFuncType, LLVM::Linkage::External);
+    initFunc.setNoInline(true);
+
+    Block *entryBlock = initFunc.addEntryBlock(builder);
+    builder.setInsertionPointToStart(entryBlock);
+    auto ret = builder.create<LLVM::ReturnOp>(loc, ValueRange{});
+    builder.setInsertionPoint(ret);
+  }
+
+  for (const auto &info : encrypted) {
+    Value globalAddr = builder.create<LLVM::AddressOfOp>(loc, i8PtrType, info.name);
+    Value lenVal = builder.create<LLVM::ConstantOp>(loc, i32Type,
+                                                     builder.getI32IntegerAttr(info.length));
+    builder.create<LLVM::CallOp>(loc, TypeRange{}, "__obfs_decrypt", ValueRange{globalAddr, lenVal});
+  }
+  encrypted.clear();
+
+  LLVM::GlobalCtorsOp existingCtors = nullptr;
+  for (auto &op : module.getBody()->getOperations()) {
+    if (auto ctorsOp = llvm::dyn_cast<LLVM::GlobalCtorsOp>(&op)) {
+      existingCtors = ctorsOp;
+      break;
+    }
+  }
+
+  auto initRef = FlatSymbolRefAttr::get(ctx, "__obfs_init");
+  if (existingCtors) {
+    if (llvm::is_contained(existingCtors.getCtors(), initRef))
+      return;
+
+    SmallVector<Attribute> newCtors(existingCtors.getCtors().begin(),
+                                    existingCtors.getCtors().end());
+    SmallVector<Attribute> newPriorities(existingCtors.getPriorities().begin(),
+                                         existingCtors.getPriorities().end());
+    SmallVector<Attribute> newData;
+    if (auto dataAttr = existingCtors.getData()) {
+      for (auto attr : dataAttr)
+        newData.push_back(attr);
+    }
+
+    newCtors.push_back(initRef);
+    newPriorities.push_back(builder.getI32IntegerAttr(101));
+    newData.push_back(LLVM::ZeroAttr::get(ctx));
+
+    // Updated in place: callers may hold the op (fused-obfuscate does)
+    existingCtors.setCtorsAttr(builder.getArrayAttr(newCtors));
+    existingCtors.setPrioritiesAttr(builder.getArrayAttr(newPriorities));
+    existingCtors.setDataAttr(builder.getArrayAttr(newData));
+  } else {
+    builder.setInsertionPointToEnd(module.getBody());
+    builder.create<LLVM::GlobalCtorsOp>(
+        loc,
+        builder.getArrayAttr({initRef}),
+        builder.getArrayAttr({builder.getI32IntegerAttr(101)}),
+        builder.getArrayAttr({LLVM::ZeroAttr::get(ctx)})
+    );
+  }
+}
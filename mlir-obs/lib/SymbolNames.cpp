@@ -0,0 +1,97 @@
+#include "Obfuscator/SymbolNames.h"
+
+#include "mlir/IR/AttrTypeSubElements.h"
+#include "mlir/IR/BuiltinAttributes.h"
+
+#include <openssl/evp.h>
+#include <cstdio>
+#include <iomanip>
+#include <sstream>
+
+using namespace mlir;
+using namespace mlir::obs;
+
+std::string mlir::obs::generateObfuscatedName(std::mt19937 &rng,
+                                              llvm::StringRef prefix) {
+  std::uniform_int_distribution<uint32_t> dist(0, 0xFFFFFFFF);
+  uint32_t num = dist(rng);
+
+  char buffer[16];
+  snprintf(buffer, sizeof(buffer), "_%08x", num);
+  return prefix.str() + buffer;
+}
+
+static std::string computeDigest(const EVP_MD *md, const std::string &input,
+                                 const std::string &salt) {
+  std::string data = salt + input + salt;
+
+  unsigned char hash[EVP_MAX_MD_SIZE];
+  unsigned int hashLen = 0;
+
+  EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
+  EVP_DigestInit_ex(mdctx, md, NULL);
+  EVP_DigestUpdate(mdctx, data.c_str(), data.size());
+  EVP_DigestFinal_ex(mdctx, hash, &hashLen);
+  EVP_MD_CTX_free(mdctx);
+
+  std::stringstream ss;
+  for (unsigned int i = 0; i < hashLen; i++) {
+    ss << std::hex << std::setw(2) << std::setfill('0') << (int)hash[i];
+  }
+  return ss.str();
+}
+
+std::string mlir::obs::generateHashedName(llvm::StringRef name,
+                                          CryptoHashPass::HashAlgorithm algorithm,
+                                          llvm::StringRef salt,
+                                          unsigned hashLength) {
+  std::string fullHash;
+
+  switch (algorithm) {
+    case CryptoHashPass::HashAlgorithm::SHA256:
+    // No SipHash digest in EVP; SHA256 stands in
+    case CryptoHashPass::HashAlgorithm::SIPHASH:
+      fullHash = computeDigest(EVP_sha256(), name.str(), salt.str());
+      break;
+    case CryptoHashPass::HashAlgorithm::BLAKE2B:
+      fullHash = computeDigest(EVP_blake2b512(), name.str(), salt.str());
+      break;
+  }
+
+  return "f_" + fullHash.substr(0, hashLength);
+}
+
+static AttrTypeReplacer
+symbolReplacer(const llvm::StringMap<std::string> &renames) {
+  AttrTypeReplacer replacer;
+  replacer.addReplacement(
+      [&renames](SymbolRefAttr ref) -> std::optional<Attribute> {
+        auto it = renames.find(ref.getRootReference().getValue());
+        if (it == renames.end())
+          return std::nullopt;
+        return SymbolRefAttr::get(
+            StringAttr::get(ref.getContext(), it->second),
+            ref.getNestedReferences());
+      });
+  return replacer;
+}
+
+void mlir::obs::replaceSymbolUses(ArrayRef<Operation *> users,
+                                  const llvm::StringMap<std::string> &renames) {
+  if (renames.empty())
+    return;
+  AttrTypeReplacer replacer = symbolReplacer(renames);
+  for (Operation *op : users)
+    replacer.replaceElementsIn(op, /*replaceAttrs=*/true, /*replaceLocs=*/false,
+                               /*replaceTypes=*/false);
+}
+
+void mlir::obs::replaceSymbolUses(Operation *root,
+                                  const llvm::StringMap<std::string> &renames) {
+  if (renames.empty())
+    return;
+  AttrTypeReplacer replacer = symbolReplacer(renames);
+  replacer.recursivelyReplaceElementsIn(root, /*replaceAttrs=*/true,
+                                        /*replaceLocs=*/false,
+                                        /*replaceTypes=*/false);
+}
@@ -1,4 +1,6 @@
 #include "Obfuscator/Passes.h"
+#include "Obfuscator/ProfileTiers.h"
+#include "Obfuscator/SymbolNames.h"
 
 #include "mlir/IR/BuiltinOps.h"
 #include "mlir/IR/SymbolTable.h"
@@ -7,24 +9,9 @@
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
 
-#include <random>
-
 using namespace mlir;
 using namespace mlir::obs;
 
-namespace {
-
-static std::string generateObfuscatedName(std::mt19937 &rng) {
-  std::uniform_int_distribution<uint32_t> dist(0, 0xFFFFFFFF);
-  uint32_t num = dist(rng);
-
-  char buffer[16];
-  snprintf(buffer, sizeof(buffer), "f_%08x", num);
-  return std::string(buffer);
-}
-
-}
-
 void SymbolObfuscatePass::runOnOperation() {
   ModuleOp module = getOperation();
   MLIRContext *ctx = module.getContext();
@@ -51,7 +38,6 @@ void SymbolObfuscatePass::runOnOperation() {
 
 void SymbolObfuscatePass::processFuncDialect() {
   ModuleOp module = getOperation();
-  MLIRContext *ctx = module.getContext();
   SymbolTable symbolTable(module);
 
   std::seed_seq seq(key.begin(), key.end());
@@ -62,40 +48,22 @@ void SymbolObfuscatePass::processFuncDialect() {
   module.walk([&](func::FuncOp func) {
     StringRef oldName = func.getSymName();
 
-    if (oldName == "main")
+    if (func.isDeclaration())
       return;
 
-    if (func.isDeclaration())
+    if (oldName == "main" || !isTransformAllowed(func, TransformCost::Free)) {
+      ++numKept;
       return;
+    }
 
     if (renameMap.find(oldName) == renameMap.end()) {
-      std::string newName = generateObfuscatedName(rng);
+      std::string newName = generateObfuscatedName(rng, "f");
       renameMap[oldName] = newName;
     }
   });
+  numRenamed += renameMap.size();
 
-  module.walk([&](Operation *op) {
-    SmallVector<NamedAttribute> updatedAttrs;
-    bool changed = false;
-
-    for (auto &attr : op->getAttrs()) {
-      if (auto symAttr = llvm::dyn_cast<SymbolRefAttr>(attr.getValue())) {
-        StringRef old = symAttr.getRootReference();
-        auto it = renameMap.find(old);
-        if (it != renameMap.end()) {
-          auto newRef = SymbolRefAttr::get(ctx, it->second);
-          updatedAttrs.emplace_back(attr.getName(), newRef);
-          changed = true;
-          continue;
-        }
-      }
-      updatedAttrs.push_back(attr);
-    }
-
-    if (changed) {
-      op->setAttrs(DictionaryAttr::get(ctx, updatedAttrs));
-    }
-  });
+  replaceSymbolUses(module, renameMap);
 
   module.walk([&](func::FuncOp func) {
     StringRef oldName = func.getSymName();
@@ -108,7 +76,6 @@ void SymbolObfuscatePass::processFuncDialect() {
 
 void SymbolObfuscatePass::processLLVMDialect() {
   ModuleOp module = getOperation();
-  MLIRContext *ctx = module.getContext();
   SymbolTable symbolTable(module);
 
   std::seed_seq seq(key.begin(), key.end());
@@ -119,14 +86,16 @@ void SymbolObfuscatePass::processLLVMDialect() {
   module.walk([&](LLVM::LLVMFuncOp func) {
     StringRef oldName = func.getSymName();
 
-    if (oldName == "main")
+    if (func.isExternal())
       return;
 
-    if (func.isExternal())
+    if (oldName == "main" || !isTransformAllowed(func, TransformCost::Free)) {
+      ++numKept;
       return;
+    }
 
     if (renameMap.find(oldName) == renameMap.end()) {
-      std::string newName = generateObfuscatedName(rng);
+      std::string newName = generateObfuscatedName(rng, "f");
       renameMap[oldName] = newName;
     }
   });
@@ -138,46 +107,12 @@ void SymbolObfuscatePass::processLLVMDialect() {
       return;
 
     if (renameMap.find(oldName) == renameMap.end()) {
-      std::uniform_int_distribution<uint32_t> dist(0, 0xFFFFFFFF);
-      uint32_t num = dist(rng);
-      char buffer[16];
-      snprintf(buffer, sizeof(buffer), "g_%08x", num);
-      renameMap[oldName] = std::string(buffer);
+      renameMap[oldName] = generateObfuscatedName(rng, "g");
     }
   });
+  numRenamed += renameMap.size();
 
-  module.walk([&](Operation *op) {
-    SmallVector<NamedAttribute> updatedAttrs;
-    bool changed = false;
-
-    for (auto &attr : op->getAttrs()) {
-      if (auto symAttr = llvm::dyn_cast<SymbolRefAttr>(attr.getValue())) {
-        StringRef old = symAttr.getRootReference();
-        auto it = renameMap.find(old);
-        if (it != renameMap.end()) {
-          auto newRef = SymbolRefAttr::get(ctx, it->second);
-          updatedAttrs.emplace_back(attr.getName(), newRef);
-          changed = true;
-          continue;
-        }
-      }
-      if (auto flatSymAttr = llvm::dyn_cast<FlatSymbolRefAttr>(attr.getValue())) {
-        StringRef old = flatSymAttr.getValue();
-        auto it = renameMap.find(old);
-        if (it != renameMap.end()) {
-          auto newRef = FlatSymbolRefAttr::get(ctx, it->second);
-          updatedAttrs.emplace_back(attr.getName(), newRef);
-          changed = true;
-          continue;
-        }
-      }
-      updatedAttrs.push_back(attr);
-    }
-
-    if (changed) {
-      op->setAttrs(DictionaryAttr::get(ctx, updatedAttrs));
-    }
-  });
+  replaceSymbolUses(module, renameMap);
 
   module.walk([&](LLVM::LLVMFuncOp func) {
     StringRef oldName = func.getSymName();
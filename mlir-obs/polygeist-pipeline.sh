@@ -1,6 +1,10 @@
 #!/bin/bash
 # End-to-end Polygeist-based obfuscation pipeline
-# Usage: ./polygeist-pipeline.sh input.c output_binary
+# Usage: ./polygeist-pipeline.sh input.c output_binary [--two-stage]
+#
+# --two-stage runs affine loop optimizations (fusion, tiling,
+# super-vectorization) before obfuscating, and keeps SCF obfuscation out of
+# the optimized loop nests. Use it for numeric kernels.
 
 set -e
 
@@ -15,9 +19,14 @@ NC='\033[0m' # No Color
 # Configuration
 INPUT_FILE="${1:-}"
 OUTPUT_BINARY="${2:-a.out}"
+TWO_STAGE=0
+if [ "${3:-}" = "--two-stage" ]; then
+    TWO_STAGE=1
+fi
+AFFINE_TILE_SIZE="${AFFINE_TILE_SIZE:-32}"
+AFFINE_VECTOR_SIZE="${AFFINE_VECTOR_SIZE:-8}"
 TEMP_DIR="$(mktemp -d)"
-LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f | head -1)
-MLIR_OBFUSCATE="$SCRIPT_DIR/build/tools/mlir-obfuscate"
+LIBRARY=$(find "$SCRIPT_DIR/build" -name "*MLIRObfuscation.*" -type f 2>/dev/null | head -1)
 
 trap "rm -rf $TEMP_DIR" EXIT
 
@@ -29,7 +38,7 @@ echo ""
 # Validate input
 if [ -z "$INPUT_FILE" ]; then
     echo -e "${RED}ERROR: No input file specified${NC}"
-    echo "Usage: $0 <input.c> [output_binary]"
+    echo "Usage: $0 <input.c> [output_binary] [--two-stage]"
     exit 1
 fi
 
@@ -58,16 +67,23 @@ else
     CGEIST_CMD="cgeist"
 fi
 
-# Check if obfuscator is built
-if [ ! -f "$MLIR_OBFUSCATE" ]; then
-    echo -e "${YELLOW}WARNING: mlir-obfuscate not found, using mlir-opt with plugin${NC}"
-    MLIR_OBFUSCATE="mlir-opt --load-pass-plugin=$LIBRARY"
+# Check if obfuscator is built. The Polygeist output stays in the func,
+# scf, affine and memref dialects until step 5, so the passes run in
+# mlir-opt, which registers those dialects and the upstream passes, with
+# the plugin loaded; mlir-obfuscate only reads and writes LLVM IR.
+if [ -z "$LIBRARY" ]; then
+    echo -e "${RED}ERROR: MLIR library not found. Please run ./build.sh first${NC}"
+    exit 1
 fi
+MLIR_OBFUSCATE="mlir-opt --load-dialect-plugin=$LIBRARY --load-pass-plugin=$LIBRARY"
 
 echo -e "${GREEN}✓${NC} Input file: $INPUT_FILE"
 echo -e "${GREEN}✓${NC} Output binary: $OUTPUT_BINARY"
 echo -e "${GREEN}✓${NC} Temp directory: $TEMP_DIR"
 echo -e "${GREEN}✓${NC} Polygeist: $CGEIST_CMD"
+if [ "$TWO_STAGE" = "1" ]; then
+    echo -e "${GREEN}✓${NC} Mode: two-stage (affine optimization, then obfuscation)"
+fi
 echo ""
 
 # ============================================================================
@@ -94,11 +110,31 @@ echo "━━━━━━━━━━━━━━━━━━━━━━━━
 echo "[Step 2/7] SCF Dialect Obfuscation"
 echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
 
-$MLIR_OBFUSCATE "$TEMP_DIR/polygeist.mlir" \
-    --pass-pipeline="builtin.module(scf-obfuscate)" \
+SCF_INPUT="$TEMP_DIR/polygeist.mlir"
+SCF_PIPELINE="scf-obfuscate"
+
+if [ "$TWO_STAGE" = "1" ]; then
+    # Stage 1: optimize loop nests while they are still affine
+    mlir-opt "$TEMP_DIR/polygeist.mlir" \
+        --affine-loop-fusion \
+        --affine-loop-tile="tile-size=$AFFINE_TILE_SIZE" \
+        --affine-super-vectorize="virtual-vector-size=$AFFINE_VECTOR_SIZE" \
+        --canonicalize \
+        -o "$TEMP_DIR/affine_optimized.mlir" \
+        2>&1 || { echo -e "${RED}✗ Affine optimization failed${NC}"; exit 1; }
+    echo -e "${GREEN}✓ Affine loop optimization complete${NC}"
+
+    # Stage 2: obfuscate around the optimized nests, not inside them
+    SCF_INPUT="$TEMP_DIR/affine_optimized.mlir"
+    SCF_PIPELINE="scf-obfuscate{preserve-loop-nests=true}"
+fi
+
+# obs.opaque_pred ops are shared by CSE/LICM, then expanded by obs-lower.
+# scf-obfuscate runs on each function in parallel, after obs-hotness.
+$MLIR_OBFUSCATE "$SCF_INPUT" \
+    --pass-pipeline="builtin.module(obs-hotness,any($SCF_PIPELINE),cse,loop-invariant-code-motion,obs-lower)" \
     -o "$TEMP_DIR/scf_obfuscated.mlir" \
-    2>&1 || { echo -e "${YELLOW}⚠ SCF obfuscation skipped (pass may not be ready)${NC}";
-              cp "$TEMP_DIR/polygeist.mlir" "$TEMP_DIR/scf_obfuscated.mlir"; }
+    2>&1 || { echo -e "${RED}✗ Failed${NC}"; exit 1; }
 
 echo -e "${GREEN}✓ SCF obfuscation complete${NC}"
 echo ""
@@ -146,11 +182,17 @@ echo "━━━━━━━━━━━━━━━━━━━━━━━━
 echo "[Step 5/7] Lowering to LLVM Dialect"
 echo "━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━"
 
+# vector.transfer_* ops from --two-stage need vector-to-scf, which emits
+# affine ops of its own, before anything is lowered to LLVM
 mlir-opt "$TEMP_DIR/string_encrypted.mlir" \
+    --convert-vector-to-scf \
+    --lower-affine \
     --convert-scf-to-cf \
+    --convert-vector-to-llvm \
     --convert-arith-to-llvm \
+    --convert-cf-to-llvm \
+    --finalize-memref-to-llvm \
     --convert-func-to-llvm \
-    --convert-memref-to-llvm \
     --reconcile-unrealized-casts \
     -o "$TEMP_DIR/llvm_dialect.mlir" \
     2>&1 || { echo -e "${RED}✗ Failed${NC}"; exit 1; }
@@ -0,0 +1,188 @@
+/*
+ * Runtime for the anti-debug pass (Linux).
+ *
+ * Every instrumented function decrements a thread-local countdown and only
+ * calls __obfs_ad_slow() when it runs out. The slow path runs the requested
+ * checks and returns the next countdown, sized so that time spent in here
+ * stays under budget_us microseconds per second of wall time on the thread.
+ * /proc reads are shared by all threads and reused for proc_cache_ms.
+ *
+ * Build with the obfuscated IR:
+ *   clang -O2 -c obfs_antidebug.c -o obfs_antidebug.o
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ptrace.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Must match the Technique bits in lib/AntiDebugPass.cpp. */
+#define OBFS_AD_PTRACE       (1u << 0)
+#define OBFS_AD_PROC_STATUS  (1u << 1)
+#define OBFS_AD_PARENT_CHECK (1u << 2)
+#define OBFS_AD_TIMING       (1u << 3)
+
+/* Countdown bounds: never re-check more often than every 16 calls, and
+ * never go longer than ~1M calls between samples. */
+#define OBFS_AD_MIN_INTERVAL 16u
+#define OBFS_AD_MAX_INTERVAL (1u << 20)
+#define OBFS_AD_FIRST_INTERVAL 64u
+/* Same threshold as the source-level timing check. */
+#define OBFS_AD_TIMING_LIMIT_NS 10000000ull
+
+struct obfs_ad_thread {
+  uint64_t last_ns;  /* CLOCK_MONOTONIC at the previous sample */
+  uint32_t interval; /* countdown handed out at the previous sample */
+  uint64_t cost_ns;  /* moving average of one slow-path call */
+  uint64_t rng;
+};
+
+static __thread struct obfs_ad_thread obfs_ad_tls;
+
+/* Provided by obfs_selfcheck.c when it is linked; a few
+ * checksum chunks then ride on each sample and count against its budget. */
+extern void __obfs_sc_step(void) __attribute__((weak));
+
+static int obfs_ad_ptrace_done;
+static uint64_t obfs_ad_proc_checked_ns;
+
+__attribute__((noreturn, cold)) static void obfs_ad_detected(const char *tag) {
+  ssize_t unused = write(2, tag, 4);
+  (void)unused;
+  _exit(1);
+}
+
+static uint64_t obfs_ad_now(clockid_t clock) {
+  struct timespec ts;
+  clock_gettime(clock, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static ssize_t obfs_ad_read(const char *path, char *buf, size_t size) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  ssize_t n = read(fd, buf, size - 1);
+  close(fd);
+  buf[n > 0 ? n : 0] = '\0';
+  return n;
+}
+
+/* PTRACE_TRACEME can only succeed once per process, so it runs once. */
+static void obfs_ad_check_ptrace(void) {
+  if (__atomic_exchange_n(&obfs_ad_ptrace_done, 1, __ATOMIC_RELAXED))
+    return;
+  if (ptrace(PTRACE_TRACEME, 0, 0, 0) == -1)
+    obfs_ad_detected("DBG\n");
+}
+
+static void obfs_ad_check_proc_status(void) {
+  char buf[2048];
+  if (obfs_ad_read("/proc/self/status", buf, sizeof(buf)) <= 0)
+    return;
+  const char *line = strstr(buf, "TracerPid:");
+  if (!line)
+    return;
+  line += sizeof("TracerPid:") - 1;
+  while (*line == ' ' || *line == '\t')
+    ++line;
+  if (*line != '0')
+    obfs_ad_detected("TRC\n");
+}
+
+static void obfs_ad_check_parent(void) {
+  static const char *const tools[] = {"gdb", "lldb", "strace", "ltrace"};
+  char path[64];
+  char buf[256];
+  snprintf(path, sizeof(path), "/proc/%d/cmdline", (int)getppid());
+  if (obfs_ad_read(path, buf, sizeof(buf)) <= 0)
+    return;
+  for (size_t i = 0; i < sizeof(tools) / sizeof(tools[0]); ++i)
+    if (strstr(buf, tools[i]))
+      obfs_ad_detected("PAR\n");
+}
+
+/* A short loop that only takes over 10ms when single-stepped or stopped. */
+static void obfs_ad_check_timing(void) {
+  uint64_t start = obfs_ad_now(CLOCK_MONOTONIC);
+  volatile uint32_t sink = 0;
+  for (uint32_t i = 0; i < 1000; ++i)
+    sink += i;
+  if (obfs_ad_now(CLOCK_MONOTONIC) - start > OBFS_AD_TIMING_LIMIT_NS)
+    obfs_ad_detected("TIM\n");
+}
+
+/* /proc based checks are refreshed at most once per proc_cache_ms across
+ * all threads; whichever thread wins the CAS does the read. */
+static void obfs_ad_check_proc(uint32_t techniques, uint64_t now,
+                               uint32_t proc_cache_ms) {
+  uint64_t last = __atomic_load_n(&obfs_ad_proc_checked_ns, __ATOMIC_RELAXED);
+  if (last && now - last < (uint64_t)proc_cache_ms * 1000000ull)
+    return;
+  if (!__atomic_compare_exchange_n(&obfs_ad_proc_checked_ns, &last, now, 0,
+                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    return;
+  if (techniques & OBFS_AD_PROC_STATUS)
+    obfs_ad_check_proc_status();
+  if (techniques & OBFS_AD_PARENT_CHECK)
+    obfs_ad_check_parent();
+  if (techniques & OBFS_AD_TIMING)
+    obfs_ad_check_timing();
+}
+
+static uint32_t obfs_ad_random(struct obfs_ad_thread *t) {
+  if (!t->rng)
+    t->rng = (uintptr_t)t ^ obfs_ad_now(CLOCK_MONOTONIC) ^ 0x9E3779B97F4A7C15ull;
+  t->rng ^= t->rng << 13;
+  t->rng ^= t->rng >> 7;
+  t->rng ^= t->rng << 17;
+  return (uint32_t)(t->rng >> 32);
+}
+
+/* calls/s observed since the last sample, divided by how many slow-path
+ * calls per second the budget affords, jittered to 50-150%. */
+static uint32_t obfs_ad_next_interval(struct obfs_ad_thread *t, uint64_t now,
+                                      uint32_t budget_us) {
+  uint64_t elapsed = now - t->last_ns;
+  if (!t->last_ns || !elapsed || !t->interval)
+    return OBFS_AD_FIRST_INTERVAL;
+
+  double calls_per_sec = (double)t->interval * 1e9 / (double)elapsed;
+  double samples_per_sec =
+      (double)budget_us * 1000.0 / (double)(t->cost_ns ? t->cost_ns : 1);
+  double interval = samples_per_sec > 0.0 ? calls_per_sec / samples_per_sec
+                                          : (double)OBFS_AD_MAX_INTERVAL;
+  interval *= 0.5 + (double)(obfs_ad_random(t) & 0xFFFF) / 65536.0;
+
+  if (interval < OBFS_AD_MIN_INTERVAL)
+    return OBFS_AD_MIN_INTERVAL;
+  if (interval > OBFS_AD_MAX_INTERVAL)
+    return OBFS_AD_MAX_INTERVAL;
+  return (uint32_t)interval;
+}
+
+int32_t __obfs_ad_slow(uint32_t techniques, uint32_t budget_us,
+                       uint32_t proc_cache_ms) {
+  struct obfs_ad_thread *t = &obfs_ad_tls;
+  uint64_t start = obfs_ad_now(CLOCK_MONOTONIC);
+
+  if (techniques & OBFS_AD_PTRACE)
+    obfs_ad_check_ptrace();
+  if (techniques & (OBFS_AD_PROC_STATUS | OBFS_AD_PARENT_CHECK | OBFS_AD_TIMING))
+    obfs_ad_check_proc(techniques, start, proc_cache_ms);
+  if (__obfs_sc_step)
+    __obfs_sc_step();
+
+  uint64_t end = obfs_ad_now(CLOCK_MONOTONIC);
+  uint64_t cost = end - start;
+  t->cost_ns = t->cost_ns ? (t->cost_ns * 7 + cost) / 8 : cost;
+
+  uint32_t next = obfs_ad_next_interval(t, end, budget_us);
+  t->last_ns = end;
+  t->interval = next;
+  return (int32_t)next;
+}
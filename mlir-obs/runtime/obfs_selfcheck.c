@@ -0,0 +1,294 @@
+/*
+ * Incremental self-checksumming of .text and .rodata (Linux, ELF).
+ *
+ * obfs_sc_table below is a fixed-size table in its own .obfs_crc section.
+ * After linking, the CLI (core/self_checksum.py) splits .text and .rodata
+ * into chunks, records each chunk's CRC32C and patches the table in the
+ * file. At run time the chunks are re-verified a few at a time instead of
+ * all at startup:
+ *
+ *   OBFS_SC_MODE_THREAD     background thread, sleeps so it uses at most
+ *                           OBFS_SC_BUDGET_PERMILLE of one CPU
+ *   OBFS_SC_MODE_PIGGYBACK  __obfs_sc_step() checks OBFS_SC_CHUNKS_PER_STEP
+ *                           chunks; the anti-debug runtime calls it from its
+ *                           sampled slow path, so that budget covers both
+ *   OBFS_SC_MODE_EAGER      everything in a constructor (for comparison)
+ *
+ * Verification keeps cycling, so pages patched after startup (software
+ * breakpoints, hooks) are caught too. A mismatch writes "CRC" to stderr and
+ * exits, like the anti-debug checks.
+ *
+ * CRC32C uses SSE4.2 crc32 (or the ARMv8 CRC extension) with three chunks
+ * in flight to hide the instruction's 3-cycle latency, and a table-driven
+ * fallback elsewhere.
+ *
+ * Build:
+ *   clang -O2 -c obfs_selfcheck.c -DOBFS_SC_MODE=OBFS_SC_MODE_THREAD
+ *   (link with -pthread)
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <nmmintrin.h>
+#define OBFS_SC_HW_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define OBFS_SC_HW_ARM 1
+#endif
+
+#define OBFS_SC_MODE_EAGER 0
+#define OBFS_SC_MODE_THREAD 1
+#define OBFS_SC_MODE_PIGGYBACK 2
+
+#ifndef OBFS_SC_MODE
+#define OBFS_SC_MODE OBFS_SC_MODE_THREAD
+#endif
+/* Share of one CPU the background thread may use, in 1/1000. */
+#ifndef OBFS_SC_BUDGET_PERMILLE
+#define OBFS_SC_BUDGET_PERMILLE 10
+#endif
+#ifndef OBFS_SC_CHUNKS_PER_STEP
+#define OBFS_SC_CHUNKS_PER_STEP 4
+#endif
+/* Table slots; the sealer grows the chunk size until the image fits. */
+#ifndef OBFS_SC_CAPACITY
+#define OBFS_SC_CAPACITY 2048
+#endif
+
+/* Layout shared with core/self_checksum.py (little-endian). */
+struct obfs_sc_entry {
+  uint64_t vaddr; /* link-time address of the chunk */
+  uint32_t size;
+  uint32_t crc;
+};
+
+struct obfs_sc_table {
+  char magic[8];        /* "OBFSCRC1" */
+  uint32_t capacity;
+  uint32_t count;       /* 0 until sealed */
+  uint64_t image_vaddr; /* link-time address of the ELF header */
+  struct obfs_sc_entry entries[OBFS_SC_CAPACITY];
+};
+
+__attribute__((used, aligned(16), section(".obfs_crc")))
+struct obfs_sc_table obfs_sc_table = {
+    {'O', 'B', 'F', 'S', 'C', 'R', 'C', '1'}, OBFS_SC_CAPACITY, 0, 0, {{0}}};
+
+/* Defined by GNU ld and lld at the ELF header of the executable. */
+extern const char __ehdr_start[] __attribute__((weak, visibility("hidden")));
+
+static uint32_t obfs_sc_cursor;
+/* Set once the CRC tables/CPU detection are done; other constructors may
+ * reach __obfs_sc_step() through the anti-debug runtime before ours runs. */
+static int obfs_sc_initialized;
+
+/* ---- CRC32C ------------------------------------------------------------ */
+
+static uint32_t obfs_sc_sw_table[256];
+
+static void obfs_sc_init_sw_table(void) {
+  for (uint32_t i = 0; i < 256; ++i) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit)
+      crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1)));
+    obfs_sc_sw_table[i] = crc;
+  }
+}
+
+static uint32_t obfs_sc_crc_sw(const uint8_t *p, size_t n) {
+  uint32_t crc = ~0u;
+  while (n--)
+    crc = obfs_sc_sw_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
+
+#if defined(OBFS_SC_HW_X86)
+#define OBFS_SC_TARGET __attribute__((target("sse4.2")))
+#define OBFS_SC_CRC8(c, v) _mm_crc32_u8((c), (v))
+#define OBFS_SC_CRC64(c, v) ((uint32_t)_mm_crc32_u64((c), (v)))
+#elif defined(OBFS_SC_HW_ARM)
+#define OBFS_SC_TARGET
+#define OBFS_SC_CRC8(c, v) __crc32cb((c), (v))
+#define OBFS_SC_CRC64(c, v) __crc32cd((c), (v))
+#endif
+
+#ifdef OBFS_SC_TARGET
+static int obfs_sc_have_hw;
+
+OBFS_SC_TARGET static uint32_t obfs_sc_crc_hw(const uint8_t *p, size_t n) {
+  uint32_t crc = ~0u;
+  for (; n >= 8; p += 8, n -= 8) {
+    uint64_t v;
+    memcpy(&v, p, 8);
+    crc = OBFS_SC_CRC64(crc, v);
+  }
+  while (n--)
+    crc = OBFS_SC_CRC8(crc, *p++);
+  return ~crc;
+}
+
+/* Three independent chunks of the same size, interleaved. */
+OBFS_SC_TARGET static void obfs_sc_crc_hw_x3(const uint8_t *a, const uint8_t *b,
+                                             const uint8_t *c, size_t n,
+                                             uint32_t out[3]) {
+  uint32_t ca = ~0u, cb = ~0u, cc = ~0u;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint64_t va, vb, vc;
+    memcpy(&va, a + i, 8);
+    memcpy(&vb, b + i, 8);
+    memcpy(&vc, c + i, 8);
+    ca = OBFS_SC_CRC64(ca, va);
+    cb = OBFS_SC_CRC64(cb, vb);
+    cc = OBFS_SC_CRC64(cc, vc);
+  }
+  for (; i < n; ++i) {
+    ca = OBFS_SC_CRC8(ca, a[i]);
+    cb = OBFS_SC_CRC8(cb, b[i]);
+    cc = OBFS_SC_CRC8(cc, c[i]);
+  }
+  out[0] = ~ca;
+  out[1] = ~cb;
+  out[2] = ~cc;
+}
+#endif
+
+uint32_t __obfs_sc_crc32c(const void *data, size_t n) {
+#ifdef OBFS_SC_TARGET
+  if (obfs_sc_have_hw)
+    return obfs_sc_crc_hw((const uint8_t *)data, n);
+#endif
+  return obfs_sc_crc_sw((const uint8_t *)data, n);
+}
+
+/* ---- Verification ------------------------------------------------------ */
+
+__attribute__((noreturn, cold)) static void obfs_sc_tampered(void) {
+  ssize_t unused = write(2, "CRC\n", 4);
+  (void)unused;
+  _exit(1);
+}
+
+/* Keeps the compiler from folding the pre-seal contents of the table. */
+static const struct obfs_sc_table *obfs_sc_get_table(void) {
+  const struct obfs_sc_table *table = &obfs_sc_table;
+  __asm__("" : "+r"(table));
+  return table;
+}
+
+static const uint8_t *obfs_sc_address(const struct obfs_sc_table *table,
+                                      const struct obfs_sc_entry *entry) {
+  return (const uint8_t *)__ehdr_start + (entry->vaddr - table->image_vaddr);
+}
+
+static void obfs_sc_verify_range(const struct obfs_sc_table *table,
+                                 uint32_t first, uint32_t n) {
+  const struct obfs_sc_entry *e = &table->entries[first];
+#ifdef OBFS_SC_TARGET
+  if (obfs_sc_have_hw) {
+    for (; n >= 3 && e[0].size == e[1].size && e[1].size == e[2].size;
+         n -= 3, e += 3) {
+      uint32_t crc[3];
+      obfs_sc_crc_hw_x3(obfs_sc_address(table, &e[0]),
+                        obfs_sc_address(table, &e[1]),
+                        obfs_sc_address(table, &e[2]), e[0].size, crc);
+      if (crc[0] != e[0].crc || crc[1] != e[1].crc || crc[2] != e[2].crc)
+        obfs_sc_tampered();
+    }
+  }
+#endif
+  for (; n; --n, ++e)
+    if (__obfs_sc_crc32c(obfs_sc_address(table, e), e->size) != e->crc)
+      obfs_sc_tampered();
+}
+
+/* Claims the next `chunks` entries (wrapping) and verifies them. */
+static void obfs_sc_verify_next(const struct obfs_sc_table *table,
+                                uint32_t chunks) {
+  uint32_t count = table->count;
+  if (chunks > count)
+    chunks = count;
+  uint32_t first =
+      __atomic_fetch_add(&obfs_sc_cursor, chunks, __ATOMIC_RELAXED) % count;
+  uint32_t head = count - first < chunks ? count - first : chunks;
+  obfs_sc_verify_range(table, first, head);
+  if (head < chunks)
+    obfs_sc_verify_range(table, 0, chunks - head);
+}
+
+static int obfs_sc_ready(const struct obfs_sc_table *table) {
+  return table->count != 0 && table->count <= table->capacity &&
+         (const void *)__ehdr_start != NULL;
+}
+
+void __obfs_sc_step(void) {
+  const struct obfs_sc_table *table = obfs_sc_get_table();
+  if (__atomic_load_n(&obfs_sc_initialized, __ATOMIC_ACQUIRE) &&
+      obfs_sc_ready(table))
+    obfs_sc_verify_next(table, OBFS_SC_CHUNKS_PER_STEP);
+}
+
+#if OBFS_SC_MODE == OBFS_SC_MODE_THREAD
+static uint64_t obfs_sc_now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Work for t ns, then sleep t * (1000 - budget) / budget ns. */
+static void *obfs_sc_thread(void *arg) {
+  const struct obfs_sc_table *table = arg;
+  for (;;) {
+    uint64_t start = obfs_sc_now();
+    obfs_sc_verify_next(table, OBFS_SC_CHUNKS_PER_STEP);
+    uint64_t work = obfs_sc_now() - start;
+    uint64_t idle = work * (1000 - OBFS_SC_BUDGET_PERMILLE) /
+                    (OBFS_SC_BUDGET_PERMILLE ? OBFS_SC_BUDGET_PERMILLE : 1);
+    if (idle < 100000)
+      idle = 100000;
+    struct timespec ts = {(time_t)(idle / 1000000000ull),
+                          (long)(idle % 1000000000ull)};
+    nanosleep(&ts, NULL);
+  }
+  return NULL;
+}
+
+static void obfs_sc_start_thread(void) {
+  pthread_attr_t attr;
+  pthread_t thread;
+  pthread_attr_init(&attr);
+  pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+  pthread_attr_setstacksize(&attr, 64 * 1024);
+  pthread_create(&thread, &attr, obfs_sc_thread,
+                 (void *)obfs_sc_get_table());
+  pthread_attr_destroy(&attr);
+}
+#endif
+
+__attribute__((constructor)) static void obfs_sc_init(void) {
+  obfs_sc_init_sw_table();
+#if defined(OBFS_SC_HW_X86)
+  __builtin_cpu_init();
+  obfs_sc_have_hw = __builtin_cpu_supports("sse4.2");
+#elif defined(OBFS_SC_HW_ARM)
+  obfs_sc_have_hw = 1;
+#endif
+  __atomic_store_n(&obfs_sc_initialized, 1, __ATOMIC_RELEASE);
+  const struct obfs_sc_table *table = obfs_sc_get_table();
+  if (!obfs_sc_ready(table))
+    return;
+#if OBFS_SC_MODE == OBFS_SC_MODE_EAGER
+  obfs_sc_verify_range(table, 0, table->count);
+#elif OBFS_SC_MODE == OBFS_SC_MODE_THREAD
+  obfs_sc_start_thread();
+  /* fork() only copies the calling thread. */
+  pthread_atfork(NULL, NULL, obfs_sc_start_thread);
+#endif
+}
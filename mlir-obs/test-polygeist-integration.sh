@@ -218,7 +218,7 @@ EOF
         "grep -q 'func.func @f_[0-9a-f]\{8\}' $TEMP_DIR/poly_obf.mlir"
 
     run_test "Apply SCF obfuscation" \
-        "mlir-opt $TEMP_DIR/poly_obf.mlir --load-pass-plugin=$LIBRARY --pass-pipeline='builtin.module(scf-obfuscate)' -o $TEMP_DIR/poly_scf_obf.mlir"
+        "mlir-opt $TEMP_DIR/poly_obf.mlir --load-pass-plugin=$LIBRARY --pass-pipeline='builtin.module(scf-obfuscate,obs-lower)' -o $TEMP_DIR/poly_scf_obf.mlir"
 
     run_test "Lower to LLVM dialect" \
         "mlir-opt $TEMP_DIR/poly_scf_obf.mlir --convert-scf-to-cf --convert-arith-to-llvm --convert-func-to-llvm --convert-memref-to-llvm --reconcile-unrealized-casts -o $TEMP_DIR/poly_llvm.mlir"
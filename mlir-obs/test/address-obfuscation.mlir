@@ -0,0 +1,90 @@
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(llvm.func(address-obfuscation))' | FileCheck %s
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(llvm.func(address-obfuscation{force-loops=true}))' | FileCheck %s --check-prefix=FORCE
+
+// The key pair is materialized once at entry. GEP indices become
+// (idx + key) + nkey; raw pointers go through two i8 GEPs.
+
+// CHECK-LABEL: llvm.func @index
+// CHECK: %[[K:.*]] = obs.encoded_const {{.*}} : i64
+// CHECK-NEXT: %[[NK:.*]] = obs.encoded_const {{.*}} : i64
+// CHECK-NEXT: %[[S:.*]] = llvm.add %arg1, %[[K]] : i64
+// CHECK-NEXT: %[[M:.*]] = llvm.add %[[S]], %[[NK]] : i64
+// CHECK-NEXT: %[[P:.*]] = llvm.getelementptr %arg0[%[[M]]] : (!llvm.ptr, i64) -> !llvm.ptr, i32
+// CHECK-NEXT: llvm.load %[[P]] : !llvm.ptr -> i32
+// CHECK-NEXT: %[[Q1:.*]] = llvm.getelementptr %arg2[%[[K]]] : (!llvm.ptr, i64) -> !llvm.ptr, i8
+// CHECK-NEXT: %[[Q2:.*]] = llvm.getelementptr %[[Q1]][%[[NK]]] : (!llvm.ptr, i64) -> !llvm.ptr, i8
+// CHECK-NEXT: llvm.load %[[Q2]] : !llvm.ptr -> i32
+llvm.func @index(%arg0: !llvm.ptr, %arg1: i64, %arg2: !llvm.ptr) -> i32 {
+  %0 = llvm.getelementptr %arg0[%arg1] : (!llvm.ptr, i64) -> !llvm.ptr, i32
+  %1 = llvm.load %0 : !llvm.ptr -> i32
+  %2 = llvm.load %arg2 : !llvm.ptr -> i32
+  %3 = llvm.add %1, %2 : i32
+  llvm.return %3 : i32
+}
+
+// Stack slots keep their plain addresses and indices, for SROA.
+
+// CHECK-LABEL: llvm.func @stack
+// CHECK-NOT: obs.encoded_const
+// CHECK: llvm.getelementptr %{{.*}}[0, %arg0]
+// CHECK-NOT: obs.encoded_const
+// CHECK: llvm.return
+llvm.func @stack(%arg0: i64) -> i32 {
+  %0 = llvm.mlir.constant(1 : i64) : i64
+  %1 = llvm.alloca %0 x !llvm.array<4 x i32> : (i64) -> !llvm.ptr
+  %2 = llvm.getelementptr %1[0, %arg0] : (!llvm.ptr, i64) -> !llvm.ptr, !llvm.array<4 x i32>
+  %3 = llvm.load %2 : !llvm.ptr -> i32
+  llvm.return %3 : i32
+}
+
+// A global is loaded from directly, but a dynamic index into it is masked.
+
+llvm.mlir.global internal constant @table(dense<[1, 2, 3, 4]> : tensor<4xi32>) : !llvm.array<4 x i32>
+
+// CHECK-LABEL: llvm.func @lookup
+// CHECK: %[[K:.*]] = obs.encoded_const {{.*}} : i64
+// CHECK-NEXT: %[[NK:.*]] = obs.encoded_const {{.*}} : i64
+// CHECK-NEXT: %[[T:.*]] = llvm.mlir.addressof @table : !llvm.ptr
+// CHECK-NEXT: llvm.load %[[T]] : !llvm.ptr -> i32
+// CHECK-NEXT: %[[S:.*]] = llvm.add %arg0, %[[K]] : i64
+// CHECK-NEXT: %[[M:.*]] = llvm.add %[[S]], %[[NK]] : i64
+// CHECK-NEXT: llvm.getelementptr %[[T]][0, %[[M]]]
+llvm.func @lookup(%arg0: i64) -> i32 {
+  %0 = llvm.mlir.addressof @table : !llvm.ptr
+  %1 = llvm.load %0 : !llvm.ptr -> i32
+  %2 = llvm.getelementptr %0[0, %arg0] : (!llvm.ptr, i64) -> !llvm.ptr, !llvm.array<4 x i32>
+  %3 = llvm.load %2 : !llvm.ptr -> i32
+  %4 = llvm.add %1, %3 : i32
+  llvm.return %4 : i32
+}
+
+// A call-free innermost loop is what the vectorizer takes: left alone
+// unless force-loops is set.
+
+// CHECK-LABEL: llvm.func @sum
+// CHECK-NOT: obs.encoded_const
+// CHECK: ^bb1(%[[I:.*]]: i64, %{{.*}}: i32):
+// CHECK-NEXT: llvm.getelementptr %arg0[%[[I]]] : (!llvm.ptr, i64) -> !llvm.ptr, i32
+
+// FORCE-LABEL: llvm.func @sum
+// FORCE: %[[K:.*]] = obs.encoded_const {{.*}} : i64
+// FORCE-NEXT: %[[NK:.*]] = obs.encoded_const {{.*}} : i64
+// FORCE: ^bb1(%[[I:.*]]: i64, %{{.*}}: i32):
+// FORCE-NEXT: %[[S:.*]] = llvm.add %[[I]], %[[K]] : i64
+// FORCE-NEXT: %[[M:.*]] = llvm.add %[[S]], %[[NK]] : i64
+// FORCE-NEXT: llvm.getelementptr %arg0[%[[M]]] : (!llvm.ptr, i64) -> !llvm.ptr, i32
+llvm.func @sum(%arg0: !llvm.ptr, %arg1: i64) -> i32 {
+  %0 = llvm.mlir.constant(0 : i64) : i64
+  %1 = llvm.mlir.constant(0 : i32) : i32
+  %2 = llvm.mlir.constant(1 : i64) : i64
+  llvm.br ^bb1(%0, %1 : i64, i32)
+^bb1(%3: i64, %4: i32):
+  %5 = llvm.getelementptr %arg0[%3] : (!llvm.ptr, i64) -> !llvm.ptr, i32
+  %6 = llvm.load %5 : !llvm.ptr -> i32
+  %7 = llvm.add %4, %6 : i32
+  %8 = llvm.add %3, %2 : i64
+  %9 = llvm.icmp "eq" %8, %arg1 : i64
+  llvm.cond_br %9, ^bb2, ^bb1(%8, %7 : i64, i32)
+^bb2:
+  llvm.return %7 : i32
+}
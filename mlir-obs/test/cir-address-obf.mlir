@@ -0,0 +1,46 @@
+// RUN: %obs-opt %s --allow-unregistered-dialect --pass-pipeline='builtin.module(cir-address-obf)' | FileCheck %s
+// RUN: %obs-opt %s --allow-unregistered-dialect --pass-pipeline='builtin.module(cir-address-obf{enable=false})' | FileCheck %s --check-prefix=OFF
+
+// The CIR ops stay unregistered; the pass matches them by name. One key
+// constant per index type at entry, shared by every masked access.
+
+// CHECK-LABEL: func.func @access
+// CHECK-NEXT: %[[K64:.*]] = arith.constant {{.*}} : i64
+// CHECK-NEXT: %[[KIDX:.*]] = arith.constant {{.*}} : index
+// CHECK-NEXT: %[[M1:.*]] = arith.xori %arg1, %[[K64]] : i64
+// CHECK-NEXT: %[[V:.*]] = "cir.load"(%arg0, %[[M1]])
+// CHECK-NEXT: %[[M2:.*]] = arith.xori %arg2, %[[KIDX]] : index
+// CHECK-NEXT: "cir.store"(%[[V]], %arg0, %[[M2]])
+// CHECK-NEXT: %[[M3:.*]] = arith.xori %arg1, %[[K64]] : i64
+// CHECK-NEXT: "cir.load"(%arg0, %[[M3]])
+
+// OFF-LABEL: func.func @access
+// OFF-NOT: arith.
+// OFF: return
+func.func @access(%p: !llvm.ptr, %i: i64, %j: index) -> i32 {
+  %v = "cir.load"(%p, %i) : (!llvm.ptr, i64) -> i32
+  "cir.store"(%v, %p, %j) : (i32, !llvm.ptr, index) -> ()
+  %w = "cir.load"(%p, %i) : (!llvm.ptr, i64) -> i32
+  return %w : i32
+}
+
+// Every gep index is masked, never the base pointer.
+
+// CHECK-LABEL: func.func @gep
+// CHECK-NEXT: %[[K:.*]] = arith.constant {{.*}} : index
+// CHECK-NEXT: %[[M1:.*]] = arith.xori %arg1, %[[K]] : index
+// CHECK-NEXT: %[[M2:.*]] = arith.xori %arg2, %[[K]] : index
+// CHECK-NEXT: "cir.gep"(%arg0, %[[M1]], %[[M2]])
+func.func @gep(%p: !llvm.ptr, %i: index, %j: index) -> !llvm.ptr {
+  %g = "cir.gep"(%p, %i, %j) : (!llvm.ptr, index, index) -> !llvm.ptr
+  return %g : !llvm.ptr
+}
+
+// No memory ops: no key.
+
+// CHECK-LABEL: func.func @no_access
+// CHECK-NOT: arith.constant
+// CHECK: return
+func.func @no_access(%i: i64) -> i64 {
+  return %i : i64
+}
@@ -0,0 +1,54 @@
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(llvm.func(constant-encode))' | FileCheck %s
+// RUN: %obs-opt %s --mlir-disable-threading --pass-pipeline='builtin.module(llvm.func(constant-encode))' | FileCheck %s
+
+// A function pass: every function is encoded on its own, and the output is
+// the same with and without threading.
+
+// Constants feeding cheap ops are encoded; the shift amount stays visible.
+
+// CHECK-LABEL: llvm.func @encode
+// CHECK-NEXT: %[[K:.*]] = obs.encoded_const {{.*}} : i32, {{.*}} : i32 : i32
+// CHECK-NEXT: %[[S:.*]] = llvm.add %arg0, %[[K]] : i32
+// CHECK-NEXT: %[[C3:.*]] = llvm.mlir.constant(3 : i32) : i32
+// CHECK-NEXT: llvm.shl %[[S]], %[[C3]] : i32
+llvm.func @encode(%arg0: i32) -> i32 attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(1234 : i32) : i32
+  %1 = llvm.add %arg0, %0 : i32
+  %2 = llvm.mlir.constant(3 : i32) : i32
+  %3 = llvm.shl %1, %2 : i32
+  llvm.return %3 : i32
+}
+
+// Each function gets its own keys.
+
+// CHECK-LABEL: llvm.func @encode_again
+// CHECK-NEXT: obs.encoded_const {{.*}} : i32, {{.*}} : i32 : i32
+// CHECK-NEXT: llvm.add
+llvm.func @encode_again(%arg0: i32) -> i32 attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(1234 : i32) : i32
+  %1 = llvm.add %arg0, %0 : i32
+  llvm.return %1 : i32
+}
+
+// Constants used inside a loop are left alone; the one only used after
+// the loop is encoded.
+
+// CHECK-LABEL: llvm.func @loop
+// CHECK-DAG: llvm.mlir.constant(0 : i64) : i64
+// CHECK-DAG: llvm.mlir.constant(1 : i64) : i64
+// CHECK-DAG: obs.encoded_const {{.*}} : i64, {{.*}} : i64 : i64
+// CHECK: ^bb2:
+// CHECK-NEXT: llvm.xor
+llvm.func @loop(%arg0: i64) -> i64 attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(0 : i64) : i64
+  %1 = llvm.mlir.constant(1 : i64) : i64
+  %2 = llvm.mlir.constant(99 : i64) : i64
+  llvm.br ^bb1(%0 : i64)
+^bb1(%3: i64):
+  %4 = llvm.add %3, %1 : i64
+  %5 = llvm.icmp "eq" %4, %arg0 : i64
+  llvm.cond_br %5, ^bb2, ^bb1(%4 : i64)
+^bb2:
+  %6 = llvm.xor %4, %2 : i64
+  llvm.return %6 : i64
+}
@@ -0,0 +1,68 @@
+// RUN: %obs-opt %s --allow-unregistered-dialect --pass-pipeline='builtin.module(convert-cir-to-func)' | FileCheck %s
+
+// The CIR ops stay unregistered and !cir.ptr<T> is an opaque type; the
+// signature step maps it to memref<?xT> and the body patterns follow.
+
+// A single-index gep takes the benefit-2 pattern, which keeps a constant
+// index as a static offset; the general pattern would pass %c5 through.
+
+// CHECK-LABEL: func.func @gep_single(%arg0: memref<?xi32>, %arg1: index) -> i32
+// CHECK-NOT: {{arith.addi|unrealized_conversion_cast}}
+// CHECK: %[[DIM:.*]] = memref.dim %arg0, %{{.*}} : memref<?xi32>
+// CHECK: %[[SIZE:.*]] = arith.subi %[[DIM]], %{{.*}} : index
+// CHECK-NEXT: %[[VIEW:.*]] = memref.subview %arg0[5] [%[[SIZE]]] [1] : memref<?xi32> to memref<?xi32, strided<[1], offset: 5>>
+// CHECK-NEXT: %[[V:.*]] = memref.load %[[VIEW]][%arg1]
+// CHECK-NEXT: return %[[V]] : i32
+"cir.func"() ({
+^bb0(%p: !cir.ptr<i32>, %i: index):
+  %c5 = arith.constant 5 : index
+  %g = "cir.gep"(%p, %c5) : (!cir.ptr<i32>, index) -> !cir.ptr<i32>
+  %v = "cir.load"(%g, %i) : (!cir.ptr<i32>, index) -> i32
+  "cir.return"(%v) : (i32) -> ()
+}) {sym_name = "gep_single", function_type = (!cir.ptr<i32>, index) -> i32} : () -> ()
+
+// Several indices go to the general pattern: summed, then one subview.
+
+// CHECK-LABEL: func.func @gep_multi(%arg0: memref<?xi32>, %arg1: index, %arg2: i64) -> i32
+// CHECK-NOT: unrealized_conversion_cast
+// CHECK: %[[J:.*]] = arith.index_cast %arg2 : i64 to index
+// CHECK-NEXT: %[[OFF:.*]] = arith.addi %arg1, %[[J]] : index
+// CHECK: %[[DIM:.*]] = memref.dim %arg0, %{{.*}} : memref<?xi32>
+// CHECK-NEXT: %[[SIZE:.*]] = arith.subi %[[DIM]], %[[OFF]] : index
+// CHECK-NEXT: %[[VIEW:.*]] = memref.subview %arg0[%[[OFF]]] [%[[SIZE]]] [1]
+// CHECK-NEXT: memref.load %[[VIEW]][%arg1]
+"cir.func"() ({
+^bb0(%p: !cir.ptr<i32>, %i: index, %j: i64):
+  %g = "cir.gep"(%p, %i, %j) : (!cir.ptr<i32>, index, i64) -> !cir.ptr<i32>
+  %v = "cir.load"(%g, %i) : (!cir.ptr<i32>, index) -> i32
+  "cir.return"(%v) : (i32) -> ()
+}) {sym_name = "gep_multi", function_type = (!cir.ptr<i32>, index, i64) -> i32} : () -> ()
+
+// A dynamic single index is cast to index, never summed.
+
+// CHECK-LABEL: func.func @gep_dynamic(%arg0: memref<?xf64>, %arg1: i64)
+// CHECK-NOT: arith.addi
+// CHECK: %[[I:.*]] = arith.index_cast %arg1 : i64 to index
+// CHECK-NOT: arith.addi
+// CHECK: memref.subview %arg0[%[[I]]]
+"cir.func"() ({
+^bb0(%p: !cir.ptr<f64>, %i: i64):
+  %c0 = arith.constant 0 : i64
+  %g = "cir.gep"(%p, %i) : (!cir.ptr<f64>, i64) -> !cir.ptr<f64>
+  %v = "cir.load"(%g, %c0) : (!cir.ptr<f64>, i64) -> f64
+  "cir.return"(%v) : (f64) -> ()
+}) {sym_name = "gep_dynamic", function_type = (!cir.ptr<f64>, i64) -> f64} : () -> ()
+
+// Loads and stores index the converted memref directly.
+
+// CHECK-LABEL: func.func @load_store(%arg0: memref<?xi32>, %arg1: i64, %arg2: i32)
+// CHECK-NEXT: %[[I:.*]] = arith.index_cast %arg1 : i64 to index
+// CHECK-NEXT: memref.store %arg2, %arg0[%[[I]]] : memref<?xi32>
+// CHECK-NEXT: %[[I2:.*]] = arith.index_cast %arg1 : i64 to index
+// CHECK-NEXT: memref.load %arg0[%[[I2]]] : memref<?xi32>
+"cir.func"() ({
+^bb0(%p: !cir.ptr<i32>, %i: i64, %x: i32):
+  "cir.store"(%x, %p, %i) : (i32, !cir.ptr<i32>, i64) -> ()
+  %v = "cir.load"(%p, %i) : (!cir.ptr<i32>, i64) -> i32
+  "cir.return"(%v) : (i32) -> ()
+}) {sym_name = "load_store", function_type = (!cir.ptr<i32>, i64, i32) -> i32} : () -> ()
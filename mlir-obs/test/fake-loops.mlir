@@ -0,0 +1,46 @@
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(fake-loops-plan{count=1},llvm.func(fake-loops))' | FileCheck %s
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(fake-loops-plan{count=1})' | FileCheck %s --check-prefix=PLAN
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(fake-loops-plan{count=0},llvm.func(fake-loops))' | FileCheck %s --check-prefix=NONE
+
+// fake-loops-plan marks the coldest block and creates the sink;
+// fake-loops splits that block and puts a never-entered loop in front.
+
+// PLAN: llvm.mlir.global internal @__obfs_fl_sink(0 : i32)
+// PLAN-LABEL: llvm.func @cold_path
+// PLAN: ^bb1:
+// PLAN-NEXT: llvm.mlir.constant(7 : i32) {obs.fake_loop = {{-?[0-9]+}} : i32} : i32
+
+// NONE-NOT: __obfs_fl_sink
+// NONE-NOT: obs.opaque_pred
+
+// CHECK: llvm.mlir.global internal @__obfs_fl_sink(0 : i32)
+// CHECK-LABEL: llvm.func @cold_path
+// CHECK: ^bb1:
+// CHECK-NEXT: %[[P:.*]] = obs.opaque_pred false
+// CHECK-NEXT: %[[INIT:.*]] = llvm.mlir.constant({{.*}} : i32) : i32
+// CHECK-NEXT: llvm.cond_br %[[P]], ^bb2(%[[INIT]] : i32), ^bb3
+// CHECK: ^bb2(%[[IV:.*]]: i32):
+// CHECK: llvm.mul %[[IV]]
+// CHECK: llvm.xor
+// CHECK: %[[SINK:.*]] = llvm.mlir.addressof @__obfs_fl_sink : !llvm.ptr
+// CHECK-NEXT: llvm.store volatile %{{.*}}, %[[SINK]]
+// CHECK: %[[NEXT:.*]] = llvm.add %[[IV]]
+// CHECK: %[[MORE:.*]] = llvm.icmp "slt" %[[NEXT]]
+// CHECK-NEXT: llvm.cond_br %[[MORE]], ^bb2(%[[NEXT]] : i32), ^bb3
+// CHECK: ^bb3:
+// CHECK-NEXT: llvm.mlir.constant(7 : i32) : i32
+// CHECK: ^bb4:
+// CHECK-NOT: obs.opaque_pred
+// CHECK-NOT: obs.fake_loop
+// CHECK: llvm.return
+llvm.func @cold_path(%arg0: i32) -> i32 attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(0 : i32) : i32
+  %1 = llvm.icmp "eq" %arg0, %0 : i32
+  llvm.cond_br %1 weights([1, 99]), ^bb1, ^bb2
+^bb1:
+  %2 = llvm.mlir.constant(7 : i32) : i32
+  llvm.return %2 : i32
+^bb2:
+  %3 = llvm.add %arg0, %arg0 : i32
+  llvm.return %3 : i32
+}
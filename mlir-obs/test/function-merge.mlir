@@ -0,0 +1,124 @@
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(function-merge)' | FileCheck %s
+
+// Without a profile, the static hotness estimate calls most straight-line
+// code in a small module hot, and merged bodies are kept out of hot code;
+// obs.policy = "max" opts the functions in.
+
+// Same body up to two constants: one merged body, constants picked by the
+// selector, and both functions become thunks.
+
+// CHECK-LABEL: llvm.func internal @__obfs_merged_0(%arg0: i32, %arg1: i32) -> i32
+// CHECK-SAME: no_inline
+// CHECK-DAG: %[[C3:.*]] = llvm.mlir.constant(3 : i32) : i32
+// CHECK-DAG: %[[C5:.*]] = llvm.mlir.constant(5 : i32) : i32
+// CHECK: %[[IS1:.*]] = llvm.icmp "eq" %arg0, %{{.*}} : i32
+// CHECK: %[[K:.*]] = llvm.select %[[IS1]], %[[C5]], %[[C3]] : i1, i32
+// CHECK: %[[MUL:.*]] = llvm.mul %arg1, %[[K]] : i32
+// CHECK-DAG: %[[C7:.*]] = llvm.mlir.constant(7 : i32) : i32
+// CHECK-DAG: %[[C11:.*]] = llvm.mlir.constant(11 : i32) : i32
+// CHECK: %[[IS1B:.*]] = llvm.icmp "eq" %arg0, %{{.*}} : i32
+// CHECK: %[[B:.*]] = llvm.select %[[IS1B]], %[[C11]], %[[C7]] : i1, i32
+// CHECK: llvm.add %[[MUL]], %[[B]] : i32
+
+// CHECK-LABEL: llvm.func @scale_a(%arg0: i32) -> i32
+// CHECK-SAME: always_inline
+// CHECK-NEXT: %[[SEL:.*]] = llvm.mlir.constant(0 : i32) : i32
+// CHECK-NEXT: %[[R:.*]] = llvm.call @__obfs_merged_0(%[[SEL]], %arg0) : (i32, i32) -> i32
+// CHECK-NEXT: llvm.return %[[R]] : i32
+llvm.func @scale_a(%arg0: i32) -> i32 attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(3 : i32) : i32
+  %1 = llvm.mul %arg0, %0 : i32
+  %2 = llvm.mlir.constant(7 : i32) : i32
+  %3 = llvm.add %1, %2 : i32
+  %4 = llvm.xor %3, %arg0 : i32
+  %5 = llvm.shl %4, %0 : i32
+  %6 = llvm.sub %5, %1 : i32
+  llvm.return %6 : i32
+}
+
+// CHECK-LABEL: llvm.func @scale_b(%arg0: i32) -> i32
+// CHECK-SAME: always_inline
+// CHECK-NEXT: %[[SEL:.*]] = llvm.mlir.constant(1 : i32) : i32
+// CHECK-NEXT: %[[R:.*]] = llvm.call @__obfs_merged_0(%[[SEL]], %arg0) : (i32, i32) -> i32
+// CHECK-NEXT: llvm.return %[[R]] : i32
+llvm.func @scale_b(%arg0: i32) -> i32 attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(5 : i32) : i32
+  %1 = llvm.mul %arg0, %0 : i32
+  %2 = llvm.mlir.constant(11 : i32) : i32
+  %3 = llvm.add %1, %2 : i32
+  %4 = llvm.xor %3, %arg0 : i32
+  %5 = llvm.shl %4, %0 : i32
+  %6 = llvm.sub %5, %1 : i32
+  llvm.return %6 : i32
+}
+
+// Parameter attributes are part of the ABI: they carry over to the merged
+// body (after the selector) and its call in the thunk, and a function with
+// different ones is not merged.
+
+// CHECK-LABEL: llvm.func internal @__obfs_merged_1(%arg0: i32, %arg1: !llvm.ptr {llvm.sret = i64}, %arg2: !llvm.ptr)
+// CHECK-SAME: no_inline
+// CHECK: llvm.store %{{.*}}, %arg1 : i64, !llvm.ptr
+
+// CHECK-LABEL: llvm.func @ret_a(%arg0: !llvm.ptr {llvm.sret = i64}, %arg1: !llvm.ptr)
+// CHECK: llvm.call @__obfs_merged_1(%{{.*}}, %arg0, %arg1)
+// CHECK-NOT: llvm.load
+// CHECK: llvm.return
+llvm.func @ret_a(%arg0: !llvm.ptr {llvm.sret = i64}, %arg1: !llvm.ptr) attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(1 : i64) : i64
+  %1 = llvm.load %arg1 : !llvm.ptr -> i64
+  %2 = llvm.mul %1, %0 : i64
+  %3 = llvm.add %2, %1 : i64
+  %4 = llvm.xor %3, %0 : i64
+  %5 = llvm.or %4, %1 : i64
+  llvm.store %5, %arg0 : i64, !llvm.ptr
+  llvm.return
+}
+
+// CHECK-LABEL: llvm.func @ret_b(%arg0: !llvm.ptr {llvm.sret = i64}, %arg1: !llvm.ptr)
+// CHECK: llvm.call @__obfs_merged_1(%{{.*}}, %arg0, %arg1)
+llvm.func @ret_b(%arg0: !llvm.ptr {llvm.sret = i64}, %arg1: !llvm.ptr) attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(2 : i64) : i64
+  %1 = llvm.load %arg1 : !llvm.ptr -> i64
+  %2 = llvm.mul %1, %0 : i64
+  %3 = llvm.add %2, %1 : i64
+  %4 = llvm.xor %3, %0 : i64
+  %5 = llvm.or %4, %1 : i64
+  llvm.store %5, %arg0 : i64, !llvm.ptr
+  llvm.return
+}
+
+// CHECK-LABEL: llvm.func @ret_plain(%arg0: !llvm.ptr, %arg1: !llvm.ptr)
+// CHECK-NOT: always_inline
+// CHECK: llvm.load %arg1
+// CHECK-NOT: llvm.call
+llvm.func @ret_plain(%arg0: !llvm.ptr, %arg1: !llvm.ptr) attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(3 : i64) : i64
+  %1 = llvm.load %arg1 : !llvm.ptr -> i64
+  %2 = llvm.mul %1, %0 : i64
+  %3 = llvm.add %2, %1 : i64
+  %4 = llvm.xor %3, %0 : i64
+  %5 = llvm.or %4, %1 : i64
+  llvm.store %5, %arg0 : i64, !llvm.ptr
+  llvm.return
+}
+
+// Below min-ops: kept as is.
+
+// CHECK-LABEL: llvm.func @tiny_a(%arg0: i32) -> i32
+// CHECK-NOT: llvm.call
+// CHECK: llvm.add
+llvm.func @tiny_a(%arg0: i32) -> i32 attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(1 : i32) : i32
+  %1 = llvm.add %arg0, %0 : i32
+  llvm.return %1 : i32
+}
+
+// CHECK-LABEL: llvm.func @tiny_b(%arg0: i32) -> i32
+// CHECK-NOT: llvm.call
+// CHECK: llvm.add
+llvm.func @tiny_b(%arg0: i32) -> i32 attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(2 : i32) : i32
+  %1 = llvm.add %arg0, %0 : i32
+  llvm.return %1 : i32
+}
@@ -0,0 +1,42 @@
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(fused-obfuscate{transforms=crypto-hash,symbol-obfuscate,string-encrypt})' -o %t.fused
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(string-encrypt,symbol-obfuscate,crypto-hash)' -o %t.separate
+// RUN: diff %t.fused %t.separate
+// RUN: FileCheck %s --input-file=%t.fused
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(string-encrypt,symbol-obfuscate)' | FileCheck %s --check-prefix=CTOR
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(string-encrypt,crypto-hash)' | FileCheck %s --check-prefix=CTOR
+
+// One walk gives the same module as the three passes run one after another
+// in the fixed order (strings, random names, hashed names), whatever order
+// `transforms` lists them in. @main keeps its name; @greet and the string
+// do not survive.
+
+// CHECK-NOT: hello
+// CHECK-NOT: @greet
+// CHECK-DAG: llvm.mlir.global_ctors
+// CHECK-DAG: llvm.func @main()
+// CHECK-NOT: hello
+// CHECK-NOT: @greet
+
+// The standalone renaming passes follow __obfs_init into the global_ctors
+// entry string-encrypt added for it.
+
+// CTOR-NOT: __obfs_init
+// CTOR: llvm.func @[[INIT:f_[0-9a-f]+]]() attributes {no_inline}
+// CTOR-NOT: __obfs_init
+// CTOR: llvm.mlir.global_ctors {{.*}}[@[[INIT]]]
+// CTOR-NOT: __obfs_init
+
+llvm.mlir.global internal constant @".str"("hello\00") {addr_space = 0 : i32}
+
+llvm.func @puts(!llvm.ptr) -> i32
+
+llvm.func @greet() -> i32 attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.addressof @".str" : !llvm.ptr
+  %1 = llvm.call @puts(%0) : (!llvm.ptr) -> i32
+  llvm.return %1 : i32
+}
+
+llvm.func @main() -> i32 {
+  %0 = llvm.call @greet() : () -> i32
+  llvm.return %0 : i32
+}
@@ -0,0 +1,33 @@
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(import-obfuscate)' | FileCheck %s
+
+// Calls to an import go through obs.resolve_import and keep the original
+// call's attributes.
+
+llvm.func @sqrt(f64) -> f64
+
+// CHECK-DAG: llvm.mlir.global internal @__obfs_fp_sqrt()
+// CHECK-DAG: llvm.func internal @__obfs_resolve_sqrt() -> !llvm.ptr
+// CHECK-DAG: llvm.call @dlsym
+
+// CHECK-LABEL: llvm.func @root
+// CHECK-NEXT: %[[FP:.*]] = obs.resolve_import @__obfs_resolve_sqrt : !llvm.ptr
+// CHECK-NEXT: %[[R:.*]] = llvm.call %[[FP]](%arg0) {{.*}}fastmathFlags = #llvm.fastmath<fast>{{.*}} : !llvm.ptr, (f64) -> f64
+// CHECK-NEXT: %[[FP2:.*]] = obs.resolve_import @__obfs_resolve_sqrt : !llvm.ptr
+// CHECK-NEXT: llvm.call %[[FP2]](%[[R]]) {{.*}}test.tag{{.*}} : !llvm.ptr, (f64) -> f64
+// CHECK-NOT: llvm.call @sqrt
+// CHECK: llvm.return
+llvm.func @root(%arg0: f64) -> f64 attributes {obs.policy = "max"} {
+  %0 = llvm.call @sqrt(%arg0) {fastmathFlags = #llvm.fastmath<fast>} : (f64) -> f64
+  %1 = llvm.call @sqrt(%0) {test.tag} : (f64) -> f64
+  llvm.return %1 : f64
+}
+
+// A call with operand bundles is left direct.
+
+// CHECK-LABEL: llvm.func @bundled
+// CHECK-NOT: obs.resolve_import
+// CHECK: llvm.call @sqrt(%arg0) ["align"(%arg1 : i64)] : (f64) -> f64
+llvm.func @bundled(%arg0: f64, %arg1: i64) -> f64 attributes {obs.policy = "max"} {
+  %0 = llvm.call @sqrt(%arg0) ["align"(%arg1 : i64)] : (f64) -> f64
+  llvm.return %0 : f64
+}
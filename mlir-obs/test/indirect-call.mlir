@@ -0,0 +1,73 @@
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(indirect-call-table,llvm.func(indirect-call))' | FileCheck %s
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(indirect-call-table,llvm.func(indirect-call{fast-path=true}))' | FileCheck %s --check-prefix=FAST
+
+// Slots are numbered in first-use order: @puts, then @helper. Each entry
+// is ptrtoint(@f) + key, in a 64-byte aligned table.
+
+// CHECK: llvm.mlir.global internal @__obfs_icall_table() {{.*}}alignment = 64{{.*}} : !llvm.array<2 x i64>
+// CHECK: llvm.mlir.addressof @puts
+// CHECK: llvm.mlir.addressof @helper
+
+llvm.func @puts(!llvm.ptr) -> i32
+
+llvm.func @helper(%arg0: i32) -> i32 attributes {obs.policy = "max"} {
+  %0 = llvm.add %arg0, %arg0 : i32
+  llvm.return %0 : i32
+}
+
+// Each site loads its slot, subtracts the encoded key and calls through
+// the result. The slot marks are gone afterwards.
+
+// CHECK-LABEL: llvm.func @caller
+// CHECK: %[[K0:.*]] = obs.encoded_const
+// CHECK-NEXT: %[[T0:.*]] = llvm.mlir.addressof @__obfs_icall_table : !llvm.ptr
+// CHECK-NEXT: %[[S0:.*]] = llvm.getelementptr %[[T0]][0] : (!llvm.ptr) -> !llvm.ptr, i64
+// CHECK-NEXT: %[[E0:.*]] = llvm.load %[[S0]] : !llvm.ptr -> i64
+// CHECK-NEXT: %[[R0:.*]] = llvm.sub %[[E0]], %[[K0]] : i64
+// CHECK-NEXT: %[[FP0:.*]] = llvm.inttoptr %[[R0]] : i64 to !llvm.ptr
+// CHECK-NEXT: llvm.call %[[FP0]](%arg0) : !llvm.ptr, (!llvm.ptr) -> i32
+// CHECK: llvm.getelementptr %{{.*}}[1] : (!llvm.ptr) -> !llvm.ptr, i64
+// CHECK: llvm.call %{{.*}}(%arg1) : !llvm.ptr, (i32) -> i32
+// CHECK: llvm.getelementptr %{{.*}}[0] : (!llvm.ptr) -> !llvm.ptr, i64
+// CHECK-NOT: obs.icall_slot
+// CHECK-NOT: llvm.call @
+
+// With fast-path, the direct call stays behind a pointer comparison.
+
+// FAST-LABEL: llvm.func @caller
+// FAST: %[[FP:.*]] = llvm.inttoptr
+// FAST-NEXT: %[[D:.*]] = llvm.mlir.addressof @puts : !llvm.ptr
+// FAST-NEXT: %[[EQ:.*]] = llvm.icmp "eq" %[[FP]], %[[D]] : !llvm.ptr
+// FAST-NEXT: llvm.cond_br %[[EQ]], ^bb1, ^bb2
+// FAST: ^bb1:
+// FAST-NEXT: %[[DR:.*]] = llvm.call @puts(%arg0) : (!llvm.ptr) -> i32
+// FAST-NEXT: llvm.br ^bb3(%[[DR]] : i32)
+// FAST: ^bb2:
+// FAST-NEXT: %[[IR:.*]] = llvm.call %[[FP]](%arg0) : !llvm.ptr, (!llvm.ptr) -> i32
+// FAST-NEXT: llvm.br ^bb3(%[[IR]] : i32)
+llvm.func @caller(%arg0: !llvm.ptr, %arg1: i32) -> i32 attributes {obs.policy = "max"} {
+  %0 = llvm.call @puts(%arg0) : (!llvm.ptr) -> i32
+  %1 = llvm.call @helper(%arg1) : (i32) -> i32
+  %2 = llvm.call @puts(%arg0) : (!llvm.ptr) -> i32
+  %3 = llvm.add %0, %1 : i32
+  %4 = llvm.add %3, %2 : i32
+  llvm.return %4 : i32
+}
+
+// Calls inside loops stay direct.
+
+// CHECK-LABEL: llvm.func @looped
+// CHECK: ^bb1(
+// CHECK-NEXT: llvm.call @helper(%{{.*}}) : (i32) -> i32
+llvm.func @looped(%arg0: i32) attributes {obs.policy = "max"} {
+  %0 = llvm.mlir.constant(0 : i32) : i32
+  %1 = llvm.mlir.constant(1 : i32) : i32
+  llvm.br ^bb1(%0 : i32)
+^bb1(%2: i32):
+  %3 = llvm.call @helper(%2) : (i32) -> i32
+  %4 = llvm.add %2, %1 : i32
+  %5 = llvm.icmp "eq" %4, %arg0 : i32
+  llvm.cond_br %5, ^bb2, ^bb1(%4 : i32)
+^bb2:
+  llvm.return
+}
@@ -0,0 +1,28 @@
+# -*- Python -*-
+
+import os
+
+import lit.formats
+from lit.llvm import llvm_config
+
+config.name = "MLIR_OBS"
+config.test_format = lit.formats.ShTest(not llvm_config.use_lit_shell)
+config.suffixes = [".mlir"]
+
+config.test_source_root = os.path.dirname(__file__)
+config.test_exec_root = os.path.join(config.obs_obj_root, "test")
+config.excludes = ["CMakeLists.txt", "lit.cfg.py", "lit.site.cfg.py"]
+
+llvm_config.use_default_substitutions()
+
+# `%obs-opt` is mlir-opt with the passes and the obs dialect loaded from the
+# plugin, the way the Python CLI's mlir-opt chain runs them.
+config.substitutions.append(
+    ("%obs-opt",
+     "mlir-opt --load-dialect-plugin={0} --load-pass-plugin={0}".format(
+         config.obs_plugin)))
+
+llvm_config.with_environment("PATH", config.llvm_tools_dir, append_path=True)
+llvm_config.add_tool_substitutions(
+    ["mlir-opt", "mlir-obfuscate"],
+    [config.obs_tools_dir, config.llvm_tools_dir])
@@ -0,0 +1,167 @@
+// RUN: %obs-opt %s --pass-pipeline='builtin.module(obs-lower)' | FileCheck %s
+// RUN: %obs-opt %s --canonicalize | FileCheck %s --check-prefix=FOLD
+
+// Pure obs ops are evaluated once, at entry, however many blocks use them.
+
+// CHECK-LABEL: llvm.func @pure
+// CHECK: %[[P:.*]] = llvm.icmp "eq"
+// CHECK-NEXT: llvm.mlir.constant(12 : i64) : i64
+// CHECK-NEXT: llvm.inline_asm
+// CHECK-NEXT: llvm.mlir.constant(5 : i64) : i64
+// CHECK-NEXT: %[[X:.*]] = llvm.xor
+// CHECK-NEXT: llvm.cond_br %arg0, ^bb1, ^bb2
+// CHECK: ^bb1:
+// CHECK-NEXT: llvm.select %[[P]], %[[X]]
+// CHECK: ^bb2:
+// CHECK-NOT: llvm.xor
+// CHECK-NOT: llvm.icmp
+// CHECK: llvm.select %[[P]], %[[X]]
+llvm.func @pure(%arg0: i1, %arg1: i64) -> i64 {
+  llvm.cond_br %arg0, ^bb1, ^bb2
+^bb1:
+  %0 = obs.opaque_pred true
+  %1 = obs.encoded_const 12 : i64, 5 : i64 : i64
+  %2 = llvm.select %0, %1, %arg1 : i1, i64
+  llvm.return %2 : i64
+^bb2:
+  %3 = obs.opaque_pred true
+  %4 = obs.encoded_const 12 : i64, 5 : i64 : i64
+  %5 = llvm.select %3, %4, %arg1 : i1, i64
+  llvm.return %5 : i64
+}
+
+// A zero key folds to a plain constant.
+
+// FOLD-LABEL: llvm.func @fold
+// FOLD-NEXT: %[[C:.*]] = llvm.mlir.constant(42 : i32) : i32
+// FOLD-NEXT: llvm.return %[[C]] : i32
+llvm.func @fold() -> i32 {
+  %0 = obs.encoded_const 42 : i32, 0 : i32 : i32
+  llvm.return %0 : i32
+}
+
+llvm.func @__obfs_resolve_puts() -> !llvm.ptr
+
+// A resolve in a loop runs once, before the loop; the second resolve in
+// the same block is dominated by the first and reuses it.
+
+// CHECK-LABEL: llvm.func @loop
+// CHECK: %[[FP:.*]] = llvm.call @__obfs_resolve_puts() : () -> !llvm.ptr
+// CHECK-NEXT: llvm.br ^bb1
+// CHECK: ^bb1(
+// CHECK-NEXT: llvm.call %[[FP]](%arg0)
+// CHECK-NEXT: llvm.call %[[FP]](%arg0)
+// CHECK-NOT: @__obfs_resolve_puts
+// CHECK: llvm.return
+llvm.func @loop(%arg0: !llvm.ptr, %arg1: i64) {
+  %0 = llvm.mlir.constant(0 : i64) : i64
+  %1 = llvm.mlir.constant(1 : i64) : i64
+  llvm.br ^bb1(%0 : i64)
+^bb1(%2: i64):
+  %3 = obs.resolve_import @__obfs_resolve_puts : !llvm.ptr
+  %4 = llvm.call %3(%arg0) : !llvm.ptr, (!llvm.ptr) -> i32
+  %5 = obs.resolve_import @__obfs_resolve_puts : !llvm.ptr
+  %6 = llvm.call %5(%arg0) : !llvm.ptr, (!llvm.ptr) -> i32
+  %7 = llvm.add %2, %1 : i64
+  %8 = llvm.icmp "eq" %7, %arg1 : i64
+  llvm.cond_br %8, ^bb2, ^bb1(%7 : i64)
+^bb2:
+  llvm.return
+}
+
+// Outside loops a resolve stays where it is: neither branch dominates the
+// other or the join, so only the join's second resolve is dropped.
+
+// CHECK-LABEL: llvm.func @branches
+// CHECK-NOT: @__obfs_resolve_puts
+// CHECK: llvm.cond_br
+// CHECK: ^bb1:
+// CHECK-NEXT: %[[A:.*]] = llvm.call @__obfs_resolve_puts()
+// CHECK-NEXT: llvm.call %[[A]](%arg1)
+// CHECK: ^bb2:
+// CHECK-NEXT: %[[B:.*]] = llvm.call @__obfs_resolve_puts()
+// CHECK-NEXT: llvm.call %[[B]](%arg1)
+// CHECK: ^bb3:
+// CHECK-NEXT: %[[C:.*]] = llvm.call @__obfs_resolve_puts()
+// CHECK-NEXT: llvm.call %[[C]](%arg1)
+// CHECK-NEXT: llvm.call %[[C]](%arg1)
+// CHECK-NEXT: llvm.return
+llvm.func @branches(%arg0: i1, %arg1: !llvm.ptr) {
+  llvm.cond_br %arg0, ^bb1, ^bb2
+^bb1:
+  %0 = obs.resolve_import @__obfs_resolve_puts : !llvm.ptr
+  %1 = llvm.call %0(%arg1) : !llvm.ptr, (!llvm.ptr) -> i32
+  llvm.br ^bb3
+^bb2:
+  %2 = obs.resolve_import @__obfs_resolve_puts : !llvm.ptr
+  %3 = llvm.call %2(%arg1) : !llvm.ptr, (!llvm.ptr) -> i32
+  llvm.br ^bb3
+^bb3:
+  %4 = obs.resolve_import @__obfs_resolve_puts : !llvm.ptr
+  %5 = llvm.call %4(%arg1) : !llvm.ptr, (!llvm.ptr) -> i32
+  %6 = obs.resolve_import @__obfs_resolve_puts : !llvm.ptr
+  %7 = llvm.call %6(%arg1) : !llvm.ptr, (!llvm.ptr) -> i32
+  llvm.return
+}
+
+llvm.mlir.global internal @msg("hello") : !llvm.array<5 x i8>
+llvm.func @__obfs_decrypt(!llvm.ptr, i32)
+llvm.func @puts(!llvm.ptr) -> i32
+
+// Decrypts of the same global are pure: they dedup into one call at entry,
+// whichever branches used them.
+
+// CHECK-LABEL: llvm.func @decrypt
+// CHECK-NEXT: %[[S:.*]] = llvm.call @__obfs_decrypt_once_msg() : () -> !llvm.ptr
+// CHECK-NEXT: llvm.cond_br %arg0, ^bb1, ^bb2
+// CHECK: ^bb1:
+// CHECK-NEXT: llvm.call @puts(%[[S]])
+// CHECK: ^bb2:
+// CHECK-NEXT: llvm.call @puts(%[[S]])
+// CHECK-NEXT: llvm.call @puts(%[[S]])
+llvm.func @decrypt(%arg0: i1) {
+  llvm.cond_br %arg0, ^bb1, ^bb2
+^bb1:
+  %0 = obs.decrypt @msg, 5 : !llvm.ptr
+  %1 = llvm.call @puts(%0) : (!llvm.ptr) -> i32
+  llvm.return
+^bb2:
+  %2 = obs.decrypt @msg, 5 : !llvm.ptr
+  %3 = llvm.call @puts(%2) : (!llvm.ptr) -> i32
+  %4 = obs.decrypt @msg, 5 : !llvm.ptr
+  %5 = llvm.call @puts(%4) : (!llvm.ptr) -> i32
+  llvm.return
+}
+
+// Nothing to decrypt: the global's address, no helper.
+
+// CHECK-LABEL: llvm.func @empty
+// CHECK-NEXT: %[[A:.*]] = llvm.mlir.addressof @msg : !llvm.ptr
+// CHECK-NEXT: llvm.return %[[A]]
+// FOLD-LABEL: llvm.func @empty
+// FOLD-NEXT: %[[A:.*]] = llvm.mlir.addressof @msg : !llvm.ptr
+// FOLD-NEXT: llvm.return %[[A]]
+llvm.func @empty() -> !llvm.ptr {
+  %0 = obs.decrypt @msg, 0 : !llvm.ptr
+  llvm.return %0 : !llvm.ptr
+}
+
+// One helper per global. The thread whose cmpxchg claims the state word
+// decrypts and publishes it with a release store; the others spin on
+// acquire loads until it is published.
+
+// CHECK: llvm.mlir.global internal @__obfs_dstate_msg(0 : i32)
+// CHECK-NOT: @__obfs_dstate_
+// CHECK-LABEL: llvm.func internal @__obfs_decrypt_once_msg() -> !llvm.ptr
+// CHECK: %[[STATE:.*]] = llvm.mlir.addressof @__obfs_dstate_msg : !llvm.ptr
+// CHECK: llvm.load %[[STATE]] atomic acquire {alignment = 4 : i64} : !llvm.ptr -> i32
+// CHECK: ^bb1:
+// CHECK-NEXT: llvm.cmpxchg %[[STATE]], %{{.*}}, %{{.*}} acq_rel acquire
+// CHECK: ^bb2:
+// CHECK: llvm.call @__obfs_decrypt(%{{.*}}, %{{.*}}) : (!llvm.ptr, i32) -> ()
+// CHECK-NEXT: llvm.store %{{.*}}, %[[STATE]] atomic release {alignment = 4 : i64} : i32, !llvm.ptr
+// CHECK: ^bb3:
+// CHECK-NEXT: llvm.load %[[STATE]] atomic acquire {alignment = 4 : i64} : !llvm.ptr -> i32
+// CHECK: ^bb4:
+// CHECK-NEXT: %[[R:.*]] = llvm.mlir.addressof @msg : !llvm.ptr
+// CHECK-NEXT: llvm.return %[[R]] : !llvm.ptr
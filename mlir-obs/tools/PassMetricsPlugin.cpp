@@ -0,0 +1,181 @@
+// ObsPassMetrics: opt pass plugin that records an IR metrics snapshot after
+// every pass of the pipeline, without printing or re-parsing the IR.
+//
+//   opt -load-pass-plugin=ObsPassMetrics.so -obs-pass-metrics=metrics.json \
+//       -load-pass-plugin=LLVMObfuscationPlugin.so -passes=flattening,... in.bc
+//
+// Module passes are measured by recounting the module. Function passes run
+// function by function, so each run recounts only its function and adds
+// the difference to that pass's entry; entry k of the timeline is the
+// module as if every function had been through the first k passes. Passes
+// that preserve all analyses are recorded without recounting. The JSON
+// timeline (see PassMetrics.h) is rewritten after every module-level pass,
+// so it is complete whenever opt exits normally.
+
+#include "Obfuscator/PassMetrics.h"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassInstrumentation.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Passes/PassPlugin.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+using namespace mlir::obs;
+
+static cl::opt<std::string> passMetricsFile(
+    "obs-pass-metrics",
+    cl::desc("Write an IR metrics snapshot after every pass to this JSON file"),
+    cl::value_desc("filename"));
+
+namespace {
+
+class PassMetricsRecorder {
+public:
+  explicit PassMetricsRecorder(PassInstrumentationCallbacks &callbacks)
+      : callbacks(callbacks) {}
+
+  void beforePass(StringRef, Any ir) {
+    if (started)
+      return;
+    if (const auto *module = any_cast<const Module *>(&ir))
+      recount(**module);
+    else if (const auto *function = any_cast<const Function *>(&ir))
+      recount(*(*function)->getParent());
+    else
+      return;
+    input = current;
+    started = true;
+  }
+
+  void afterPass(StringRef passID, Any ir, const PreservedAnalyses &preserved) {
+    if (!started)
+      return;
+    // Pass managers only group passes that are recorded themselves; opt
+    // adds the verifier and the writer around the pipeline
+    if (passID.contains("PassManager") || passID == "VerifierPass" ||
+        passID == "BitcodeWriterPass" || passID == "PrintModulePass")
+      return;
+
+    if (const auto *functionPtr = any_cast<const Function *>(&ir)) {
+      const Function *function = *functionPtr;
+      unsigned label = labelOf(passID);
+      Entry &entry = entryFor(label, ++functionRuns[{function, label}]);
+      if (preserved.areAllPreserved())
+        return;
+      IRCounts counts = countFunction(*function);
+      IRCounts &previous = functionCounts[function];
+      IRCounts delta = counts - previous;
+      previous = counts;
+      entry.delta += delta;
+      current += delta;
+      return;
+    }
+
+    const auto *modulePtr = any_cast<const Module *>(&ir);
+    if (!modulePtr)
+      return;
+    // Its function passes were recorded one by one
+    if (passID != "ModuleToFunctionPassAdaptor") {
+      unsigned label = labelOf(passID);
+      Entry &entry = entryFor(label, ++moduleRuns[label]);
+      if (!preserved.areAllPreserved()) {
+        IRCounts before = current;
+        recount(**modulePtr);
+        entry.delta += current - before;
+      }
+    }
+    write();
+  }
+
+private:
+  struct Entry {
+    unsigned label;
+    IRCounts delta;
+  };
+
+  // Counts every function afresh; module passes may add or delete them
+  void recount(const Module &module) {
+    functionCounts.clear();
+    current = IRCounts();
+    for (const Function &function : module) {
+      IRCounts counts = countFunction(function);
+      functionCounts[&function] = counts;
+      current += counts;
+    }
+    current.globals = module.global_size();
+  }
+
+  unsigned labelOf(StringRef passID) {
+    StringRef name = callbacks.getPassNameForClassName(passID);
+    if (name.empty())
+      name = passID;
+    auto inserted = labelIds.try_emplace(name, labels.size());
+    if (inserted.second)
+      labels.push_back(name.str());
+    return inserted.first->second;
+  }
+
+  // The run-th run of a pass, in order of first appearance
+  Entry &entryFor(unsigned label, unsigned run) {
+    auto inserted = entryIndex.try_emplace({label, run}, entries.size());
+    if (inserted.second)
+      entries.push_back({label, IRCounts()});
+    return entries[inserted.first->second];
+  }
+
+  void write() const {
+    PassMetricsTimeline timeline("llvm");
+    IRCounts counts = input;
+    timeline.add("input", counts);
+    for (const Entry &entry : entries) {
+      counts += entry.delta;
+      timeline.add(labels[entry.label], counts);
+    }
+    std::string error = timeline.write(passMetricsFile);
+    if (!error.empty())
+      errs() << "obs-pass-metrics: " << passMetricsFile << ": " << error << "\n";
+  }
+
+  PassInstrumentationCallbacks &callbacks;
+  bool started = false;
+  IRCounts input;
+  IRCounts current;
+  DenseMap<const Function *, IRCounts> functionCounts;
+
+  std::vector<std::string> labels;
+  StringMap<unsigned> labelIds;
+  DenseMap<std::pair<const Function *, unsigned>, unsigned> functionRuns;
+  DenseMap<unsigned, unsigned> moduleRuns;
+  DenseMap<std::pair<unsigned, unsigned>, size_t> entryIndex;
+  std::vector<Entry> entries;
+};
+
+} // namespace
+
+static void registerCallbacks(PassBuilder &builder) {
+  PassInstrumentationCallbacks *callbacks = builder.getPassInstrumentationCallbacks();
+  if (passMetricsFile.empty() || !callbacks)
+    return;
+  // Lives as long as opt's pass builder, which outlives every pipeline
+  static PassMetricsRecorder recorder(*callbacks);
+  callbacks->registerBeforeNonSkippedPassCallback(
+      [](StringRef passID, Any ir) { recorder.beforePass(passID, std::move(ir)); });
+  callbacks->registerAfterPassCallback(
+      [](StringRef passID, Any ir, const PreservedAnalyses &preserved) {
+        recorder.afterPass(passID, std::move(ir), preserved);
+      });
+}
+
+extern "C" LLVM_ATTRIBUTE_WEAK PassPluginLibraryInfo llvmGetPassPluginInfo() {
+  return {LLVM_PLUGIN_API_VERSION, "ObsPassMetrics", LLVM_VERSION_STRING,
+          registerCallbacks};
+}
@@ -1,71 +1,623 @@
-#include "Obfuscator/Passes.h"
+// mlir-obfuscate: LLVM IR in, obfuscated LLVM IR out, in one process.
+//
+// Replaces the mlir-translate --import-llvm | mlir-opt --load-pass-plugin |
+// mlir-translate --mlir-to-llvmir chain: the module is imported, run through
+// the pass pipeline and exported in memory, and the obfuscation passes are
+// linked in rather than loaded as a plugin.
+//
+//   mlir-obfuscate app.ll -o app.bc \
+//       --pass-pipeline='builtin.module(string-encrypt,symbol-obfuscate,obs-lower)'
+//   mlir-obfuscate app.bc -S -o app.ll --pipeline-file=passes.txt
+//
+// The usual mlir-opt pass manager options apply (--mlir-pass-statistics,
+// --mlir-timing, ...). --threads=N sizes the pool function passes run on
+// (default: all hardware threads, 1: no threading); the output does not
+// depend on it. Passes that only run on functions (address-obfuscation,
+// scf-obfuscate) are nested on them implicitly, as in mlir-opt.
+// --statistics-json=stats.json writes every pass statistic as JSON, per
+// pass and summed over the pipeline; "statistics-enabled" is false in
+// builds without LLVM statistics, where every counter reads 0.
+// --pass-metrics-json=metrics.json records the module's size (instructions,
+// blocks, edges, calls, globals) after every top-level pass, as the
+// ObsPassMetrics opt plugin does for the LLVM pipeline.
+//
+// The exported module is repaired in memory before it is written:
+// declarations the import dropped are re-added, --target-triple and
+// --data-layout override the target, and --strip-attrs removes function
+// and call-site attributes (e.g. target-cpu, memory) by name.
+//
+// MLIR is persisted as bytecode: --emit-mlir=app.mlirbc keeps the obfuscated
+// module (text only if the name ends in .mlir), and .mlirbc/.mlir inputs skip
+// the LLVM IR import. --print-functions=main,foo prints just those functions
+// of a bytecode file; the other function bodies are never materialized.
+
 #include "Obfuscator/Config.h"
-#include "CIR/Passes.h"
-#include "mlir/IR/MLIRContext.h"
-#include "mlir/Pass/Pass.h"
-#include "mlir/Pass/PassManager.h"
-#include "mlir/Tools/mlir-opt/MlirOptMain.h"
-#include "mlir/InitAllDialects.h"
-#include "mlir/InitAllPasses.h"
+#include "Obfuscator/ObsDialect.h"
+#include "Obfuscator/PassMetrics.h"
+#include "Obfuscator/Passes.h"
+
+#include "mlir/Bytecode/BytecodeReader.h"
+#include "mlir/Bytecode/BytecodeWriter.h"
+#include "mlir/Dialect/DLTI/DLTI.h"
 #include "mlir/Dialect/Func/IR/FuncOps.h"
 #include "mlir/Dialect/LLVMIR/LLVMDialect.h"
-#include "mlir/Dialect/SCF/IR/SCF.h"
-#include "mlir/Dialect/Arith/IR/Arith.h"
-#include "mlir/Dialect/MemRef/IR/MemRef.h"
-#include "mlir/Dialect/Affine/IR/AffineOps.h"
-#include "mlir/Conversion/Passes.h"
+#include "mlir/IR/AsmState.h"
+#include "mlir/IR/BuiltinOps.h"
+#include "mlir/IR/Diagnostics.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/SymbolTable.h"
+#include "mlir/Interfaces/CallInterfaces.h"
+#include "mlir/Interfaces/FunctionInterfaces.h"
+#include "mlir/Parser/Parser.h"
+#include "mlir/Pass/PassInstrumentation.h"
+#include "mlir/Pass/PassManager.h"
+#include "mlir/Pass/PassRegistry.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Support/Timing.h"
+#include "mlir/Target/LLVMIR/Dialect/All.h"
+#include "mlir/Target/LLVMIR/Export.h"
+#include "mlir/Target/LLVMIR/Import.h"
 
-int main(int argc, char **argv) {
-  // Register all standard MLIR dialects
-  mlir::DialectRegistry registry;
-  mlir::registerAllDialects(registry);
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/ADT/StringSet.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/InstIterator.h"
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/InitLLVM.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/SystemUtils.h"
+#include "llvm/Support/ThreadPool.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/ToolOutputFile.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace mlir;
+
+static llvm::cl::opt<std::string> inputFilename(llvm::cl::Positional,
+                                                llvm::cl::desc("<input .ll/.bc>"),
+                                                llvm::cl::init("-"));
+
+static llvm::cl::opt<std::string> outputFilename("o",
+                                                 llvm::cl::desc("Output file"),
+                                                 llvm::cl::value_desc("filename"),
+                                                 llvm::cl::init("-"));
+
+static llvm::cl::opt<bool> emitText("S",
+                                    llvm::cl::desc("Write textual LLVM IR instead of bitcode"));
+
+static llvm::cl::opt<std::string> passPipeline(
+    "pass-pipeline",
+    llvm::cl::desc("Textual pass pipeline, e.g. 'builtin.module(string-encrypt,obs-lower)'"));
+
+static llvm::cl::opt<std::string> pipelineFile(
+    "pipeline-file",
+    llvm::cl::desc("Read the pass pipeline from a file ('#' starts a comment line)"),
+    llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<std::string> targetTriple(
+    "target-triple", llvm::cl::desc("Target triple of the output (default: the input's)"));
+
+static llvm::cl::opt<std::string> dataLayout(
+    "data-layout", llvm::cl::desc("Data layout of the output (default: the input's)"));
+
+static llvm::cl::list<std::string> stripAttrs(
+    "strip-attrs",
+    llvm::cl::desc("Function and call-site attributes to remove from the output, "
+                   "e.g. target-cpu,target-features,memory"),
+    llvm::cl::CommaSeparated);
+
+static llvm::cl::opt<bool> restoreDeclarations(
+    "restore-declarations",
+    llvm::cl::desc("Re-add external function declarations the import dropped"),
+    llvm::cl::init(true));
+
+static llvm::cl::opt<std::string> emitMLIR(
+    "emit-mlir",
+    llvm::cl::desc("Also write the obfuscated MLIR module, as bytecode unless "
+                   "the name ends in .mlir"),
+    llvm::cl::value_desc("filename"));
+
+static llvm::cl::list<std::string> printFunctions(
+    "print-functions",
+    llvm::cl::desc("Print these functions of an MLIR bytecode input as text and "
+                   "exit, loading only their bodies"),
+    llvm::cl::CommaSeparated);
+
+static llvm::cl::opt<unsigned> numThreads(
+    "threads",
+    llvm::cl::desc("Threads for function-level pass work (0 = all hardware "
+                   "threads, 1 = single-threaded)"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<std::string> statisticsJSON(
+    "statistics-json",
+    llvm::cl::desc("Write the pass statistics as JSON: per pass argument and "
+                   "summed over the pipeline"),
+    llvm::cl::value_desc("filename"));
+
+static llvm::cl::opt<std::string> passMetricsJSON(
+    "pass-metrics-json",
+    llvm::cl::desc("Write the module's IR metrics after every top-level pass "
+                   "as a JSON timeline"),
+    llvm::cl::value_desc("filename"));
+
+// Pipeline from --pass-pipeline or --pipeline-file; bare pass lists are
+// anchored on builtin.module like the CLI's _mlir_pass_pipeline.
+static FailureOr<std::string> loadPipeline() {
+  if (!passPipeline.empty() && !pipelineFile.empty()) {
+    llvm::errs() << "mlir-obfuscate: --pass-pipeline and --pipeline-file are exclusive\n";
+    return failure();
+  }
+
+  std::string pipeline = passPipeline;
+  if (!pipelineFile.empty()) {
+    auto buffer = llvm::MemoryBuffer::getFile(pipelineFile, /*IsText=*/true);
+    if (!buffer) {
+      llvm::errs() << "mlir-obfuscate: cannot read '" << pipelineFile
+                   << "': " << buffer.getError().message() << "\n";
+      return failure();
+    }
+    SmallVector<StringRef> lines;
+    (*buffer)->getBuffer().split(lines, '\n');
+    for (StringRef line : lines) {
+      line = line.trim();
+      if (!line.empty() && !line.starts_with("#"))
+        pipeline += line.str();
+    }
+  }
+
+  StringRef trimmed = StringRef(pipeline).trim();
+  if (trimmed.empty()) {
+    llvm::errs() << "mlir-obfuscate: no pass pipeline given "
+                    "(--pass-pipeline or --pipeline-file)\n";
+    return failure();
+  }
+  if (!trimmed.starts_with("builtin.module("))
+    return ("builtin.module(" + trimmed + ")").str();
+  return trimmed.str();
+}
+
+namespace {
+/// Records the statistics of every pass instance after each of its runs.
+/// A nested pass is cloned once per thread and each clone counts only the
+/// operations it ran on, so the latest value per instance is kept and the
+/// instances are summed at the end. mlir-opt's own statistics display has
+/// no machine-readable form and only reaches the clones through the pass
+/// manager internals.
+class StatisticsCollector : public PassInstrumentation {
+public:
+  void runAfterPass(Pass *pass, Operation *) override { record(pass); }
+  void runAfterPassFailed(Pass *pass, Operation *) override { record(pass); }
 
-  // Explicitly register dialects we use (redundant but explicit)
-  registry.insert<mlir::func::FuncDialect,
-                  mlir::LLVM::LLVMDialect,
-                  mlir::scf::SCFDialect,
-                  mlir::arith::ArithDialect,
-                  mlir::memref::MemRefDialect,
-                  mlir::affine::AffineDialect>();
+  llvm::json::Value toJSON() const {
+    llvm::StringMap<llvm::StringMap<uint64_t>> perPass;
+    llvm::StringMap<uint64_t> totals;
+    for (const auto &it : instances) {
+      for (const auto &stat : it.second.values) {
+        perPass[it.second.argument][stat.getKey()] += stat.getValue();
+        totals[stat.getKey()] += stat.getValue();
+      }
+    }
+    auto toObject = [](const llvm::StringMap<uint64_t> &values) {
+      llvm::json::Object object;
+      for (const auto &value : values)
+        object[value.getKey().str()] = value.getValue();
+      return object;
+    };
+    llvm::json::Object passes;
+    for (const auto &pass : perPass)
+      passes[pass.getKey().str()] = toObject(pass.getValue());
+    // Pass::Statistic is an llvm::Statistic: without LLVM_ENABLE_STATS
+    // (release builds) every counter reads 0, so tell readers not to trust them
+    return llvm::json::Object{{"statistics-enabled", LLVM_ENABLE_STATS != 0},
+                              {"passes", std::move(passes)},
+                              {"totals", toObject(totals)}};
+  }
 
+private:
+  struct Instance {
+    std::string argument;
+    llvm::StringMap<uint64_t> values;
+  };
+
+  void record(Pass *pass) {
+    ArrayRef<Pass::Statistic *> statistics = pass->getStatistics();
+    if (statistics.empty())
+      return;
+    std::lock_guard<std::mutex> lock(mutex);
+    Instance &instance = instances[pass];
+    if (instance.argument.empty()) {
+      StringRef argument = pass->getArgument();
+      instance.argument = (argument.empty() ? pass->getName() : argument).str();
+    }
+    for (Pass::Statistic *statistic : statistics)
+      instance.values[statistic->getName()] = statistic->getValue();
+  }
+
+  std::mutex mutex;
+  llvm::DenseMap<const Pass *, Instance> instances;
+};
+
+/// Snapshots the module before the first and after every top-level pass.
+/// Nested pipelines are measured once, after their adaptor finished all
+/// functions, and named after the passes that ran inside them.
+class PassMetricsCollector : public PassInstrumentation {
+public:
+  PassMetricsCollector() : timeline("mlir") {}
+
+  void runBeforePass(Pass *, Operation *op) override {
+    if (op->getParentOp())
+      return;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (timeline.empty())
+      timeline.add("input", countModule(op));
+  }
+
+  void runAfterPass(Pass *pass, Operation *op) override {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (op->getParentOp()) {
+      nestedAnchor = op->getName().getStringRef().str();
+      nestedPasses.insert(label(pass));
+      return;
+    }
+    std::string name = label(pass);
+    if (pass->getArgument().empty() && !nestedPasses.empty())
+      name = nestedAnchor + "(" + llvm::join(nestedPasses, ",") + ")";
+    nestedPasses.clear();
+    timeline.add(name, countModule(op));
+  }
+
+  const obs::PassMetricsTimeline &getTimeline() const { return timeline; }
+
+private:
+  static std::string label(Pass *pass) {
+    StringRef argument = pass->getArgument();
+    return (argument.empty() ? pass->getName() : argument).str();
+  }
+
+  // Function bodies only, like the LLVM side: constants and address-of ops
+  // are not instructions there
+  static obs::IRCounts countModule(Operation *module) {
+    obs::IRCounts counts;
+    for (Operation &op : module->getRegion(0).front()) {
+      if (isa<LLVM::GlobalOp>(op)) {
+        ++counts.globals;
+        continue;
+      }
+      auto func = dyn_cast<FunctionOpInterface>(op);
+      if (!func || func.isExternal())
+        continue;
+      ++counts.functions;
+      func->walk([&](Operation *nested) {
+        for (Region &region : nested->getRegions())
+          counts.blocks += region.getBlocks().size();
+        if (nested == func.getOperation() || nested->hasTrait<OpTrait::ConstantLike>())
+          return;
+        StringRef opcode = nested->getName().stripDialect();
+        if (opcode.starts_with("mlir."))
+          return;
+        counts.addInstruction(opcode);
+        if (isa<CallOpInterface>(nested))
+          ++counts.calls;
+        counts.edges += nested->getNumSuccessors();
+      });
+    }
+    return counts;
+  }
+
+  std::mutex mutex;
+  obs::PassMetricsTimeline timeline;
+  std::string nestedAnchor;
+  llvm::SetVector<std::string> nestedPasses;
+};
+
+/// What the input knew that the MLIR round trip may lose. Types and
+/// attribute lists live in the LLVMContext, which the export reuses.
+struct InputFacts {
+  llvm::Triple triple;
+  std::string dataLayout;
+  struct Declaration {
+    std::string name;
+    llvm::FunctionType *type;
+    llvm::AttributeList attributes;
+    llvm::CallingConv::ID callingConv;
+  };
+  std::vector<Declaration> declarations;
+};
+} // namespace
+
+static InputFacts collectInputFacts(const llvm::Module &module) {
+  InputFacts facts;
+  facts.triple = module.getTargetTriple();
+  facts.dataLayout = module.getDataLayoutStr();
+  for (const llvm::Function &function : module) {
+    if (function.isDeclaration() && !function.isIntrinsic())
+      facts.declarations.push_back({function.getName().str(), function.getFunctionType(),
+                                    function.getAttributes(), function.getCallingConv()});
+  }
+  return facts;
+}
+
+// Structural counterpart of the CLI's textual repairs of mlir-translate
+// output. Array sizes of string constants need no repair here: an
+// initializer whose type disagrees with its global fails the verifier.
+static void repairExportedModule(llvm::Module &module, const InputFacts &facts) {
+  if (!targetTriple.empty())
+    module.setTargetTriple(llvm::Triple(targetTriple));
+  else if (module.getTargetTriple().str().empty())
+    module.setTargetTriple(facts.triple);
+  if (!dataLayout.empty())
+    module.setDataLayout(dataLayout);
+  else if (module.getDataLayoutStr().empty())
+    module.setDataLayout(facts.dataLayout);
+
+  if (restoreDeclarations) {
+    for (const InputFacts::Declaration &declaration : facts.declarations) {
+      if (module.getNamedValue(declaration.name))
+        continue;
+      llvm::Function *function =
+          llvm::Function::Create(declaration.type, llvm::GlobalValue::ExternalLinkage,
+                                 declaration.name, module);
+      function->setAttributes(declaration.attributes);
+      function->setCallingConv(declaration.callingConv);
+    }
+  }
+
+  if (stripAttrs.empty())
+    return;
+  // Enum attributes by kind (memory, convergent, ...), the rest as string
+  // attributes (target-cpu, ...); names unknown to this LLVM match nothing.
+  llvm::AttributeMask mask;
+  for (const std::string &name : stripAttrs) {
+    llvm::Attribute::AttrKind kind = llvm::Attribute::getAttrKindFromName(name);
+    if (kind != llvm::Attribute::None)
+      mask.addAttribute(kind);
+    else
+      mask.addAttribute(name);
+  }
+  for (llvm::Function &function : module) {
+    function.removeFnAttrs(mask);
+    for (llvm::Instruction &inst : llvm::instructions(function))
+      if (auto *call = llvm::dyn_cast<llvm::CallBase>(&inst))
+        call->removeFnAttrs(mask);
+  }
+}
+
+static LogicalResult writeModule(const llvm::Module &module) {
+  std::string error;
+  std::unique_ptr<llvm::ToolOutputFile> output =
+      openOutputFile(outputFilename, &error);
+  if (!output) {
+    llvm::errs() << "mlir-obfuscate: " << error << "\n";
+    return failure();
+  }
+  if (emitText) {
+    module.print(output->os(), /*AAW=*/nullptr);
+  } else {
+    if (llvm::CheckBitcodeOutputToConsole(output->os()))
+      return failure();
+    llvm::WriteBitcodeToFile(module, output->os());
+  }
+  output->keep();
+  return success();
+}
+
+static LogicalResult writeStatistics(const StatisticsCollector &collector) {
+  std::string error;
+  std::unique_ptr<llvm::ToolOutputFile> output = openOutputFile(statisticsJSON, &error);
+  if (!output) {
+    llvm::errs() << "mlir-obfuscate: " << error << "\n";
+    return failure();
+  }
+  output->os() << llvm::formatv("{0:2}", collector.toJSON()) << "\n";
+  output->keep();
+  return success();
+}
+
+static LogicalResult writeMLIR(ModuleOp module) {
+  std::string error;
+  std::unique_ptr<llvm::ToolOutputFile> output = openOutputFile(emitMLIR, &error);
+  if (!output) {
+    llvm::errs() << "mlir-obfuscate: " << error << "\n";
+    return failure();
+  }
+  if (StringRef(emitMLIR).ends_with(".mlir"))
+    module.print(output->os());
+  else if (failed(writeBytecodeToFile(module, output->os())))
+    return failure();
+  output->keep();
+  return success();
+}
+
+// Functions are isolated from above, so the bytecode reader can defer their
+// bodies; only the ones asked for are materialized and printed.
+static LogicalResult printFunctionsLazily(const llvm::MemoryBuffer &buffer,
+                                          MLIRContext &context) {
+  Block block;
+  ParserConfig config(&context);
+  BytecodeReader reader(buffer.getMemBufferRef(), config, /*lazyLoad=*/true);
+  // The callback picks what to read eagerly: the module, not the functions
+  if (failed(reader.readTopLevel(&block, [](Operation *op) { return isa<ModuleOp>(op); })))
+    return failure();
+  auto module = block.empty() ? ModuleOp() : dyn_cast<ModuleOp>(&block.front());
+  if (!module) {
+    llvm::errs() << "mlir-obfuscate: input has no top-level builtin.module\n";
+    return failure();
+  }
+
+  std::string error;
+  std::unique_ptr<llvm::ToolOutputFile> output = openOutputFile(outputFilename, &error);
+  if (!output) {
+    llvm::errs() << "mlir-obfuscate: " << error << "\n";
+    return failure();
+  }
+
+  llvm::StringSet<> wanted;
+  for (const std::string &name : printFunctions)
+    wanted.insert(name);
+  for (Operation &op : module.getBody()->getOperations()) {
+    StringAttr name = op.getAttrOfType<StringAttr>(SymbolTable::getSymbolAttrName());
+    if (!name || !wanted.erase(name.getValue()))
+      continue;
+    if (reader.isMaterializable(&op) && failed(reader.materialize(&op)))
+      return failure();
+    op.print(output->os(), OpPrintingFlags().useLocalScope());
+    output->os() << "\n";
+  }
+  for (const auto &missing : wanted)
+    llvm::errs() << "mlir-obfuscate: no function '" << missing.getKey() << "'\n";
+
+  // Drop the bodies that were never loaded instead of decoding them
+  if (failed(reader.finalize([](Operation *) { return false; })))
+    return failure();
+  output->keep();
+  return wanted.empty() ? success() : failure();
+}
+
+int main(int argc, char **argv) {
+  llvm::InitLLVM init(argc, argv);
 
-  mlir::registerAllPasses();
+  mlir::obs::registerObfuscationPasses();
+  registerMLIRContextCLOptions();
+  registerPassManagerCLOptions();
+  registerDefaultTimingManagerCLOptions();
+  registerAsmPrinterCLOptions();
+  llvm::cl::ParseCommandLineOptions(
+      argc, argv,
+      "MLIR obfuscator (" MLIR_VERSION_STRING "): LLVM IR -> passes -> LLVM IR\n");
 
-  // Register CIR passes (Layer 1.5)
-  mlir::cir::registerCIRPasses();
+  std::string error;
+  std::unique_ptr<llvm::MemoryBuffer> buffer = openInputFile(inputFilename, &error);
+  if (!buffer) {
+    llvm::errs() << "mlir-obfuscate: " << error << "\n";
+    return 1;
+  }
+  bool bytecodeInput = isBytecode(buffer->getMemBufferRef());
+  bool mlirInput = bytecodeInput || StringRef(inputFilename).ends_with(".mlir");
 
+  FailureOr<std::string> pipeline = failure();
+  if (printFunctions.empty()) {
+    pipeline = loadPipeline();
+    if (failed(pipeline))
+      return 1;
+  } else if (!bytecodeInput) {
+    llvm::errs() << "mlir-obfuscate: --print-functions needs an MLIR bytecode input\n";
+    return 1;
+  }
 
-  mlir::registerPass([]() -> std::unique_ptr<mlir::Pass> {
-    return std::make_unique<mlir::obs::StringEncryptPass>();
-  });
+  DialectRegistry registry;
+  registry.insert<LLVM::LLVMDialect, DLTIDialect, func::FuncDialect,
+                  obs::ObsDialect>();
+  registerAllFromLLVMIRTranslations(registry);
+  registerAllToLLVMIRTranslations(registry);
+  // Declared before the context, which must not outlive it
+  std::unique_ptr<llvm::DefaultThreadPool> threadPool;
+  MLIRContext context(registry, MLIRContext::Threading::DISABLED);
+  if (numThreads != 1) {
+    threadPool = std::make_unique<llvm::DefaultThreadPool>(
+        llvm::hardware_concurrency(numThreads));
+    context.setThreadPool(*threadPool);
+  }
 
-  mlir::registerPass([]() -> std::unique_ptr<mlir::Pass> {
-    return std::make_unique<mlir::obs::SymbolObfuscatePass>();
-  });
+  llvm::SourceMgr sourceMgr;
+  SourceMgrDiagnosticHandler diagnostics(sourceMgr, &context);
 
-  mlir::registerPass([]() -> std::unique_ptr<mlir::Pass> {
-    return std::make_unique<mlir::obs::CryptoHashPass>();
-  });
+  if (!printFunctions.empty())
+    return failed(printFunctionsLazily(*buffer, context)) ? 1 : 0;
 
-  mlir::registerPass([]() -> std::unique_ptr<mlir::Pass> {
-    return std::make_unique<mlir::obs::ConstantObfuscationPass>();
-  });
+  DefaultTimingManager timing;
+  applyDefaultTimingManagerCLOptions(timing);
+  TimingScope rootTimer = timing.getRootScope();
 
-  mlir::registerPass([]() -> std::unique_ptr<mlir::Pass> {
-    return std::make_unique<mlir::obs::SCFObfuscatePass>();
-  });
+  PassManager pm(&context, ModuleOp::getOperationName(),
+                 OpPassManager::Nesting::Implicit);
+  if (failed(parsePassPipeline(*pipeline, pm, llvm::errs())))
+    return 1;
+  if (failed(applyPassManagerCLOptions(pm)))
+    return 1;
+  StatisticsCollector *statistics = nullptr;
+  if (!statisticsJSON.empty()) {
+    auto collector = std::make_unique<StatisticsCollector>();
+    statistics = collector.get();
+    pm.addInstrumentation(std::move(collector));
+  }
+  PassMetricsCollector *passMetrics = nullptr;
+  if (!passMetricsJSON.empty()) {
+    auto collector = std::make_unique<PassMetricsCollector>();
+    passMetrics = collector.get();
+    pm.addInstrumentation(std::move(collector));
+  }
 
-  mlir::registerPass([]() -> std::unique_ptr<mlir::Pass> {
-    return std::make_unique<mlir::obs::ImportObfuscationPass>();
-  });
+  llvm::LLVMContext llvmContext;
+  OwningOpRef<ModuleOp> module;
+  InputFacts inputFacts;
+  {
+    TimingScope importTimer = rootTimer.nest(mlirInput ? "Parse MLIR" : "Import LLVM IR");
+    if (mlirInput) {
+      sourceMgr.AddNewSourceBuffer(std::move(buffer), llvm::SMLoc());
+      module = parseSourceFile<ModuleOp>(sourceMgr, ParserConfig(&context));
+    } else {
+      llvm::SMDiagnostic err;
+      std::unique_ptr<llvm::Module> input =
+          llvm::parseIR(buffer->getMemBufferRef(), err, llvmContext);
+      if (!input) {
+        err.print("mlir-obfuscate", llvm::errs());
+        return 1;
+      }
+      inputFacts = collectInputFacts(*input);
+      module = translateLLVMIRToModule(std::move(input), &context);
+    }
+    if (!module)
+      return 1;
+  }
 
-  
-  llvm::outs() << "MLIR Obfuscator Tool\n";
-  llvm::outs() << "MLIR/LLVM Version: " << MLIR_VERSION_STRING << "\n";
-  llvm::outs() << "Supported Frontend: ClangIR (LLVM 22 native)\n";
-  llvm::outs() << "\n";
+  {
+    TimingScope passTimer = rootTimer.nest("Pass pipeline");
+    pm.enableTiming(passTimer);
+    if (failed(pm.run(*module)))
+      return 1;
+  }
+  if (statistics && failed(writeStatistics(*statistics)))
+    return 1;
+  if (passMetrics) {
+    std::string metricsError = passMetrics->getTimeline().write(passMetricsJSON);
+    if (!metricsError.empty()) {
+      llvm::errs() << "mlir-obfuscate: " << passMetricsJSON << ": " << metricsError << "\n";
+      return 1;
+    }
+  }
+  if (!emitMLIR.empty() && failed(writeMLIR(*module)))
+    return 1;
 
-  
-  return mlir::asMainReturnCode(
-      mlir::MlirOptMain(argc, argv, "MLIR Obfuscator\n", registry));
+  // Same context as the input, so the recorded declarations can be re-added
+  TimingScope exportTimer = rootTimer.nest("Export LLVM IR");
+  std::unique_ptr<llvm::Module> output =
+      translateModuleToLLVMIR(*module, llvmContext, inputFilename);
+  if (!output) {
+    llvm::errs() << "mlir-obfuscate: failed to translate to LLVM IR\n";
+    return 1;
+  }
+  repairExportedModule(*output, inputFacts);
+  if (llvm::verifyModule(*output, &llvm::errs())) {
+    llvm::errs() << "mlir-obfuscate: exported module is broken\n";
+    return 1;
+  }
+  return failed(writeModule(*output)) ? 1 : 0;
 }
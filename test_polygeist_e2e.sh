@@ -320,7 +320,7 @@ else
     echo "Step 3: Apply SCF obfuscation"
     mlir-opt "$TEMP_DIR/polygeist_sym_obf.mlir" \
         --load-pass-plugin="$LIBRARY" \
-        --pass-pipeline='builtin.module(scf-obfuscate)' \
+        --pass-pipeline='builtin.module(scf-obfuscate,obs-lower)' \
         -o "$TEMP_DIR/polygeist_scf_obf.mlir" 2>&1
     SCF_RESULT=$?
     if [ $SCF_RESULT -eq 0 ]; then
@@ -0,0 +1,149 @@
+"""
+Unit tests for the core.autotune module.
+Tests candidate sampling, ranking and the successive-halving search with
+builds and benchmark runs stubbed out.
+"""
+
+from pathlib import Path
+
+import pytest
+import yaml
+
+from core.autotune import Autotuner, Candidate
+from core.config import AutotuneConfig
+from core.exceptions import ObfuscationError
+
+
+def make_tuner(tmp_dir: Path, **overrides) -> Autotuner:
+    settings = dict(source=tmp_dir / "main.c", benchmark_command="--iterations 10", candidates=5, runs=1,
+                    eta=2, seed=7, output=tmp_dir / "autotune", base={"level": 3})
+    settings.update(overrides)
+    return Autotuner(AutotuneConfig(**settings))
+
+
+def measured(id: int, protection: float, overhead: float) -> Candidate:
+    return Candidate(id, {}, protection=protection, overhead_percent=overhead)
+
+
+class TestSample:
+    """Tests for Autotuner.sample and config_data."""
+
+    def test_base_first_then_distinct(self, tmp_dir: Path):
+        candidates = make_tuner(tmp_dir).sample()
+        assert [c.id for c in candidates] == [0, 1, 2, 3, 4]
+        assert candidates[0].settings == {}
+        assert len({repr(sorted(c.settings.items())) for c in candidates}) == 5
+        assert all(c.settings["profile.static_estimate"] for c in candidates[1:])
+
+    def test_same_seed_same_candidates(self, tmp_dir: Path):
+        first = [c.settings for c in make_tuner(tmp_dir).sample()]
+        assert [c.settings for c in make_tuner(tmp_dir).sample()] == first
+        assert [c.settings for c in make_tuner(tmp_dir, seed=8).sample()] != first
+
+    def test_profiled_base_keeps_profile(self, tmp_dir: Path):
+        tuner = make_tuner(tmp_dir, base={"profile": {"path": "app.profdata"}})
+        assert all("profile.static_estimate" not in c.settings for c in tuner.sample())
+
+    def test_config_data_overlays_base(self, tmp_dir: Path):
+        tuner = make_tuner(tmp_dir, base={"level": 3, "passes": {"flattening": True}})
+        data = tuner.config_data(Candidate(1, {"passes.flattening": False, "advanced.cycles": 2}))
+        assert data == {"level": 3, "passes": {"flattening": False}, "advanced": {"cycles": 2}}
+        assert tuner.config.base["passes"]["flattening"] is True
+
+
+class TestCommand:
+    """Tests for Autotuner.command."""
+
+    def test_arguments(self, tmp_dir: Path):
+        assert make_tuner(tmp_dir).command(Path("/bin/app")) == ["/bin/app", "--iterations", "10"]
+
+    def test_placeholder(self, tmp_dir: Path):
+        tuner = make_tuner(tmp_dir, benchmark_command="taskset -c 2 {binary} 'a b'")
+        assert tuner.command(Path("/bin/app")) == ["taskset", "-c", "2", "/bin/app", "a b"]
+
+
+class TestRanking:
+    """Tests for rank_key and pareto_front."""
+
+    def test_within_budget_by_protection(self, tmp_dir: Path):
+        tuner = make_tuner(tmp_dir, overhead_budget_percent=8.0)
+        candidates = [measured(0, 10, 1.0), measured(1, 50, 30.0), measured(2, 40, 5.0),
+                      measured(3, 40, 2.0), measured(4, 90, 9.0)]
+        ranked = sorted(candidates, key=tuner.rank_key)
+        # Within budget by protection, then overhead; the rest by overhead
+        assert [c.id for c in ranked] == [3, 2, 0, 4, 1]
+
+    def test_pareto_front(self):
+        candidates = [measured(0, 10, 1.0), measured(1, 50, 30.0), measured(2, 40, 5.0),
+                      measured(3, 30, 7.0), Candidate(4, {}, error="build failed")]
+        assert [c.id for c in Autotuner.pareto_front(candidates)] == [0, 2, 1]
+
+
+class TestRun:
+    """Tests for the successive-halving search."""
+
+    PROTECTION = {0: 10.0, 1: 50.0, 2: 40.0, 3: 30.0, 4: 20.0}
+    RUNTIME_MS = {"base": 100.0, "c0": 101.0, "c1": 130.0, "c2": 105.0, "c3": 107.0, "c4": 102.0}
+
+    @pytest.fixture
+    def tuner(self, tmp_dir: Path, monkeypatch):
+        tuner = make_tuner(tmp_dir)
+        self.runs = []
+
+        def build(candidates):
+            for candidate in candidates:
+                candidate.protection = self.PROTECTION[candidate.id]
+                candidate.binary = Path(f"c{candidate.id}")
+                candidate.baseline = Path("base")
+
+        def run_once(binary):
+            self.runs.append(binary.name)
+            return self.RUNTIME_MS[binary.name], 0
+
+        monkeypatch.setattr(tuner, "build", build)
+        monkeypatch.setattr(tuner, "run_once", run_once)
+        return tuner
+
+    def test_halving(self, tuner):
+        """
+        Rung 0 keeps the best 3 of 5 (c1 is over budget), rung 1 the best 2,
+        and rung 2 picks c2: the most protection within budget.
+        """
+        results = tuner.run()
+
+        assert results["best"] == 2
+        assert results["baseline_ms"] == 100.0
+        assert results["pareto_front"] == [0, 4, 2, 1]
+        by_id = {c["id"]: c for c in results["candidates"]}
+        assert [(by_id[i]["rung"], by_id[i]["runs"]) for i in range(5)] == [
+            (0, 1), (0, 1), (2, 4), (2, 4), (1, 2)
+        ]
+        assert by_id[2]["overhead_percent"] == 5.0
+        # Runs double each rung and the baseline is timed in every round
+        assert self.runs.count("base") == 1 + 2 + 4
+
+        written = yaml.safe_load((tuner.config.output / "obfuscation.yaml").read_text())
+        assert written["obfuscation"]["output"]["directory"] == "./obfuscated"
+        assert (tuner.config.output / "autotune.json").exists()
+
+    def test_nothing_within_budget(self, tuner):
+        tuner.config.overhead_budget_percent = 0.5
+        results = tuner.run()
+        assert results["best"] is None
+        assert results["config_file"] is None
+
+    def test_exit_code_mismatch_fails_candidate(self, tuner, monkeypatch):
+        """A candidate that does not behave like the baseline is dropped."""
+        def run_once(binary):
+            return self.RUNTIME_MS[binary.name], 1 if binary.name == "c2" else 0
+
+        monkeypatch.setattr(tuner, "run_once", run_once)
+        results = tuner.run()
+        by_id = {c["id"]: c for c in results["candidates"]}
+        assert by_id[2]["status"] == "failed"
+        assert results["best"] == 3
+
+    def test_baseline_failure(self, tuner, monkeypatch):
+        monkeypatch.setattr(tuner, "run_once", lambda binary: (None, None))
+        with pytest.raises(ObfuscationError, match="baseline"):
+            tuner.run()
@@ -18,11 +18,13 @@ from core.config import (
     UPXConfiguration,
     RemarksConfiguration,
     AntiDebugConfiguration,
+    SelfChecksumConfiguration,
     AdvancedConfiguration,
     OutputConfiguration,
     ObfuscationConfig,
     AnalyzeConfig,
     CompareConfig,
+    AutotuneConfig,
 )
 
 
@@ -86,12 +88,14 @@ class TestMLIRFrontend:
         """Test all MLIRFrontend enum values exist."""
         assert MLIRFrontend.CLANG.value == "clang"
         assert MLIRFrontend.CLANGIR.value == "clangir"
+        assert MLIRFrontend.POLYGEIST.value == "polygeist"
 
     def test_mlir_frontend_from_string_valid(self):
         """Test MLIRFrontend.from_string with valid inputs."""
         assert MLIRFrontend.from_string("clang") == MLIRFrontend.CLANG
         assert MLIRFrontend.from_string("CLANG") == MLIRFrontend.CLANG
         assert MLIRFrontend.from_string("clangir") == MLIRFrontend.CLANGIR
+        assert MLIRFrontend.from_string("polygeist") == MLIRFrontend.POLYGEIST
 
     def test_mlir_frontend_from_string_invalid(self):
         """Test MLIRFrontend.from_string with invalid input raises ValueError."""
@@ -160,7 +164,9 @@ class TestPassConfiguration:
         assert config.string_encrypt is False
         assert config.symbol_obfuscate is False
         assert config.constant_obfuscate is False
+        assert config.constant_encode is False
         assert config.address_obfuscation is False
+        assert config.function_merge is False
         assert config.crypto_hash is None
 
     def test_enabled_passes_empty(self):
@@ -181,6 +187,11 @@ class TestPassConfiguration:
         assert "string-encrypt" in passes
         assert len(passes) == 3
 
+    def test_enabled_passes_with_function_merge(self):
+        """Test enabled_passes includes function-merge when enabled."""
+        config = PassConfiguration(function_merge=True)
+        assert config.enabled_passes() == ["function-merge"]
+
     def test_enabled_passes_with_crypto_hash(self):
         """Test enabled_passes includes crypto-hash when enabled."""
         crypto_config = CryptoHashConfiguration(enabled=True)
@@ -198,6 +209,7 @@ class TestIndirectCallConfiguration:
         assert config.enabled is False
         assert config.obfuscate_stdlib is True
         assert config.obfuscate_custom is True
+        assert config.guarded_fast_path is False
 
 
 class TestUPXConfiguration:
@@ -234,6 +246,20 @@ class TestAntiDebugConfiguration:
         config = AntiDebugConfiguration()
         assert config.enabled is False
         assert config.techniques == ["ptrace", "proc_status"]
+        assert config.overhead_budget_us == 1000
+        assert config.proc_cache_ms == 100
+
+
+class TestSelfChecksumConfiguration:
+    """Tests for SelfChecksumConfiguration dataclass."""
+
+    def test_default_values(self):
+        """Test default values for SelfChecksumConfiguration."""
+        config = SelfChecksumConfiguration()
+        assert config.enabled is False
+        assert config.mode == "thread"
+        assert config.cpu_budget_permille == 10
+        assert config.chunks_per_step == 4
 
 
 class TestAdvancedConfiguration:
@@ -250,6 +276,7 @@ class TestAdvancedConfiguration:
         assert isinstance(config.anti_debug, AntiDebugConfiguration)
         assert config.preserve_ir is True
         assert config.ir_metrics_enabled is True
+        assert config.recovery_pipeline is True
 
 
 class TestOutputConfiguration:
@@ -312,6 +339,20 @@ class TestObfuscationConfig:
         assert config.passes.substitution is True
         assert config.passes.string_encrypt is True
 
+    def test_from_dict_with_address_obfuscation(self):
+        """Test ObfuscationConfig.from_dict enables the address-obfuscation pass."""
+        data = {"passes": {"address_obfuscation": True}}
+        config = ObfuscationConfig.from_dict(data)
+        assert config.passes.address_obfuscation is True
+        assert "address-obfuscation" in config.passes.enabled_passes()
+
+    def test_from_dict_with_constant_encode(self):
+        """Test constant_encode is an option of constant-obfuscate, not a pass of its own."""
+        data = {"passes": {"constant_obfuscate": True, "constant_encode": True}}
+        config = ObfuscationConfig.from_dict(data)
+        assert config.passes.constant_encode is True
+        assert config.passes.enabled_passes() == ["constant-obfuscate"]
+
     def test_from_dict_with_advanced_config(self):
         """Test ObfuscationConfig.from_dict with advanced configuration."""
         data = {
@@ -330,12 +371,122 @@ class TestObfuscationConfig:
         assert config.advanced.upx_packing.enabled is True
         assert config.advanced.upx_packing.compression_level == "brute"
 
+    def test_from_dict_with_indirect_call_fast_path(self):
+        """Test ObfuscationConfig.from_dict parses the guarded fast path option."""
+        data = {"advanced": {"indirect_calls": {"enabled": True, "guarded_fast_path": True}}}
+        config = ObfuscationConfig.from_dict(data)
+        assert config.advanced.indirect_calls.enabled is True
+        assert config.advanced.indirect_calls.guarded_fast_path is True
+
+    def test_from_dict_with_anti_debug_budget(self):
+        """Test ObfuscationConfig.from_dict parses the anti-debug overhead budget."""
+        data = {"advanced": {"anti_debug": {"enabled": True, "overhead_budget_us": 250, "proc_cache_ms": 500}}}
+        config = ObfuscationConfig.from_dict(data)
+        assert config.advanced.anti_debug.enabled is True
+        assert config.advanced.anti_debug.overhead_budget_us == 250
+        assert config.advanced.anti_debug.proc_cache_ms == 500
+
+    def test_from_dict_with_self_checksum(self):
+        """Test ObfuscationConfig.from_dict parses self-checksum settings."""
+        data = {"advanced": {"self_checksum": {"enabled": True, "mode": "piggyback", "cpu_budget_permille": 5}}}
+        config = ObfuscationConfig.from_dict(data)
+        assert config.advanced.self_checksum.enabled is True
+        assert config.advanced.self_checksum.mode == "piggyback"
+        assert config.advanced.self_checksum.cpu_budget_permille == 5
+        assert config.advanced.self_checksum.chunks_per_step == 4
+
+    def test_from_dict_disables_recovery_pipeline(self):
+        """Test ObfuscationConfig.from_dict can turn off the recovery pipeline."""
+        data = {"advanced": {"recovery_pipeline": False}}
+        config = ObfuscationConfig.from_dict(data)
+        assert config.advanced.recovery_pipeline is False
+
     def test_from_dict_with_mlir_frontend(self):
         """Test ObfuscationConfig.from_dict with mlir_frontend specified."""
         data = {"mlir_frontend": "clangir"}
         config = ObfuscationConfig.from_dict(data)
         assert config.mlir_frontend == MLIRFrontend.CLANGIR
 
+    def test_profile_defaults(self):
+        """Test profile-guided tiers are off unless a profile is given."""
+        config = ObfuscationConfig.from_dict({})
+        assert config.profile.path is None
+        assert config.profile.hot_percent == 90
+        assert config.profile.warm_percent == 99
+        assert config.profile.hot_policy == "none"
+        assert config.profile.warm_policy == "cheap"
+        assert config.profile.static_estimate is False
+
+    def test_from_dict_with_static_estimate(self):
+        """Test static hotness tiers can be requested without a profile."""
+        config = ObfuscationConfig.from_dict({"profile": {"static_estimate": True}})
+        assert config.profile.path is None
+        assert config.profile.static_estimate is True
+
+    def test_from_dict_with_profile(self):
+        """Test ObfuscationConfig.from_dict with a profile."""
+        data = {"profile": {"path": "app.profdata", "hot_percent": 80, "hot_policy": "cheap",
+                            "benchmark_args": ["--iterations", "10"]}}
+        config = ObfuscationConfig.from_dict(data)
+        assert config.profile.path == Path("app.profdata")
+        assert config.profile.hot_percent == 80
+        assert config.profile.hot_policy == "cheap"
+        assert config.profile.warm_policy == "cheap"
+        assert config.profile.benchmark_args == ["--iterations", "10"]
+
+    def test_policy_file_default(self):
+        """Test no policy file is used unless one is given."""
+        config = ObfuscationConfig.from_dict({})
+        assert config.policy_file is None
+
+    def test_from_dict_with_policy_file(self):
+        """Test ObfuscationConfig.from_dict parses the function policy file."""
+        config = ObfuscationConfig.from_dict({"policy_file": "obf-policy.txt"})
+        assert config.policy_file == Path("obf-policy.txt")
+
+    def test_overhead_prediction_default(self):
+        """Test the static overhead prediction is on by default, without llvm-mca."""
+        config = ObfuscationConfig.from_dict({})
+        assert config.advanced.overhead_prediction.enabled is True
+        assert config.advanced.overhead_prediction.mca is False
+        assert config.advanced.overhead_prediction.top == 10
+
+    def test_from_dict_with_overhead_prediction(self):
+        """Test ObfuscationConfig.from_dict parses the overhead prediction options."""
+        config = ObfuscationConfig.from_dict({"advanced": {"overhead_prediction": {"mca": True, "top": 5}}})
+        assert config.advanced.overhead_prediction.mca is True
+        assert config.advanced.overhead_prediction.top == 5
+
+    def test_text_ir_default(self):
+        """Test pipeline stages exchange bitcode unless text IR is requested."""
+        assert ObfuscationConfig.from_dict({}).advanced.text_ir is False
+        assert ObfuscationConfig.from_dict({"advanced": {"text_ir": True}}).advanced.text_ir is True
+
+    def test_size_budget_default(self):
+        """Test the size budget is off unless a growth cap or plan is given."""
+        config = ObfuscationConfig.from_dict({})
+        assert config.size_budget.growth_percent is None
+        assert config.size_budget.plan_file is None
+        assert config.size_budget.enabled is False
+
+    def test_from_dict_with_size_budget(self):
+        """Test ObfuscationConfig.from_dict parses the size budget."""
+        config = ObfuscationConfig.from_dict({"size_budget": {"growth_percent": 15}})
+        assert config.size_budget.growth_percent == 15
+        assert config.size_budget.enabled is True
+
+    def test_from_dict_with_size_plan(self):
+        """Test a saved size plan alone enables the size budget."""
+        config = ObfuscationConfig.from_dict({"size_budget": {"plan_file": "app_size_plan.json"}})
+        assert config.size_budget.plan_file == Path("app_size_plan.json")
+        assert config.size_budget.enabled is True
+
+
+    def test_from_dict_with_address_force_loops(self):
+        """Test address-obfuscation masks vectorizable loops only when asked."""
+        assert ObfuscationConfig.from_dict({}).passes.address_force_loops is False
+        config = ObfuscationConfig.from_dict({"passes": {"address_obfuscation": True, "address_force_loops": True}})
+        assert config.passes.address_force_loops is True
 
 class TestAnalyzeConfig:
     """Tests for AnalyzeConfig dataclass."""
@@ -366,3 +517,23 @@ class TestCompareConfig:
         assert config.original_binary == original
         assert config.obfuscated_binary == obfuscated
         assert config.output is None
+
+
+class TestAutotuneConfig:
+    """Tests for AutotuneConfig dataclass."""
+
+    def test_defaults(self, tmp_dir: Path):
+        """Test AutotuneConfig defaults to an 8% budget over an empty base config."""
+        source = tmp_dir / "app.c"
+        config = AutotuneConfig(source=source)
+        assert config.source == source
+        assert config.overhead_budget_percent == 8.0
+        assert config.eta == 2
+        assert config.base == {}
+        assert config.output == Path("./autotune")
+
+    def test_base_not_shared(self, tmp_dir: Path):
+        """Test each AutotuneConfig gets its own base dict."""
+        first = AutotuneConfig(source=tmp_dir / "a.c")
+        first.base["level"] = 5
+        assert AutotuneConfig(source=tmp_dir / "b.c").base == {}
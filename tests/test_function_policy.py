@@ -0,0 +1,111 @@
+"""
+Unit tests for the core.function_policy module.
+Tests policy files, annotation parsing and the precedence between sources.
+"""
+
+from pathlib import Path
+
+import pytest
+
+from core.exceptions import ObfuscationError
+from core.function_policy import FunctionPolicy, function_string_attributes
+
+
+POLICY_IR = '''\
+@.str = private unnamed_addr constant [8 x i8] c"obf:max\\00", section "llvm.metadata"
+@.str.1 = private unnamed_addr constant [10 x i8] c"obf:bogus\\00", section "llvm.metadata"
+@.str.2 = private unnamed_addr constant [5 x i8] c"hot\\5C\\00", section "llvm.metadata"
+@.file = private unnamed_addr constant [4 x i8] c"a.c\\00", section "llvm.metadata"
+@llvm.global.annotations = appending global [3 x { ptr, ptr, ptr, i32, ptr }] [{ ptr, ptr, ptr, i32, ptr } { ptr @annotated, ptr @.str, ptr @.file, i32 1, ptr null }, { ptr, ptr, ptr, i32, ptr } { ptr @bogus, ptr @.str.1, ptr @.file, i32 2, ptr null }, { ptr, ptr, ptr, i32, ptr } { ptr @plain, ptr @.str.2, ptr @.file, i32 3, ptr null }], section "llvm.metadata"
+
+define void @annotated() #0 {
+  ret void
+}
+
+define void @recorded() #0 {
+  ret void
+}
+
+define void @bogus() {
+  ret void
+}
+
+define void @plain() {
+  ret void
+}
+
+define void @_Z3fooi(i32 %x) {
+  ret void
+}
+
+define void @other() #1 {
+  ret void
+}
+
+attributes #0 = { noinline "obf-policy"="light" }
+attributes #1 = { noinline }
+'''
+
+# Tried in order; the first match wins
+RULES = [("plain", "light"), ("foo(*", "max"), ("*", "none")]
+
+
+@pytest.fixture
+def demangle(monkeypatch):
+    """Fixed demangler, independent of the c++filt installed."""
+    names = {"_Z3fooi": "foo(int)"}
+    monkeypatch.setattr(FunctionPolicy, "_demangle", staticmethod(lambda batch: [names.get(n, n) for n in batch]))
+
+
+class TestFromFile:
+    """Tests for FunctionPolicy.from_file."""
+
+    def test_rules_in_order(self, tmp_dir: Path):
+        path = tmp_dir / "policy.txt"
+        path.write_text("# hot paths\nplain light\n\nfoo(* max  # demangled\n* none\n")
+        assert FunctionPolicy.from_file(path).rules == RULES
+
+    def test_unknown_policy(self, tmp_dir: Path):
+        path = tmp_dir / "policy.txt"
+        path.write_text("* none\nmain heavy\n")
+        with pytest.raises(ObfuscationError, match="policy.txt:2"):
+            FunctionPolicy.from_file(path)
+
+
+class TestSources:
+    """Tests for each policy source on its own."""
+
+    def test_annotations(self):
+        """Only valid obf: annotations count."""
+        assert FunctionPolicy().annotations(POLICY_IR) == {"annotated": "max"}
+
+    def test_recorded(self):
+        assert FunctionPolicy().recorded(POLICY_IR) == {"annotated": "light", "recorded": "light"}
+
+    def test_function_string_attributes(self):
+        assert function_string_attributes(POLICY_IR, "obf-policy") == {"annotated": "light", "recorded": "light"}
+        assert function_string_attributes(POLICY_IR, "missing") == {}
+
+
+class TestResolve:
+    """Tests for FunctionPolicy.resolve precedence."""
+
+    def test_precedence(self, demangle):
+        """Annotation, then recorded attribute, then the first matching rule."""
+        policies = FunctionPolicy(RULES).resolve(POLICY_IR)
+        assert policies == {
+            "annotated": "max",    # annotation beats the recorded "light" and the "*" rule
+            "recorded": "light",   # recorded attribute beats the "*" rule
+            "bogus": "none",       # unknown annotation ignored, falls through to rules
+            "plain": "light",      # first rule wins over "*"
+            "_Z3fooi": "max",      # matched by its demangled name
+            "other": "none",
+        }
+
+    def test_no_rules(self):
+        policies = FunctionPolicy().resolve(POLICY_IR)
+        assert policies == {"annotated": "max", "recorded": "light"}
+
+    def test_summary(self, demangle):
+        policy = FunctionPolicy(RULES)
+        assert policy.summary(policy.resolve(POLICY_IR)) == {"none": 2, "light": 2, "max": 2}
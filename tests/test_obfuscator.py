@@ -0,0 +1,89 @@
+"""
+Unit tests for the core.obfuscator module.
+Tests reading the MLIR pass statistics and the IR scan used when a build
+of MLIR has none.
+"""
+
+import json
+from pathlib import Path
+
+import pytest
+
+from core.obfuscator import LLVMObfuscator
+
+
+# Exported IR with two indirect-call sites, one anti-debug site and one fake loop
+SITES_IR = '''\
+@__obfs_icall_table = internal global [2 x i64] [i64 1, i64 2], align 64
+@__obfs_ad_countdown = internal thread_local global i32 0
+@__obfs_fl_sink = internal global i32 0
+
+define i32 @main() {
+  %tls = call ptr @llvm.threadlocal.address.p0(ptr @__obfs_ad_countdown)
+  %a = getelementptr i64, ptr @__obfs_icall_table, i32 0
+  %b = getelementptr i64, ptr @__obfs_icall_table, i32 1
+  store volatile i32 7, ptr @__obfs_fl_sink, align 4
+  ret i32 0
+}
+'''
+
+
+@pytest.fixture
+def obfuscator() -> LLVMObfuscator:
+    return LLVMObfuscator()
+
+
+def write_statistics(path: Path, totals, **fields) -> Path:
+    path.write_text(json.dumps({**fields, "passes": {"fake-loops": totals}, "totals": totals}))
+    return path
+
+
+class TestStatistics:
+    """Tests for loading and parsing the MLIR pass statistics."""
+
+    def test_load_json(self, obfuscator, tmp_dir: Path):
+        path = write_statistics(tmp_dir / "stats.json", {"fake-loops-inserted": 3, "fake-loops-skipped-hot": 0},
+                                **{"statistics-enabled": True})
+        obfuscator._load_mlir_statistics_json(path)
+        assert obfuscator._mlir_statistics == {"fake-loops-inserted": 3, "fake-loops-skipped-hot": 0}
+        assert obfuscator._mlir_pass_statistics["fake-loops"]["fake-loops-inserted"] == 3
+        assert not path.exists()
+
+    def test_load_all_zero_json(self, obfuscator, tmp_dir: Path):
+        """A release build counts nothing: the zeros are dropped, not reported."""
+        path = write_statistics(tmp_dir / "stats.json", {"strings-encrypted": 0, "fake-loops-inserted": 0})
+        obfuscator._load_mlir_statistics_json(path)
+        assert obfuscator._mlir_statistics == {}
+        assert obfuscator._mlir_pass_statistics == {}
+
+    def test_load_json_statistics_disabled(self, obfuscator, tmp_dir: Path):
+        path = write_statistics(tmp_dir / "stats.json", {"strings-encrypted": 0}, **{"statistics-enabled": False})
+        obfuscator._load_mlir_statistics_json(path)
+        assert obfuscator._mlir_statistics == {}
+
+    def test_parse_all_zero(self, obfuscator):
+        stderr = "  (S) 0 strings-encrypted - Strings encrypted\n  (S) 0 bytes-encrypted - Bytes encrypted\n"
+        assert obfuscator._parse_mlir_statistics(stderr) == {}
+        stderr = stderr.replace("(S) 0 strings", "(S) 4 strings")
+        assert obfuscator._parse_mlir_statistics(stderr) == {"strings-encrypted": 4, "bytes-encrypted": 0}
+
+
+class TestSiteCounts:
+    """Tests for the IR scan behind _mlir_count."""
+
+    def test_count_sites(self, obfuscator, tmp_dir: Path):
+        ir_file = tmp_dir / "app.ll"
+        ir_file.write_text(SITES_IR)
+        assert obfuscator._count_mlir_sites(ir_file) == {
+            "icall-sites-converted": 2,
+            "anti-debug-sites": 1,
+            "fake-loops-inserted": 1,
+            "icall-table-entries": 2,
+        }
+
+    def test_statistics_first(self, obfuscator):
+        obfuscator._mlir_statistics = {"fake-loops-inserted": 5}
+        obfuscator._mlir_ir_counts = {"fake-loops-inserted": 1, "anti-debug-sites": 2}
+        assert obfuscator._mlir_count("fake-loops-inserted") == 5
+        assert obfuscator._mlir_count("anti-debug-sites") == 2
+        assert obfuscator._mlir_count("icall-sites-skipped-hot") == 0
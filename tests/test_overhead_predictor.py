@@ -0,0 +1,180 @@
+"""
+Unit tests for the core.overhead_predictor module.
+Tests parsing of opt's cost-model and block-frequency output, pairing of
+renamed functions and the per-function comparison.
+"""
+
+import shutil
+from pathlib import Path
+
+import pytest
+
+from core.overhead_predictor import BlockCost, FunctionCost, ModuleCosts, OverheadPredictor
+
+
+IR = '''\
+define i32 @f(i32 %a) {
+entry:
+  %c = icmp sgt i32 %a, 0
+  br i1 %c, label %pos, label %done
+
+pos:
+  %m = mul i32 %a, %a
+  br label %done
+
+done:
+  %r = phi i32 [ %m, %pos ], [ 0, %entry ]
+  ret i32 %r
+}
+'''
+
+# opt -passes=print<block-freq>,print<cost-model> from LLVM 14 (one cost kind)
+ANALYSIS_LLVM14 = '''\
+Printing analysis results of BFI for function 'f':
+block-frequency-info: f
+ - entry: float = 1.0, int = 12
+ - pos: float = 0.625, int = 8
+ - done: float = 1.0, int = 12
+
+Cost Model for function 'f'
+Cost Model: Found an estimated cost of 1 for instruction:   %c = icmp sgt i32 %a, 0
+Cost Model: Found an estimated cost of 1 for instruction:   br i1 %c, label %pos, label %done
+Cost Model: Found an estimated cost of 4 for instruction:   %m = mul i32 %a, %a
+Cost Model: Found an estimated cost of 1 for instruction:   br label %done
+Cost Model: Found an estimated cost of 0 for instruction:   %r = phi i32 [ %m, %pos ], [ 0, %entry ]
+Cost Model: Found an estimated cost of 1 for instruction:   ret i32 %r
+'''
+
+# The same with -cost-kind=all, LLVM 20 and later
+ANALYSIS_LLVM20 = '''\
+block-frequency-info: f
+ - entry: float = 1.0, int = 12
+ - pos: float = 0.625, int = 8
+ - done: float = 1.0, int = 12
+Printing analysis 'Cost Model Analysis' for function 'f':
+Cost Model: Found costs of RThru:1 CodeSize:1 Lat:1 SizeLat:1 for:   %c = icmp sgt i32 %a, 0
+Cost Model: Found costs of RThru:0 CodeSize:1 Lat:1 SizeLat:1 for:   br i1 %c, label %pos, label %done
+Cost Model: Found costs of RThru:1 CodeSize:1 Lat:3 SizeLat:1 for:   %m = mul i32 %a, %a
+Cost Model: Found costs of RThru:0 CodeSize:1 Lat:1 SizeLat:1 for:   br label %done
+Cost Model: Found costs of RThru:0 CodeSize:1 Lat:0 SizeLat:0 for:   %r = phi i32 [ %m, %pos ], [ 0, %entry ]
+Cost Model: Found costs of Invalid for:   ret i32 %r
+'''
+
+ASM = '''\
+f:                                      # @f
+\t.cfi_startproc
+# %bb.0:                                # %entry
+\ttestl\t%edi, %edi
+\tjle\t.LBB0_1
+# %bb.2:                                # %pos
+\tmovl\t%edi, %eax
+\timull\t%edi, %eax
+\tretq
+.LBB0_1:
+\txorl\t%eax, %eax
+\tretq
+.Lfunc_end0:
+'''
+
+
+def function(name: str, signature: str, *blocks) -> FunctionCost:
+    """FunctionCost from (frequency, throughput) pairs; latency equals throughput."""
+    cost = FunctionCost(name, signature)
+    for index, (frequency, throughput) in enumerate(blocks):
+        cost.blocks.append(BlockCost(f"b{index}", frequency, throughput, throughput))
+    return cost
+
+
+class TestParse:
+    """Tests for OverheadPredictor.parse."""
+
+    def test_llvm14_costs_weighted_by_frequency(self):
+        costs = OverheadPredictor().parse(IR, ANALYSIS_LLVM14)
+        f = costs["f"]
+        assert f.signature == "i32/1"
+        assert f.weighted
+        assert [(b.name, b.frequency, b.throughput) for b in f.blocks] == [
+            ("entry", 1.0, 2.0), ("pos", 0.625, 5.0), ("done", 1.0, 1.0)
+        ]
+        assert f.throughput == pytest.approx(2.0 + 0.625 * 5.0 + 1.0)
+        assert f.hottest_block.name == "pos"
+
+    def test_llvm20_throughput_and_latency(self):
+        f = OverheadPredictor().parse(IR, ANALYSIS_LLVM20)["f"]
+        assert [(b.throughput, b.latency) for b in f.blocks] == [(1.0, 2.0), (1.0, 4.0), (0.0, 0.0)]
+        assert f.latency == pytest.approx(2.0 + 0.625 * 4.0)
+
+    def test_unweighted_without_frequencies(self):
+        """Without matching BFI output every block counts once."""
+        analysis = ANALYSIS_LLVM14.split("\n\n", 1)[1]
+        f = OverheadPredictor().parse(IR, analysis)["f"]
+        assert not f.weighted
+        assert [b.frequency for b in f.blocks] == [1.0, 1.0, 1.0]
+        assert f.throughput == 8.0
+
+    def test_cost_values(self):
+        assert OverheadPredictor._cost_values("RThru:2 CodeSize:1 Lat:5 SizeLat:1") == (2.0, 5.0)
+        assert OverheadPredictor._cost_values("3") == (3.0, 3.0)
+        assert OverheadPredictor._cost_values("Invalid") == (0.0, 0.0)
+
+
+class TestPairAndCompare:
+    """Tests for pairing renamed functions and the comparison report."""
+
+    def test_pair_by_signature_order(self):
+        """Same names pair first; renamed ones pair in order where signatures agree."""
+        baseline = {
+            "main": function("main", "i32/0", (1.0, 4.0)),
+            "parse": function("parse", "i32/2", (1.0, 4.0)),
+            "emit": function("emit", "void/1", (1.0, 4.0)),
+        }
+        obfuscated = {
+            "main": function("main", "i32/0", (1.0, 4.0)),
+            "f_1a2b": function("f_1a2b", "i32/2", (1.0, 4.0)),
+            "__obfs_decrypt": function("__obfs_decrypt", "void/3", (1.0, 4.0)),
+            "f_3c4d": function("f_3c4d", "void/1", (1.0, 4.0)),
+        }
+        pairs, added, removed = OverheadPredictor.pair(baseline, obfuscated)
+        assert [(before.name, after.name) for before, after in pairs] == [
+            ("main", "main"), ("parse", "f_1a2b"), ("emit", "f_3c4d")
+        ]
+        assert added == ["__obfs_decrypt"]
+        assert removed == []
+
+    def test_compare_ranks_by_added_cost(self):
+        baseline = ModuleCosts({
+            "hot": function("hot", "i32/1", (1.0, 2.0), (100.0, 1.0)),
+            "cold": function("cold", "i32/2", (1.0, 10.0)),
+        })
+        obfuscated = ModuleCosts({
+            "hot": function("hot", "i32/1", (1.0, 2.0), (100.0, 3.0)),
+            "f_cold": function("f_cold", "i32/2", (1.0, 15.0)),
+        })
+        report = OverheadPredictor().compare(baseline, obfuscated)
+        assert report["functions_compared"] == 2
+        assert report["functions_slower"] == 2
+        hot, cold = report["functions"]
+        assert (hot["function"], hot["added_cost"], hot["throughput_overhead_percent"]) == ("hot", 200.0, 196.1)
+        assert hot["hottest_block"] == "b1"
+        assert (cold["function"], cold["obfuscated_name"], cold["added_cost"]) == ("cold", "f_cold", 5.0)
+        assert report["max_throughput_overhead_percent"] == 196.1
+
+    def test_asm_block(self):
+        """Instructions llc placed under the `# %pos` label."""
+        assert OverheadPredictor._asm_block(ASM, "f", "pos") == ["movl\t%edi, %eax", "imull\t%edi, %eax", "retq"]
+        assert OverheadPredictor._asm_block(ASM, "g", "pos") == []
+
+
+@pytest.mark.skipif(shutil.which("opt") is None, reason="opt not installed")
+class TestWithOpt:
+    """Runs the installed opt on a small module."""
+
+    def test_function_costs(self, tmp_dir: Path):
+        ir_file = tmp_dir / "f.ll"
+        ir_file.write_text(IR)
+        module = OverheadPredictor().function_costs(ir_file)
+        f = module.functions["f"]
+        assert f.weighted
+        assert [b.name for b in f.blocks] == ["entry", "pos", "done"]
+        assert f.blocks[1].frequency < 1.0
+        assert f.throughput > 0
@@ -0,0 +1,110 @@
+"""
+Unit tests for the core.profile_tiers module.
+Tests profile count extraction, tier classification and OLLVM annotations.
+"""
+
+from core.profile_tiers import ProfileTiers
+
+
+PROFILED_IR = '''\
+define i32 @main() !prof !0 {
+entry:
+  br i1 %c, label %a, label %b, !prof !3
+}
+
+define internal void @"helper.cold"() !prof !1 {
+entry:
+  ret void
+}
+
+define void @loop() !prof !2 {
+entry:
+  br i1 %c, label %body, label %exit, !prof !4
+}
+
+!0 = !{!"function_entry_count", i64 1}
+!1 = !{!"function_entry_count", i64 5}
+!2 = !{!"function_entry_count", i64 10}
+!3 = !{!"branch_weights", i32 60, i32 40}
+!4 = !{!"branch_weights", i32 900, i32 10}
+'''
+
+
+class TestFunctionCounts:
+    """Tests for ProfileTiers.function_counts."""
+
+    def test_peak_block_count(self):
+        """Entry count, raised to the hottest branch_weights sum in the body."""
+        counts = ProfileTiers().function_counts(PROFILED_IR)
+        assert counts == {"main": 100, "helper.cold": 5, "loop": 910}
+
+    def test_no_profile(self):
+        assert ProfileTiers().function_counts("define void @f() {\n  ret void\n}\n") == {}
+
+
+class TestClassify:
+    """Tests for ProfileTiers.classify."""
+
+    def test_tiers_by_cumulative_share(self):
+        """A function's tier is where its own counts start in the ranking."""
+        counts = {"a": 800, "b": 150, "c": 40, "d": 10, "e": 0}
+        tiers = ProfileTiers(hot_percent=90, warm_percent=99).classify(counts)
+        # a starts at 0%, b at 80%, c at 95%, d at 99%
+        assert tiers == {"a": "hot", "b": "hot", "c": "warm", "d": "cold", "e": "cold"}
+
+    def test_coverage(self):
+        counts = {"a": 800, "b": 150, "c": 50}
+        tiers = {"a": "hot", "b": "warm", "c": "cold"}
+        report = ProfileTiers().coverage(counts, tiers)
+        assert report["hot"] == {"functions": 1, "count_share_percent": 80.0}
+        assert report["warm"] == {"functions": 1, "count_share_percent": 15.0}
+        assert report["cold"] == {"functions": 1, "count_share_percent": 5.0}
+
+    def test_limits(self):
+        tiers = {"a": "hot", "b": "warm", "c": "cold"}
+        limits = ProfileTiers.limits(tiers, {"hot": "none", "warm": "cheap"})
+        assert limits == {"a": "none", "b": "cheap", "c": "full"}
+
+
+class TestAnnotateOllvm:
+    """Tests for ProfileTiers.annotate_ollvm."""
+
+    def test_limits_become_annotations(self):
+        """none rules out every pass, cheap keeps split, full adds nothing."""
+        ir_text, added = ProfileTiers().annotate_ollvm(
+            PROFILED_IR,
+            {"main": "none", "loop": "cheap", "helper.cold": "full"},
+            ["flattening", "split"],
+        )
+        assert added == 3
+        assert '@.obfs.tier.nofla = private unnamed_addr constant [6 x i8] c"nofla\\00"' in ir_text
+        assert "appending global [3 x { ptr, ptr, ptr, i32, ptr }]" in ir_text
+        assert "ptr @main, ptr @.obfs.tier.nofla" in ir_text
+        assert "ptr @main, ptr @.obfs.tier.nosplit" in ir_text
+        assert "ptr @loop, ptr @.obfs.tier.nofla" in ir_text
+        assert "ptr @loop, ptr @.obfs.tier.nosplit" not in ir_text
+
+    def test_budget_skips_and_quoting(self):
+        """Passes the size budget dropped are annotated too; odd names are quoted."""
+        ir_text, added = ProfileTiers().annotate_ollvm(
+            PROFILED_IR, {}, ["boguscf"], skips={"helper.cold": ["boguscf"], "operator new": ["boguscf"]}
+        )
+        assert added == 2
+        assert 'ptr @helper.cold, ptr @.obfs.tier.nobcf' in ir_text
+        assert 'ptr @"operator new", ptr @.obfs.tier.nobcf' in ir_text
+
+    def test_merges_existing_annotations(self):
+        existing = (
+            '@llvm.global.annotations = appending global [1 x { ptr, ptr, ptr, i32, ptr }] '
+            '[{ ptr, ptr, ptr, i32, ptr } { ptr @main, ptr @.str, ptr @.file, i32 3, ptr null }], '
+            'section "llvm.metadata"\n'
+        )
+        ir_text, added = ProfileTiers().annotate_ollvm(PROFILED_IR + existing, {"loop": "none"}, ["substitution"])
+        assert added == 1
+        assert ir_text.count("@llvm.global.annotations") == 1
+        assert "appending global [2 x { ptr, ptr, ptr, i32, ptr }]" in ir_text
+        assert "ptr @main, ptr @.str" in ir_text
+        assert "ptr @loop, ptr @.obfs.tier.nosub" in ir_text
+
+    def test_nothing_to_add(self):
+        assert ProfileTiers().annotate_ollvm(PROFILED_IR, {"main": "full"}, ["flattening"]) == (PROFILED_IR, 0)
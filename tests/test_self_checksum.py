@@ -0,0 +1,137 @@
+"""
+Unit tests for the core.self_checksum module.
+Tests the CRC32C implementation and sealing of the .obfs_crc table.
+"""
+
+import struct
+from pathlib import Path
+
+import pytest
+
+from core import self_checksum
+from core.self_checksum import SelfChecksumSealer, crc32c
+
+
+IMAGE_VADDR = 0x400000
+TEXT_OFFSET = 0x100
+TABLE_OFFSET = 0x1600
+STRTAB_OFFSET = 0x1700
+SHDR_OFFSET = 0x1800
+
+
+def build_elf(text: bytes, capacity: int, with_table: bool = True) -> bytes:
+    """Minimal ELF64: one PT_LOAD mapping the header, .text and .obfs_crc."""
+    names = b"\0.text\0.obfs_crc\0.shstrtab\0"
+    sections = [(0, 0, 0, 0, 0), (names.index(b".text"), 1, IMAGE_VADDR + TEXT_OFFSET, TEXT_OFFSET, len(text))]
+    if with_table:
+        table_size = SelfChecksumSealer.HEADER.size + capacity * SelfChecksumSealer.ENTRY.size
+        sections.append((names.index(b".obfs_crc"), 1, IMAGE_VADDR + TABLE_OFFSET, TABLE_OFFSET, table_size))
+    sections.append((names.index(b".shstrtab"), 3, 0, STRTAB_OFFSET, len(names)))
+
+    data = bytearray(SHDR_OFFSET + 64 * len(sections))
+    struct.pack_into(
+        "<16sHHIQQQIHHHHHH", data, 0,
+        b"\x7fELF\x02\x01\x01", 2, 62, 1, 0, 64, SHDR_OFFSET, 0, 64, 56, 1, 64, len(sections), len(sections) - 1,
+    )
+    struct.pack_into("<IIQQQQQQ", data, 64, 1, 5, 0, IMAGE_VADDR, IMAGE_VADDR, SHDR_OFFSET, SHDR_OFFSET, 0x1000)
+    data[TEXT_OFFSET:TEXT_OFFSET + len(text)] = text
+    if with_table:
+        SelfChecksumSealer.HEADER.pack_into(data, TABLE_OFFSET, SelfChecksumSealer.TABLE_MAGIC, capacity, 0, 0)
+    data[STRTAB_OFFSET:STRTAB_OFFSET + len(names)] = names
+    for index, (name, sh_type, addr, offset, size) in enumerate(sections):
+        struct.pack_into("<IIQQQQIIQQ", data, SHDR_OFFSET + 64 * index, name, sh_type, 2, addr, offset, size, 0, 0, 1, 0)
+    return bytes(data)
+
+
+def read_table(data: bytes):
+    _, capacity, count, image_vaddr = SelfChecksumSealer.HEADER.unpack_from(data, TABLE_OFFSET)
+    entries = [
+        SelfChecksumSealer.ENTRY.unpack_from(
+            data, TABLE_OFFSET + SelfChecksumSealer.HEADER.size + index * SelfChecksumSealer.ENTRY.size
+        )
+        for index in range(count)
+    ]
+    return image_vaddr, entries
+
+
+class TestCrc32c:
+    """Tests for the crc32c function."""
+
+    @pytest.fixture(params=["native", "table"])
+    def implementation(self, request, monkeypatch):
+        """Run each test against the optional native module and the fallback."""
+        if request.param == "native" and self_checksum._crc32c_native is None:
+            pytest.skip("crc32c module not installed")
+        if request.param == "table":
+            monkeypatch.setattr(self_checksum, "_crc32c_native", None)
+
+    def test_check_value(self, implementation):
+        """The standard CRC-32C check value (RFC 3720)."""
+        assert crc32c(b"123456789") == 0xE3069283
+
+    def test_empty(self, implementation):
+        assert crc32c(b"") == 0
+
+    def test_iscsi_vectors(self, implementation):
+        """32 bytes of zeros / ones, from RFC 3720 B.4."""
+        assert crc32c(bytes(32)) == 0x8A9136AA
+        assert crc32c(b"\xff" * 32) == 0x62A8AB43
+
+
+class TestSelfChecksumSealer:
+    """Tests for SelfChecksumSealer.seal."""
+
+    def test_seals_page_chunks(self, tmp_dir: Path):
+        """.text is split into page-sized chunks, each with its CRC."""
+        text = bytes(range(256)) * 20  # 5120 bytes: one full page and a tail
+        binary = tmp_dir / "sealed"
+        binary.write_bytes(build_elf(text, capacity=4))
+
+        report = SelfChecksumSealer().seal(binary)
+
+        assert report["status"] == "success"
+        assert report["chunks"] == 2
+        assert report["chunk_size"] == 4096
+        assert report["bytes_covered"] == len(text)
+        image_vaddr, entries = read_table(binary.read_bytes())
+        assert image_vaddr == IMAGE_VADDR
+        assert entries == [
+            (IMAGE_VADDR + TEXT_OFFSET, 4096, crc32c(text[:4096])),
+            (IMAGE_VADDR + TEXT_OFFSET + 4096, 1024, crc32c(text[4096:])),
+        ]
+
+    def test_chunks_grow_to_fit_table(self, tmp_dir: Path):
+        """A table with room for one entry gets one power-of-two chunk."""
+        text = b"\x90" * 5120
+        binary = tmp_dir / "sealed"
+        binary.write_bytes(build_elf(text, capacity=1))
+
+        report = SelfChecksumSealer().seal(binary)
+
+        assert report["chunk_size"] == 8192
+        _, entries = read_table(binary.read_bytes())
+        assert entries == [(IMAGE_VADDR + TEXT_OFFSET, len(text), crc32c(text))]
+
+    def test_missing_table_skipped(self, tmp_dir: Path):
+        binary = tmp_dir / "plain"
+        original = build_elf(b"\xc3" * 16, capacity=0, with_table=False)
+        binary.write_bytes(original)
+
+        report = SelfChecksumSealer().seal(binary)
+
+        assert report["status"] == "skipped"
+        assert binary.read_bytes() == original
+
+    def test_bad_magic_fails(self, tmp_dir: Path):
+        data = bytearray(build_elf(b"\xc3" * 16, capacity=2))
+        data[TABLE_OFFSET:TABLE_OFFSET + 8] = b"NOTATABL"
+        binary = tmp_dir / "corrupt"
+        binary.write_bytes(bytes(data))
+
+        assert SelfChecksumSealer().seal(binary)["status"] == "failed"
+
+    def test_non_elf_skipped(self, tmp_dir: Path):
+        binary = tmp_dir / "script"
+        binary.write_bytes(b"#!/bin/sh\nexit 0\n")
+
+        assert SelfChecksumSealer().seal(binary)["status"] == "skipped"
@@ -0,0 +1,133 @@
+"""
+Unit tests for the core.size_budget module.
+Tests IR measurement, the budget plan on a fixed cost table and plan files.
+"""
+
+from pathlib import Path
+
+import pytest
+
+from core.config import Architecture
+from core.exceptions import ObfuscationError
+from core.size_budget import SizeBudgetPlanner, SizePlan
+
+
+BUDGET_IR = '''\
+@.str = private unnamed_addr constant [6 x i8] c"hello\\00", align 1
+
+define i32 @f(i32 %a, i32 %b) {
+  %1 = add i32 %a, %b
+  %2 = sub i32 %1, %b
+  %3 = xor i32 %2, %a
+  %4 = and i32 %3, 255
+  %5 = mul i32 %4, %4
+  %6 = mul i32 %5, %a
+  %7 = mul i32 %6, %b
+  ret i32 %7
+}
+
+define i32 @g(i32 %a) {
+  %1 = add i32 %a, 1
+  br label %next
+next:
+  %2 = mul i32 %1, 3
+  br label %done
+done:
+  ret i32 %2
+}
+'''
+
+
+@pytest.fixture
+def planner():
+    """Planner with every IR instruction costing one byte."""
+    planner = SizeBudgetPlanner(Architecture.X86_64)
+    planner.cost = {"default": 1.0}
+    return planner
+
+
+def plan(planner, growth_percent):
+    return planner.plan(
+        BUDGET_IR,
+        growth_percent,
+        mlir_transforms=["string-encrypt", "fake-loops", "address-obfuscation"],
+        ollvm_passes=["flattening", "substitution"],
+    )
+
+
+class TestMeasure:
+    """Tests for SizeBudgetPlanner.measure and the cost model."""
+
+    def test_instruction_classes(self):
+        sizes = SizeBudgetPlanner().measure(BUDGET_IR)
+        assert (sizes["f"].instructions, sizes["f"].blocks, sizes["f"].arithmetic, sizes["f"].bitwise) == (8, 1, 4, 2)
+        assert (sizes["g"].instructions, sizes["g"].blocks, sizes["g"].arithmetic) == (5, 3, 1)
+        assert sizes["g"].opcodes == {"add": 1, "br": 2, "mul": 1, "ret": 1}
+
+    def test_function_bytes(self):
+        """Seven default-cost instructions and a ret on x86-64."""
+        planner = SizeBudgetPlanner(Architecture.X86_64)
+        assert planner.function_bytes(planner.measure(BUDGET_IR)["f"]) == pytest.approx(7 * 3.2 + 1.0)
+
+    def test_growth(self, planner):
+        f = planner.measure(BUDGET_IR)["f"]
+        assert planner.growth_bytes("substitution", f) == 12.0  # 3 per add/sub/and/or/xor
+        assert planner.growth_bytes("flattening", f) == 14.0    # 10 + 4 per block
+
+
+class TestPlan:
+    """Tests for SizeBudgetPlanner.plan on the fixed cost table."""
+
+    def test_best_ratio_first(self, planner):
+        """
+        Budget 26 bytes: g/substitution (3) and f/flattening (14) fit; the
+        next best, g/flattening (22), and everything after it do not.
+        """
+        result = plan(planner, 200)
+        assert (result.baseline_bytes, result.budget_bytes, result.growth_bytes) == (13, 26, 17)
+        assert result.module == []
+        assert result.dropped == ["string-encrypt"]
+        assert result.functions["f"] == {"limit": "none", "ollvm": ["flattening"], "bytes": 8, "growth_bytes": 14}
+        assert result.functions["g"] == {"limit": "none", "ollvm": ["substitution"], "bytes": 5, "growth_bytes": 3}
+
+    def test_full_needs_cheap(self, planner):
+        """
+        Budget 65 bytes: f's full limit (2 bytes, best ratio) is only taken
+        once its cheap limit was picked, on the second round.
+        """
+        result = plan(planner, 500)
+        assert result.growth_bytes == 65
+        assert result.functions["f"]["limit"] == "full"
+        assert result.functions["f"]["ollvm"] == ["flattening", "substitution"]
+        assert result.functions["g"]["limit"] == "none"
+        assert result.functions["g"]["ollvm"] == ["flattening", "substitution"]
+        assert result.summary() == {"none": 1, "cheap": 0, "full": 1}
+
+    def test_unlimited(self, planner):
+        result = plan(planner, 10000)
+        assert result.module == ["string-encrypt"]
+        assert {entry["limit"] for entry in result.functions.values()} == {"full"}
+
+    def test_deterministic(self, planner):
+        assert plan(planner, 200).to_dict() == plan(planner, 200).to_dict()
+
+
+class TestSizePlan:
+    """Tests for SizePlan files and OLLVM skips."""
+
+    def test_round_trip(self, planner, tmp_dir: Path):
+        path = tmp_dir / "plan.json"
+        original = plan(planner, 200)
+        original.save(path)
+        assert SizePlan.load(path).to_dict() == original.to_dict()
+
+    def test_unsupported_version(self, tmp_dir: Path):
+        path = tmp_dir / "plan.json"
+        path.write_text('{"version": 99}')
+        with pytest.raises(ObfuscationError, match="Unsupported size plan version"):
+            SizePlan.load(path)
+
+    def test_ollvm_skips(self, planner):
+        """Passes not planned for a function are skipped; unplanned functions skip all."""
+        skips = plan(planner, 200).ollvm_skips(["flattening", "substitution"], ["f", "g", "new"])
+        assert skips == {"f": ["substitution"], "g": ["flattening"], "new": ["flattening", "substitution"]}
@@ -31,6 +31,7 @@ from core.utils import (
     make_executable,
     create_logger,
     read_text,
+    run_pipeline,
 )
 from core.exceptions import ObfuscationError
 
@@ -71,6 +72,27 @@ class TestToolExists:
         assert tool_exists("definitely_nonexistent_tool_xyz123") is False
 
 
+class TestRunPipeline:
+    """Tests for run_pipeline function."""
+
+    def test_output_of_last_command(self):
+        """stdout flows through the pipe; stderr is the last command's."""
+        _, stdout, stderr = run_pipeline([
+            ["python3", "-c", "print('b'); print('a')"],
+            ["python3", "-c", "import sys; print(''.join(sorted(sys.stdin)), end=''); print('done', file=sys.stderr)"],
+        ])
+        assert stdout == "a\nb\n"
+        assert stderr == "done\n"
+
+    def test_failing_stage_raises(self):
+        """A failure anywhere in the pipe is reported."""
+        with pytest.raises(ObfuscationError, match="exit code 3"):
+            run_pipeline([
+                ["python3", "-c", "import sys; sys.exit(3)"],
+                ["python3", "-c", "import sys; sys.stdin.read()"],
+            ])
+
+
 class TestGetTimestamp:
     """Tests for get_timestamp function."""
 